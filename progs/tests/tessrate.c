@@ -0,0 +1,184 @@
+/*
+ * Measure GLU tessellator throughput, in input vertices per second.
+ *
+ * The test polygon is a long, noisy outline (like a coastline or a
+ * county border from a GIS data set) with a number of small holes.
+ * The same tessellator object is used for all repetitions, as an
+ * application drawing many polygons would do.
+ *
+ * Usage: tessrate [vertices [holes [reps]]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <GL/glu.h>
+
+#ifndef CALLBACK
+#define CALLBACK
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static GLint NumVerts = 100000;
+static GLint NumHoles = 16;
+static GLint NumReps = 5;
+
+static GLdouble (*Coords)[3];
+static GLuint NumTriVerts, NumCombined;
+
+
+static void CALLBACK
+Vertex(void *data)
+{
+   (void) data;
+   NumTriVerts++;
+}
+
+
+/* Having an edge flag callback makes the tessellator emit GL_TRIANGLES */
+static void CALLBACK
+EdgeFlag(GLboolean flag)
+{
+   (void) flag;
+}
+
+
+static void CALLBACK
+Combine(GLdouble coords[3], void *data[4], GLfloat weight[4], void **out)
+{
+   (void) coords;
+   (void) weight;
+   NumCombined++;
+   *out = data[0];
+}
+
+
+static void CALLBACK
+Error(GLenum err)
+{
+   fprintf(stderr, "tessellation error: %s\n", (char *) gluErrorString(err));
+}
+
+
+/**
+ * Outer contour: a star-shaped outline whose radius wiggles at many
+ * frequencies.  Holes: small circles on a ring well inside of it.
+ */
+static void
+MakePolygon(void)
+{
+   GLint holeVerts = NumHoles ? 64 : 0;
+   GLint outerVerts = NumVerts - NumHoles * holeVerts;
+   /* keep the jitter below the vertex spacing, so that the number of
+    * edges crossing the sweep line stays reasonable
+    */
+   GLdouble noise = 0.5 * M_PI / outerVerts;
+   GLint i, h, n = 0;
+
+   Coords = (GLdouble (*)[3]) malloc(NumVerts * sizeof(Coords[0]));
+   srand(42);
+
+   for (i = 0; i < outerVerts; i++) {
+      GLdouble a = 2.0 * M_PI * i / outerVerts;
+      GLdouble r = 1.0 + 0.2 * sin(7.0 * a) + 0.1 * sin(131.0 * a)
+                 + noise * (rand() % 1000) / 1000.0;
+      Coords[n][0] = r * cos(a);
+      Coords[n][1] = r * sin(a);
+      Coords[n][2] = 0.0;
+      n++;
+   }
+
+   for (h = 0; h < NumHoles; h++) {
+      GLdouble ha = 2.0 * M_PI * h / NumHoles;
+      GLdouble hr = M_PI * 0.35 / NumHoles;
+      for (i = 0; i < holeVerts; i++) {
+         /* clockwise */
+         GLdouble a = -2.0 * M_PI * i / holeVerts;
+         Coords[n][0] = 0.35 * cos(ha) + hr * 0.8 * cos(a);
+         Coords[n][1] = 0.35 * sin(ha) + hr * 0.8 * sin(a);
+         Coords[n][2] = 0.0;
+         n++;
+      }
+   }
+}
+
+
+static void
+TessPolygon(GLUtesselator *tess)
+{
+   GLint holeVerts = NumHoles ? 64 : 0;
+   GLint outerVerts = NumVerts - NumHoles * holeVerts;
+   GLint i, h, n = 0;
+
+   gluTessBeginPolygon(tess, NULL);
+
+   gluTessBeginContour(tess);
+   for (i = 0; i < outerVerts; i++, n++)
+      gluTessVertex(tess, Coords[n], Coords[n]);
+   gluTessEndContour(tess);
+
+   for (h = 0; h < NumHoles; h++) {
+      gluTessBeginContour(tess);
+      for (i = 0; i < holeVerts; i++, n++)
+         gluTessVertex(tess, Coords[n], Coords[n]);
+      gluTessEndContour(tess);
+   }
+
+   gluTessEndPolygon(tess);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   GLUtesselator *tess;
+   GLint rep;
+   double best = 0.0;
+
+   if (argc > 1)
+      NumVerts = atoi(argv[1]);
+   if (argc > 2)
+      NumHoles = atoi(argv[2]);
+   if (argc > 3)
+      NumReps = atoi(argv[3]);
+   if (NumHoles < 0 || NumVerts < NumHoles * 64 + 3) {
+      fprintf(stderr, "need at least 3 outline vertices besides the holes\n");
+      return 1;
+   }
+
+   MakePolygon();
+
+   tess = gluNewTess();
+   gluTessCallback(tess, GLU_TESS_VERTEX, (void (CALLBACK *)()) Vertex);
+   gluTessCallback(tess, GLU_TESS_EDGE_FLAG, (void (CALLBACK *)()) EdgeFlag);
+   gluTessCallback(tess, GLU_TESS_COMBINE, (void (CALLBACK *)()) Combine);
+   gluTessCallback(tess, GLU_TESS_ERROR, (void (CALLBACK *)()) Error);
+   gluTessNormal(tess, 0.0, 0.0, 1.0);
+
+   for (rep = 0; rep < NumReps; rep++) {
+      clock_t t0, t1;
+      double secs, rate;
+
+      NumTriVerts = NumCombined = 0;
+      t0 = clock();
+      TessPolygon(tess);
+      t1 = clock();
+
+      secs = (double) (t1 - t0) / CLOCKS_PER_SEC;
+      rate = secs > 0.0 ? NumVerts / secs : 0.0;
+      if (rate > best)
+         best = rate;
+      printf("%d vertices, %d holes: %u triangles, %u intersections, "
+             "%.3f s, %.0f vertices/sec\n",
+             NumVerts, NumHoles, NumTriVerts / 3, NumCombined, secs, rate);
+   }
+   printf("best: %.0f vertices/sec\n", best);
+
+   gluDeleteTess(tess);
+   free(Coords);
+   return 0;
+}
@@ -42,13 +42,15 @@
 #ifndef __dict_list_h_
 #define __dict_list_h_
 
+#include "memalloc.h"
+
 /* Use #define's so that another heap implementation can use this one */
 
 #define DictKey		DictListKey
 #define Dict		DictList
 #define DictNode	DictListNode
 
-#define dictNewDict(frame,leq)		__gl_dictListNewDict(frame,leq)
+#define dictNewDict(frame,leq,pool)	__gl_dictListNewDict(frame,leq,pool)
 #define dictDeleteDict(dict)		__gl_dictListDeleteDict(dict)
 
 #define dictSearch(dict,key)		__gl_dictListSearch(dict,key)
@@ -68,9 +70,13 @@ typedef void *DictKey;
 typedef struct Dict Dict;
 typedef struct DictNode DictNode;
 
+/* Nodes are allocated from the given pool, which may be shared with
+ * other dictionaries.
+ */
 Dict		*dictNewDict(
 			void *frame,
-			int (*leq)(void *frame, DictKey key1, DictKey key2) );
+			int (*leq)(void *frame, DictKey key1, DictKey key2),
+			MemPool *pool );
 			
 void		dictDeleteDict( Dict *dict );
 
@@ -102,6 +108,7 @@ struct Dict {
   DictNode	head;
   void		*frame;
   int		(*leq)(void *frame, DictKey key1, DictKey key2);
+  MemPool	*pool;
 };
 
 #endif
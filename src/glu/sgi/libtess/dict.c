@@ -45,7 +45,8 @@
 
 /* really __gl_dictListNewDict */
 Dict *dictNewDict( void *frame,
-		   int (*leq)(void *frame, DictKey key1, DictKey key2) )
+		   int (*leq)(void *frame, DictKey key1, DictKey key2),
+		   MemPool *pool )
 {
   Dict *dict = (Dict *) memAlloc( sizeof( Dict ));
   DictNode *head;
@@ -60,6 +61,7 @@ Dict *dictNewDict( void *frame,
 
   dict->frame = frame;
   dict->leq = leq;
+  dict->pool = pool;
 
   return dict;
 }
@@ -71,7 +73,7 @@ void dictDeleteDict( Dict *dict )
 
   for( node = dict->head.next; node != &dict->head; node = next ) {
     next = node->next;
-    memFree( node );
+    poolFree( dict->pool, node );
   }
   memFree( dict );
 }
@@ -85,7 +87,7 @@ DictNode *dictInsertBefore( Dict *dict, DictNode *node, DictKey key )
     node = node->prev;
   } while( node->key != NULL && ! (*dict->leq)(dict->frame, node->key, key));
 
-  newNode = (DictNode *) memAlloc( sizeof( DictNode ));
+  newNode = (DictNode *) poolAlloc( dict->pool );
   if (newNode == NULL) return NULL;
 
   newNode->key = key;
@@ -98,11 +100,11 @@ DictNode *dictInsertBefore( Dict *dict, DictNode *node, DictKey key )
 }
 
 /* really __gl_dictListDelete */
-void dictDelete( Dict *dict, DictNode *node ) /*ARGSUSED*/
+void dictDelete( Dict *dict, DictNode *node )
 {
   node->next->prev = node->prev;
   node->prev->next = node->next;
-  memFree( node );
+  poolFree( dict->pool, node );
 }
 
 /* really __gl_dictListSearch */
@@ -60,3 +60,128 @@ void *__gl_memAlloc( size_t n )
 }
 #endif
 
+
+
+/* Blocks start out small, so that tessellating a handful of vertices
+ * stays cheap, and double in size up to POOL_MAX_GROW objects.
+ */
+#define POOL_MIN_GROW	32
+#define POOL_MAX_GROW	4096
+
+struct MemBlock {
+  MemBlock	*next;
+  size_t	count;		/* number of objects in this block */
+};
+
+/* The strictest alignment needed by the objects we pool */
+typedef union { double d; long l; void *p; } MemAlign;
+
+#define ALIGN_UP(n)	(((n) + sizeof(MemAlign) - 1) / sizeof(MemAlign) \
+			 * sizeof(MemAlign))
+#define BLOCK_HEADER	ALIGN_UP(sizeof(MemBlock))
+
+void __gl_poolInit( MemPool *pool, size_t size )
+{
+  pool->size = ALIGN_UP( size );
+  pool->grow = POOL_MIN_GROW;
+  pool->next = pool->end = NULL;
+  pool->freeList = NULL;
+  pool->blocks = NULL;
+  pool->spare = NULL;
+}
+
+static int NewBlock( MemPool *pool )
+{
+  MemBlock *block = pool->spare;
+
+  if( block != NULL ) {
+    pool->spare = block->next;
+  } else {
+    block = (MemBlock *)memAlloc( BLOCK_HEADER + pool->grow * pool->size );
+    if (block == NULL) return 0;
+    block->count = pool->grow;
+    if( pool->grow < POOL_MAX_GROW ) pool->grow *= 2;
+  }
+  block->next = pool->blocks;
+  pool->blocks = block;
+  pool->next = (char *)block + BLOCK_HEADER;
+  pool->end = pool->next + block->count * pool->size;
+  return 1;
+}
+
+void *__gl_poolAlloc( MemPool *pool )
+{
+  void *p = pool->freeList;
+
+  if( p != NULL ) {
+    pool->freeList = *(void **)p;
+  } else {
+    if( pool->next == pool->end && ! NewBlock( pool )) return NULL;
+    p = pool->next;
+    pool->next += pool->size;
+  }
+#ifdef MEMORY_DEBUG
+  memset( p, 0xa5, pool->size );
+#endif
+  return p;
+}
+
+void __gl_poolFree( MemPool *pool, void *p )
+{
+  *(void **)p = pool->freeList;
+  pool->freeList = p;
+}
+
+/* __gl_poolReset( pool ) frees all objects of the pool at once.  The
+ * blocks are kept and handed out again before any new ones are allocated.
+ */
+void __gl_poolReset( MemPool *pool )
+{
+  MemBlock *block = pool->blocks;
+
+  if( block != NULL ) {
+    while( block->next != NULL ) block = block->next;
+    block->next = pool->spare;
+    pool->spare = pool->blocks;
+    pool->blocks = NULL;
+  }
+  pool->next = pool->end = NULL;
+  pool->freeList = NULL;
+}
+
+/* __gl_poolAbsorb( pool, other ) makes "pool" the owner of all objects
+ * allocated from "other", which is left empty.  The free objects of
+ * "other" are not recycled until the next reset.
+ */
+void __gl_poolAbsorb( MemPool *pool, MemPool *other )
+{
+  MemBlock *block;
+
+  if( other->blocks != NULL ) {
+    for( block = other->blocks; block->next != NULL; block = block->next ) ;
+    block->next = pool->blocks;
+    pool->blocks = other->blocks;
+  }
+  if( other->spare != NULL ) {
+    for( block = other->spare; block->next != NULL; block = block->next ) ;
+    block->next = pool->spare;
+    pool->spare = other->spare;
+  }
+  if( other->grow > pool->grow ) pool->grow = other->grow;
+  __gl_poolInit( other, other->size );
+}
+
+void __gl_poolDeinit( MemPool *pool )
+{
+  MemBlock *block, *next;
+
+  for( block = pool->blocks; block != NULL; block = next ) {
+    next = block->next;
+    memFree( block );
+  }
+  for( block = pool->spare; block != NULL; block = next ) {
+    next = block->next;
+    memFree( block );
+  }
+  __gl_poolInit( pool, pool->size );
+}
@@ -58,4 +58,38 @@ extern int		__gl_memInit( size_t );
 extern void *		__gl_memAlloc( size_t );
 #endif
 
+
+/* Fixed-size object pools.  The mesh and sweep structures are small,
+ * all of one size, and created and destroyed in large numbers, so they
+ * are carved out of big blocks instead of being malloc'ed one by one.
+ * Objects handed back with poolFree are recycled by later allocations;
+ * poolReset frees every object of a pool at once but keeps the blocks,
+ * so that the next polygon does not have to go back to malloc either.
+ */
+typedef struct MemBlock MemBlock;
+
+typedef struct MemPool {
+  size_t	size;		/* object size, rounded up for alignment */
+  size_t	grow;		/* number of objects in the next new block */
+  char		*next;		/* first unused object in the current block */
+  char		*end;		/* end of the current block */
+  void		*freeList;	/* objects returned by poolFree */
+  MemBlock	*blocks;	/* blocks handed out since the last reset */
+  MemBlock	*spare;		/* blocks kept by poolReset for reuse */
+} MemPool;
+
+#define poolInit	__gl_poolInit
+#define poolAlloc	__gl_poolAlloc
+#define poolFree	__gl_poolFree
+#define poolReset	__gl_poolReset
+#define poolAbsorb	__gl_poolAbsorb
+#define poolDeinit	__gl_poolDeinit
+
+extern void		__gl_poolInit( MemPool *pool, size_t size );
+extern void *		__gl_poolAlloc( MemPool *pool );
+extern void		__gl_poolFree( MemPool *pool, void *p );
+extern void		__gl_poolReset( MemPool *pool );
+extern void		__gl_poolAbsorb( MemPool *pool, MemPool *other );
+extern void		__gl_poolDeinit( MemPool *pool );
+
 #endif
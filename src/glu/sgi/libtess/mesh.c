@@ -48,14 +48,14 @@
 #define TRUE 1
 #define FALSE 0
 
-static GLUvertex *allocVertex()
+static GLUvertex *allocVertex( GLUmesh *mesh )
 {
-   return (GLUvertex *)memAlloc( sizeof( GLUvertex ));
+   return (GLUvertex *)poolAlloc( &mesh->vertexPool );
 }
 
-static GLUface *allocFace()
+static GLUface *allocFace( GLUmesh *mesh )
 {
-   return (GLUface *)memAlloc( sizeof( GLUface ));
+   return (GLUface *)poolAlloc( &mesh->facePool );
 }
 
 /************************ Utility Routines ************************/
@@ -69,12 +69,12 @@ typedef struct { GLUhalfEdge e, eSym; } EdgePair;
  * No vertex or face structures are allocated, but these must be assigned
  * before the current edge operation is completed.
  */
-static GLUhalfEdge *MakeEdge( GLUhalfEdge *eNext )
+static GLUhalfEdge *MakeEdge( GLUmesh *mesh, GLUhalfEdge *eNext )
 {
   GLUhalfEdge *e;
   GLUhalfEdge *eSym;
   GLUhalfEdge *ePrev;
-  EdgePair *pair = (EdgePair *)memAlloc( sizeof( EdgePair ));
+  EdgePair *pair = (EdgePair *)poolAlloc( &mesh->edgePool );
   if (pair == NULL) return NULL;
 
   e = &pair->e;
@@ -204,7 +204,7 @@ static void MakeFace( GLUface *newFace, GLUhalfEdge *eOrig, GLUface *fNext )
 /* KillEdge( eDel ) destroys an edge (the half-edges eDel and eDel->Sym),
  * and removes from the global edge list.
  */
-static void KillEdge( GLUhalfEdge *eDel )
+static void KillEdge( GLUmesh *mesh, GLUhalfEdge *eDel )
 {
   GLUhalfEdge *ePrev, *eNext;
 
@@ -217,14 +217,14 @@ static void KillEdge( GLUhalfEdge *eDel )
   eNext->Sym->next = ePrev;
   ePrev->Sym->next = eNext;
 
-  memFree( eDel );
+  poolFree( &mesh->edgePool, eDel );
 }
 
 
 /* KillVertex( vDel ) destroys a vertex and removes it from the global
  * vertex list.  It updates the vertex loop to point to a given new vertex.
  */
-static void KillVertex( GLUvertex *vDel, GLUvertex *newOrg )
+static void KillVertex( GLUmesh *mesh, GLUvertex *vDel, GLUvertex *newOrg )
 {
   GLUhalfEdge *e, *eStart = vDel->anEdge;
   GLUvertex *vPrev, *vNext;
@@ -242,13 +242,13 @@ static void KillVertex( GLUvertex *vDel, GLUvertex *newOrg )
   vNext->prev = vPrev;
   vPrev->next = vNext;
 
-  memFree( vDel );
+  poolFree( &mesh->vertexPool, vDel );
 }
 
 /* KillFace( fDel ) destroys a face and removes it from the global face
  * list.  It updates the face loop to point to a given new face.
  */
-static void KillFace( GLUface *fDel, GLUface *newLface )
+static void KillFace( GLUmesh *mesh, GLUface *fDel, GLUface *newLface )
 {
   GLUhalfEdge *e, *eStart = fDel->anEdge;
   GLUface *fPrev, *fNext;
@@ -266,7 +266,7 @@ static void KillFace( GLUface *fDel, GLUface *newLface )
   fNext->prev = fPrev;
   fPrev->next = fNext;
 
-  memFree( fDel );
+  poolFree( &mesh->facePool, fDel );
 }
 
 
@@ -277,20 +277,20 @@ static void KillFace( GLUface *fDel, GLUface *newLface )
  */
 GLUhalfEdge *__gl_meshMakeEdge( GLUmesh *mesh )
 {
-  GLUvertex *newVertex1= allocVertex();
-  GLUvertex *newVertex2= allocVertex();
-  GLUface *newFace= allocFace();
+  GLUvertex *newVertex1= allocVertex( mesh );
+  GLUvertex *newVertex2= allocVertex( mesh );
+  GLUface *newFace= allocFace( mesh );
   GLUhalfEdge *e;
 
   /* if any one is null then all get freed */
   if (newVertex1 == NULL || newVertex2 == NULL || newFace == NULL) {
-     if (newVertex1 != NULL) memFree(newVertex1);
-     if (newVertex2 != NULL) memFree(newVertex2);
-     if (newFace != NULL) memFree(newFace);     
+     if (newVertex1 != NULL) poolFree( &mesh->vertexPool, newVertex1 );
+     if (newVertex2 != NULL) poolFree( &mesh->vertexPool, newVertex2 );
+     if (newFace != NULL) poolFree( &mesh->facePool, newFace );
      return NULL;
   } 
 
-  e = MakeEdge( &mesh->eHead );
+  e = MakeEdge( mesh, &mesh->eHead );
   if (e == NULL) return NULL;
 
   MakeVertex( newVertex1, e, &mesh->vHead );
@@ -300,7 +300,7 @@ GLUhalfEdge *__gl_meshMakeEdge( GLUmesh *mesh )
 }
   
 
-/* __gl_meshSplice( eOrg, eDst ) is the basic operation for changing the
+/* __gl_meshSplice( mesh, eOrg, eDst ) is the basic operation for changing the
  * mesh connectivity and topology.  It changes the mesh so that
  *	eOrg->Onext <- OLD( eDst->Onext )
  *	eDst->Onext <- OLD( eOrg->Onext )
@@ -323,7 +323,7 @@ GLUhalfEdge *__gl_meshMakeEdge( GLUmesh *mesh )
  * If eDst == eOrg->Onext, the new vertex will have a single edge.
  * If eDst == eOrg->Oprev, the old vertex will have a single edge.
  */
-int __gl_meshSplice( GLUhalfEdge *eOrg, GLUhalfEdge *eDst )
+int __gl_meshSplice( GLUmesh *mesh, GLUhalfEdge *eOrg, GLUhalfEdge *eDst )
 {
   int joiningLoops = FALSE;
   int joiningVertices = FALSE;
@@ -333,19 +333,19 @@ int __gl_meshSplice( GLUhalfEdge *eOrg, GLUhalfEdge *eDst )
   if( eDst->Org != eOrg->Org ) {
     /* We are merging two disjoint vertices -- destroy eDst->Org */
     joiningVertices = TRUE;
-    KillVertex( eDst->Org, eOrg->Org );
+    KillVertex( mesh, eDst->Org, eOrg->Org );
   }
   if( eDst->Lface != eOrg->Lface ) {
     /* We are connecting two disjoint loops -- destroy eDst->Lface */
     joiningLoops = TRUE;
-    KillFace( eDst->Lface, eOrg->Lface );
+    KillFace( mesh, eDst->Lface, eOrg->Lface );
   }
 
   /* Change the edge structure */
   Splice( eDst, eOrg );
 
   if( ! joiningVertices ) {
-    GLUvertex *newVertex= allocVertex();
+    GLUvertex *newVertex= allocVertex( mesh );
     if (newVertex == NULL) return 0;
 
     /* We split one vertex into two -- the new vertex is eDst->Org.
@@ -355,7 +355,7 @@ int __gl_meshSplice( GLUhalfEdge *eOrg, GLUhalfEdge *eDst )
     eOrg->Org->anEdge = eOrg;
   }
   if( ! joiningLoops ) {
-    GLUface *newFace= allocFace();  
+    GLUface *newFace= allocFace( mesh );
     if (newFace == NULL) return 0;
 
     /* We split one loop into two -- the new loop is eDst->Lface.
@@ -369,17 +369,17 @@ int __gl_meshSplice( GLUhalfEdge *eOrg, GLUhalfEdge *eDst )
 }
 
 
-/* __gl_meshDelete( eDel ) removes the edge eDel.  There are several cases:
+/* __gl_meshDelete( mesh, eDel ) removes the edge eDel.  There are several cases:
  * if (eDel->Lface != eDel->Rface), we join two loops into one; the loop
  * eDel->Lface is deleted.  Otherwise, we are splitting one loop into two;
  * the newly created loop will contain eDel->Dst.  If the deletion of eDel
  * would create isolated vertices, those are deleted as well.
  *
  * This function could be implemented as two calls to __gl_meshSplice
- * plus a few calls to memFree, but this would allocate and delete
+ * plus a few calls to poolFree, but this would allocate and delete
  * unnecessary vertices and faces.
  */
-int __gl_meshDelete( GLUhalfEdge *eDel )
+int __gl_meshDelete( GLUmesh *mesh, GLUhalfEdge *eDel )
 {
   GLUhalfEdge *eDelSym = eDel->Sym;
   int joiningLoops = FALSE;
@@ -390,11 +390,11 @@ int __gl_meshDelete( GLUhalfEdge *eDel )
   if( eDel->Lface != eDel->Rface ) {
     /* We are joining two loops into one -- remove the left face */
     joiningLoops = TRUE;
-    KillFace( eDel->Lface, eDel->Rface );
+    KillFace( mesh, eDel->Lface, eDel->Rface );
   }
 
   if( eDel->Onext == eDel ) {
-    KillVertex( eDel->Org, NULL );
+    KillVertex( mesh, eDel->Org, NULL );
   } else {
     /* Make sure that eDel->Org and eDel->Rface point to valid half-edges */
     eDel->Rface->anEdge = eDel->Oprev;
@@ -402,7 +402,7 @@ int __gl_meshDelete( GLUhalfEdge *eDel )
 
     Splice( eDel, eDel->Oprev );
     if( ! joiningLoops ) {
-      GLUface *newFace= allocFace();
+      GLUface *newFace= allocFace( mesh );
       if (newFace == NULL) return 0; 
 
       /* We are splitting one loop into two -- create a new loop for eDel. */
@@ -414,8 +414,8 @@ int __gl_meshDelete( GLUhalfEdge *eDel )
    * may have been deleted.  Now we disconnect eDel->Dst.
    */
   if( eDelSym->Onext == eDelSym ) {
-    KillVertex( eDelSym->Org, NULL );
-    KillFace( eDelSym->Lface, NULL );
+    KillVertex( mesh, eDelSym->Org, NULL );
+    KillFace( mesh, eDelSym->Lface, NULL );
   } else {
     /* Make sure that eDel->Dst and eDel->Lface point to valid half-edges */
     eDel->Lface->anEdge = eDelSym->Oprev;
@@ -424,7 +424,7 @@ int __gl_meshDelete( GLUhalfEdge *eDel )
   }
 
   /* Any isolated vertices or faces have already been freed. */
-  KillEdge( eDel );
+  KillEdge( mesh, eDel );
 
   return 1;
 }
@@ -437,14 +437,14 @@ int __gl_meshDelete( GLUhalfEdge *eDel )
  */
 
 
-/* __gl_meshAddEdgeVertex( eOrg ) creates a new edge eNew such that
+/* __gl_meshAddEdgeVertex( mesh, eOrg ) creates a new edge eNew such that
  * eNew == eOrg->Lnext, and eNew->Dst is a newly created vertex.
  * eOrg and eNew will have the same left face.
  */
-GLUhalfEdge *__gl_meshAddEdgeVertex( GLUhalfEdge *eOrg )
+GLUhalfEdge *__gl_meshAddEdgeVertex( GLUmesh *mesh, GLUhalfEdge *eOrg )
 {
   GLUhalfEdge *eNewSym;
-  GLUhalfEdge *eNew = MakeEdge( eOrg );
+  GLUhalfEdge *eNew = MakeEdge( mesh, eOrg );
   if (eNew == NULL) return NULL;
 
   eNewSym = eNew->Sym;
@@ -455,7 +455,7 @@ GLUhalfEdge *__gl_meshAddEdgeVertex( GLUhalfEdge *eOrg )
   /* Set the vertex and face information */
   eNew->Org = eOrg->Dst;
   {
-    GLUvertex *newVertex= allocVertex();
+    GLUvertex *newVertex= allocVertex( mesh );
     if (newVertex == NULL) return NULL;
 
     MakeVertex( newVertex, eNewSym, eNew->Org );
@@ -466,14 +466,14 @@ GLUhalfEdge *__gl_meshAddEdgeVertex( GLUhalfEdge *eOrg )
 }
 
 
-/* __gl_meshSplitEdge( eOrg ) splits eOrg into two edges eOrg and eNew,
+/* __gl_meshSplitEdge( mesh, eOrg ) splits eOrg into two edges eOrg and eNew,
  * such that eNew == eOrg->Lnext.  The new vertex is eOrg->Dst == eNew->Org.
  * eOrg and eNew will have the same left face.
  */
-GLUhalfEdge *__gl_meshSplitEdge( GLUhalfEdge *eOrg )
+GLUhalfEdge *__gl_meshSplitEdge( GLUmesh *mesh, GLUhalfEdge *eOrg )
 {
   GLUhalfEdge *eNew;
-  GLUhalfEdge *tempHalfEdge= __gl_meshAddEdgeVertex( eOrg );
+  GLUhalfEdge *tempHalfEdge= __gl_meshAddEdgeVertex( mesh, eOrg );
   if (tempHalfEdge == NULL) return NULL;
 
   eNew = tempHalfEdge->Sym;
@@ -493,7 +493,7 @@ GLUhalfEdge *__gl_meshSplitEdge( GLUhalfEdge *eOrg )
 }
 
 
-/* __gl_meshConnect( eOrg, eDst ) creates a new edge from eOrg->Dst
+/* __gl_meshConnect( mesh, eOrg, eDst ) creates a new edge from eOrg->Dst
  * to eDst->Org, and returns the corresponding half-edge eNew.
  * If eOrg->Lface == eDst->Lface, this splits one loop into two,
  * and the newly created loop is eNew->Lface.  Otherwise, two disjoint
@@ -503,11 +503,12 @@ GLUhalfEdge *__gl_meshSplitEdge( GLUhalfEdge *eOrg )
  * If (eOrg->Lnext == eDst), the old face is reduced to a single edge.
  * If (eOrg->Lnext->Lnext == eDst), the old face is reduced to two edges.
  */
-GLUhalfEdge *__gl_meshConnect( GLUhalfEdge *eOrg, GLUhalfEdge *eDst )
+GLUhalfEdge *__gl_meshConnect( GLUmesh *mesh, GLUhalfEdge *eOrg,
+			       GLUhalfEdge *eDst )
 {
   GLUhalfEdge *eNewSym;
   int joiningLoops = FALSE;  
-  GLUhalfEdge *eNew = MakeEdge( eOrg );
+  GLUhalfEdge *eNew = MakeEdge( mesh, eOrg );
   if (eNew == NULL) return NULL;
 
   eNewSym = eNew->Sym;
@@ -515,7 +516,7 @@ GLUhalfEdge *__gl_meshConnect( GLUhalfEdge *eOrg, GLUhalfEdge *eDst )
   if( eDst->Lface != eOrg->Lface ) {
     /* We are connecting two disjoint loops -- destroy eDst->Lface */
     joiningLoops = TRUE;
-    KillFace( eDst->Lface, eOrg->Lface );
+    KillFace( mesh, eDst->Lface, eOrg->Lface );
   }
 
   /* Connect the new edge appropriately */
@@ -531,7 +532,7 @@ GLUhalfEdge *__gl_meshConnect( GLUhalfEdge *eOrg, GLUhalfEdge *eDst )
   eOrg->Lface->anEdge = eNewSym;
 
   if( ! joiningLoops ) {
-    GLUface *newFace= allocFace();
+    GLUface *newFace= allocFace( mesh );
     if (newFace == NULL) return NULL;
 
     /* We split one loop into two -- the new loop is eNew->Lface */
@@ -543,14 +544,14 @@ GLUhalfEdge *__gl_meshConnect( GLUhalfEdge *eOrg, GLUhalfEdge *eDst )
 
 /******************** Other Operations **********************/
 
-/* __gl_meshZapFace( fZap ) destroys a face and removes it from the
+/* __gl_meshZapFace( mesh, fZap ) destroys a face and removes it from the
  * global face list.  All edges of fZap will have a NULL pointer as their
  * left face.  Any edges which also have a NULL pointer as their right face
  * are deleted entirely (along with any isolated vertices this produces).
  * An entire mesh can be deleted by zapping its faces, one at a time,
  * in any order.  Zapped faces cannot be used in further mesh operations!
  */
-void __gl_meshZapFace( GLUface *fZap )
+void __gl_meshZapFace( GLUmesh *mesh, GLUface *fZap )
 {
   GLUhalfEdge *eStart = fZap->anEdge;
   GLUhalfEdge *e, *eNext, *eSym;
@@ -567,7 +568,7 @@ void __gl_meshZapFace( GLUface *fZap )
       /* delete the edge -- see __gl_MeshDelete above */
 
       if( e->Onext == e ) {
-	KillVertex( e->Org, NULL );
+	KillVertex( mesh, e->Org, NULL );
       } else {
 	/* Make sure that e->Org points to a valid half-edge */
 	e->Org->anEdge = e->Onext;
@@ -575,13 +576,13 @@ void __gl_meshZapFace( GLUface *fZap )
       }
       eSym = e->Sym;
       if( eSym->Onext == eSym ) {
-	KillVertex( eSym->Org, NULL );
+	KillVertex( mesh, eSym->Org, NULL );
       } else {
 	/* Make sure that eSym->Org points to a valid half-edge */
 	eSym->Org->anEdge = eSym->Onext;
 	Splice( eSym, eSym->Oprev );
       }
-      KillEdge( e );
+      KillEdge( mesh, e );
     }
   } while( e != eStart );
 
@@ -591,28 +592,18 @@ void __gl_meshZapFace( GLUface *fZap )
   fNext->prev = fPrev;
   fPrev->next = fNext;
 
-  memFree( fZap );
+  poolFree( &mesh->facePool, fZap );
 }
 
 
-/* __gl_meshNewMesh() creates a new mesh with no edges, no vertices,
- * and no loops (what we usually call a "face").
+/* InitHeads( mesh ) sets up the dummy list headers of an empty mesh.
  */
-GLUmesh *__gl_meshNewMesh( void )
+static void InitHeads( GLUmesh *mesh )
 {
-  GLUvertex *v;
-  GLUface *f;
-  GLUhalfEdge *e;
-  GLUhalfEdge *eSym;
-  GLUmesh *mesh = (GLUmesh *)memAlloc( sizeof( GLUmesh ));
-  if (mesh == NULL) {
-     return NULL;
-  }
-  
-  v = &mesh->vHead;
-  f = &mesh->fHead;
-  e = &mesh->eHead;
-  eSym = &mesh->eHeadSym;
+  GLUvertex *v = &mesh->vHead;
+  GLUface *f = &mesh->fHead;
+  GLUhalfEdge *e = &mesh->eHead;
+  GLUhalfEdge *eSym = &mesh->eHeadSym;
 
   v->next = v->prev = v;
   v->anEdge = NULL;
@@ -642,6 +633,23 @@ GLUmesh *__gl_meshNewMesh( void )
   eSym->Lface = NULL;
   eSym->winding = 0;
   eSym->activeRegion = NULL;
+}
+
+
+/* __gl_meshNewMesh() creates a new mesh with no edges, no vertices,
+ * and no loops (what we usually call a "face").
+ */
+GLUmesh *__gl_meshNewMesh( void )
+{
+  GLUmesh *mesh = (GLUmesh *)memAlloc( sizeof( GLUmesh ));
+  if (mesh == NULL) {
+     return NULL;
+  }
+
+  InitHeads( mesh );
+  poolInit( &mesh->vertexPool, sizeof( GLUvertex ));
+  poolInit( &mesh->facePool, sizeof( GLUface ));
+  poolInit( &mesh->edgePool, sizeof( EdgePair ));
 
   return mesh;
 }
@@ -681,58 +689,38 @@ GLUmesh *__gl_meshUnion( GLUmesh *mesh1, GLUmesh *mesh2 )
     e1->Sym->next = e2->Sym->next;
   }
 
+  /* The storage of mesh2 now belongs to mesh1 as well */
+  poolAbsorb( &mesh1->vertexPool, &mesh2->vertexPool );
+  poolAbsorb( &mesh1->facePool, &mesh2->facePool );
+  poolAbsorb( &mesh1->edgePool, &mesh2->edgePool );
+
   memFree( mesh2 );
   return mesh1;
 }
 
 
-#ifdef DELETE_BY_ZAPPING
-
-/* __gl_meshDeleteMesh( mesh ) will free all storage for any valid mesh.
+/* __gl_meshEmptyMesh( mesh ) frees all vertices, faces and edges of
+ * a mesh in one shot.  The storage is kept for the next contours.
  */
-void __gl_meshDeleteMesh( GLUmesh *mesh )
+void __gl_meshEmptyMesh( GLUmesh *mesh )
 {
-  GLUface *fHead = &mesh->fHead;
-
-  while( fHead->next != fHead ) {
-    __gl_meshZapFace( fHead->next );
-  }
-  assert( mesh->vHead.next == &mesh->vHead );
-
-  memFree( mesh );
+  InitHeads( mesh );
+  poolReset( &mesh->vertexPool );
+  poolReset( &mesh->facePool );
+  poolReset( &mesh->edgePool );
 }
 
-#else
 
 /* __gl_meshDeleteMesh( mesh ) will free all storage for any valid mesh.
  */
 void __gl_meshDeleteMesh( GLUmesh *mesh )
 {
-  GLUface *f, *fNext;
-  GLUvertex *v, *vNext;
-  GLUhalfEdge *e, *eNext;
-
-  for( f = mesh->fHead.next; f != &mesh->fHead; f = fNext ) {
-    fNext = f->next;
-    memFree( f );
-  }
-
-  for( v = mesh->vHead.next; v != &mesh->vHead; v = vNext ) {
-    vNext = v->next;
-    memFree( v );
-  }
-
-  for( e = mesh->eHead.next; e != &mesh->eHead; e = eNext ) {
-    /* One call frees both e and e->Sym (see EdgePair above) */
-    eNext = e->next;
-    memFree( e );
-  }
-
+  poolDeinit( &mesh->vertexPool );
+  poolDeinit( &mesh->facePool );
+  poolDeinit( &mesh->edgePool );
   memFree( mesh );
 }
 
-#endif
-
 #ifndef NDEBUG
 
 /* __gl_meshCheckMesh( mesh ) checks a mesh for self-consistency.
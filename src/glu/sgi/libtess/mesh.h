@@ -43,6 +43,7 @@
 #define __mesh_h_
 
 #include <GL/glu.h>
+#include "memalloc.h"
 
 typedef struct GLUmesh GLUmesh; 
 
@@ -172,6 +173,10 @@ struct GLUmesh {
   GLUface	fHead;		/* dummy header for face list */
   GLUhalfEdge	eHead;		/* dummy header for edge list */
   GLUhalfEdge	eHeadSym;	/* and its symmetric counterpart */
+
+  MemPool	vertexPool;	/* storage for vertices, */
+  MemPool	facePool;	/* faces, */
+  MemPool	edgePool;	/* and pairs of half-edges */
 };
 
 /* The mesh operations below have three motivations: completeness,
@@ -188,12 +193,15 @@ struct GLUmesh {
  * Other internal data (v->data, v->activeRegion, f->data, f->marked,
  * f->trail, e->winding) is set to zero.
  *
+ * Vertices, faces and edges are allocated from pools owned by the mesh,
+ * which is why every operation takes the mesh it works on.
+ *
  * ********************** Basic Edge Operations **************************
  *
  * __gl_meshMakeEdge( mesh ) creates one edge, two vertices, and a loop.
  * The loop (face) consists of the two new half-edges.
  *
- * __gl_meshSplice( eOrg, eDst ) is the basic operation for changing the
+ * __gl_meshSplice( mesh, eOrg, eDst ) is the basic operation for changing the
  * mesh connectivity and topology.  It changes the mesh so that
  *	eOrg->Onext <- OLD( eDst->Onext )
  *	eDst->Onext <- OLD( eOrg->Onext )
@@ -209,7 +217,7 @@ struct GLUmesh {
  *  - if eOrg->Lface != eDst->Lface, two distinct loops are joined into one
  * In both cases, eDst->Lface is changed and eOrg->Lface is unaffected.
  *
- * __gl_meshDelete( eDel ) removes the edge eDel.  There are several cases:
+ * __gl_meshDelete( mesh, eDel ) removes the edge eDel.  There are several cases:
  * if (eDel->Lface != eDel->Rface), we join two loops into one; the loop
  * eDel->Lface is deleted.  Otherwise, we are splitting one loop into two;
  * the newly created loop will contain eDel->Dst.  If the deletion of eDel
@@ -217,15 +225,15 @@ struct GLUmesh {
  *
  * ********************** Other Edge Operations **************************
  *
- * __gl_meshAddEdgeVertex( eOrg ) creates a new edge eNew such that
+ * __gl_meshAddEdgeVertex( mesh, eOrg ) creates a new edge eNew such that
  * eNew == eOrg->Lnext, and eNew->Dst is a newly created vertex.
  * eOrg and eNew will have the same left face.
  *
- * __gl_meshSplitEdge( eOrg ) splits eOrg into two edges eOrg and eNew,
+ * __gl_meshSplitEdge( mesh, eOrg ) splits eOrg into two edges eOrg and eNew,
  * such that eNew == eOrg->Lnext.  The new vertex is eOrg->Dst == eNew->Org.
  * eOrg and eNew will have the same left face.
  *
- * __gl_meshConnect( eOrg, eDst ) creates a new edge from eOrg->Dst
+ * __gl_meshConnect( mesh, eOrg, eDst ) creates a new edge from eOrg->Dst
  * to eDst->Org, and returns the corresponding half-edge eNew.
  * If eOrg->Lface == eDst->Lface, this splits one loop into two,
  * and the newly created loop is eNew->Lface.  Otherwise, two disjoint
@@ -239,9 +247,12 @@ struct GLUmesh {
  * __gl_meshUnion( mesh1, mesh2 ) forms the union of all structures in
  * both meshes, and returns the new mesh (the old meshes are destroyed).
  *
+ * __gl_meshEmptyMesh( mesh ) frees all vertices, faces and edges of
+ * a mesh in one shot, keeping their storage for reuse.
+ *
  * __gl_meshDeleteMesh( mesh ) will free all storage for any valid mesh.
  *
- * __gl_meshZapFace( fZap ) destroys a face and removes it from the
+ * __gl_meshZapFace( mesh, fZap ) destroys a face and removes it from the
  * global face list.  All edges of fZap will have a NULL pointer as their
  * left face.  Any edges which also have a NULL pointer as their right face
  * are deleted entirely (along with any isolated vertices this produces).
@@ -252,17 +263,20 @@ struct GLUmesh {
  */
 
 GLUhalfEdge	*__gl_meshMakeEdge( GLUmesh *mesh );
-int		__gl_meshSplice( GLUhalfEdge *eOrg, GLUhalfEdge *eDst );
-int		__gl_meshDelete( GLUhalfEdge *eDel );
+int		__gl_meshSplice( GLUmesh *mesh, GLUhalfEdge *eOrg,
+				 GLUhalfEdge *eDst );
+int		__gl_meshDelete( GLUmesh *mesh, GLUhalfEdge *eDel );
 
-GLUhalfEdge	*__gl_meshAddEdgeVertex( GLUhalfEdge *eOrg );
-GLUhalfEdge	*__gl_meshSplitEdge( GLUhalfEdge *eOrg );
-GLUhalfEdge	*__gl_meshConnect( GLUhalfEdge *eOrg, GLUhalfEdge *eDst );
+GLUhalfEdge	*__gl_meshAddEdgeVertex( GLUmesh *mesh, GLUhalfEdge *eOrg );
+GLUhalfEdge	*__gl_meshSplitEdge( GLUmesh *mesh, GLUhalfEdge *eOrg );
+GLUhalfEdge	*__gl_meshConnect( GLUmesh *mesh, GLUhalfEdge *eOrg,
+				   GLUhalfEdge *eDst );
 
 GLUmesh		*__gl_meshNewMesh( void );
 GLUmesh		*__gl_meshUnion( GLUmesh *mesh1, GLUmesh *mesh2 );
+void		__gl_meshEmptyMesh( GLUmesh *mesh );
 void		__gl_meshDeleteMesh( GLUmesh *mesh );
-void		__gl_meshZapFace( GLUface *fZap );
+void		__gl_meshZapFace( GLUmesh *mesh, GLUface *fZap );
 
 #ifdef NDEBUG
 #define		__gl_meshCheckMesh( mesh )
@@ -135,15 +135,48 @@ gluNewTess( void )
 
   tess->polygonData= NULL;
 
+  tess->spareMesh = NULL;
+  poolInit( &tess->regionPool, sizeof( ActiveRegion ));
+  poolInit( &tess->nodePool, sizeof( DictNode ));
+
   return tess;
 }
 
+/* NewMesh( tess ) returns an empty mesh, reusing the storage of the
+ * previous polygon when there is one.
+ */
+static GLUmesh *NewMesh( GLUtesselator *tess )
+{
+  GLUmesh *mesh = tess->spareMesh;
+
+  if( mesh != NULL ) {
+    tess->spareMesh = NULL;
+    return mesh;
+  }
+  return __gl_meshNewMesh();
+}
+
+/* ReleaseMesh( tess, mesh ) frees everything a polygon has allocated
+ * in one shot.  The mesh storage is kept for the next polygon.
+ */
+static void ReleaseMesh( GLUtesselator *tess, GLUmesh *mesh )
+{
+  if( tess->spareMesh == NULL ) {
+    __gl_meshEmptyMesh( mesh );
+    tess->spareMesh = mesh;
+  } else {
+    __gl_meshDeleteMesh( mesh );
+  }
+  poolReset( &tess->regionPool );
+  poolReset( &tess->nodePool );
+}
+
 static void MakeDormant( GLUtesselator *tess )
 {
   /* Return the tessellator to its original dormant state. */
 
   if( tess->mesh != NULL ) {
-    __gl_meshDeleteMesh( tess->mesh );
+    ReleaseMesh( tess, tess->mesh );
   }
   tess->state = T_DORMANT;
   tess->lastEdge = NULL;
@@ -194,6 +227,11 @@ void GLAPIENTRY
 gluDeleteTess( GLUtesselator *tess )
 {
   RequireState( tess, T_DORMANT );
+  if( tess->spareMesh != NULL ) {
+    __gl_meshDeleteMesh( tess->spareMesh );
+  }
+  poolDeinit( &tess->regionPool );
+  poolDeinit( &tess->nodePool );
   memFree( tess );
 }
 
@@ -353,12 +391,12 @@ static int AddVertex( GLUtesselator *tess, GLdouble coords[3], void *data )
 
     e = __gl_meshMakeEdge( tess->mesh );
     if (e == NULL) return 0;
-    if ( !__gl_meshSplice( e, e->Sym ) ) return 0;
+    if ( !__gl_meshSplice( tess->mesh, e, e->Sym ) ) return 0;
   } else {
     /* Create a new vertex and edge which immediately follow e
      * in the ordering around the left face.
      */
-    if (__gl_meshSplitEdge( e ) == NULL) return 0;
+    if (__gl_meshSplitEdge( tess->mesh, e ) == NULL) return 0;
     e = e->Lnext;
   }
 
@@ -399,7 +437,7 @@ static int EmptyCache( GLUtesselator *tess )
   CachedVertex *v = tess->cache;
   CachedVertex *vLast;
 
-  tess->mesh = __gl_meshNewMesh();
+  tess->mesh = NewMesh( tess );
   if (tess->mesh == NULL) return 0;
 
   for( vLast = v + tess->cacheCount; v < vLast; ++v ) {
@@ -505,6 +543,10 @@ gluTessEndPolygon( GLUtesselator *tess )
   if (setjmp(tess->env) != 0) { 
      /* come back here if out of memory */
      CALL_ERROR_OR_ERROR_DATA( GLU_OUT_OF_MEMORY );
+     if( tess->mesh != NULL ) {
+       ReleaseMesh( tess, tess->mesh );
+       tess->mesh = NULL;
+     }
      return;
   }
 
@@ -582,12 +624,14 @@ gluTessEndPolygon( GLUtesselator *tess )
        */
       __gl_meshDiscardExterior( mesh );
       (*tess->callMesh)( mesh );		/* user wants the mesh itself */
+      poolReset( &tess->regionPool );
+      poolReset( &tess->nodePool );
       tess->mesh = NULL;
       tess->polygonData= NULL;
       return;
     }
   }
-  __gl_meshDeleteMesh( mesh );
+  ReleaseMesh( tess, mesh );
   tess->polygonData= NULL;
   tess->mesh = NULL;
 }
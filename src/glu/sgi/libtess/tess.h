@@ -127,6 +127,13 @@ struct GLUtesselator {
 
   jmp_buf env;			/* place to jump to when memAllocs fail */
 
+  /*** storage kept from one polygon to the next ***/
+
+  GLUmesh	*spareMesh;	/* emptied mesh, kept for its vertex, face
+				   and edge storage */
+  MemPool	regionPool;	/* active regions of the sweep line */
+  MemPool	nodePool;	/* nodes of the edge dictionary */
+
   void *polygonData;		/* client data for current polygon */
 };
 
@@ -49,7 +49,7 @@
 #define AddWinding(eDst,eSrc)	(eDst->winding += eSrc->winding, \
 				 eDst->Sym->winding += eSrc->Sym->winding)
 
-/* __gl_meshTessellateMonoRegion( face ) tessellates a monotone region
+/* __gl_meshTessellateMonoRegion( mesh, face ) tessellates a monotone region
  * (what else would it do??)  The region must consist of a single
  * loop of half-edges (see mesh.h) oriented CCW.  "Monotone" in this
  * case means that any vertical line intersects the interior of the
@@ -76,7 +76,7 @@
  * to the fan is a simple orientation test.  By making the fan as large
  * as possible, we restore the invariant (check it yourself).
  */
-int __gl_meshTessellateMonoRegion( GLUface *face )
+int __gl_meshTessellateMonoRegion( GLUmesh *mesh, GLUface *face )
 {
   GLUhalfEdge *up, *lo;
 
@@ -102,7 +102,7 @@ int __gl_meshTessellateMonoRegion( GLUface *face )
        */
       while( lo->Lnext != up && (EdgeGoesLeft( lo->Lnext )
 	     || EdgeSign( lo->Org, lo->Dst, lo->Lnext->Dst ) <= 0 )) {
-	GLUhalfEdge *tempHalfEdge= __gl_meshConnect( lo->Lnext, lo );
+	GLUhalfEdge *tempHalfEdge= __gl_meshConnect( mesh, lo->Lnext, lo );
 	if (tempHalfEdge == NULL) return 0;
 	lo = tempHalfEdge->Sym;
       }
@@ -111,7 +111,7 @@ int __gl_meshTessellateMonoRegion( GLUface *face )
       /* lo->Org is on the left.  We can make CCW triangles from up->Dst. */
       while( lo->Lnext != up && (EdgeGoesRight( up->Lprev )
 	     || EdgeSign( up->Dst, up->Org, up->Lprev->Org ) >= 0 )) {
-	GLUhalfEdge *tempHalfEdge= __gl_meshConnect( up, up->Lprev );
+	GLUhalfEdge *tempHalfEdge= __gl_meshConnect( mesh, up, up->Lprev );
 	if (tempHalfEdge == NULL) return 0;
 	up = tempHalfEdge->Sym;
       }
@@ -124,7 +124,7 @@ int __gl_meshTessellateMonoRegion( GLUface *face )
    */
   assert( lo->Lnext != up );
   while( lo->Lnext->Lnext != up ) {
-    GLUhalfEdge *tempHalfEdge= __gl_meshConnect( lo->Lnext, lo );
+    GLUhalfEdge *tempHalfEdge= __gl_meshConnect( mesh, lo->Lnext, lo );
     if (tempHalfEdge == NULL) return 0;
     lo = tempHalfEdge->Sym;
   }
@@ -146,7 +146,7 @@ int __gl_meshTessellateInterior( GLUmesh *mesh )
     /* Make sure we don''t try to tessellate the new triangles. */
     next = f->next;
     if( f->inside ) {
-      if ( !__gl_meshTessellateMonoRegion( f ) ) return 0;
+      if ( !__gl_meshTessellateMonoRegion( mesh, f ) ) return 0;
     }
   }
 
@@ -168,7 +168,7 @@ void __gl_meshDiscardExterior( GLUmesh *mesh )
     /* Since f will be destroyed, save its next pointer. */
     next = f->next;
     if( ! f->inside ) {
-      __gl_meshZapFace( f );
+      __gl_meshZapFace( mesh, f );
     }
   }
 }
@@ -200,7 +200,7 @@ int __gl_meshSetWindingNumber( GLUmesh *mesh, int value,
       if( ! keepOnlyBoundary ) {
 	e->winding = 0;
       } else {
-	if ( !__gl_meshDelete( e ) ) return 0;
+	if ( !__gl_meshDelete( mesh, e ) ) return 0;
       }
     }
   }
@@ -342,6 +342,433 @@ static int nearestPower(GLuint value)
         ((GLuint)((const GLubyte*)(s))[2])<<16 | \
         ((GLuint)((const GLubyte*)(s))[1])<<8  | ((const GLubyte*)(s))[0])
 
+/*
+** Fast paths for unsigned bytes and shorts.  When the components of a
+** group are tightly packed and no byte swapping is needed, whole rows are
+** halved at a time, with SSE2 when the compiler allows it; this gives the
+** same results as the generic code.  Rescaling uses an integer box filter
+** instead of float math.
+*/
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+/*
+** Add adjacent pairs of groups of 16 bit components.  The sums for the
+** two (4 components), four (2) or eight (1) groups in 's' are returned in
+** the low half of the result.
+*/
+static __m128i pair_sums_epi16(__m128i s, GLint components)
+{
+    /* move the even groups to the low half, the odd ones to the high half */
+    if (components == 1) {
+	s = _mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 1, 2, 0));
+	s = _mm_shufflehi_epi16(s, _MM_SHUFFLE(3, 1, 2, 0));
+	s = _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 1, 2, 0));
+    } else if (components == 2) {
+	s = _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 1, 2, 0));
+    }
+    return _mm_add_epi16(s, _mm_srli_si128(s, 8));
+}
+
+/*
+** Halve a row of groups of 1, 2 or 4 unsigned bytes, 16 output bytes at
+** a time.  Returns the number of output components done.
+*/
+static GLint halve_row_ubyte_sse2(GLint components, const GLubyte *rowA,
+				  const GLubyte *rowB, GLint n, GLubyte *dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+    GLint i;
+
+    n = n / 16 * 16;
+    for (i = 0; i < n; i += 16) {
+	const __m128i a0 = _mm_loadu_si128((const __m128i *)(rowA + 2*i));
+	const __m128i a1 = _mm_loadu_si128((const __m128i *)(rowA + 2*i + 16));
+	const __m128i b0 = _mm_loadu_si128((const __m128i *)(rowB + 2*i));
+	const __m128i b1 = _mm_loadu_si128((const __m128i *)(rowB + 2*i + 16));
+	__m128i s0, s1, s2, s3, lo, hi;
+
+	/* sum the two rows with 16 bit components */
+	s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero),
+			   _mm_unpacklo_epi8(b0, zero));
+	s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero),
+			   _mm_unpackhi_epi8(b0, zero));
+	s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero),
+			   _mm_unpacklo_epi8(b1, zero));
+	s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero),
+			   _mm_unpackhi_epi8(b1, zero));
+
+	/* then adjacent groups, and round */
+	lo = _mm_unpacklo_epi64(pair_sums_epi16(s0, components),
+				pair_sums_epi16(s1, components));
+	hi = _mm_unpacklo_epi64(pair_sums_epi16(s2, components),
+				pair_sums_epi16(s3, components));
+	lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+	hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+
+	_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    return n;
+}
+
+/*
+** Add adjacent pairs of groups of 32 bit components, for 1 or 2
+** components.  The sums are returned in the low half of the result.
+*/
+static __m128i pair_sums_epi32(__m128i s, GLint components)
+{
+    if (components == 1) {
+	s = _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 1, 2, 0));
+    }
+    return _mm_add_epi32(s, _mm_srli_si128(s, 8));
+}
+
+/*
+** Halve a row of groups of 1, 2 or 4 unsigned shorts, 8 output shorts at
+** a time.  Returns the number of output components done.
+*/
+static GLint halve_row_ushort_sse2(GLint components, const GLushort *rowA,
+				   const GLushort *rowB, GLint n,
+				   GLushort *dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi32(2);
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16((short) 0x8000);
+    GLint i;
+
+    n = n / 8 * 8;
+    for (i = 0; i < n; i += 8) {
+	const __m128i a0 = _mm_loadu_si128((const __m128i *)(rowA + 2*i));
+	const __m128i a1 = _mm_loadu_si128((const __m128i *)(rowA + 2*i + 8));
+	const __m128i b0 = _mm_loadu_si128((const __m128i *)(rowB + 2*i));
+	const __m128i b1 = _mm_loadu_si128((const __m128i *)(rowB + 2*i + 8));
+	__m128i s0, s1, s2, s3, lo, hi;
+
+	/* sum the two rows with 32 bit components */
+	s0 = _mm_add_epi32(_mm_unpacklo_epi16(a0, zero),
+			   _mm_unpacklo_epi16(b0, zero));
+	s1 = _mm_add_epi32(_mm_unpackhi_epi16(a0, zero),
+			   _mm_unpackhi_epi16(b0, zero));
+	s2 = _mm_add_epi32(_mm_unpacklo_epi16(a1, zero),
+			   _mm_unpacklo_epi16(b1, zero));
+	s3 = _mm_add_epi32(_mm_unpackhi_epi16(a1, zero),
+			   _mm_unpackhi_epi16(b1, zero));
+
+	/* then adjacent groups; a group of 4 fills a whole register */
+	if (components == 4) {
+	    lo = _mm_add_epi32(s0, s1);
+	    hi = _mm_add_epi32(s2, s3);
+	} else {
+	    lo = _mm_unpacklo_epi64(pair_sums_epi32(s0, components),
+				    pair_sums_epi32(s1, components));
+	    hi = _mm_unpacklo_epi64(pair_sums_epi32(s2, components),
+				    pair_sums_epi32(s3, components));
+	}
+	lo = _mm_srli_epi32(_mm_add_epi32(lo, two), 2);
+	hi = _mm_srli_epi32(_mm_add_epi32(hi, two), 2);
+
+	/* SSE2 only packs to signed shorts, so pack with a bias */
+	lo = _mm_packs_epi32(_mm_sub_epi32(lo, bias32),
+			     _mm_sub_epi32(hi, bias32));
+	_mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(lo, bias16));
+    }
+    return n;
+}
+
+#endif /* __SSE2__ */
+
+/*
+** Halve a row pair of tightly packed unsigned bytes into newwidth groups.
+*/
+static void halve_row_ubyte(GLint components, GLint newwidth,
+			    const GLubyte *rowA, const GLubyte *rowB,
+			    GLubyte *dst)
+{
+    const GLint n = newwidth * components;
+    GLint i = 0, k;
+
+#if defined(__SSE2__)
+    if (components != 3) {
+	i = halve_row_ubyte_sse2(components, rowA, rowB, n, dst);
+    }
+#endif
+    rowA += 2*i;
+    rowB += 2*i;
+    for (; i < n; i += components) {
+	for (k = 0; k < components; k++) {
+	    dst[i+k] = (rowA[k] + rowA[k+components] +
+			rowB[k] + rowB[k+components] + 2) >> 2;
+	}
+	rowA += 2*components;
+	rowB += 2*components;
+    }
+}
+
+/*
+** Halve a row pair of tightly packed unsigned shorts into newwidth groups.
+*/
+static void halve_row_ushort(GLint components, GLint newwidth,
+			     const GLushort *rowA, const GLushort *rowB,
+			     GLushort *dst)
+{
+    const GLint n = newwidth * components;
+    GLint i = 0, k;
+
+#if defined(__SSE2__)
+    if (components != 3) {
+	i = halve_row_ushort_sse2(components, rowA, rowB, n, dst);
+    }
+#endif
+    rowA += 2*i;
+    rowB += 2*i;
+    for (; i < n; i += components) {
+	for (k = 0; k < components; k++) {
+	    dst[i+k] = (rowA[k] + rowA[k+components] +
+			rowB[k] + rowB[k+components] + 2) >> 2;
+	}
+	rowA += 2*components;
+	rowB += 2*components;
+    }
+}
+
+/*
+** The input pixels covered by one output pixel of a box filter, with
+** their weights in 16 bit fixed point.  In units of 1/sizeout of an input
+** pixel, output pixel j spans [j*sizein, (j+1)*sizein); the weights come
+** from rounding the pixel boundaries in there, so that they always add up
+** to exactly 65536.
+*/
+typedef struct {
+    GLint first, count;		/* input pixels covered */
+    const GLuint *weight;	/* and their weights */
+} BoxSpan;
+
+#define BOX_SHIFT 16
+
+static void make_box_spans(GLint sizein, GLint sizeout, BoxSpan *span,
+			   GLuint *weight)
+{
+    GLuint a = sizein, b = sizeout, t;
+    GLuint in, out, lo, hi, q, prev, next;
+    GLint j;
+
+    /* divide the sizes by their gcd, which keeps the products in range */
+    while (b) {
+	t = a % b;
+	a = b;
+	b = t;
+    }
+    in = sizein / a;
+    out = sizeout / a;
+
+    for (j = 0; j < sizeout; j++) {
+	lo = j * in;
+	hi = lo + in;
+	span[j].first = lo / out;
+	span[j].count = (hi - 1) / out - span[j].first + 1;
+	span[j].weight = weight;
+	prev = 0;
+	for (q = (span[j].first + 1) * out; q < hi; q += out) {
+	    next = (((q - lo) << BOX_SHIFT) + in / 2) / in;
+	    *weight++ = next - prev;
+	    prev = next;
+	}
+	*weight++ = (1 << BOX_SHIFT) - prev;
+    }
+}
+
+/*
+** Filter a row of 'stride' elements apart groups horizontally, into
+** widthout groups of 32 bit components with 'frac' fraction bits.
+*/
+static void box_row_ubyte(const BoxSpan *span, GLint widthout,
+			  GLint components, const GLubyte *src, GLint stride,
+			  GLint frac, GLuint *dst)
+{
+    const GLuint round = 1 << (BOX_SHIFT - frac - 1);
+    GLint j, k, x;
+
+    if (components == 4) {
+	for (j = 0; j < widthout; j++, dst += 4) {
+	    const GLubyte *r = src + span[j].first * stride;
+	    const GLuint *w = span[j].weight;
+	    GLuint s0 = round, s1 = round, s2 = round, s3 = round;
+
+	    for (x = 0; x < span[j].count; x++, r += stride) {
+		s0 += r[0] * w[x];
+		s1 += r[1] * w[x];
+		s2 += r[2] * w[x];
+		s3 += r[3] * w[x];
+	    }
+	    dst[0] = s0 >> (BOX_SHIFT - frac);
+	    dst[1] = s1 >> (BOX_SHIFT - frac);
+	    dst[2] = s2 >> (BOX_SHIFT - frac);
+	    dst[3] = s3 >> (BOX_SHIFT - frac);
+	}
+	return;
+    }
+
+    for (j = 0; j < widthout; j++, dst += components) {
+	const GLubyte *r = src + span[j].first * stride;
+	const GLuint *w = span[j].weight;
+	GLuint sum[4];
+
+	for (k = 0; k < components; k++) sum[k] = round;
+	for (x = 0; x < span[j].count; x++, r += stride) {
+	    for (k = 0; k < components; k++) sum[k] += r[k] * w[x];
+	}
+	for (k = 0; k < components; k++) dst[k] = sum[k] >> (BOX_SHIFT - frac);
+    }
+}
+
+static void box_row_ushort(const BoxSpan *span, GLint widthout,
+			   GLint components, const GLushort *src, GLint stride,
+			   GLint frac, GLuint *dst)
+{
+    const GLuint round = 1 << (BOX_SHIFT - frac - 1);
+    GLint j, k, x;
+
+    if (components == 4) {
+	for (j = 0; j < widthout; j++, dst += 4) {
+	    const GLushort *r = src + span[j].first * stride;
+	    const GLuint *w = span[j].weight;
+	    GLuint s0 = round, s1 = round, s2 = round, s3 = round;
+
+	    for (x = 0; x < span[j].count; x++, r += stride) {
+		s0 += r[0] * w[x];
+		s1 += r[1] * w[x];
+		s2 += r[2] * w[x];
+		s3 += r[3] * w[x];
+	    }
+	    dst[0] = s0 >> (BOX_SHIFT - frac);
+	    dst[1] = s1 >> (BOX_SHIFT - frac);
+	    dst[2] = s2 >> (BOX_SHIFT - frac);
+	    dst[3] = s3 >> (BOX_SHIFT - frac);
+	}
+	return;
+    }
+
+    for (j = 0; j < widthout; j++, dst += components) {
+	const GLushort *r = src + span[j].first * stride;
+	const GLuint *w = span[j].weight;
+	GLuint sum[4];
+
+	for (k = 0; k < components; k++) sum[k] = round;
+	for (x = 0; x < span[j].count; x++, r += stride) {
+	    for (k = 0; k < components; k++) sum[k] += r[k] * w[x];
+	}
+	for (k = 0; k < components; k++) dst[k] = sum[k] >> (BOX_SHIFT - frac);
+    }
+}
+
+/*
+** Rescale an image of unsigned bytes (element_size 1) or unsigned shorts
+** (element_size 2) with a separable integer box filter.  Each input row is
+** filtered horizontally once, keeping 8 fraction bits for bytes, and the
+** filtered rows are summed with their vertical weights.  All the sums fit
+** in 32 bits.  Returns GL_FALSE if memory runs out, so the caller can use
+** the float code instead.
+*/
+static GLboolean scale_box_integer(GLint components, GLint widthin,
+				   GLint heightin, const char *datain,
+				   GLint widthout, GLint heightout,
+				   void *dataout, GLint element_size,
+				   GLint ysize, GLint group_size,
+				   GLint myswap_bytes)
+{
+    const GLint frac = element_size == 1 ? 8 : 0;
+    const GLuint vround = 1 << (BOX_SHIFT + frac - 1);
+    const GLint nout = widthout * components;
+    BoxSpan *xspan, *yspan;
+    GLushort *row;
+    GLuint *hrow, *acc, *weight;
+    GLint hrowY = -1;
+    GLint i, k, n, x, y;
+
+    /* the weights are computed from (sizein/gcd) << BOX_SHIFT */
+    if (widthin > 65535 || heightin > 65535) return GL_FALSE;
+
+    /* each span shares at most its end pixels with its neighbors */
+    xspan = (BoxSpan *)malloc((widthout + heightout) * sizeof(BoxSpan));
+    weight = (GLuint *)malloc((2 * (widthin + widthout + heightin + heightout))
+			      * sizeof(GLuint));
+    hrow = (GLuint *)malloc(2 * nout * sizeof(GLuint));
+    row = NULL;
+    if (myswap_bytes) {
+	row = (GLushort *)malloc(widthin * components * sizeof(GLushort));
+    }
+    if (xspan == NULL || weight == NULL || hrow == NULL ||
+	(myswap_bytes && row == NULL)) {
+	free(xspan);
+	free(weight);
+	free(hrow);
+	free(row);
+	return GL_FALSE;
+    }
+    yspan = xspan + widthout;
+    acc = hrow + nout;
+
+    make_box_spans(widthin, widthout, xspan, weight);
+    make_box_spans(heightin, heightout, yspan,
+		   weight + 2 * (widthin + widthout));
+
+    for (i = 0; i < heightout; i++) {
+	for (y = 0; y < yspan[i].count; y++) {
+	    const GLuint wy = yspan[i].weight[y];
+
+	    if (yspan[i].first + y != hrowY) {
+		/* filter the input row horizontally */
+		const char *t = datain + (yspan[i].first + y) * ysize;
+
+		if (element_size == 1) {
+		    box_row_ubyte(xspan, widthout, components,
+				  (const GLubyte *)t, group_size, frac, hrow);
+		} else if (myswap_bytes) {
+		    for (x = 0, n = 0; x < widthin; x++, t += group_size) {
+			for (k = 0; k < components; k++, n++) {
+			    row[n] = __GLU_SWAP_2_BYTES(t + 2*k);
+			}
+		    }
+		    box_row_ushort(xspan, widthout, components, row,
+				   components, frac, hrow);
+		} else {
+		    box_row_ushort(xspan, widthout, components,
+				   (const GLushort *)t, group_size / 2, frac, hrow);
+		}
+		hrowY = yspan[i].first + y;
+	    }
+
+	    if (y == 0) {
+		for (n = 0; n < nout; n++) acc[n] = hrow[n] * wy;
+	    } else {
+		for (n = 0; n < nout; n++) acc[n] += hrow[n] * wy;
+	    }
+	}
+
+	if (element_size == 1) {
+	    GLubyte *s = (GLubyte *)dataout + i * nout;
+	    for (n = 0; n < nout; n++) {
+		s[n] = (acc[n] + vround) >> (BOX_SHIFT + frac);
+	    }
+	} else {
+	    GLushort *s = (GLushort *)dataout + i * nout;
+	    for (n = 0; n < nout; n++) {
+		s[n] = (acc[n] + vround) >> (BOX_SHIFT + frac);
+	    }
+	}
+    }
+
+    free(xspan);
+    free(weight);
+    free(hrow);
+    free(row);
+    return GL_TRUE;
+}
+
 static void halveImage(GLint components, GLuint width, GLuint height,
 		       const GLushort *datain, GLushort *dataout)
 {
@@ -395,6 +822,16 @@ static void halveImage_ubyte(GLint components, GLuint width, GLuint height,
     s = dataout;
     t = (const char *)datain;
 
+    if (element_size == 1 && group_size == components) {
+	for (i = 0; i < newheight; i++) {
+	    halve_row_ubyte(components, newwidth, (const GLubyte *)t,
+			    (const GLubyte *)(t+ysize), s);
+	    s += newwidth * components;
+	    t += 2 * ysize;
+	}
+	return;
+    }
+
     /* Piece o' cake! */
     for (i = 0; i < newheight; i++) {
 	for (j = 0; j < newwidth; j++) {
@@ -597,6 +1034,16 @@ static void halveImage_ushort(GLint components, GLuint width, GLuint height,
     s = dataout;
     t = (const char *)datain;
 
+    if (!myswap_bytes && element_size == 2 && group_size == 2*components) {
+	for (i = 0; i < newheight; i++) {
+	    halve_row_ushort(components, newwidth, (const GLushort *)t,
+			     (const GLushort *)(t+ysize), s);
+	    s += newwidth * components;
+	    t += 2 * ysize;
+	}
+	return;
+    }
+
     /* Piece o' cake! */
     if (!myswap_bytes)
     for (i = 0; i < newheight; i++) {
@@ -1420,6 +1867,11 @@ static void scale_internal_ubyte(GLint components, GLint widthin,
 	element_size, ysize, group_size);
 	return;
     }
+    if (scale_box_integer(components, widthin, heightin,
+			  (const char *)datain, widthout, heightout,
+			  dataout, element_size, ysize, group_size, 0)) {
+	return;
+    }
     convy = (float) heightin/heightout;
     convx = (float) widthin/widthout;
     convy_int = floor(convy);
@@ -1855,6 +2307,12 @@ static void scale_internal_ushort(GLint components, GLint widthin,
 	element_size, ysize, group_size, myswap_bytes);
 	return;
     }
+    if (scale_box_integer(components, widthin, heightin,
+			  (const char *)datain, widthout, heightout,
+			  dataout, element_size, ysize, group_size,
+			  myswap_bytes)) {
+	return;
+    }
     convy = (float) heightin/heightout;
     convx = (float) widthin/widthout;
     convy_int = floor(convy);
@@ -681,6 +681,7 @@ extern void __glEmptyImage(__GLXcontext*, GLint, GLint, GLint, GLint, GLenum,
 ** Allocate and Initialize Vertex Array client state 
 */
 extern void __glXInitVertexArrayState(__GLXcontext*);
+extern void __glXFreeVertexArrayState(__GLXcontext*);
 
 /*
 ** Inform the Server of the major and minor numbers and of the client
@@ -503,6 +503,7 @@ void __glXFreeContext(__GLXcontext *gc)
     if (gc->version) XFree((char *) gc->version);
     if (gc->extensions) XFree((char *) gc->extensions);
     __glFreeAttributeState(gc);
+    __glXFreeVertexArrayState(gc);
     XFree((char *) gc->buf);
     Xfree((char *) gc->client_state_private);
     XFree((char *) gc);
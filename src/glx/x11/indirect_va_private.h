@@ -198,6 +198,30 @@ struct array_state_vector {
      */
     size_t enabled_client_array_count;
 
+    /**
+     * \name Enabled arrays.
+     *
+     * Pointers to the enabled arrays, in the order that their data is sent,
+     * and the size of the data sent for a single vertex using the selected
+     * protocol.  These fields are only valid if \c array_info_cache_valid
+     * is true.
+     */
+    /*@{*/
+    struct array_state ** enabled_arrays;
+    size_t single_vertex_size;
+    /*@}*/
+
+    /**
+     * If the enabled arrays are already laid out in memory exactly like the
+     * array data of the DrawArrays protocol (e.g., a single tightly packed
+     * array, or interleaved arrays in protocol order), this points to the
+     * data for element zero.  The data for a range of elements can then be
+     * copied, or sent in a RenderLarge command, as a single block.
+     * Otherwise it is \c NULL.  Only valid if \c array_info_cache_valid is
+     * true.
+     */
+    const GLubyte * packed_array_data;
+
     /**
      * \name ARRAY_INFO cache.
      * 
@@ -80,7 +80,7 @@ static GLubyte * emit_element_old( GLubyte * dst,
     const struct array_state_vector * arrays, unsigned index );
 static struct array_state * get_array_entry(
     const struct array_state_vector * arrays, GLenum key, unsigned index );
-static void fill_array_info_cache( struct array_state_vector * arrays );
+static GLboolean fill_array_info_cache( struct array_state_vector * arrays );
 static GLboolean validate_mode(__GLXcontext *gc, GLenum mode);
 static GLboolean validate_count(__GLXcontext *gc, GLsizei count);
 static GLboolean validate_type(__GLXcontext *gc, GLenum type);
@@ -268,6 +268,29 @@ __glXInitVertexArrayState( __GLXcontext * gc )
 }
 
 
+/**
+ * Free the vertex array state of a GLX context.
+ */
+void
+__glXFreeVertexArrayState( __GLXcontext * gc )
+{
+    __GLXattribute * state = (__GLXattribute *)(gc->client_state_private);
+    struct array_state_vector * arrays = state->array_state;
+
+
+    if ( arrays == NULL ) {
+	return;
+    }
+
+    free( arrays->enabled_arrays );
+    free( arrays->array_info_cache_base );
+    free( arrays->stack );
+    free( arrays->arrays );
+    free( arrays );
+    state->array_state = NULL;
+}
+
+
 /**
  * Calculate the size of a single vertex for the "none" protocol.  This is
  * essentially the size of all the immediate-mode commands required to
@@ -280,16 +303,77 @@ calculate_single_vertex_size_none( const struct array_state_vector * arrays )
     unsigned   i;
 
 
-    for ( i = 0 ; i < arrays->num_arrays ; i++ ) {
-    	if ( arrays->arrays[i].enabled ) {
-	    single_vertex_size += ((uint16_t *)arrays->arrays[i].header)[0];
-	}
+    for ( i = 0 ; i < arrays->enabled_client_array_count ; i++ ) {
+	single_vertex_size += ((uint16_t *) arrays->enabled_arrays[i]->header)[0];
     }
     
     return single_vertex_size;
 }
 
 
+/**
+ * Copy a single array element of \c size bytes.  The sizes that are
+ * common for vertex arrays get fixed-size copies, which the compiler turns
+ * into a few loads and stores instead of a call to \c memcpy.
+ */
+static void
+copy_element( GLubyte * dst, const GLubyte * src, size_t size )
+{
+    switch ( size ) {
+    case 4:  (void) memcpy( dst, src, 4 );  break;
+    case 8:  (void) memcpy( dst, src, 8 );  break;
+    case 12: (void) memcpy( dst, src, 12 ); break;
+    case 16: (void) memcpy( dst, src, 16 ); break;
+    default: (void) memcpy( dst, src, size ); break;
+    }
+}
+
+
+/**
+ * Copy \c count elements of a single array.  Consecutive elements are
+ * \c src_stride bytes apart in the application's array and \c dst_stride
+ * bytes apart in the protocol.
+ */
+static void
+copy_array_elements( GLubyte * dst, size_t dst_stride,
+		     const GLubyte * src, size_t src_stride,
+		     size_t size, size_t count )
+{
+    size_t i;
+
+
+    /* Select the copy once for the whole array instead of once per element.
+     */
+    switch ( size ) {
+    case 4:
+	for ( i = 0 ; i < count ; i++, dst += dst_stride, src += src_stride ) {
+	    (void) memcpy( dst, src, 4 );
+	}
+	break;
+    case 8:
+	for ( i = 0 ; i < count ; i++, dst += dst_stride, src += src_stride ) {
+	    (void) memcpy( dst, src, 8 );
+	}
+	break;
+    case 12:
+	for ( i = 0 ; i < count ; i++, dst += dst_stride, src += src_stride ) {
+	    (void) memcpy( dst, src, 12 );
+	}
+	break;
+    case 16:
+	for ( i = 0 ; i < count ; i++, dst += dst_stride, src += src_stride ) {
+	    (void) memcpy( dst, src, 16 );
+	}
+	break;
+    default:
+	for ( i = 0 ; i < count ; i++, dst += dst_stride, src += src_stride ) {
+	    (void) memcpy( dst, src, size );
+	}
+	break;
+    }
+}
+
+
 /**
  * Emit a single element using non-DrawArrays protocol.
  */
@@ -301,29 +385,31 @@ emit_element_none( GLubyte * dst,
     unsigned i;
 
 
-    for ( i = 0 ; i < arrays->num_arrays ; i++ ) {
-	if ( arrays->arrays[i].enabled ) {
-	    const size_t offset = index * arrays->arrays[i].true_stride;
+    for ( i = 0 ; i < arrays->enabled_client_array_count ; i++ ) {
+	const struct array_state * a = arrays->enabled_arrays[i];
+	const size_t command_size = ((uint16_t *) a->header)[0];
+	const size_t data_size = a->header_size + a->element_size;
 
-	    /* The generic attributes can have more data than is in the
-	     * elements.  This is because a vertex array can be a 2 element,
-	     * normalized, unsigned short, but the "closest" immediate mode
-	     * protocol is for a 4Nus.  Since the sizes are small, the
-	     * performance impact on modern processors should be negligible.
-	     */
-	    (void) memset( dst, 0,
-			   ((uint16_t *)arrays->arrays[i].header)[0] );
-
-	    (void) memcpy( dst, arrays->arrays[i].header, 
-			   arrays->arrays[i].header_size );
-
-	    dst += arrays->arrays[i].header_size;
+	*(uint32_t *)(dst + 0) = a->header[0];
+	if ( a->header_size == 8 ) {
+	    *(uint32_t *)(dst + 4) = a->header[1];
+	}
 
-	    (void) memcpy( dst, ((GLubyte *) arrays->arrays[i].data) + offset,
-			   arrays->arrays[i].element_size );
+	copy_element( dst + a->header_size,
+		      ((const GLubyte *) a->data) + index * a->true_stride,
+		      a->element_size );
 
-	    dst += __GLX_PAD( arrays->arrays[i].element_size );
+	/* The generic attributes can have more data than is in the
+	 * elements.  This is because a vertex array can be a 2 element,
+	 * normalized, unsigned short, but the "closest" immediate mode
+	 * protocol is for a 4Nus.  Since the sizes are small, the
+	 * performance impact on modern processors should be negligible.
+	 */
+	if ( command_size > data_size ) {
+	    (void) memset( dst + data_size, 0, command_size - data_size );
 	}
+
+	dst += command_size;
     }
 
     return dst;
@@ -342,21 +428,77 @@ emit_element_old( GLubyte * dst,
     unsigned i;
 
 
-    for ( i = 0 ; i < arrays->num_arrays ; i++ ) {
-	if ( arrays->arrays[i].enabled ) {
-	    const size_t offset = index * arrays->arrays[i].true_stride;
+    for ( i = 0 ; i < arrays->enabled_client_array_count ; i++ ) {
+	const struct array_state * a = arrays->enabled_arrays[i];
 
-	    (void) memcpy( dst, ((GLubyte *) arrays->arrays[i].data) + offset,
-			   arrays->arrays[i].element_size );
+	copy_element( dst, ((const GLubyte *) a->data) + index * a->true_stride,
+		      a->element_size );
 
-	    dst += __GLX_PAD( arrays->arrays[i].element_size );
-	}
+	dst += __GLX_PAD( a->element_size );
     }
 
     return dst;
 }
 
 
+/**
+ * Emit \c count consecutive elements, starting with \c first, using either
+ * non-DrawArrays protocol (\c with_headers set) or "old" DrawArrays
+ * protocol.  Instead of going element by element, the data of each enabled
+ * array is copied to its place in all of the elements in turn.  When the
+ * arrays are already laid out like the protocol, all of the data is copied
+ * as a single block.
+ */
+static GLubyte *
+emit_element_run( GLubyte * dst, const struct array_state_vector * arrays,
+		  GLboolean with_headers, GLint first, size_t count )
+{
+    const size_t vertex_size = arrays->single_vertex_size;
+    GLubyte * d = dst;
+    unsigned i;
+    size_t j;
+
+
+    if ( !with_headers && (arrays->packed_array_data != NULL) ) {
+	(void) memcpy( dst, arrays->packed_array_data + first * vertex_size,
+		       count * vertex_size );
+	return dst + (count * vertex_size);
+    }
+
+    for ( i = 0 ; i < arrays->enabled_client_array_count ; i++ ) {
+	const struct array_state * a = arrays->enabled_arrays[i];
+	size_t size = __GLX_PAD( a->element_size );
+
+	if ( with_headers ) {
+	    const size_t command_size = ((uint16_t *) a->header)[0];
+	    const size_t data_size = a->header_size + a->element_size;
+	    GLubyte * h = d;
+
+	    for ( j = 0 ; j < count ; j++, h += vertex_size ) {
+		*(uint32_t *)(h + 0) = a->header[0];
+		if ( a->header_size == 8 ) {
+		    *(uint32_t *)(h + 4) = a->header[1];
+		}
+
+		if ( command_size > data_size ) {
+		    (void) memset( h + data_size, 0, command_size - data_size );
+		}
+	    }
+
+	    d += a->header_size;
+	    size = command_size - a->header_size;
+	}
+
+	copy_array_elements( d, vertex_size,
+			     ((const GLubyte *) a->data) + first * a->true_stride,
+			     a->true_stride, a->element_size, count );
+	d += size;
+    }
+
+    return dst + (count * vertex_size);
+}
+
+
 struct array_state *
 get_array_entry( const struct array_state_vector * arrays,
 		 GLenum key, unsigned index )
@@ -398,14 +540,63 @@ allocate_array_info_cache( struct array_state_vector * arrays,
 
 
 /**
+ * Determine whether the enabled arrays are laid out in memory exactly like
+ * the array data of the "old" DrawArrays protocol.  Arrays whose elements
+ * need padding are not considered, so that no data past the end of the
+ * last array is ever read.
+ *
+ * \returns
+ * A pointer to the data for element zero, or \c NULL.
  */
-void
+static const GLubyte *
+find_packed_array_data( const struct array_state_vector * arrays )
+{
+    const GLubyte * base;
+    size_t offset = 0;
+    unsigned i;
+
+
+    if ( arrays->enabled_client_array_count == 0 ) {
+	return NULL;
+    }
+
+    base = arrays->enabled_arrays[0]->data;
+    for ( i = 0 ; i < arrays->enabled_client_array_count ; i++ ) {
+	const struct array_state * a = arrays->enabled_arrays[i];
+
+	if ( ((const GLubyte *) a->data != base + offset)
+	     || (a->true_stride != arrays->single_vertex_size)
+	     || ((a->element_size & 3) != 0) ) {
+	    return NULL;
+	}
+
+	offset += a->element_size;
+    }
+
+    return base;
+}
+
+
+/**
+ * \returns
+ * \c GL_FALSE if memory could not be allocated for the cache.
+ */
+GLboolean
 fill_array_info_cache( struct array_state_vector * arrays )
 {
     GLboolean old_DrawArrays_possible;
     unsigned  i;
 
 
+    if ( arrays->enabled_arrays == NULL ) {
+	arrays->enabled_arrays = malloc( sizeof( struct array_state * )
+					 * arrays->num_arrays );
+	if ( arrays->enabled_arrays == NULL ) {
+	    return GL_FALSE;
+	}
+    }
+
+
     /* Determine how many arrays are enabled.
      */
 
@@ -413,6 +604,8 @@ fill_array_info_cache( struct array_state_vector * arrays )
     old_DrawArrays_possible = arrays->old_DrawArrays_possible;
     for ( i = 0 ; i < arrays->num_arrays ; i++ ) {
 	if ( arrays->arrays[i].enabled ) {
+	    arrays->enabled_arrays[ arrays->enabled_client_array_count ] =
+	      & arrays->arrays[i];
 	    arrays->enabled_client_array_count++;
 	    old_DrawArrays_possible &= arrays->arrays[i].old_DrawArrays_possible;
 	}
@@ -427,7 +620,7 @@ fill_array_info_cache( struct array_state_vector * arrays )
 
 
 	if ( ! allocate_array_info_cache( arrays, required_size ) ) {
-	    return;
+	    return GL_FALSE;
 	}
 
 
@@ -440,15 +633,27 @@ fill_array_info_cache( struct array_state_vector * arrays )
 	    }
 	}
 
+	arrays->single_vertex_size = 0;
+	for ( i = 0 ; i < arrays->enabled_client_array_count ; i++ ) {
+	    arrays->single_vertex_size +=
+	      __GLX_PAD( arrays->enabled_arrays[i]->element_size );
+	}
+
+	arrays->packed_array_data = find_packed_array_data( arrays );
+
 	arrays->DrawArrays = emit_DrawArrays_old;
 	arrays->DrawElements = emit_DrawElements_old;
     }
     else {
+	arrays->single_vertex_size = calculate_single_vertex_size_none( arrays );
+	arrays->packed_array_data = NULL;
+
 	arrays->DrawArrays = emit_DrawArrays_none;
 	arrays->DrawElements = emit_DrawElements_none;
     }
 
     arrays->array_info_cache_valid = GL_TRUE;
+    return GL_TRUE;
 }
 
 
@@ -467,15 +672,12 @@ emit_DrawArrays_none( GLenum mode, GLint first, GLsizei count )
        (const __GLXattribute *)(gc->client_state_private);
     struct array_state_vector * arrays = state->array_state;
 
-    size_t single_vertex_size;
+    const size_t single_vertex_size = arrays->single_vertex_size;
     GLubyte * pc;
-    unsigned  i;
     static const uint16_t begin_cmd[2] = { 8, X_GLrop_Begin };
     static const uint16_t end_cmd[2]   = { 4, X_GLrop_End };
 
 
-    single_vertex_size = calculate_single_vertex_size_none( arrays );
-
     pc = gc->pc;
 
     (void) memcpy( pc, begin_cmd, 4 );
@@ -483,16 +685,30 @@ emit_DrawArrays_none( GLenum mode, GLint first, GLsizei count )
 
     pc += 8;
 
-    for ( i = 0 ; i < count ; i++ ) {
-	if ( (pc + single_vertex_size) >= gc->bufEnd ) {
-	    pc = __glXFlushRenderBuffer(gc, gc->pc);
+    /* Emit as many elements as will fit in the buffer at a time, then flush
+     * it.  Elements are never split across buffers.  With no arrays enabled
+     * there is nothing to send between the Begin and the End.
+     */
+    while ( (count > 0) && (single_vertex_size != 0) ) {
+	size_t elements = (size_t) (gc->bufEnd - pc - 1) / single_vertex_size;
+
+	if ( elements == 0 ) {
+	    pc = __glXFlushRenderBuffer(gc, pc);
+	    continue;
 	}
 
-	pc = emit_element_none( pc, arrays, first + i );
+	if ( elements > (size_t) count ) {
+	    elements = count;
+	}
+
+	pc = emit_element_run( pc, arrays, GL_TRUE, first, elements );
+
+	first += elements;
+	count -= elements;
     }
 
     if ( (pc + 4) >= gc->bufEnd ) {
-	pc = __glXFlushRenderBuffer(gc, gc->pc);
+	pc = __glXFlushRenderBuffer(gc, pc);
     }
 
     (void) memcpy( pc, end_cmd, 4 );
@@ -531,9 +747,8 @@ emit_DrawArrays_header_old( __GLXcontext * gc,
 			    GLenum mode, GLsizei count )
 {
     size_t command_size;
-    size_t single_vertex_size;
+    const size_t single_vertex_size = arrays->single_vertex_size;
     const unsigned header_size = 16;
-    unsigned  i;
     GLubyte * pc;
 
 
@@ -542,13 +757,6 @@ emit_DrawArrays_header_old( __GLXcontext * gc,
      * it will be known whether a Render or RenderLarge command is needed.
      */
 
-    single_vertex_size = 0;
-    for ( i = 0 ; i < arrays->num_arrays ; i++ ) {
-	if ( arrays->arrays[i].enabled ) {
-	    single_vertex_size += __GLX_PAD( arrays->arrays[i].element_size );
-	}
-    }
-
     command_size = arrays->array_info_cache_size + header_size 
       + (single_vertex_size * count);
 
@@ -641,8 +849,6 @@ emit_DrawArrays_old( GLenum mode, GLint first, GLsizei count )
     GLubyte * pc;
     size_t elements_per_request;
     unsigned total_requests = 0;
-    unsigned i;
-    size_t total_sent = 0;
 
 
     pc = emit_DrawArrays_header_old( gc, arrays, & elements_per_request,
@@ -655,9 +861,7 @@ emit_DrawArrays_old( GLenum mode, GLint first, GLsizei count )
     if ( total_requests == 0 ) {
 	assert( elements_per_request >= count );
 
-	for ( i = 0 ; i < count ; i++ ) {
-	    pc = emit_element_old( pc, arrays, i + first );
-	}
+	pc = emit_element_run( pc, arrays, GL_FALSE, first, count );
 
 	assert( pc <= gc->bufEnd );
 
@@ -675,17 +879,27 @@ emit_DrawArrays_old( GLenum mode, GLint first, GLsizei count )
 		elements_per_request = count;
 	    }
 
-	    pc = gc->pc;
-	    for ( i = 0 ; i < elements_per_request ; i++ ) {
-		pc = emit_element_old( pc, arrays, i + first );
+	    /* If the application's arrays already look like the protocol,
+	     * send the data straight from them without copying it.
+	     */
+	    if ( arrays->packed_array_data != NULL ) {
+		const size_t size = arrays->single_vertex_size
+		  * elements_per_request;
+
+		__glXSendLargeChunk( gc, req, total_requests,
+				     arrays->packed_array_data
+				     + (first * arrays->single_vertex_size),
+				     size );
 	    }
+	    else {
+		pc = emit_element_run( gc->pc, arrays, GL_FALSE, first,
+				       elements_per_request );
 
-	    first += elements_per_request;
-
-	    total_sent += (size_t) (pc - gc->pc);
-	    __glXSendLargeChunk( gc, req, total_requests, gc->pc,
-				 pc - gc->pc );
+		__glXSendLargeChunk( gc, req, total_requests, gc->pc,
+				     pc - gc->pc );
+	    }
 
+	    first += elements_per_request;
 	    count -= elements_per_request;
 	}
     }
@@ -704,13 +918,10 @@ emit_DrawElements_none( GLenum mode, GLsizei count, GLenum type,
     static const uint16_t end_cmd[2]   = { 4, X_GLrop_End };
 
     GLubyte * pc;
-    size_t single_vertex_size;
+    const size_t single_vertex_size = arrays->single_vertex_size;
     unsigned  i;
 
 
-    single_vertex_size = calculate_single_vertex_size_none( arrays );
-
-
     if ( (gc->pc + single_vertex_size) >= gc->bufEnd ) {
 	gc->pc = __glXFlushRenderBuffer(gc, gc->pc);
     }
@@ -726,7 +937,7 @@ emit_DrawElements_none( GLenum mode, GLsizei count, GLenum type,
 	unsigned  index = 0;
 
 	if ( (pc + single_vertex_size) >= gc->bufEnd ) {
-	    pc = __glXFlushRenderBuffer(gc, gc->pc);
+	    pc = __glXFlushRenderBuffer(gc, pc);
 	}
 
 	switch( type ) {
@@ -744,7 +955,7 @@ emit_DrawElements_none( GLenum mode, GLsizei count, GLenum type,
     }
 
     if ( (pc + 4) >= gc->bufEnd ) {
-	pc = __glXFlushRenderBuffer(gc, gc->pc);
+	pc = __glXFlushRenderBuffer(gc, pc);
     }
 
     (void) memcpy( pc, end_cmd, 4 );
@@ -926,8 +1137,10 @@ void __indirect_glDrawArrays(GLenum mode, GLint first, GLsizei count)
     
 
     if ( validate_mode(gc, mode) && validate_count(gc, count) ) {
-	if ( ! arrays->array_info_cache_valid ) {
-	    fill_array_info_cache( arrays );
+	if ( ! arrays->array_info_cache_valid
+	     && ! fill_array_info_cache( arrays ) ) {
+	    __glXSetError(gc, GL_OUT_OF_MEMORY);
+	    return;
 	}
 
 	arrays->DrawArrays(mode, first, count);
@@ -942,12 +1155,18 @@ void __indirect_glArrayElement(GLint index)
        (const __GLXattribute *)(gc->client_state_private);
     struct array_state_vector * arrays = state->array_state;
 
-    size_t single_vertex_size;
 
+    if ( ! arrays->array_info_cache_valid
+	 && ! fill_array_info_cache( arrays ) ) {
+	__glXSetError(gc, GL_OUT_OF_MEMORY);
+	return;
+    }
 
-    single_vertex_size = calculate_single_vertex_size_none( arrays );
-
-    if ( (gc->pc + single_vertex_size) >= gc->bufEnd ) {
+    /* The immediate-mode commands for an element may be larger than its
+     * DrawArrays array data.
+     */
+    if ( (gc->pc + calculate_single_vertex_size_none( arrays ))
+	 >= gc->bufEnd ) {
 	gc->pc = __glXFlushRenderBuffer(gc, gc->pc);
     }
 
@@ -970,8 +1189,10 @@ void __indirect_glDrawElements(GLenum mode, GLsizei count, GLenum type,
 
     if ( validate_mode(gc, mode) && validate_count(gc, count)
 	 && validate_type(gc, type) ) {
-	if ( ! arrays->array_info_cache_valid ) {
-	    fill_array_info_cache( arrays );
+	if ( ! arrays->array_info_cache_valid
+	     && ! fill_array_info_cache( arrays ) ) {
+	    __glXSetError(gc, GL_OUT_OF_MEMORY);
+	    return;
 	}
 
 	arrays->DrawElements(mode, count, type, indices);
@@ -996,8 +1217,10 @@ void __indirect_glDrawRangeElements(GLenum mode, GLuint start, GLuint end,
 	    return;
 	}
 
-	if ( ! arrays->array_info_cache_valid ) {
-	    fill_array_info_cache( arrays );
+	if ( ! arrays->array_info_cache_valid
+	     && ! fill_array_info_cache( arrays ) ) {
+	    __glXSetError(gc, GL_OUT_OF_MEMORY);
+	    return;
 	}
 
 	arrays->DrawElements(mode, count, type, indices);
@@ -1016,8 +1239,10 @@ void __indirect_glMultiDrawArraysEXT(GLenum mode, GLint *first, GLsizei *count,
 
 
     if ( validate_mode(gc, mode) ) {
-	if ( ! arrays->array_info_cache_valid ) {
-	    fill_array_info_cache( arrays );
+	if ( ! arrays->array_info_cache_valid
+	     && ! fill_array_info_cache( arrays ) ) {
+	    __glXSetError(gc, GL_OUT_OF_MEMORY);
+	    return;
 	}
 
 	for ( i = 0 ; i < primcount ; i++ ) {
@@ -1041,8 +1266,10 @@ void __indirect_glMultiDrawElementsEXT(GLenum mode, const GLsizei *count,
 
 
     if ( validate_mode(gc, mode) && validate_type(gc, type) ) {
-	if ( ! arrays->array_info_cache_valid ) {
-	    fill_array_info_cache( arrays );
+	if ( ! arrays->array_info_cache_valid
+	     && ! fill_array_info_cache( arrays ) ) {
+	    __glXSetError(gc, GL_OUT_OF_MEMORY);
+	    return;
 	}
 
 	for ( i = 0 ; i < primcount ; i++ ) {
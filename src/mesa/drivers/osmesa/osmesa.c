@@ -1226,6 +1226,13 @@ OSMesaCreateContextExt( GLenum format, GLint depthBits, GLint stencilBits,
       _mesa_enable_1_3_extensions(&(osmesa->mesa));
       _mesa_enable_1_4_extensions(&(osmesa->mesa));
       _mesa_enable_1_5_extensions(&(osmesa->mesa));
+      _mesa_enable_extension(&(osmesa->mesa),
+                             "GL_3DFX_texture_compression_FXT1");
+      if (osmesa->mesa.Mesa_DXTn) {
+         _mesa_enable_extension(&(osmesa->mesa),
+                                "GL_EXT_texture_compression_s3tc");
+         _mesa_enable_extension(&(osmesa->mesa), "GL_S3_s3tc");
+      }
 
       osmesa->gl_buffer = _mesa_create_framebuffer(osmesa->gl_visual);
       if (!osmesa->gl_buffer) {
@@ -1284,6 +1291,11 @@ OSMesaCreateContextExt( GLenum format, GLint depthBits, GLint stencilBits,
          swrast = SWRAST_CONTEXT( ctx );
          swrast->choose_line = osmesa_choose_line;
          swrast->choose_triangle = osmesa_choose_triangle;
+
+         /* Our span and triangle functions only touch the pixels they're
+          * asked to, so triangles may be rasterized by several threads.
+          */
+         _swrast_allow_tile_binning( ctx, GL_TRUE );
       }
    }
    return osmesa;
@@ -1524,6 +1536,9 @@ OSMesaGetDepthBuffer( OSMesaContext c, GLint *width, GLint *height,
       else
          *bytesPerValue = sizeof(GLuint);
       *buffer = rb->Data;
+      /* we can't tell when the application writes into it */
+      rb->AppAccess = GL_TRUE;
+      rb->DepthStamp++;
       return GL_TRUE;
    }
 }
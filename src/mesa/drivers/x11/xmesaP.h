@@ -573,7 +573,7 @@ extern void xmesa_register_swrast_functions( GLcontext *ctx );
 
 
 
-#define ENABLE_EXT_texure_compression_s3tc 0 /* SW texture compression */
+#define ENABLE_EXT_texure_compression_s3tc 1 /* SW texture compression */
 
 #ifdef XFree86Server
 #define ENABLE_EXT_timer_query 0
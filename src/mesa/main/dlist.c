@@ -350,8 +350,9 @@ typedef enum
    OPCODE_EVAL_P1,
    OPCODE_EVAL_P2,
 
-   /* The following three are meta instructions */
+   /* The following four are meta instructions */
    OPCODE_ERROR,                /* raise compiled-in error */
+   OPCODE_INLINED_LIST,         /* start of a copy of a called list */
    OPCODE_CONTINUE,
    OPCODE_END_OF_LIST,
    OPCODE_EXT_0
@@ -436,6 +437,20 @@ lookup_list(GLcontext *ctx, GLuint list)
 }
 
 
+/**
+ * Return the number of nodes used by the instruction at n.
+ */
+static INLINE GLuint
+instruction_size(const GLcontext *ctx, const Node *n)
+{
+   const GLint i = (GLint) n[0].opcode - (GLint) OPCODE_EXT_0;
+   if (i >= 0 && i < (GLint) ctx->ListExt.NumOpcodes)
+      return ctx->ListExt.Opcode[i].Size;
+   else
+      return InstSize[n[0].opcode];
+}
+
+
 
 /**
  * Delete the named display list, but don't remove from hash table.
@@ -585,10 +600,48 @@ _mesa_delete_list(GLcontext *ctx, struct mesa_display_list *dlist)
       }
    }
 
+   if (dlist->callers)
+      _mesa_free(dlist->callers);
    _mesa_free(dlist);
 }
 
 
+/**
+ * Flag all copies of the given list which the optimizer has inlined into
+ * other lists as stale.  Those lists will call the list by number instead
+ * from now on.  Used when the list is about to be deleted or replaced.
+ */
+static void
+invalidate_inlined_copies(GLcontext *ctx, struct mesa_display_list *dlist)
+{
+   GLuint i;
+
+   for (i = 0; i < dlist->numCallers; i++) {
+      struct mesa_display_list *caller = lookup_list(ctx, dlist->callers[i]);
+      Node *n;
+
+      if (!caller)
+         continue;
+
+      n = caller->node;
+      while (n[0].opcode != OPCODE_END_OF_LIST) {
+         if (n[0].opcode == OPCODE_CONTINUE) {
+            n = (Node *) n[1].next;
+            continue;
+         }
+         if (n[0].opcode == OPCODE_INLINED_LIST && n[1].ui == dlist->id)
+            n[2].b = GL_TRUE;
+         n += instruction_size(ctx, n);
+      }
+   }
+
+   if (dlist->callers)
+      _mesa_free(dlist->callers);
+   dlist->callers = NULL;
+   dlist->numCallers = 0;
+}
+
+
 /**
  * Destroy a display list and remove from hash table.
  * \param list - display list number
@@ -605,6 +658,7 @@ destroy_list(GLcontext *ctx, GLuint list)
    if (!dlist)
       return;
 
+   invalidate_inlined_copies(ctx, dlist);
    _mesa_delete_list(ctx, dlist);
    _mesa_HashRemove(ctx->Shared->DisplayList, list);
 }
@@ -752,6 +806,8 @@ _mesa_alloc_instruction(GLcontext *ctx, GLuint opcode, GLuint bytes)
  * \param execute  function to execute the new display list command
  * \param destroy  function to destroy the new display list command
  * \param print  function to print the new display list command
+ * \param copy  function called after the display list optimizer has
+ *              duplicated the command, or NULL if it can't be duplicated
  * \return  the new opcode number or -1 if error
  */
 GLint
@@ -759,7 +815,8 @@ _mesa_alloc_opcode(GLcontext *ctx,
                    GLuint size,
                    void (*execute) (GLcontext *, void *),
                    void (*destroy) (GLcontext *, void *),
-                   void (*print) (GLcontext *, void *))
+                   void (*print) (GLcontext *, void *),
+                   void (*copy) (GLcontext *, void *))
 {
    if (ctx->ListExt.NumOpcodes < MAX_DLIST_EXT_OPCODES) {
       const GLuint i = ctx->ListExt.NumOpcodes++;
@@ -768,6 +825,7 @@ _mesa_alloc_opcode(GLcontext *ctx,
       ctx->ListExt.Opcode[i].Execute = execute;
       ctx->ListExt.Opcode[i].Destroy = destroy;
       ctx->ListExt.Opcode[i].Print = print;
+      ctx->ListExt.Opcode[i].Copy = copy;
       return i + OPCODE_EXT_0;
    }
    return -1;
@@ -5656,6 +5714,467 @@ islist(GLcontext *ctx, GLuint list)
 
 
 
+/**********************************************************************/
+/*                     Display list optimization                      */
+/**********************************************************************/
+
+/*
+ * When ctx->ListState.Optimize is set, each list is rewritten in
+ * glEndList:
+ *  - state changes which are overwritten before anything could see them
+ *    are removed, as are glBindTexture calls which rebind the same texture,
+ *  - small lists called with glCallList are inlined,
+ *  - the list is stored in one contiguous block of nodes.
+ *
+ * An inlined list starts with an OPCODE_INLINED_LIST node giving the
+ * list number and the size of the copy.  The called list records the
+ * numbers of the lists holding copies of it, so when it's deleted or
+ * redefined those copies are flagged as stale and skipped in favour of
+ * calling the list by number.
+ */
+
+/** Largest list (in nodes) which will be inlined */
+#define MAX_INLINE_NODES 128
+
+/** Max number of state changes tracked by find_dead_state() */
+#define MAX_PENDING_STATE 32
+
+enum pending_kind
+{
+   PENDING_ATTR_NV,
+   PENDING_ATTR_ARB,
+   PENDING_MATERIAL,
+   PENDING_BIND_TEXTURE
+};
+
+/**
+ * A state change which nothing has looked at yet.
+ */
+struct pending_state
+{
+   const Node *n;
+   GLuint inst;                 /**< instruction number */
+   enum pending_kind kind;
+   GLuint key;
+};
+
+
+/**
+ * Classify a state change instruction for find_dead_state().
+ * \return GL_FALSE if the instruction is not a state change we track.
+ */
+static GLboolean
+classify_state(GLcontext *ctx, const Node *n,
+               enum pending_kind *kind, GLuint *key)
+{
+   switch (n[0].opcode) {
+   case OPCODE_ATTR_1F_NV:
+   case OPCODE_ATTR_2F_NV:
+   case OPCODE_ATTR_3F_NV:
+   case OPCODE_ATTR_4F_NV:
+      *kind = PENDING_ATTR_NV;
+      *key = n[1].ui;
+      return *key != 0;         /* attrib 0 emits a vertex */
+   case OPCODE_ATTR_1F_ARB:
+   case OPCODE_ATTR_2F_ARB:
+   case OPCODE_ATTR_3F_ARB:
+   case OPCODE_ATTR_4F_ARB:
+      *kind = PENDING_ATTR_ARB;
+      *key = n[1].ui;
+      return *key != 0;
+   case OPCODE_MATERIAL:
+      *kind = PENDING_MATERIAL;
+      *key = _mesa_material_bitmask(ctx, n[1].e, n[2].e, ~0, NULL);
+      return GL_TRUE;
+   case OPCODE_BIND_TEXTURE:
+      *kind = PENDING_BIND_TEXTURE;
+      *key = n[1].e;
+      return GL_TRUE;
+   default:
+      return GL_FALSE;
+   }
+}
+
+
+/**
+ * Find the state changes in a list which have no effect.  An attribute
+ * or material change is dead if the same state is set again before any
+ * other instruction could use it.  A glBindTexture is dead if it binds
+ * the texture which is already bound.  Any instruction not handled by
+ * classify_state() ends the search for overwrites.
+ *
+ * \param dead  per instruction number, set to GL_TRUE for dead ones
+ * \return number of dead instructions
+ */
+static GLuint
+find_dead_state(GLcontext *ctx, const Node *n, GLboolean *dead)
+{
+   struct pending_state pending[MAX_PENDING_STATE];
+   GLuint numPending = 0, numDead = 0, inst = 0;
+
+   while (n[0].opcode != OPCODE_END_OF_LIST) {
+      enum pending_kind kind;
+      GLuint key, i;
+
+      if (n[0].opcode == OPCODE_CONTINUE) {
+         n = (const Node *) n[1].next;
+         continue;
+      }
+
+      dead[inst] = GL_FALSE;
+
+      if (!classify_state(ctx, n, &kind, &key)) {
+         numPending = 0;
+      }
+      else {
+         GLboolean redundant = GL_FALSE;
+
+         for (i = 0; i < numPending; i++) {
+            struct pending_state *p = &pending[i];
+            GLboolean remove = GL_FALSE;
+
+            if (p->kind != kind)
+               continue;
+
+            switch (kind) {
+            case PENDING_MATERIAL:
+               if ((p->key & ~key) == 0) {
+                  dead[p->inst] = GL_TRUE;
+                  numDead++;
+                  remove = GL_TRUE;
+               }
+               break;
+            case PENDING_BIND_TEXTURE:
+               if (p->key == key) {
+                  if (p->n[2].ui == n[2].ui)
+                     redundant = GL_TRUE;
+                  else
+                     remove = GL_TRUE;
+               }
+               break;
+            default:
+               if (p->key == key) {
+                  dead[p->inst] = GL_TRUE;
+                  numDead++;
+                  remove = GL_TRUE;
+               }
+            }
+
+            if (remove) {
+               pending[i--] = pending[--numPending];
+            }
+         }
+
+         if (redundant) {
+            dead[inst] = GL_TRUE;
+            numDead++;
+         }
+         else {
+            if (numPending == MAX_PENDING_STATE)
+               numPending = 0;
+            pending[numPending].n = n;
+            pending[numPending].inst = inst;
+            pending[numPending].kind = kind;
+            pending[numPending].key = key;
+            numPending++;
+         }
+      }
+
+      n += instruction_size(ctx, n);
+      inst++;
+   }
+
+   return numDead;
+}
+
+
+/**
+ * Can the instruction at n be duplicated?  Instructions which own
+ * malloc'd data (see _mesa_delete_list()) can't be.
+ */
+static GLboolean
+copyable_instruction(const GLcontext *ctx, const Node *n)
+{
+   const GLint i = (GLint) n[0].opcode - (GLint) OPCODE_EXT_0;
+
+   if (i >= 0 && i < (GLint) ctx->ListExt.NumOpcodes)
+      return ctx->ListExt.Opcode[i].Copy != NULL;
+
+   switch (n[0].opcode) {
+   case OPCODE_MAP1:
+   case OPCODE_MAP2:
+   case OPCODE_DRAW_PIXELS:
+   case OPCODE_BITMAP:
+   case OPCODE_COLOR_TABLE:
+   case OPCODE_COLOR_SUB_TABLE:
+   case OPCODE_CONVOLUTION_FILTER_1D:
+   case OPCODE_CONVOLUTION_FILTER_2D:
+   case OPCODE_POLYGON_STIPPLE:
+   case OPCODE_TEX_IMAGE1D:
+   case OPCODE_TEX_IMAGE2D:
+   case OPCODE_TEX_IMAGE3D:
+   case OPCODE_TEX_SUB_IMAGE1D:
+   case OPCODE_TEX_SUB_IMAGE2D:
+   case OPCODE_TEX_SUB_IMAGE3D:
+   case OPCODE_COMPRESSED_TEX_IMAGE_1D:
+   case OPCODE_COMPRESSED_TEX_IMAGE_2D:
+   case OPCODE_COMPRESSED_TEX_IMAGE_3D:
+   case OPCODE_COMPRESSED_TEX_SUB_IMAGE_1D:
+   case OPCODE_COMPRESSED_TEX_SUB_IMAGE_2D:
+   case OPCODE_COMPRESSED_TEX_SUB_IMAGE_3D:
+   case OPCODE_LOAD_PROGRAM_NV:
+   case OPCODE_REQUEST_RESIDENT_PROGRAMS_NV:
+   case OPCODE_PROGRAM_NAMED_PARAMETER_NV:
+   case OPCODE_PROGRAM_STRING_ARB:
+      return GL_FALSE;
+   default:
+      return GL_TRUE;
+   }
+}
+
+
+/**
+ * Check if the list called by a glCallList in the list being compiled
+ * can be inlined.
+ * \param size  returns the size of the list in nodes
+ * \return the list, or NULL
+ */
+static struct mesa_display_list *
+inline_candidate(GLcontext *ctx, GLuint list, GLuint *size)
+{
+   struct mesa_display_list *dlist;
+   const Node *n;
+   GLuint count = 0;
+
+   /* a list calling itself calls the new version */
+   if (list == ctx->ListState.CurrentListNum)
+      return NULL;
+
+   dlist = lookup_list(ctx, list);
+   if (!dlist)
+      return NULL;
+
+   n = dlist->node;
+   while (n[0].opcode != OPCODE_END_OF_LIST) {
+      if (n[0].opcode == OPCODE_CONTINUE) {
+         n = (const Node *) n[1].next;
+         continue;
+      }
+      if (!copyable_instruction(ctx, n))
+         return NULL;
+      count += instruction_size(ctx, n);
+      if (count > MAX_INLINE_NODES)
+         return NULL;
+      n += instruction_size(ctx, n);
+   }
+
+   /* Don't bother with empty lists, they're often just placeholders
+    * from glGenLists.
+    */
+   if (count == 0)
+      return NULL;
+
+   *size = count;
+   return dlist;
+}
+
+
+/**
+ * Record that list 'caller' holds an inlined copy of dlist.
+ */
+static GLboolean
+add_caller(struct mesa_display_list *dlist, GLuint caller)
+{
+   GLuint *callers;
+   GLuint i;
+
+   for (i = 0; i < dlist->numCallers; i++) {
+      if (dlist->callers[i] == caller)
+         return GL_TRUE;
+   }
+
+   callers = (GLuint *) _mesa_realloc(dlist->callers,
+                                      dlist->numCallers * sizeof(GLuint),
+                                      (dlist->numCallers + 1) * sizeof(GLuint));
+   if (!callers)
+      return GL_FALSE;
+
+   callers[dlist->numCallers++] = caller;
+   dlist->callers = callers;
+   return GL_TRUE;
+}
+
+
+/**
+ * Copy the instructions of the called list 'callee' to dst, for
+ * inlining into list number 'caller'.
+ * \return pointer to the node after the copy
+ */
+static Node *
+copy_inlined_list(GLcontext *ctx, GLuint caller,
+                  const struct mesa_display_list *callee, Node *dst)
+{
+   const Node *n = callee->node;
+
+   while (n[0].opcode != OPCODE_END_OF_LIST) {
+      const GLint i = (GLint) n[0].opcode - (GLint) OPCODE_EXT_0;
+      GLuint size;
+
+      if (n[0].opcode == OPCODE_CONTINUE) {
+         n = (const Node *) n[1].next;
+         continue;
+      }
+
+      size = instruction_size(ctx, n);
+      _mesa_memcpy(dst, n, size * sizeof(Node));
+
+      if (i >= 0 && i < (GLint) ctx->ListExt.NumOpcodes) {
+         ctx->ListExt.Opcode[i].Copy(ctx, &dst[1]);
+      }
+      else if (n[0].opcode == OPCODE_INLINED_LIST && !dst[2].b) {
+         /* the caller now holds a copy of this list too */
+         struct mesa_display_list *nested = lookup_list(ctx, dst[1].ui);
+         if (!nested || !add_caller(nested, caller))
+            dst[2].b = GL_TRUE;
+      }
+
+      dst += size;
+      n += size;
+   }
+
+   return dst;
+}
+
+
+/**
+ * Free the blocks of nodes of a list, but not the instructions' data.
+ */
+static void
+free_list_blocks(GLcontext *ctx, Node *n)
+{
+   Node *block = n;
+
+   while (n[0].opcode != OPCODE_END_OF_LIST) {
+      if (n[0].opcode == OPCODE_CONTINUE) {
+         n = (Node *) n[1].next;
+         _mesa_free(block);
+         block = n;
+      }
+      else {
+         n += instruction_size(ctx, n);
+      }
+   }
+   _mesa_free(block);
+}
+
+
+/**
+ * Optimize the list which has just been compiled, see above.  The list
+ * is left as it was if we run out of memory.
+ */
+static void
+optimize_list(GLcontext *ctx, struct mesa_display_list *dlist)
+{
+   GLboolean *dead;
+   Node *n, *nodes, *dst;
+   GLuint numInst = 0, numNodes = 1, inst;
+
+   /* count the instructions */
+   n = dlist->node;
+   while (n[0].opcode != OPCODE_END_OF_LIST) {
+      if (n[0].opcode == OPCODE_CONTINUE) {
+         n = (Node *) n[1].next;
+         continue;
+      }
+      numInst++;
+      n += instruction_size(ctx, n);
+   }
+
+   if (numInst == 0)
+      return;
+
+   dead = (GLboolean *) _mesa_malloc(numInst * sizeof(GLboolean));
+   if (!dead)
+      return;
+
+   (void) find_dead_state(ctx, dlist->node, dead);
+
+   /* size of the new list */
+   n = dlist->node;
+   inst = 0;
+   while (n[0].opcode != OPCODE_END_OF_LIST) {
+      GLuint size;
+      if (n[0].opcode == OPCODE_CONTINUE) {
+         n = (Node *) n[1].next;
+         continue;
+      }
+      if (!dead[inst]) {
+         if (n[0].opcode == OPCODE_CALL_LIST &&
+             inline_candidate(ctx, n[1].ui, &size))
+            numNodes += InstSize[OPCODE_INLINED_LIST] + size;
+         else
+            numNodes += instruction_size(ctx, n);
+      }
+      n += instruction_size(ctx, n);
+      inst++;
+   }
+
+   nodes = (Node *) _mesa_malloc(numNodes * sizeof(Node));
+   if (!nodes) {
+      _mesa_free(dead);
+      return;
+   }
+
+   /* Move the instructions to the new list.  Their data now belongs to
+    * the new nodes.
+    */
+   n = dlist->node;
+   dst = nodes;
+   inst = 0;
+   while (n[0].opcode != OPCODE_END_OF_LIST) {
+      GLuint size;
+      if (n[0].opcode == OPCODE_CONTINUE) {
+         n = (Node *) n[1].next;
+         continue;
+      }
+      size = instruction_size(ctx, n);
+      if (!dead[inst]) {
+         struct mesa_display_list *callee = NULL;
+         GLuint calleeSize;
+
+         if (n[0].opcode == OPCODE_CALL_LIST) {
+            callee = inline_candidate(ctx, n[1].ui, &calleeSize);
+            if (callee && !add_caller(callee, dlist->id))
+               callee = NULL;
+         }
+
+         if (callee) {
+            dst[0].opcode = OPCODE_INLINED_LIST;
+            dst[1].ui = callee->id;
+            dst[2].b = GL_FALSE;
+            dst[3].ui = calleeSize;
+            dst = copy_inlined_list(ctx, dlist->id, callee,
+                                    dst + InstSize[OPCODE_INLINED_LIST]);
+            dlist->flags |= callee->flags;
+         }
+         else {
+            _mesa_memcpy(dst, n, size * sizeof(Node));
+            dst += size;
+         }
+      }
+      n += size;
+      inst++;
+   }
+   dst[0].opcode = OPCODE_END_OF_LIST;
+
+   free_list_blocks(ctx, dlist->node);
+   dlist->node = nodes;
+
+   _mesa_free(dead);
+}
+
+
+
 /**********************************************************************/
 /*                     Display list execution                         */
 /**********************************************************************/
@@ -5756,6 +6275,17 @@ execute_list(GLcontext *ctx, GLuint list)
                execute_list(ctx, ctx->List.ListBase + n[1].ui);
             }
             break;
+         case OPCODE_INLINED_LIST:
+            /* The copy of the list which follows is used unless the
+             * list has been replaced since.
+             */
+            if (n[2].b) {
+               if (ctx->ListState.CallDepth < MAX_LIST_NESTING) {
+                  execute_list(ctx, n[1].ui);
+               }
+               n += n[3].ui;
+            }
+            break;
          case OPCODE_CLEAR:
             CALL_Clear(ctx->Exec, (n[1].bf));
             break;
@@ -6736,6 +7266,9 @@ _mesa_EndList(void)
 
    (void) ALLOC_INSTRUCTION(ctx, OPCODE_END_OF_LIST, 0);
 
+   if (ctx->ListState.Optimize)
+      optimize_list(ctx, ctx->ListState.CurrentList);
+
    /* Destroy old list, if any */
    destroy_list(ctx, ctx->ListState.CurrentListNum);
    /* Install the list */
@@ -8180,6 +8713,10 @@ print_list(GLcontext *ctx, GLuint list)
             _mesa_printf("CallList %d + offset %u = %u\n", (int) n[1].ui,
                          ctx->List.ListBase, ctx->List.ListBase + n[1].ui);
             break;
+         case OPCODE_INLINED_LIST:
+            _mesa_printf("InlinedList %d (%u nodes)%s\n", (int) n[1].ui,
+                         n[3].ui, n[2].b ? " stale" : "");
+            break;
          case OPCODE_COLOR_TABLE_PARAMETER_FV:
             _mesa_printf("ColorTableParameterfv %s %s %f %f %f %f\n",
                          enum_string(n[1].e), enum_string(n[2].e),
@@ -8505,6 +9042,8 @@ _mesa_init_display_list(GLcontext *ctx)
    /* zero-out the instruction size table, just once */
    if (!tableInitialized) {
       _mesa_bzero(InstSize, sizeof(InstSize));
+      /* never allocated with _mesa_alloc_instruction() */
+      InstSize[OPCODE_INLINED_LIST] = 4;
       tableInitialized = GL_TRUE;
    }
 
@@ -8516,6 +9055,7 @@ _mesa_init_display_list(GLcontext *ctx)
    ctx->ListState.CurrentBlock = NULL;
    ctx->ListState.CurrentListNum = 0;
    ctx->ListState.CurrentPos = 0;
+   ctx->ListState.Optimize = _mesa_getenv("MESA_DLIST_OPT") != NULL;
 
    /* Display List group */
    ctx->List.ListBase = 0;
@@ -73,7 +73,8 @@ extern void *_mesa_alloc_instruction(GLcontext *ctx, GLuint opcode, GLuint sz);
 extern GLint _mesa_alloc_opcode( GLcontext *ctx, GLuint sz,
                                  void (*execute)( GLcontext *, void * ),
                                  void (*destroy)( GLcontext *, void * ),
-                                 void (*print)( GLcontext *, void * ) );
+                                 void (*print)( GLcontext *, void * ),
+                                 void (*copy)( GLcontext *, void * ) );
 
 extern void _mesa_init_display_list( GLcontext * ctx );
 
@@ -86,7 +86,7 @@ _mesa_exec_malloc(GLuint size)
    if (block)
       addr = exec_mem + block->ofs;
    else 
-      _mesa_printf("_mesa_exec_malloc failed\n");
+      _mesa_debug(NULL, "_mesa_exec_malloc failed\n");
    
    _glthread_UNLOCK_MUTEX(exec_mutex);
    
@@ -155,6 +155,7 @@ _mesa_remove_attachment(GLcontext *ctx, struct gl_renderbuffer_attachment *att)
          /* tell driver we're done rendering to this texobj */
          ctx->Driver.FinishRenderTexture(ctx, att);
       }
+      att->Texture->ImageStamp++;
       _mesa_reference_texobj(&att->Texture, NULL); /* unbind */
       ASSERT(!att->Texture);
    }
@@ -905,13 +906,13 @@ check_begin_texture_render(GLcontext *ctx, struct gl_framebuffer *fb)
 static void
 check_end_texture_render(GLcontext *ctx, struct gl_framebuffer *fb)
 {
-   if (ctx->Driver.FinishRenderTexture) {
-      GLuint i;
-      for (i = 0; i < BUFFER_COUNT; i++) {
-         struct gl_renderbuffer_attachment *att = fb->Attachment + i;
-         if (att->Texture && att->Renderbuffer) {
+   GLuint i;
+   for (i = 0; i < BUFFER_COUNT; i++) {
+      struct gl_renderbuffer_attachment *att = fb->Attachment + i;
+      if (att->Texture && att->Renderbuffer) {
+         if (ctx->Driver.FinishRenderTexture)
             ctx->Driver.FinishRenderTexture(ctx, att);
-         }
+         att->Texture->ImageStamp++;
       }
    }
 }
@@ -1545,6 +1546,7 @@ _mesa_GenerateMipmapEXT(GLenum target)
    /* XXX this might not handle cube maps correctly */
    _mesa_lock_texture(ctx, texObj);
    _mesa_generate_mipmap(ctx, target, texUnit, texObj);
+   texObj->ImageStamp++;
    _mesa_unlock_texture(ctx, texObj);
 }
 
@@ -4,6 +4,14 @@
  *
  * Used for display lists, texture objects, vertex/fragment programs,
  * buffer objects, etc.  The hash functions are thread-safe.
+ *
+ * Small keys, such as those handed out by _mesa_HashFindFreeKeyBlock(),
+ * index a dense array directly.  Other keys go into an open-addressed
+ * table with linear probing.  Both arrays grow as needed.
+ *
+ * Removed sparse entries are only marked as such, so probing can go on
+ * past them; they're dropped when the sparse table is rebuilt.  All
+ * functions, including lookups, take the table's mutex.
  * 
  * \note key=0 is illegal.
  *
@@ -12,9 +20,9 @@
 
 /*
  * Mesa 3-D graphics library
- * Version:  6.5.1
+ * Version:  7.1
  *
- * Copyright (C) 1999-2006  Brian Paul   All Rights Reserved.
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
  *
  * Permission is hereby granted, free of charge, to any person obtaining a
  * copy of this software and associated documentation files (the "Software"),
@@ -41,18 +49,55 @@
 #include "hash.h"
 
 
-#define TABLE_SIZE 1023  /**< Size of lookup table/array */
+/** Keys below this may be stored in the dense array */
+#define MAX_DENSE_SIZE (64 * 1024)
+
+#define MIN_DENSE_SIZE 256     /**< initial size of the dense array */
+#define MIN_SPARSE_SIZE 64     /**< initial size of the sparse table */
+
+#define HASH_FUNC(K, MASK)  ((((K) * 0x9e3779b1) >> 8) & (MASK))
+
 
-#define HASH_FUNC(K)  ((K) % TABLE_SIZE)
+/**
+ * Data pointer of removed entries (and of unused dense array slots).
+ */
+static int RemovedEntry;
+#define REMOVED ((void *) &RemovedEntry)
+
+
+/**
+ * Is the sparse table entry in use?  Keys below the dense array size
+ * are left over from before the dense array grew, until the sparse table
+ * is rebuilt.
+ */
+#define SPARSE_LIVE(TABLE, ENTRY)			\
+   ((ENTRY)->Key >= (TABLE)->Dense->Size && (ENTRY)->Data != REMOVED)
 
 
 /**
- * An entry in the hash table.  
+ * An entry in the sparse table.  Key is zero for unused slots.
  */
 struct HashEntry {
    GLuint Key;             /**< the entry's key */
-   void *Data;             /**< the entry's data */
-   struct HashEntry *Next; /**< pointer to next entry */
+   void *Data;             /**< the entry's data, or REMOVED */
+};
+
+
+/**
+ * The dense array: Data[key] for keys in [1, Size).
+ */
+struct DenseArray {
+   GLuint Size;
+   void *Data[1];                /**< actually Size pointers */
+};
+
+
+/**
+ * The sparse table.  Size is a power of two.
+ */
+struct SparseArray {
+   GLuint Size;
+   struct HashEntry Entries[1];  /**< actually Size entries */
 };
 
 
@@ -60,14 +105,44 @@ struct HashEntry {
  * The hash table data structure.  
  */
 struct _mesa_HashTable {
-   struct HashEntry *Table[TABLE_SIZE];  /**< the lookup table */
-   GLuint MaxKey;                        /**< highest key inserted so far */
-   _glthread_Mutex Mutex;                /**< mutual exclusion lock */
-   GLboolean InDeleteAll;                /**< Debug check */
+   struct DenseArray *Dense;     /**< directly indexed small keys */
+   struct SparseArray *Sparse;   /**< open-addressed larger keys */
+   GLuint SparseUsed;            /**< number of non-zero keys in Sparse */
+   GLuint MaxKey;                /**< highest key inserted so far */
+   _glthread_Mutex Mutex;        /**< mutual exclusion lock */
+   GLboolean InDeleteAll;        /**< Debug check */
 };
 
 
 
+static struct DenseArray *
+new_dense_array(GLuint size)
+{
+   struct DenseArray *dense = (struct DenseArray *)
+      _mesa_malloc(sizeof(struct DenseArray) + (size - 1) * sizeof(void *));
+   if (dense) {
+      GLuint i;
+      dense->Size = size;
+      for (i = 0; i < size; i++)
+         dense->Data[i] = REMOVED;
+   }
+   return dense;
+}
+
+
+static struct SparseArray *
+new_sparse_array(GLuint size)
+{
+   struct SparseArray *sparse = (struct SparseArray *)
+      _mesa_calloc(sizeof(struct SparseArray) +
+                   (size - 1) * sizeof(struct HashEntry));
+   if (sparse) {
+      sparse->Size = size;
+   }
+   return sparse;
+}
+
+
 /**
  * Create a new hash table.
  * 
@@ -78,6 +153,16 @@ _mesa_NewHashTable(void)
 {
    struct _mesa_HashTable *table = CALLOC_STRUCT(_mesa_HashTable);
    if (table) {
+      table->Dense = new_dense_array(MIN_DENSE_SIZE);
+      table->Sparse = new_sparse_array(MIN_SPARSE_SIZE);
+      if (!table->Dense || !table->Sparse) {
+         if (table->Dense)
+            _mesa_free(table->Dense);
+         if (table->Sparse)
+            _mesa_free(table->Sparse);
+         _mesa_free(table);
+         return NULL;
+      }
       _glthread_INIT_MUTEX(table->Mutex);
    }
    return table;
@@ -87,7 +172,7 @@ _mesa_NewHashTable(void)
 
 /**
  * Delete a hash table.
- * Frees each entry on the hash table and then the hash table structure itself.
+ * Frees the hash table arrays and then the hash table structure itself.
  * Note that the caller should have already traversed the table and deleted
  * the objects in the table (i.e. We don't free the entries' data pointer).
  *
@@ -96,26 +181,71 @@ _mesa_NewHashTable(void)
 void
 _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 {
-   GLuint pos;
+   GLuint i;
+
    assert(table);
-   for (pos = 0; pos < TABLE_SIZE; pos++) {
-      struct HashEntry *entry = table->Table[pos];
-      while (entry) {
-	 struct HashEntry *next = entry->Next;
-         if (entry->Data) {
-            _mesa_problem(NULL,
-                          "In _mesa_DeleteHashTable, found non-freed data");
-         }
-	 _mesa_free(entry);
-	 entry = next;
+
+   for (i = 1; i < table->Dense->Size; i++) {
+      if (table->Dense->Data[i] && table->Dense->Data[i] != REMOVED) {
+         _mesa_problem(NULL, "In _mesa_DeleteHashTable, found non-freed data");
+         break;
+      }
+   }
+   for (i = 0; i < table->Sparse->Size; i++) {
+      const struct HashEntry *entry = &table->Sparse->Entries[i];
+      if (SPARSE_LIVE(table, entry) && entry->Data) {
+         _mesa_problem(NULL, "In _mesa_DeleteHashTable, found non-freed data");
+         break;
       }
    }
+
+   _mesa_free(table->Dense);
+   _mesa_free(table->Sparse);
+
    _glthread_DESTROY_MUTEX(table->Mutex);
    _mesa_free(table);
 }
 
 
 
+/**
+ * Find the sparse table slot for the given key.
+ * \return the key's entry, or the unused entry where it would be inserted
+ */
+static INLINE struct HashEntry *
+find_sparse_entry(const struct SparseArray *sparse, GLuint key)
+{
+   const GLuint mask = sparse->Size - 1;
+   GLuint pos = HASH_FUNC(key, mask);
+   for (;;) {
+      const struct HashEntry *entry = &sparse->Entries[pos];
+      if (entry->Key == key || entry->Key == 0)
+         return (struct HashEntry *) entry;
+      pos = (pos + 1) & mask;
+   }
+}
+
+
+
+/**
+ * Lookup an entry, with the table already locked.
+ */
+static INLINE void *
+lookup_locked(const struct _mesa_HashTable *table, GLuint key)
+{
+   void *data;
+
+   if (key < table->Dense->Size) {
+      data = table->Dense->Data[key];
+   }
+   else {
+      const struct HashEntry *entry = find_sparse_entry(table->Sparse, key);
+      data = entry->Key ? entry->Data : NULL;
+   }
+   return data == REMOVED ? NULL : data;
+}
+
+
 /**
  * Lookup an entry in the hash table.
  * 
@@ -127,24 +257,95 @@ _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 void *
 _mesa_HashLookup(const struct _mesa_HashTable *table, GLuint key)
 {
-   GLuint pos;
-   const struct HashEntry *entry;
+   /* cast-away const */
+   struct _mesa_HashTable *table2 = (struct _mesa_HashTable *) table;
+   void *data;
 
    assert(table);
    assert(key);
 
-   pos = HASH_FUNC(key);
-   entry = table->Table[pos];
-   while (entry) {
-      if (entry->Key == key) {
-	 return entry->Data;
+   _glthread_LOCK_MUTEX(table2->Mutex);
+   data = lookup_locked(table, key);
+   _glthread_UNLOCK_MUTEX(table2->Mutex);
+   return data;
+}
+
+
+
+/**
+ * Replace the dense array with a bigger one which can hold the given key.
+ */
+static GLboolean
+grow_dense_array(struct _mesa_HashTable *table, GLuint key)
+{
+   struct DenseArray *old = table->Dense;
+   struct DenseArray *dense;
+   GLuint size = old->Size, i;
+
+   while (size <= key)
+      size *= 2;
+
+   dense = new_dense_array(size);
+   if (!dense)
+      return GL_FALSE;
+
+   for (i = 0; i < old->Size; i++)
+      dense->Data[i] = old->Data[i];
+
+   /* Keys which were in the sparse table now belong in the dense array.
+    * The stale sparse entries are ignored from now on (see SPARSE_LIVE).
+    */
+   for (i = 0; i < table->Sparse->Size; i++) {
+      const struct HashEntry *entry = &table->Sparse->Entries[i];
+      if (entry->Key && entry->Key < size && entry->Data != REMOVED) {
+         dense->Data[entry->Key] = entry->Data;
       }
-      entry = entry->Next;
    }
-   return NULL;
+
+   _mesa_free(old);
+   table->Dense = dense;
+   return GL_TRUE;
 }
 
 
+/**
+ * Replace the sparse table with a new one, dropping removed entries and
+ * doubling the size if it's still more than a quarter full.
+ */
+static GLboolean
+grow_sparse_array(struct _mesa_HashTable *table)
+{
+   struct SparseArray *old = table->Sparse;
+   struct SparseArray *sparse;
+   GLuint live = 0, size, i;
+
+   for (i = 0; i < old->Size; i++) {
+      if (SPARSE_LIVE(table, &old->Entries[i]))
+         live++;
+   }
+
+   size = old->Size;
+   if (live * 4 >= size)
+      size *= 2;
+
+   sparse = new_sparse_array(size);
+   if (!sparse)
+      return GL_FALSE;
+
+   table->SparseUsed = 0;
+   for (i = 0; i < old->Size; i++) {
+      const struct HashEntry *src = &old->Entries[i];
+      if (SPARSE_LIVE(table, src)) {
+         *find_sparse_entry(sparse, src->Key) = *src;
+         table->SparseUsed++;
+      }
+   }
+
+   _mesa_free(old);
+   table->Sparse = sparse;
+   return GL_TRUE;
+}
+
 
 /**
  * Insert a key/pointer pair into the hash table.  
@@ -157,8 +358,6 @@ _mesa_HashLookup(const struct _mesa_HashTable *table, GLuint key)
 void
 _mesa_HashInsert(struct _mesa_HashTable *table, GLuint key, void *data)
 {
-   /* search for existing entry with this key */
-   GLuint pos;
    struct HashEntry *entry;
 
    assert(table);
@@ -169,29 +368,31 @@ _mesa_HashInsert(struct _mesa_HashTable *table, GLuint key, void *data)
    if (key > table->MaxKey)
       table->MaxKey = key;
 
-   pos = HASH_FUNC(key);
+   if (key >= table->Dense->Size && key < MAX_DENSE_SIZE)
+      (void) grow_dense_array(table, key);
 
-   /* check if replacing an existing entry with same key */
-   for (entry = table->Table[pos]; entry; entry = entry->Next) {
-      if (entry->Key == key) {
-         /* replace entry's data */
-#if 0 /* not sure this check is always valid */
-         if (entry->Data) {
-            _mesa_problem(NULL, "Memory leak detected in _mesa_HashInsert");
+   if (key < table->Dense->Size) {
+      table->Dense->Data[key] = data;
+      _glthread_UNLOCK_MUTEX(table->Mutex);
+      return;
+   }
+
+   entry = find_sparse_entry(table->Sparse, key);
+   if (!entry->Key) {
+      /* new key, keep the table at most half full */
+      if ((table->SparseUsed + 1) * 2 > table->Sparse->Size) {
+         if (!grow_sparse_array(table)) {
+            _glthread_UNLOCK_MUTEX(table->Mutex);
+            _mesa_problem(NULL, "Out of memory in _mesa_HashInsert");
+            return;
          }
-#endif
-	 entry->Data = data;
-         _glthread_UNLOCK_MUTEX(table->Mutex);
-	 return;
+         entry = find_sparse_entry(table->Sparse, key);
       }
+      table->SparseUsed++;
    }
 
-   /* alloc and insert new table entry */
-   entry = MALLOC_STRUCT(HashEntry);
-   entry->Key = key;
    entry->Data = data;
-   entry->Next = table->Table[pos];
-   table->Table[pos] = entry;
+   entry->Key = key;
 
    _glthread_UNLOCK_MUTEX(table->Mutex);
 }
@@ -205,14 +406,11 @@ _mesa_HashInsert(struct _mesa_HashTable *table, GLuint key, void *data)
  * \param key key of entry to remove.
  *
  * While holding the hash table's lock, searches the entry with the matching
- * key and unlinks it.
+ * key and marks it as removed.
  */
 void
 _mesa_HashRemove(struct _mesa_HashTable *table, GLuint key)
 {
-   GLuint pos;
-   struct HashEntry *entry, *prev;
-
    assert(table);
    assert(key);
 
@@ -225,24 +423,13 @@ _mesa_HashRemove(struct _mesa_HashTable *table, GLuint key)
 
    _glthread_LOCK_MUTEX(table->Mutex);
 
-   pos = HASH_FUNC(key);
-   prev = NULL;
-   entry = table->Table[pos];
-   while (entry) {
-      if (entry->Key == key) {
-         /* found it! */
-         if (prev) {
-            prev->Next = entry->Next;
-         }
-         else {
-            table->Table[pos] = entry->Next;
-         }
-         _mesa_free(entry);
-         _glthread_UNLOCK_MUTEX(table->Mutex);
-	 return;
-      }
-      prev = entry;
-      entry = entry->Next;
+   if (key < table->Dense->Size) {
+      table->Dense->Data[key] = REMOVED;
+   }
+   else {
+      struct HashEntry *entry = find_sparse_entry(table->Sparse, key);
+      if (entry->Key)
+         entry->Data = REMOVED;
    }
 
    _glthread_UNLOCK_MUTEX(table->Mutex);
@@ -264,19 +451,27 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
                     void (*callback)(GLuint key, void *data, void *userData),
                     void *userData)
 {
+   struct DenseArray *dense;
+   struct SparseArray *sparse;
    GLuint pos;
    ASSERT(table);
    ASSERT(callback);
    _glthread_LOCK_MUTEX(table->Mutex);
    table->InDeleteAll = GL_TRUE;
-   for (pos = 0; pos < TABLE_SIZE; pos++) {
-      struct HashEntry *entry, *next;
-      for (entry = table->Table[pos]; entry; entry = next) {
+   dense = table->Dense;
+   for (pos = 1; pos < dense->Size; pos++) {
+      if (dense->Data[pos] != REMOVED) {
+         callback(pos, dense->Data[pos], userData);
+         dense->Data[pos] = REMOVED;
+      }
+   }
+   sparse = table->Sparse;
+   for (pos = 0; pos < sparse->Size; pos++) {
+      struct HashEntry *entry = &sparse->Entries[pos];
+      if (SPARSE_LIVE(table, entry)) {
          callback(entry->Key, entry->Data, userData);
-         next = entry->Next;
-         _mesa_free(entry);
+         entry->Data = REMOVED;
       }
-      table->Table[pos] = NULL;
    }
    table->InDeleteAll = GL_FALSE;
    _glthread_UNLOCK_MUTEX(table->Mutex);
@@ -297,24 +492,55 @@ _mesa_HashWalk(const struct _mesa_HashTable *table,
 {
    /* cast-away const */
    struct _mesa_HashTable *table2 = (struct _mesa_HashTable *) table;
+   const struct DenseArray *dense;
+   const struct SparseArray *sparse;
    GLuint pos;
    ASSERT(table);
    ASSERT(callback);
-   _glthread_UNLOCK_MUTEX(table2->Mutex);
-   for (pos = 0; pos < TABLE_SIZE; pos++) {
-      struct HashEntry *entry;
-      for (entry = table->Table[pos]; entry; entry = entry->Next) {
+   _glthread_LOCK_MUTEX(table2->Mutex);
+   dense = table->Dense;
+   for (pos = 1; pos < dense->Size; pos++) {
+      if (dense->Data[pos] != REMOVED)
+         callback(pos, dense->Data[pos], userData);
+   }
+   sparse = table->Sparse;
+   for (pos = 0; pos < sparse->Size; pos++) {
+      const struct HashEntry *entry = &sparse->Entries[pos];
+      if (SPARSE_LIVE(table, entry))
          callback(entry->Key, entry->Data, userData);
-      }
    }
    _glthread_UNLOCK_MUTEX(table2->Mutex);
 }
 
 
+/**
+ * Return the first key found at or after the given dense array position,
+ * or in the sparse table at or after the given slot.
+ */
+static GLuint
+find_next_key(const struct _mesa_HashTable *table,
+              GLuint densePos, GLuint sparsePos)
+{
+   const struct DenseArray *dense = table->Dense;
+   const struct SparseArray *sparse = table->Sparse;
+
+   for (; densePos < dense->Size; densePos++) {
+      if (dense->Data[densePos] != REMOVED)
+         return densePos;
+   }
+   for (; sparsePos < sparse->Size; sparsePos++) {
+      const struct HashEntry *entry = &sparse->Entries[sparsePos];
+      if (SPARSE_LIVE(table, entry))
+         return entry->Key;
+   }
+   return 0;
+}
+
+
 /**
  * Return the key of the "first" entry in the hash table.
  * While holding the lock, walks through all table positions until finding
- * the first entry of the first non-empty one.
+ * the first used one.
  * 
  * \param table  the hash table
  * \return key for the "first" entry in the hash table.
@@ -322,17 +548,12 @@ _mesa_HashWalk(const struct _mesa_HashTable *table,
 GLuint
 _mesa_HashFirstEntry(struct _mesa_HashTable *table)
 {
-   GLuint pos;
+   GLuint key;
    assert(table);
    _glthread_LOCK_MUTEX(table->Mutex);
-   for (pos = 0; pos < TABLE_SIZE; pos++) {
-      if (table->Table[pos]) {
-         _glthread_UNLOCK_MUTEX(table->Mutex);
-         return table->Table[pos]->Key;
-      }
-   }
+   key = find_next_key(table, 1, 0);
    _glthread_UNLOCK_MUTEX(table->Mutex);
-   return 0;
+   return key;
 }
 
 
@@ -345,40 +566,36 @@ _mesa_HashFirstEntry(struct _mesa_HashTable *table)
 GLuint
 _mesa_HashNextEntry(const struct _mesa_HashTable *table, GLuint key)
 {
+   /* cast-away const */
+   struct _mesa_HashTable *table2 = (struct _mesa_HashTable *) table;
+   const struct SparseArray *sparse;
    const struct HashEntry *entry;
-   GLuint pos;
+   GLuint next;
 
    assert(table);
    assert(key);
 
-   /* Find the entry with given key */
-   pos = HASH_FUNC(key);
-   for (entry = table->Table[pos]; entry ; entry = entry->Next) {
-      if (entry->Key == key) {
-         break;
-      }
-   }
+   _glthread_LOCK_MUTEX(table2->Mutex);
 
-   if (!entry) {
-      /* the given key was not found, so we can't find the next entry */
-      return 0;
-   }
-
-   if (entry->Next) {
-      /* return next in linked list */
-      return entry->Next->Key;
+   if (key < table->Dense->Size) {
+      next = find_next_key(table, key + 1, 0);
    }
    else {
-      /* look for next non-empty table slot */
-      pos++;
-      while (pos < TABLE_SIZE) {
-         if (table->Table[pos]) {
-            return table->Table[pos]->Key;
-         }
-         pos++;
+      /* Find the entry with given key */
+      sparse = table->Sparse;
+      entry = find_sparse_entry(sparse, key);
+      if (entry->Key) {
+         next = find_next_key(table, table->Dense->Size,
+                              (GLuint) (entry - sparse->Entries) + 1);
+      }
+      else {
+         /* the given key was not found, so we can't find the next entry */
+         next = 0;
       }
-      return 0;
    }
+
+   _glthread_UNLOCK_MUTEX(table2->Mutex);
+   return next;
 }
 
 
@@ -390,14 +607,11 @@ _mesa_HashNextEntry(const struct _mesa_HashTable *table, GLuint key)
 void
 _mesa_HashPrint(const struct _mesa_HashTable *table)
 {
-   GLuint pos;
+   GLuint key;
    assert(table);
-   for (pos = 0; pos < TABLE_SIZE; pos++) {
-      const struct HashEntry *entry = table->Table[pos];
-      while (entry) {
-	 _mesa_debug(NULL, "%u %p\n", entry->Key, entry->Data);
-	 entry = entry->Next;
-      }
+   for (key = _mesa_HashFirstEntry((struct _mesa_HashTable *) table); key;
+        key = _mesa_HashNextEntry(table, key)) {
+      _mesa_debug(NULL, "%u %p\n", key, _mesa_HashLookup(table, key));
    }
 }
 
@@ -432,7 +646,7 @@ _mesa_HashFindFreeKeyBlock(struct _mesa_HashTable *table, GLuint numKeys)
       GLuint freeStart = 1;
       GLuint key;
       for (key = 1; key != maxKey; key++) {
-	 if (_mesa_HashLookup(table, key)) {
+	 if (lookup_locked(table, key)) {
 	    /* darn, this key is already in use */
 	    freeCount = 0;
 	    freeStart = key+1;
@@ -455,6 +669,10 @@ _mesa_HashFindFreeKeyBlock(struct _mesa_HashTable *table, GLuint numKeys)
 
 #if 0 /* debug only */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
 /**
  * Test walking over all the entries in a hash table.
  */
@@ -496,6 +714,48 @@ test_hash_walking(void)
 }
 
 
+/**
+ * Time inserting, looking up and removing numKeys keys.
+ * If sparse is set the keys are random, else they're 1..numKeys as
+ * glGenLists/glGenTextures would return.
+ */
+static void
+bench_hash(GLuint numKeys, GLboolean sparse)
+{
+   struct _mesa_HashTable *t = _mesa_NewHashTable();
+   GLuint *keys = (GLuint *) _mesa_malloc(numKeys * sizeof(GLuint));
+   GLuint i, rep, found = 0;
+   clock_t start, insert, lookup;
+
+   for (i = 0; i < numKeys; i++) {
+      keys[i] = sparse ? (((GLuint) rand() << 16) ^ rand()) | 1 : i + 1;
+   }
+
+   start = clock();
+   for (i = 0; i < numKeys; i++)
+      _mesa_HashInsert(t, keys[i], keys + i);
+   insert = clock();
+   for (rep = 0; rep < 10; rep++) {
+      for (i = 0; i < numKeys; i++) {
+         if (_mesa_HashLookup(t, keys[(i * 7919) % numKeys]))
+            found++;
+      }
+   }
+   lookup = clock();
+   for (i = 0; i < numKeys; i++)
+      _mesa_HashRemove(t, keys[i]);
+
+   printf("%u %s keys: insert %.1f ns, lookup %.1f ns (%u found)\n",
+          numKeys, sparse ? "random" : "sequential",
+          1e9 * (insert - start) / CLOCKS_PER_SEC / numKeys,
+          1e9 * (lookup - insert) / CLOCKS_PER_SEC / (10.0 * numKeys),
+          found);
+
+   _mesa_free(keys);
+   _mesa_DeleteHashTable(t);
+}
+
+
 void
 _mesa_test_hash_functions(void)
 {
@@ -510,11 +770,20 @@ _mesa_test_hash_functions(void)
 
    assert(_mesa_HashLookup(t,501));
    assert(!_mesa_HashLookup(t,1313));
+   assert(_mesa_HashLookup(t,0xfffffff8) == &b);
    assert(_mesa_HashFindFreeKeyBlock(t, 100));
 
+   _mesa_HashRemove(t, 501);
+   _mesa_HashRemove(t, 10);
+   _mesa_HashRemove(t, 0xfffffff8);
    _mesa_DeleteHashTable(t);
 
    test_hash_walking();
+
+   bench_hash(1000, GL_FALSE);
+   bench_hash(200000, GL_FALSE);
+   bench_hash(1000, GL_TRUE);
+   bench_hash(200000, GL_TRUE);
 }
 
 #endif
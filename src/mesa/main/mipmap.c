@@ -33,9 +33,189 @@
 #include "texformat.h"
 #include "teximage.h"
 #include "image.h"
+#include "macros.h"
+#include "threadpool.h"
 
 
 
+#if defined(__SSE2__)
+
+/*
+ * SSE2 versions of do_row() for the common 8-bit and float formats, for
+ * when the source row is twice as wide as the dest row.  They give the
+ * same results as the C code.  Only whole 32-byte blocks of source texels
+ * are done here, do_row() finishes the rest.
+ */
+
+#include <emmintrin.h>
+
+
+/**
+ * Add adjacent pairs of texels of 16-bit components.  The sums for the
+ * two (texelBytes 4), four (2) or eight (1) texels in 's' are returned
+ * in the low half of the result.
+ */
+static INLINE __m128i
+sse2_pair_sums(__m128i s, GLuint texelBytes)
+{
+   /* move the even texels to the low half, the odd ones to the high half */
+   if (texelBytes == 1) {
+      s = _mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 1, 2, 0));
+      s = _mm_shufflehi_epi16(s, _MM_SHUFFLE(3, 1, 2, 0));
+      s = _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 1, 2, 0));
+   }
+   else if (texelBytes == 2) {
+      s = _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 1, 2, 0));
+   }
+   return _mm_add_epi16(s, _mm_srli_si128(s, 8));
+}
+
+
+/**
+ * Box filter texels of 1, 2 or 4 unsigned bytes, 16 dest bytes at a time.
+ * \return number of dest texels done
+ */
+static GLint
+do_row_ubyte_sse2(GLuint texelBytes, const GLubyte *rowA,
+                  const GLubyte *rowB, GLint dstWidth, GLubyte *dst)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const GLint n = dstWidth * texelBytes / 16 * 16;
+   GLint i;
+
+   for (i = 0; i < n; i += 16) {
+      const __m128i a0 = _mm_loadu_si128((const __m128i *) (rowA + 2 * i));
+      const __m128i a1 = _mm_loadu_si128((const __m128i *) (rowA + 2 * i + 16));
+      const __m128i b0 = _mm_loadu_si128((const __m128i *) (rowB + 2 * i));
+      const __m128i b1 = _mm_loadu_si128((const __m128i *) (rowB + 2 * i + 16));
+      __m128i s0, s1, s2, s3, lo, hi;
+
+      /* sum the two rows with 16-bit components */
+      s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero),
+                         _mm_unpacklo_epi8(b0, zero));
+      s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero),
+                         _mm_unpackhi_epi8(b0, zero));
+      s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero),
+                         _mm_unpacklo_epi8(b1, zero));
+      s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero),
+                         _mm_unpackhi_epi8(b1, zero));
+
+      /* then adjacent texels, and divide by four */
+      lo = _mm_unpacklo_epi64(sse2_pair_sums(s0, texelBytes),
+                              sse2_pair_sums(s1, texelBytes));
+      hi = _mm_unpacklo_epi64(sse2_pair_sums(s2, texelBytes),
+                              sse2_pair_sums(s3, texelBytes));
+      lo = _mm_srli_epi16(lo, 2);
+      hi = _mm_srli_epi16(hi, 2);
+
+      _mm_storeu_si128((__m128i *) (dst + i), _mm_packus_epi16(lo, hi));
+   }
+
+   return n / texelBytes;
+}
+
+
+/**
+ * Box filter texels of 1, 2 or 4 floats, 4 dest floats at a time.
+ * The sums are done in the same order as the C code.
+ * \return number of dest texels done
+ */
+static GLint
+do_row_float_sse2(GLuint comps, const GLfloat *rowA, const GLfloat *rowB,
+                  GLint dstWidth, GLfloat *dst)
+{
+   const __m128 quarter = _mm_set1_ps(0.25F);
+   const GLint n = dstWidth * comps / 4 * 4;
+   GLint i;
+
+   for (i = 0; i < n; i += 4) {
+      const __m128 a0 = _mm_loadu_ps(rowA + 2 * i);
+      const __m128 a1 = _mm_loadu_ps(rowA + 2 * i + 4);
+      const __m128 b0 = _mm_loadu_ps(rowB + 2 * i);
+      const __m128 b1 = _mm_loadu_ps(rowB + 2 * i + 4);
+      __m128 aj, ak, bj, bk, sum;
+
+      /* separate the even (j) and odd (k) texels */
+      if (comps == 1) {
+         aj = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0));
+         ak = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1));
+         bj = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0));
+         bk = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1));
+      }
+      else if (comps == 2) {
+         aj = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(1, 0, 1, 0));
+         ak = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 2, 3, 2));
+         bj = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(1, 0, 1, 0));
+         bk = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 2, 3, 2));
+      }
+      else {
+         aj = a0;
+         ak = a1;
+         bj = b0;
+         bk = b1;
+      }
+
+      sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(aj, ak), bj), bk);
+      _mm_storeu_ps(dst + i, _mm_mul_ps(sum, quarter));
+   }
+
+   return n / comps;
+}
+
+
+/**
+ * Try to do a 2:1 row reduction with SSE2.
+ * \return number of dest texels done
+ */
+static GLint
+do_row_sse2(const struct gl_texture_format *format,
+            const GLvoid *srcRowA, const GLvoid *srcRowB,
+            GLint dstWidth, GLvoid *dstRow)
+{
+   switch (format->MesaFormat) {
+#if CHAN_TYPE == GL_UNSIGNED_BYTE
+   case MESA_FORMAT_RGBA:
+   case MESA_FORMAT_LUMINANCE_ALPHA:
+   case MESA_FORMAT_ALPHA:
+   case MESA_FORMAT_LUMINANCE:
+   case MESA_FORMAT_INTENSITY:
+#endif
+   case MESA_FORMAT_RGBA8888:
+   case MESA_FORMAT_RGBA8888_REV:
+   case MESA_FORMAT_ARGB8888:
+   case MESA_FORMAT_ARGB8888_REV:
+   case MESA_FORMAT_AL88:
+   case MESA_FORMAT_AL88_REV:
+   case MESA_FORMAT_A8:
+   case MESA_FORMAT_L8:
+   case MESA_FORMAT_I8:
+   case MESA_FORMAT_CI8:
+#if FEATURE_EXT_texture_sRGB
+   case MESA_FORMAT_SRGBA8:
+   case MESA_FORMAT_SLA8:
+   case MESA_FORMAT_SL8:
+#endif
+      return do_row_ubyte_sse2(format->TexelBytes,
+                               (const GLubyte *) srcRowA,
+                               (const GLubyte *) srcRowB,
+                               dstWidth, (GLubyte *) dstRow);
+   case MESA_FORMAT_RGBA_FLOAT32:
+   case MESA_FORMAT_LUMINANCE_ALPHA_FLOAT32:
+   case MESA_FORMAT_ALPHA_FLOAT32:
+   case MESA_FORMAT_LUMINANCE_FLOAT32:
+   case MESA_FORMAT_INTENSITY_FLOAT32:
+      return do_row_float_sse2(format->TexelBytes / sizeof(GLfloat),
+                               (const GLfloat *) srcRowA,
+                               (const GLfloat *) srcRowB,
+                               dstWidth, (GLfloat *) dstRow);
+   default:
+      return 0;
+   }
+}
+
+#endif /* __SSE2__ */
+
+
 /**
  * Average together two rows of a source image to produce a single new
  * row in the dest image.  It's legal for the two source rows to point
@@ -54,6 +234,24 @@ do_row(const struct gl_texture_format *format, GLint srcWidth,
    assert(srcWidth == dstWidth || srcWidth == 2 * dstWidth);
    */
 
+#if defined(__SSE2__)
+   if (colStride == 2) {
+      const GLint done = do_row_sse2(format, srcRowA, srcRowB,
+                                     dstWidth, dstRow);
+      if (done > 0) {
+         if (done < dstWidth) {
+            /* finish the row in C */
+            const GLint bpt = format->TexelBytes;
+            do_row(format, 2 * (dstWidth - done),
+                   (const GLubyte *) srcRowA + 2 * done * bpt,
+                   (const GLubyte *) srcRowB + 2 * done * bpt,
+                   dstWidth - done, (GLubyte *) dstRow + done * bpt);
+         }
+         return;
+      }
+   }
+#endif
+
    switch (format->MesaFormat) {
    case MESA_FORMAT_RGBA:
       {
@@ -503,6 +701,58 @@ do_row(const struct gl_texture_format *format, GLint srcWidth,
  * border texels, depending on the scale-down factor.
  */
 
+/**
+ * Don't give a thread a band of fewer dest texels than this.
+ */
+#define MIN_BAND_TEXELS (32 * 1024)
+
+
+/**
+ * Number of bands to split 'count' rows or images of 'texelsEach' dest
+ * texels into, to be run on the thread pool.
+ */
+static GLuint
+num_bands(struct _mesa_threadpool *pool, GLint count, GLint texelsEach)
+{
+   const GLint minCount = MAX2(MIN_BAND_TEXELS / MAX2(texelsEach, 1), 1);
+   return MIN2(_mesa_threadpool_size(pool), MAX2(count / minCount, 1));
+}
+
+
+/**
+ * A band of dest rows of a 2D image, for make_2d_rows().
+ */
+struct mipmap_rows
+{
+   const struct gl_texture_format *format;
+   GLint srcWidth, dstWidth;
+   const GLubyte *srcA, *srcB;          /**< first pair of source rows */
+   GLint srcRowStride;                  /**< between pairs of source rows */
+   GLubyte *dst;
+   GLint dstRowStride;
+   GLint rows, rowsPerBand;
+};
+
+
+static void
+make_2d_rows(void *data, GLuint band, GLuint thread)
+{
+   const struct mipmap_rows *r = (const struct mipmap_rows *) data;
+   const GLint first = band * r->rowsPerBand;
+   const GLint last = MIN2(first + r->rowsPerBand, r->rows);
+   GLint row;
+
+   (void) thread;
+
+   for (row = first; row < last; row++) {
+      do_row(r->format, r->srcWidth,
+             r->srcA + row * r->srcRowStride,
+             r->srcB + row * r->srcRowStride,
+             r->dstWidth, r->dst + row * r->dstRowStride);
+   }
+}
+
+
 static void
 make_1d_mipmap(const struct gl_texture_format *format, GLint border,
                GLint srcWidth, const GLubyte *srcPtr,
@@ -557,12 +807,26 @@ make_2d_mipmap(const struct gl_texture_format *format, GLint border,
       srcB = srcA;
    dst = dstPtr + border * ((dstWidth + 1) * bpt);
 
-   for (row = 0; row < dstHeightNB; row++) {
-      do_row(format, srcWidthNB, srcA, srcB,
-             dstWidthNB, dst);
-      srcA += 2 * srcRowStride;
-      srcB += 2 * srcRowStride;
-      dst += dstRowStride;
+   /* Large images are done in bands of rows on several threads */
+   {
+      struct _mesa_threadpool *pool = _mesa_get_threadpool();
+      struct mipmap_rows rows;
+      GLuint numBands = num_bands(pool, dstHeightNB, dstWidthNB);
+
+      rows.format = format;
+      rows.srcWidth = srcWidthNB;
+      rows.dstWidth = dstWidthNB;
+      rows.srcA = srcA;
+      rows.srcB = srcB;
+      rows.srcRowStride = 2 * srcRowStride;
+      rows.dst = dst;
+      rows.dstRowStride = dstRowStride;
+      rows.rows = dstHeightNB;
+      rows.rowsPerBand = (dstHeightNB + numBands - 1) / numBands;
+      if (numBands > 1)
+         _mesa_threadpool_run(pool, numBands, make_2d_rows, &rows);
+      else
+         make_2d_rows(&rows, 0, 0);
    }
 
    /* This is ugly but probably won't be used much */
@@ -617,6 +881,90 @@ make_2d_mipmap(const struct gl_texture_format *format, GLint border,
 }
 
 
+/**
+ * A band of dest images of a 3D texture, for make_3d_images().
+ */
+struct mipmap_images
+{
+   const struct gl_texture_format *format;
+   GLint border;
+   GLint srcWidth, srcWidthNB, dstWidthNB, dstHeightNB;
+   const GLubyte *srcPtr;
+   GLubyte *dstPtr;
+   GLint bytesPerSrcImage, bytesPerDstImage;
+   GLint bytesPerSrcRow, bytesPerDstRow;
+   GLint srcImageOffset, srcRowOffset;
+   GLint images, imagesPerBand;
+};
+
+
+static void
+make_3d_images(void *data, GLuint band, GLuint thread)
+{
+   const struct mipmap_images *m = (const struct mipmap_images *) data;
+   const struct gl_texture_format *format = m->format;
+   const GLint bpt = format->TexelBytes;
+   const GLint border = m->border;
+   const GLint first = band * m->imagesPerBand;
+   const GLint last = MIN2(first + m->imagesPerBand, m->images);
+   GLvoid *tmpRowA, *tmpRowB;
+   GLint img, row;
+
+   (void) thread;
+
+   /* Need two temporary row buffers */
+   tmpRowA = _mesa_malloc(m->srcWidth * bpt);
+   if (!tmpRowA)
+      return;
+   tmpRowB = _mesa_malloc(m->srcWidth * bpt);
+   if (!tmpRowB) {
+      _mesa_free(tmpRowA);
+      return;
+   }
+
+   for (img = first; img < last; img++) {
+      /* first source image pointer, skipping border */
+      const GLubyte *imgSrcA = m->srcPtr
+         + (m->bytesPerSrcImage + m->bytesPerSrcRow + border) * bpt * border
+         + img * (m->bytesPerSrcImage + m->srcImageOffset);
+      /* second source image pointer, skipping border */
+      const GLubyte *imgSrcB = imgSrcA + m->srcImageOffset;
+      /* address of the dest image, skipping border */
+      GLubyte *imgDst = m->dstPtr
+         + (m->bytesPerDstImage + m->bytesPerDstRow + border) * bpt * border
+         + img * m->bytesPerDstImage;
+
+      /* setup the four source row pointers and the dest row pointer */
+      const GLubyte *srcImgARowA = imgSrcA;
+      const GLubyte *srcImgARowB = imgSrcA + m->srcRowOffset;
+      const GLubyte *srcImgBRowA = imgSrcB;
+      const GLubyte *srcImgBRowB = imgSrcB + m->srcRowOffset;
+      GLubyte *dstImgRow = imgDst;
+
+      for (row = 0; row < m->dstHeightNB; row++) {
+         /* Average together two rows from first src image */
+         do_row(format, m->srcWidthNB, srcImgARowA, srcImgARowB,
+                m->srcWidthNB, tmpRowA);
+         /* Average together two rows from second src image */
+         do_row(format, m->srcWidthNB, srcImgBRowA, srcImgBRowB,
+                m->srcWidthNB, tmpRowB);
+         /* Average together the temp rows to make the final row */
+         do_row(format, m->srcWidthNB, tmpRowA, tmpRowB,
+                m->dstWidthNB, dstImgRow);
+         /* advance to next rows */
+         srcImgARowA += m->bytesPerSrcRow + m->srcRowOffset;
+         srcImgARowB += m->bytesPerSrcRow + m->srcRowOffset;
+         srcImgBRowA += m->bytesPerSrcRow + m->srcRowOffset;
+         srcImgBRowB += m->bytesPerSrcRow + m->srcRowOffset;
+         dstImgRow += m->bytesPerDstRow;
+      }
+   }
+
+   _mesa_free(tmpRowA);
+   _mesa_free(tmpRowB);
+}
+
+
 static void
 make_3d_mipmap(const struct gl_texture_format *format, GLint border,
                GLint srcWidth, GLint srcHeight, GLint srcDepth,
@@ -630,24 +978,16 @@ make_3d_mipmap(const struct gl_texture_format *format, GLint border,
    const GLint dstWidthNB = dstWidth - 2 * border;
    const GLint dstHeightNB = dstHeight - 2 * border;
    const GLint dstDepthNB = dstDepth - 2 * border;
-   GLvoid *tmpRowA, *tmpRowB;
-   GLint img, row;
+   struct _mesa_threadpool *pool = _mesa_get_threadpool();
+   struct mipmap_images images;
+   GLuint numBands;
+   GLint img;
    GLint bytesPerSrcImage, bytesPerDstImage;
    GLint bytesPerSrcRow, bytesPerDstRow;
    GLint srcImageOffset, srcRowOffset;
 
    (void) srcDepthNB; /* silence warnings */
 
-   /* Need two temporary row buffers */
-   tmpRowA = _mesa_malloc(srcWidth * bpt);
-   if (!tmpRowA)
-      return;
-   tmpRowB = _mesa_malloc(srcWidth * bpt);
-   if (!tmpRowB) {
-      _mesa_free(tmpRowA);
-      return;
-   }
-
    bytesPerSrcImage = srcWidth * srcHeight * bpt;
    bytesPerDstImage = dstWidth * dstHeight * bpt;
 
@@ -673,46 +1013,29 @@ make_3d_mipmap(const struct gl_texture_format *format, GLint border,
           srcWidth, srcHeight, srcDepth, dstWidth, dstHeight, dstDepth);
    */
 
-   for (img = 0; img < dstDepthNB; img++) {
-      /* first source image pointer, skipping border */
-      const GLubyte *imgSrcA = srcPtr
-         + (bytesPerSrcImage + bytesPerSrcRow + border) * bpt * border
-         + img * (bytesPerSrcImage + srcImageOffset);
-      /* second source image pointer, skipping border */
-      const GLubyte *imgSrcB = imgSrcA + srcImageOffset;
-      /* address of the dest image, skipping border */
-      GLubyte *imgDst = dstPtr
-         + (bytesPerDstImage + bytesPerDstRow + border) * bpt * border
-         + img * bytesPerDstImage;
-
-      /* setup the four source row pointers and the dest row pointer */
-      const GLubyte *srcImgARowA = imgSrcA;
-      const GLubyte *srcImgARowB = imgSrcA + srcRowOffset;
-      const GLubyte *srcImgBRowA = imgSrcB;
-      const GLubyte *srcImgBRowB = imgSrcB + srcRowOffset;
-      GLubyte *dstImgRow = imgDst;
-
-      for (row = 0; row < dstHeightNB; row++) {
-         /* Average together two rows from first src image */
-         do_row(format, srcWidthNB, srcImgARowA, srcImgARowB,
-                srcWidthNB, tmpRowA);
-         /* Average together two rows from second src image */
-         do_row(format, srcWidthNB, srcImgBRowA, srcImgBRowB,
-                srcWidthNB, tmpRowB);
-         /* Average together the temp rows to make the final row */
-         do_row(format, srcWidthNB, tmpRowA, tmpRowB,
-                dstWidthNB, dstImgRow);
-         /* advance to next rows */
-         srcImgARowA += bytesPerSrcRow + srcRowOffset;
-         srcImgARowB += bytesPerSrcRow + srcRowOffset;
-         srcImgBRowA += bytesPerSrcRow + srcRowOffset;
-         srcImgBRowB += bytesPerSrcRow + srcRowOffset;
-         dstImgRow += bytesPerDstRow;
-      }
-   }
-
-   _mesa_free(tmpRowA);
-   _mesa_free(tmpRowB);
+   images.format = format;
+   images.border = border;
+   images.srcWidth = srcWidth;
+   images.srcWidthNB = srcWidthNB;
+   images.dstWidthNB = dstWidthNB;
+   images.dstHeightNB = dstHeightNB;
+   images.srcPtr = srcPtr;
+   images.dstPtr = dstPtr;
+   images.bytesPerSrcImage = bytesPerSrcImage;
+   images.bytesPerDstImage = bytesPerDstImage;
+   images.bytesPerSrcRow = bytesPerSrcRow;
+   images.bytesPerDstRow = bytesPerDstRow;
+   images.srcImageOffset = srcImageOffset;
+   images.srcRowOffset = srcRowOffset;
+   images.images = dstDepthNB;
+
+   /* Large volumes are done in bands of images on several threads */
+   numBands = num_bands(pool, dstDepthNB, dstWidthNB * dstHeightNB);
+   images.imagesPerBand = (dstDepthNB + numBands - 1) / numBands;
+   if (numBands > 1)
+      _mesa_threadpool_run(pool, numBands, make_3d_images, &images);
+   else
+      make_3d_images(&images, 0, 0);
 
    /* Luckily we can leverage the make_2d_mipmap() function here! */
    if (border > 0) {
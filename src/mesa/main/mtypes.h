@@ -123,6 +123,7 @@ typedef int GLfixed;
 /*@{*/
 struct _mesa_HashTable;
 struct gl_pixelstore_attrib;
+struct gl_program_cache;
 struct gl_texture_format;
 struct gl_texture_image;
 struct gl_texture_object;
@@ -938,6 +939,8 @@ struct gl_list_instruction
    void (*Execute)( GLcontext *ctx, void *data );
    void (*Destroy)( GLcontext *ctx, void *data );
    void (*Print)( GLcontext *ctx, void *data );
+   /** Called on a duplicate of an instruction, may be NULL */
+   void (*Copy)( GLcontext *ctx, void *data );
 };
 
 #define MAX_DLIST_EXT_OPCODES 16
@@ -1369,6 +1372,8 @@ struct gl_texture_image
    GLuint *ImageOffsets;        /**< if 3D texture: array [Depth] of offsets to
                                      each 2D slice in 'Data', in texels */
    GLvoid *Data;		/**< Image data, accessed via FetchTexel() */
+   void *DecodedBlocks;		/**< Cache of decoded compressed blocks,
+                                     used by the FetchTexel functions */
 
    /**
     * \name For device driver:
@@ -1432,6 +1437,7 @@ struct gl_texture_object
    GLfloat _MaxLambda;		/**< = _MaxLevel - BaseLevel (q - b in spec) */
    GLboolean GenerateMipmap;    /**< GL_SGIS_generate_mipmap */
    GLboolean _Complete;		/**< Is texture object complete? */
+   GLuint ImageStamp;		/**< Bumped when image contents change */
 
    /** Actual texture images, indexed by [cube face] and [mipmap level] */
    struct gl_texture_image *Image[MAX_FACES][MAX_TEXTURE_LEVELS];
@@ -1544,19 +1550,6 @@ struct gl_texture_unit
    /*@}*/
 };
 
-struct texenvprog_cache_item {
-   GLuint hash;
-   void *key;
-   struct gl_fragment_program *data;
-   struct texenvprog_cache_item *next;
-};
-
-struct texenvprog_cache {
-   struct texenvprog_cache_item **items;
-   GLuint size, n_items;
-   GLcontext *ctx;
-};
-
 /**
  * Texture attribute group (GL_TEXTURE_BIT).
  */
@@ -1582,9 +1575,6 @@ struct gl_texture_attrib
    /** GL_EXT_shared_texture_palette */
    GLboolean SharedPalette;
    struct gl_color_table Palette;
-   
-   /** Cached texenv fragment programs */
-   struct texenvprog_cache env_fp_cache;
 };
 
 
@@ -1918,6 +1908,9 @@ struct gl_program
    GLuint NumNativeTexInstructions;
    GLuint NumNativeTexIndirections;
    /*@}*/
+
+   /** Generated SSE code, if any (see shader/prog_execute_sse.c) */
+   struct prog_native_code *NativeCode;
 };
 
 
@@ -1978,6 +1971,9 @@ struct gl_vertex_program_state
    /** Program to emulate fixed-function T&L (see above) */
    struct gl_vertex_program *_TnlProgram;
 
+   /** Cache of fixed-function T&L programs, see prog_cache.c */
+   struct gl_program_cache *Cache;
+
 #if FEATURE_MESA_program_debug
    GLprogramcallbackMESA Callback;
    GLvoid *CallbackData;
@@ -2011,6 +2007,9 @@ struct gl_fragment_program_state
    /** Program to emulate fixed-function texture env/combine (see above) */
    struct gl_fragment_program *_TexEnvProgram;
 
+   /** Cache of texture env/combine programs, see prog_cache.c */
+   struct gl_program_cache *Cache;
+
 #if FEATURE_MESA_program_debug
    GLprogramcallbackMESA Callback;
    GLvoid *CallbackData;
@@ -2251,6 +2250,8 @@ struct gl_renderbuffer
    GLubyte DepthBits;
    GLubyte StencilBits;
    GLvoid *Data;        /**< This may not be used by some kinds of RBs */
+   GLuint DepthStamp;   /**< Changed by depth writes which may raise Z */
+   GLboolean AppAccess; /**< Data was handed out to the application */
 
    /* Used to wrap one renderbuffer around another: */
    struct gl_renderbuffer *Wrapped;
@@ -2858,6 +2859,8 @@ struct mesa_display_list
    Node *node;
    GLuint id;
    GLbitfield flags;
+   GLuint *callers;     /**< lists holding an inlined copy of this one */
+   GLuint numCallers;
 };
 
 
@@ -2887,6 +2890,8 @@ struct gl_dlist_state
    
    GLubyte ActiveEdgeFlag;
    GLboolean CurrentEdgeFlag;
+
+   GLboolean Optimize;		/**< Optimize lists in glEndList? */
 };
 
 
@@ -39,10 +39,11 @@
 #include "texcompress.h"
 #include "texformat.h"
 #include "texstore.h"
+#include "threadpool.h"
 
 
 static void
-fxt1_encode (GLuint width, GLuint height, GLint comps,
+fxt1_encode (GLcontext *ctx, GLuint width, GLuint height, GLint comps,
              const void *source, GLint srcRowStride,
              void *dest, GLint destRowStride);
 
@@ -108,7 +109,7 @@ texstore_rgb_fxt1(TEXSTORE_PARAMS)
                                         dstFormat->MesaFormat,
                                         texWidth, (GLubyte *) dstAddr);
 
-   fxt1_encode(srcWidth, srcHeight, 3, pixels, srcRowStride,
+   fxt1_encode(ctx, srcWidth, srcHeight, 3, pixels, srcRowStride,
                dst, dstRowStride);
 
    if (tempImage)
@@ -165,7 +166,7 @@ texstore_rgba_fxt1(TEXSTORE_PARAMS)
                                         dstFormat->MesaFormat,
                                         texWidth, (GLubyte *) dstAddr);
 
-   fxt1_encode(srcWidth, srcHeight, 4, pixels, srcRowStride,
+   fxt1_encode(ctx, srcWidth, srcHeight, 4, pixels, srcRowStride,
                dst, dstRowStride);
 
    if (tempImage)
@@ -282,17 +283,24 @@ const struct gl_texture_format _mesa_texformat_rgba_fxt1 = {
  * is merely a proof of concept, since it is highly UNoptimized;
  * moreover, it is sub-optimal due to initial conditions passed
  * to Lloyd's algorithm (the interpolation modes are even worse).
+ *
+ * By default each block is encoded with the cheap extrema-based
+ * modes only.  With the GL_NICEST texture compression hint the
+ * vector quantized modes are tried as well, seeded along the
+ * principal axis of the block so that a few Lloyd iterations
+ * suffice, and whichever encoding decodes closest is kept.
 \***************************************************************************/
 
 
 #define MAX_COMP 4 /* ever needed maximum number of components in texel */
 #define MAX_VECT 4 /* ever needed maximum number of base vectors to find */
 #define N_TEXELS 32 /* number of texels in a block (always 32) */
-#define LL_N_REP 50 /* number of iterations in lloyd's vq */
+#define LL_N_REP 6 /* number of iterations in lloyd's vq (seeded by pca) */
 #define LL_RMS_D 10 /* fault tolerance (maximum delta) */
 #define LL_RMS_E 255 /* fault tolerance (maximum error) */
 #define ALPHA_TS 2 /* alpha threshold: (255 - ALPHA_TS) deemed opaque */
 #define ISTBLACK(v) (*((GLuint *)(v)) == 0)
+#define MIN_BAND_BLOCKS 512 /* fewest blocks worth handing to a thread */
 
 
 /*
@@ -546,6 +554,85 @@ fxt1_choose (GLfloat vec[][MAX_COMP], GLint nv,
 }
 
 
+/**
+ * Spread the nv initial vectors evenly along the principal axis of the
+ * samples.  vec[0] and vec[nv - 1] must hold the fxt1_choose() extrema,
+ * whose difference seeds the power iteration.
+ */
+static void
+fxt1_pca (GLfloat vec[][MAX_COMP], GLint nv,
+          GLubyte input[N_TEXELS][MAX_COMP], GLint nc, GLint n)
+{
+   GLfloat mean[MAX_COMP], axis[MAX_COMP], tmp[MAX_COMP];
+   GLfloat cov[MAX_COMP][MAX_COMP];
+   GLfloat len, tmin = 0.0F, tmax = 0.0F;
+   GLint i, j, k, rep;
+
+   for (i = 0; i < nc; i++) {
+      mean[i] = 0.0F;
+      for (k = 0; k < n; k++) {
+         mean[i] += input[k][i];
+      }
+      mean[i] /= n;
+   }
+
+   for (i = 0; i < nc; i++) {
+      for (j = i; j < nc; j++) {
+         GLfloat c = 0.0F;
+         for (k = 0; k < n; k++) {
+            c += (input[k][i] - mean[i]) * (input[k][j] - mean[j]);
+         }
+         cov[i][j] = cov[j][i] = c;
+      }
+      axis[i] = vec[nv - 1][i] - vec[0][i];
+   }
+
+   for (rep = 0; rep < 8; rep++) {
+      GLfloat m = 0.0F;
+      for (i = 0; i < nc; i++) {
+         tmp[i] = 0.0F;
+         for (j = 0; j < nc; j++) {
+            tmp[i] += cov[i][j] * axis[j];
+         }
+         m = MAX2(m, FABSF(tmp[i]));
+      }
+      if (m < 1e-6F) {
+         break;
+      }
+      for (i = 0; i < nc; i++) {
+         axis[i] = tmp[i] / m;
+      }
+   }
+
+   len = 0.0F;
+   for (i = 0; i < nc; i++) {
+      len += axis[i] * axis[i];
+   }
+   if (len < 1e-6F) {
+      /* keep the extrema */
+      return;
+   }
+   len = 1.0F / len;
+
+   for (k = 0; k < n; k++) {
+      GLfloat t = 0.0F;
+      for (i = 0; i < nc; i++) {
+         t += (input[k][i] - mean[i]) * axis[i];
+      }
+      t *= len;
+      tmin = MIN2(tmin, t);
+      tmax = MAX2(tmax, t);
+   }
+
+   for (j = 0; j < nv; j++) {
+      const GLfloat t = tmin + (tmax - tmin) * j / (nv - 1);
+      for (i = 0; i < nc; i++) {
+         vec[j][i] = CLAMP(mean[i] + t * axis[i], 0.0F, 255.0F);
+      }
+   }
+}
+
+
 static GLint
 fxt1_lloyd (GLfloat vec[][MAX_COMP], GLint nv,
             GLubyte input[N_TEXELS][MAX_COMP], GLint nc, GLint n)
@@ -658,6 +745,7 @@ fxt1_quantize_CHROMA (GLuint *cc,
    GLuint lohi, lolo; /* low quadword: hi dword, lo dword */
 
    if (fxt1_choose(vec, n_vect, input, n_comp, N_TEXELS) != 0) {
+      fxt1_pca(vec, n_vect, input, n_comp, N_TEXELS);
       fxt1_lloyd(vec, n_vect, input, n_comp, N_TEXELS);
    }
 
@@ -706,6 +794,7 @@ fxt1_quantize_ALPHA0 (GLuint *cc,
 
    /* the first n texels in reord are guaranteed to be non-zero */
    if (fxt1_choose(vec, n_vect, reord, n_comp, n) != 0) {
+      fxt1_pca(vec, n_vect, reord, n_comp, n);
       fxt1_lloyd(vec, n_vect, reord, n_comp, n);
    }
 
@@ -1280,8 +1369,55 @@ fxt1_quantize_MIXED0 (GLuint *cc,
 }
 
 
+/**
+ * Sum of squared differences between the decoded block and the input.
+ */
+static GLuint
+fxt1_block_error (const GLuint *cc,
+                  GLubyte input[N_TEXELS][MAX_COMP], GLint comps)
+{
+   GLuint error = 0;
+   GLint i, j, c;
+
+   for (j = 0; j < 4; j++) {
+      for (i = 0; i < 8; i++) {
+         const GLubyte *t = input[(i & 3) + j * 4 + (i & 4) * 4];
+         GLchan rgba[4];
+         fxt1_decode_1(cc, 8, i, j, rgba);
+         for (c = 0; c < comps; c++) {
+            const GLint d = CHAN_TO_UBYTE(rgba[c]) - t[c];
+            error += d * d;
+         }
+      }
+   }
+
+   return error;
+}
+
+
+/**
+ * Replace the encoding in cc with alt if the latter decodes closer
+ * to the input.
+ */
 static void
-fxt1_quantize (GLuint *cc, const GLubyte *lines[], GLint comps)
+fxt1_keep_best (GLuint *cc, GLuint *error, const GLuint *alt,
+                GLubyte input[N_TEXELS][MAX_COMP], GLint comps)
+{
+   const GLuint altError = fxt1_block_error(alt, input, comps);
+
+   if (altError < *error) {
+      *error = altError;
+      cc[0] = alt[0];
+      cc[1] = alt[1];
+      cc[2] = alt[2];
+      cc[3] = alt[3];
+   }
+}
+
+
+static void
+fxt1_quantize (GLuint *cc, const GLubyte *lines[], GLint comps,
+               GLboolean nicest)
 {
    GLint trualpha;
    GLubyte reord[N_TEXELS][MAX_COMP];
@@ -1337,46 +1473,91 @@ fxt1_quantize (GLuint *cc, const GLubyte *lines[], GLint comps)
       }
    }
 
-#if 0
-   if (trualpha) {
-      fxt1_quantize_ALPHA0(cc, input, reord, l);
-   } else if (l == 0) {
-      cc[0] = cc[1] = cc[2] = -1;
-      cc[3] = 0;
-   } else if (l < N_TEXELS) {
-      fxt1_quantize_HI(cc, input, reord, l);
-   } else {
-      fxt1_quantize_CHROMA(cc, input);
-   }
-   (void)fxt1_quantize_ALPHA1;
-   (void)fxt1_quantize_MIXED1;
-   (void)fxt1_quantize_MIXED0;
-#else
    if (trualpha) {
       fxt1_quantize_ALPHA1(cc, input);
    } else if (l == 0) {
       cc[0] = cc[1] = cc[2] = ~0u;
       cc[3] = 0;
+      return;
    } else if (l < N_TEXELS) {
       fxt1_quantize_MIXED1(cc, input);
    } else {
       fxt1_quantize_MIXED0(cc, input);
    }
-   (void)fxt1_quantize_ALPHA0;
-   (void)fxt1_quantize_HI;
-   (void)fxt1_quantize_CHROMA;
-#endif
+
+   if (nicest) {
+      GLuint error = fxt1_block_error(cc, input, comps);
+      GLuint alt[4];
+
+      if (trualpha || l < N_TEXELS) {
+         /* the first l texels of reord are not transparent black */
+         fxt1_quantize_ALPHA0(alt, input, reord, l);
+         fxt1_keep_best(cc, &error, alt, input, comps);
+      }
+      if (!trualpha) {
+         if (l == N_TEXELS) {
+            fxt1_quantize_CHROMA(alt, input);
+            fxt1_keep_best(cc, &error, alt, input, comps);
+         }
+         fxt1_quantize_HI(alt, input, l < N_TEXELS ? reord : input, l);
+         fxt1_keep_best(cc, &error, alt, input, comps);
+      }
+   }
+}
+
+
+/**
+ * State shared by the threads encoding bands of block rows.
+ */
+struct fxt1_encode_state
+{
+   GLint comps;
+   GLboolean nicest;
+   GLuint width;                /**< multiple of 8 */
+   const GLubyte *data;
+   GLint srcRowStride;          /**< in bytes */
+   GLubyte *dest;
+   GLint destRowStride;         /**< in bytes, per row of blocks */
+   GLuint blockRows, rowsPerBand;
+};
+
+
+static void
+fxt1_encode_rows (void *data, GLuint band, GLuint thread)
+{
+   const struct fxt1_encode_state *enc =
+      (const struct fxt1_encode_state *) data;
+   const GLuint first = band * enc->rowsPerBand;
+   const GLuint last = MIN2(first + enc->rowsPerBand, enc->blockRows);
+   GLuint x, y;
+   (void) thread;
+
+   for (y = first; y < last; y++) {
+      GLuint *encoded = (GLuint *)(enc->dest + y * enc->destRowStride);
+      GLuint offs = y * 4 * enc->srcRowStride;
+      for (x = 0; x < enc->width; x += 8) {
+         const GLubyte *lines[4];
+         lines[0] = &enc->data[offs];
+         lines[1] = lines[0] + enc->srcRowStride;
+         lines[2] = lines[1] + enc->srcRowStride;
+         lines[3] = lines[2] + enc->srcRowStride;
+         offs += 8 * enc->comps;
+         fxt1_quantize(encoded, lines, enc->comps, enc->nicest);
+         /* 128 bits per 8x4 block */
+         encoded += 4;
+      }
+   }
 }
 
 
 static void
-fxt1_encode (GLuint width, GLuint height, GLint comps,
+fxt1_encode (GLcontext *ctx, GLuint width, GLuint height, GLint comps,
              const void *source, GLint srcRowStride,
              void *dest, GLint destRowStride)
 {
-   GLuint x, y;
-   const GLubyte *data;
-   GLuint *encoded = (GLuint *)dest;
+   struct _mesa_threadpool *pool = _mesa_get_threadpool();
+   struct fxt1_encode_state enc;
+   GLuint numBands, minRows;
    void *newSource = NULL;
 
    assert(comps == 3 || comps == 4);
@@ -1387,7 +1568,6 @@ fxt1_encode (GLuint width, GLuint height, GLint comps,
       GLint newHeight = (height + 3) & ~3;
       newSource = _mesa_malloc(comps * newWidth * newHeight * sizeof(GLchan));
       if (!newSource) {
-         GET_CURRENT_CONTEXT(ctx);
          _mesa_error(ctx, GL_OUT_OF_MEMORY, "texture compression");
          goto cleanUp;
       }
@@ -1407,7 +1587,6 @@ fxt1_encode (GLuint width, GLuint height, GLint comps,
       GLubyte *dest = (GLubyte *) _mesa_malloc(n * sizeof(GLubyte));
       GLuint i;
       if (!dest) {
-         GET_CURRENT_CONTEXT(ctx);
          _mesa_error(ctx, GL_OUT_OF_MEMORY, "texture compression");
          goto cleanUp;
       }
@@ -1421,23 +1600,24 @@ fxt1_encode (GLuint width, GLuint height, GLint comps,
       source = dest;  /* the new, GLubyte incoming image */
    }
 
-   data = (const GLubyte *) source;
-   destRowStride = (destRowStride - width * 2) / 4;
-   for (y = 0; y < height; y += 4) {
-      GLuint offs = 0 + (y + 0) * srcRowStride;
-      for (x = 0; x < width; x += 8) {
-         const GLubyte *lines[4];
-         lines[0] = &data[offs];
-         lines[1] = lines[0] + srcRowStride;
-         lines[2] = lines[1] + srcRowStride;
-         lines[3] = lines[2] + srcRowStride;
-         offs += 8 * comps;
-         fxt1_quantize(encoded, lines, comps);
-         /* 128 bits per 8x4 block */
-         encoded += 4;
-      }
-      encoded += destRowStride;
-   }
+   enc.comps = comps;
+   enc.nicest = ctx->Hint.TextureCompression == GL_NICEST;
+   enc.width = width;
+   enc.data = (const GLubyte *) source;
+   enc.srcRowStride = srcRowStride;
+   enc.dest = (GLubyte *) dest;
+   enc.destRowStride = destRowStride;
+   enc.blockRows = height / 4;
+
+   /* bands of block rows are independent, so spread them over the pool */
+   minRows = MAX2(MIN_BAND_BLOCKS / MAX2(width / 8, 1), 1);
+   numBands = MIN2(_mesa_threadpool_size(pool),
+                   MAX2(enc.blockRows / minRows, 1));
+   enc.rowsPerBand = (enc.blockRows + numBands - 1) / numBands;
+   if (numBands > 1)
+      _mesa_threadpool_run(pool, numBands, fxt1_encode_rows, &enc);
+   else
+      fxt1_encode_rows(&enc, 0, 0);
 
  cleanUp:
    if (newSource != NULL) {
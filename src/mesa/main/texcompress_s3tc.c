@@ -1,6 +1,6 @@
 /*
  * Mesa 3-D graphics library
- * Version:  6.5.3
+ * Version:  7.1
  *
  * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
  *
@@ -26,11 +26,18 @@
 /**
  * \file texcompress_s3tc.c
  * GL_EXT_texture_compression_s3tc support.
+ *
+ * DXT1/3/5 images are encoded and decoded here; no external library is
+ * needed.  The encoder has a fast mode, used when the
+ * GL_TEXTURE_COMPRESSION_HINT is GL_FASTEST, and a high quality mode
+ * otherwise.  Large images are encoded by the threads of the Mesa thread
+ * pool, one band of block rows per thread.
+ *
+ * Texel fetches decode a whole 4x4 block at a time into a small cache
+ * of decoded blocks which is attached to the texture image, since
+ * neighbouring fetches usually hit the same block.
  */
 
-#ifndef USE_EXTERNAL_DXTN_LIB
-#define USE_EXTERNAL_DXTN_LIB 0
-#endif
 
 #include "glheader.h"
 #include "imports.h"
@@ -38,160 +45,763 @@
 #include "context.h"
 #include "convolve.h"
 #include "image.h"
+#include "macros.h"
 #include "texcompress.h"
 #include "texformat.h"
 #include "texstore.h"
+#include "threadpool.h"
+#include "glapi/glthread.h"
 
-#if USE_EXTERNAL_DXTN_LIB && !defined(__MINGW32__)
-#include <dlfcn.h>
-#endif
 
-#ifdef __MINGW32__
-#define DXTN_LIBNAME "dxtn.dll"
-#define RTLD_LAZY 0
-#define RTLD_GLOBAL 0
-#elif defined(__DJGPP__)
-#define DXTN_LIBNAME "dxtn.dxe"
-#else
-#define DXTN_LIBNAME "libtxc_dxtn.so"
-#endif
+void
+_mesa_init_texture_s3tc( GLcontext *ctx )
+{
+   /* called during context initialization */
+   ctx->Mesa_DXTn = GL_TRUE;
+}
+
+
+/**
+ * \name Block decoding, shared by the encoder and the texel fetchers
+ */
+/*@{*/
+
+static INLINE GLboolean
+is_dxt1(GLenum format)
+{
+   return format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ||
+          format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+}
+
+
+/**
+ * Expand a 565 color to RGBA ubytes the same way the hardware does.
+ */
+static INLINE void
+expand_565(GLuint c, GLubyte rgba[4])
+{
+   const GLuint r = (c >> 11) & 0x1f, g = (c >> 5) & 0x3f, b = c & 0x1f;
+   rgba[RCOMP] = (r << 3) | (r >> 2);
+   rgba[GCOMP] = (g << 2) | (g >> 4);
+   rgba[BCOMP] = (b << 3) | (b >> 2);
+   rgba[ACOMP] = 255;
+}
 
 
-typedef void (*dxtFetchTexelFuncExt)( GLint srcRowstride, GLubyte *pixdata, GLint col, GLint row, GLvoid *texelOut );
+/**
+ * Compute the four palette colors of a color block with endpoints c0, c1.
+ * In three color mode the fourth entry is opaque black.
+ */
+static void
+make_color_palette(GLuint c0, GLuint c1, GLboolean fourColor,
+                   GLubyte pal[4][4])
+{
+   GLuint k;
+   expand_565(c0, pal[0]);
+   expand_565(c1, pal[1]);
+   for (k = 0; k < 3; k++) {
+      if (fourColor) {
+         pal[2][k] = (2 * pal[0][k] + pal[1][k]) / 3;
+         pal[3][k] = (pal[0][k] + 2 * pal[1][k]) / 3;
+      }
+      else {
+         pal[2][k] = (pal[0][k] + pal[1][k]) / 2;
+         pal[3][k] = 0;
+      }
+   }
+   pal[2][ACOMP] = pal[3][ACOMP] = 255;
+}
 
-dxtFetchTexelFuncExt fetch_ext_rgb_dxt1 = NULL;
-dxtFetchTexelFuncExt fetch_ext_rgba_dxt1 = NULL;
-dxtFetchTexelFuncExt fetch_ext_rgba_dxt3 = NULL;
-dxtFetchTexelFuncExt fetch_ext_rgba_dxt5 = NULL;
 
-typedef void (*dxtCompressTexFuncExt)(GLint srccomps, GLint width,
-                                      GLint height, const GLchan *srcPixData,
-                                      GLenum destformat, GLubyte *dest,
-                                      GLint dstRowStride);
+/**
+ * Palette of the 8-byte color block at 'color'.  DXT3 and DXT5 color
+ * blocks are always decoded in four color mode.
+ */
+static INLINE void
+block_color_palette(const GLubyte *color, GLenum format, GLubyte pal[4][4])
+{
+   const GLuint c0 = color[0] | (color[1] << 8);
+   const GLuint c1 = color[2] | (color[3] << 8);
+   const GLboolean fourColor = !is_dxt1(format) || c0 > c1;
+   make_color_palette(c0, c1, fourColor, pal);
+   if (!fourColor && format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT)
+      pal[3][ACOMP] = 0;
+}
 
-static dxtCompressTexFuncExt ext_tx_compress_dxtn = NULL;
 
-static void *dxtlibhandle = NULL;
+static INLINE GLuint
+block_color_bits(const GLubyte *color)
+{
+   return color[4] | (color[5] << 8) | (color[6] << 16) |
+          ((GLuint) color[7] << 24);
+}
 
 
-typedef void (*GenericFunc)(void);
+/**
+ * Compute the eight alpha values of a DXT5 alpha block.
+ */
+static void
+make_alpha_palette(GLuint a0, GLuint a1, GLubyte pal[8])
+{
+   GLuint c;
+   pal[0] = a0;
+   pal[1] = a1;
+   if (a0 > a1) {
+      for (c = 2; c < 8; c++)
+         pal[c] = ((8 - c) * a0 + (c - 1) * a1) / 7;
+   }
+   else {
+      for (c = 2; c < 6; c++)
+         pal[c] = ((6 - c) * a0 + (c - 1) * a1) / 5;
+      pal[6] = 0;
+      pal[7] = 255;
+   }
+}
 
 
 /**
- * Wrapper for dlopen().
- * XXX Probably move this and the following wrappers into imports.h someday.
+ * The 3-bit alpha code of texel k of a DXT5 block.
  */
-static void *
-_mesa_dlopen(const char *libname, int flags)
+static INLINE GLuint
+dxt5_alpha_code(const GLubyte *blk, GLuint k)
 {
-#if USE_EXTERNAL_DXTN_LIB
-#ifdef __MINGW32__
-   return LoadLibrary(libname);
-#else
-   return dlopen(libname, flags);
-#endif
-#else
-   return NULL;
-#endif /* USE_EXTERNAL_DXTN_LIB */
+   const GLubyte *p = k < 8 ? blk + 2 : blk + 5;
+   const GLuint bits = p[0] | (p[1] << 8) | (p[2] << 16);
+   return (bits >> (3 * (k & 7))) & 7;
 }
 
 
 /**
- * Wrapper for dlsym() that does a cast to a generic function type,
- * rather than a void *.  This reduces the number of warnings that are
- * generated.
- */
-static GenericFunc
-_mesa_dlsym(void *handle, const char *fname)
-{
-#if USE_EXTERNAL_DXTN_LIB
-#ifdef __MINGW32__
-   return (GenericFunc) GetProcAddress(handle, fname);
-#elif defined(__DJGPP__)
-   /* need '_' prefix on symbol names */
-   char fname2[1000];
-   fname2[0] = '_';
-   _mesa_strncpy(fname2 + 1, fname, 998);
-   fname2[999] = 0;
-   return (GenericFunc) dlsym(handle, fname2);
-#else
-   return (GenericFunc) dlsym(handle, fname);
-#endif
-#else
-   return (GenericFunc) NULL;
-#endif /* USE_EXTERNAL_DXTN_LIB */
+ * Decode all 16 texels of a block, in row-major order.
+ */
+static void
+decode_dxt_block(const GLubyte *blk, GLenum format, GLubyte texels[16][4])
+{
+   const GLubyte *color = is_dxt1(format) ? blk : blk + 8;
+   GLubyte pal[4][4];
+   GLuint bits, k;
+
+   block_color_palette(color, format, pal);
+   bits = block_color_bits(color);
+   for (k = 0; k < 16; k++) {
+      COPY_4UBV(texels[k], pal[bits & 3]);
+      bits >>= 2;
+   }
+
+   if (format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT) {
+      for (k = 0; k < 16; k++)
+         texels[k][ACOMP] = ((blk[k >> 1] >> ((k & 1) * 4)) & 0xf) * 17;
+   }
+   else if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) {
+      GLubyte alpha[8];
+      make_alpha_palette(blk[0], blk[1], alpha);
+      for (k = 0; k < 16; k++)
+         texels[k][ACOMP] = alpha[dxt5_alpha_code(blk, k)];
+   }
 }
 
 
 /**
- * Wrapper for dlclose().
+ * Decode texel k (= 4 * row + column) of a block.
  */
 static void
-_mesa_dlclose(void *handle)
+decode_dxt_texel(const GLubyte *blk, GLenum format, GLuint k,
+                 GLubyte rgba[4])
 {
-#if USE_EXTERNAL_DXTN_LIB
-#ifdef __MINGW32__
-   FreeLibrary(handle);
-#else
-   dlclose(handle);
-#endif
-#endif
+   const GLubyte *color = is_dxt1(format) ? blk : blk + 8;
+   GLubyte pal[4][4];
+
+   block_color_palette(color, format, pal);
+   COPY_4UBV(rgba, pal[(block_color_bits(color) >> (2 * k)) & 3]);
+
+   if (format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT) {
+      rgba[ACOMP] = ((blk[k >> 1] >> ((k & 1) * 4)) & 0xf) * 17;
+   }
+   else if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) {
+      GLubyte alpha[8];
+      make_alpha_palette(blk[0], blk[1], alpha);
+      rgba[ACOMP] = alpha[dxt5_alpha_code(blk, k)];
+   }
 }
 
+/*@}*/
 
 
-void
-_mesa_init_texture_s3tc( GLcontext *ctx )
+/**
+ * \name Block encoding
+ */
+/*@{*/
+
+/** A candidate encoding of a color block */
+struct color_fit
 {
-   /* called during context initialization */
-   ctx->Mesa_DXTn = GL_FALSE;
-#if USE_EXTERNAL_DXTN_LIB
-   if (!dxtlibhandle) {
-      dxtlibhandle = _mesa_dlopen(DXTN_LIBNAME, RTLD_LAZY | RTLD_GLOBAL);
-      if (!dxtlibhandle) {
-	 _mesa_warning(ctx, "couldn't open " DXTN_LIBNAME ", software DXTn "
-	    "compression/decompression unavailable");
+   GLuint c0, c1;       /**< 565 endpoints, in the order stored */
+   GLuint indices;      /**< 2 bits per texel */
+   GLint error;         /**< sum of squared RGB errors */
+};
+
+
+static INLINE GLuint
+quantize_565(const GLfloat c[3])
+{
+   const GLint r = IROUND(CLAMP(c[0], 0.0F, 255.0F) * (31.0F / 255.0F));
+   const GLint g = IROUND(CLAMP(c[1], 0.0F, 255.0F) * (63.0F / 255.0F));
+   const GLint b = IROUND(CLAMP(c[2], 0.0F, 255.0F) * (31.0F / 255.0F));
+   return (r << 11) | (g << 5) | b;
+}
+
+
+/**
+ * Choose the nearest palette entry for each texel of a block, given
+ * the quantized endpoints.  Texels in 'transparent' (one bit per texel)
+ * get index 3, which the caller must have made transparent black by
+ * ordering the endpoints for three color mode.
+ */
+static void
+fit_color_indices(GLubyte block[16][4], GLuint transparent,
+                  GLenum format, GLuint c0, GLuint c1, struct color_fit *fit)
+{
+   const GLboolean fourColor = !is_dxt1(format) || c0 > c1;
+   /* in three color mode RGBA DXT1 can't use black for opaque texels */
+   const GLuint numColors =
+      (!fourColor && format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 3 : 4;
+   GLubyte pal[4][4];
+   GLuint k, n;
+
+   make_color_palette(c0, c1, fourColor, pal);
+
+   fit->c0 = c0;
+   fit->c1 = c1;
+   fit->indices = 0;
+   fit->error = 0;
+   for (k = 0; k < 16; k++) {
+      GLuint best = 3;
+      if (!(transparent & (1 << k))) {
+         GLint bestDist = 0x7fffffff;
+         for (n = 0; n < numColors; n++) {
+            const GLint dr = block[k][RCOMP] - pal[n][RCOMP];
+            const GLint dg = block[k][GCOMP] - pal[n][GCOMP];
+            const GLint db = block[k][BCOMP] - pal[n][BCOMP];
+            const GLint dist = dr * dr + dg * dg + db * db;
+            if (dist < bestDist) {
+               bestDist = dist;
+               best = n;
+            }
+         }
+         fit->error += bestDist;
+      }
+      fit->indices |= best << (2 * k);
+   }
+}
+
+
+/**
+ * Quantize the endpoints e0, e1, order them for four or three color mode
+ * and fit the block's indices.
+ */
+static void
+fit_color_endpoints(GLubyte block[16][4], GLuint transparent,
+                    GLenum format, GLboolean fourColor,
+                    const GLfloat e0[3], const GLfloat e1[3],
+                    struct color_fit *fit)
+{
+   GLuint c0 = quantize_565(e0), c1 = quantize_565(e1);
+   if (fourColor ? c0 < c1 : c0 > c1) {
+      const GLuint tmp = c0;
+      c0 = c1;
+      c1 = tmp;
+   }
+   fit_color_indices(block, transparent, format, c0, c1, fit);
+}
+
+
+/**
+ * Least squares endpoints for the index assignment of 'fit': minimize
+ * the sum of |(1 - w) * e0 + w * e1 - texel|^2 over the block.
+ * \return GL_FALSE if the system is degenerate
+ */
+static GLboolean
+refine_color_endpoints(GLubyte block[16][4], GLuint transparent,
+                       GLenum format, const struct color_fit *fit,
+                       GLfloat e0[3], GLfloat e1[3])
+{
+   static const GLfloat weights4[4] = { 0.0F, 1.0F, 1.0F / 3.0F, 2.0F / 3.0F };
+   static const GLfloat weights3[4] = { 0.0F, 1.0F, 0.5F, -1.0F };
+   const GLfloat *weights =
+      (!is_dxt1(format) || fit->c0 > fit->c1) ? weights4 : weights3;
+   GLfloat aa = 0.0F, ab = 0.0F, bb = 0.0F, det;
+   GLfloat ax[3], bx[3];
+   GLuint k, c;
+
+   ax[0] = ax[1] = ax[2] = bx[0] = bx[1] = bx[2] = 0.0F;
+   for (k = 0; k < 16; k++) {
+      const GLfloat w = weights[(fit->indices >> (2 * k)) & 3];
+      if ((transparent & (1 << k)) || w < 0.0F)
+         continue;  /* transparent or black texel */
+      aa += (1.0F - w) * (1.0F - w);
+      ab += (1.0F - w) * w;
+      bb += w * w;
+      for (c = 0; c < 3; c++) {
+         ax[c] += (1.0F - w) * block[k][c];
+         bx[c] += w * block[k][c];
+      }
+   }
+
+   det = aa * bb - ab * ab;
+   if (FABSF(det) < 1e-6F)
+      return GL_FALSE;
+   det = 1.0F / det;
+   for (c = 0; c < 3; c++) {
+      e0[c] = (bb * ax[c] - ab * bx[c]) * det;
+      e1[c] = (aa * bx[c] - ab * ax[c]) * det;
+   }
+   return GL_TRUE;
+}
+
+
+/**
+ * Fit a block in four or three color mode starting from endpoints e0, e1,
+ * with up to 'iterations' least squares refinements.
+ */
+static void
+fit_color_mode(GLubyte block[16][4], GLuint transparent,
+               GLenum format, GLboolean fourColor,
+               const GLfloat e0[3], const GLfloat e1[3],
+               GLuint iterations, struct color_fit *best)
+{
+   GLfloat r0[3], r1[3];
+   GLuint i;
+
+   fit_color_endpoints(block, transparent, format, fourColor, e0, e1, best);
+   for (i = 0; i < iterations && best->error > 0; i++) {
+      struct color_fit fit;
+      if (!refine_color_endpoints(block, transparent, format, best, r0, r1))
+         break;
+      fit_color_endpoints(block, transparent, format, fourColor,
+                          r0, r1, &fit);
+      if (fit.error >= best->error)
+         break;
+      *best = fit;
+   }
+}
+
+
+/**
+ * Fast endpoint estimate: the corners of the (slightly inset) bounding
+ * box of the block's colors, along the diagonal which matches the sign
+ * of the covariance with the widest channel.
+ */
+static void
+bbox_endpoints(GLubyte block[16][4], GLuint transparent,
+               GLfloat e0[3], GLfloat e1[3])
+{
+   GLint min[3], max[3], sum[3], n = 0;
+   GLuint k, c, widest = 0;
+
+   for (c = 0; c < 3; c++) {
+      min[c] = 255;
+      max[c] = sum[c] = 0;
+   }
+   for (k = 0; k < 16; k++) {
+      if (transparent & (1 << k))
+         continue;
+      for (c = 0; c < 3; c++) {
+         min[c] = MIN2(min[c], block[k][c]);
+         max[c] = MAX2(max[c], block[k][c]);
+         sum[c] += block[k][c];
+      }
+      n++;
+   }
+
+   for (c = 1; c < 3; c++) {
+      if (max[c] - min[c] > max[widest] - min[widest])
+         widest = c;
+   }
+
+   for (c = 0; c < 3; c++) {
+      const GLfloat inset = (max[c] - min[c]) * (1.0F / 16.0F);
+      GLint cov = 0;
+      if (c != widest) {
+         for (k = 0; k < 16; k++) {
+            if (!(transparent & (1 << k)))
+               cov += (n * block[k][widest] - sum[widest]) *
+                      (n * block[k][c] - sum[c]);
+         }
+      }
+      if (cov >= 0) {
+         e0[c] = max[c] - inset;
+         e1[c] = min[c] + inset;
       }
       else {
-         /* the fetch functions are not per context! Might be problematic... */
-         fetch_ext_rgb_dxt1 = (dxtFetchTexelFuncExt)
-            _mesa_dlsym(dxtlibhandle, "fetch_2d_texel_rgb_dxt1");
-         fetch_ext_rgba_dxt1 = (dxtFetchTexelFuncExt)
-            _mesa_dlsym(dxtlibhandle, "fetch_2d_texel_rgba_dxt1");
-         fetch_ext_rgba_dxt3 = (dxtFetchTexelFuncExt)
-            _mesa_dlsym(dxtlibhandle, "fetch_2d_texel_rgba_dxt3");
-         fetch_ext_rgba_dxt5 = (dxtFetchTexelFuncExt)
-            _mesa_dlsym(dxtlibhandle, "fetch_2d_texel_rgba_dxt5");
-         ext_tx_compress_dxtn = (dxtCompressTexFuncExt)
-            _mesa_dlsym(dxtlibhandle, "tx_compress_dxtn");
-
-         if (!fetch_ext_rgb_dxt1 ||
-             !fetch_ext_rgba_dxt1 ||
-             !fetch_ext_rgba_dxt3 ||
-             !fetch_ext_rgba_dxt5 ||
-             !ext_tx_compress_dxtn) {
-	    _mesa_warning(ctx, "couldn't reference all symbols in "
-	       DXTN_LIBNAME ", software DXTn compression/decompression "
-	       "unavailable");
-            fetch_ext_rgb_dxt1 = NULL;
-            fetch_ext_rgba_dxt1 = NULL;
-            fetch_ext_rgba_dxt3 = NULL;
-            fetch_ext_rgba_dxt5 = NULL;
-            ext_tx_compress_dxtn = NULL;
-            _mesa_dlclose(dxtlibhandle);
-            dxtlibhandle = NULL;
+         e0[c] = min[c] + inset;
+         e1[c] = max[c] - inset;
+      }
+   }
+}
+
+
+/**
+ * High quality endpoint estimate: the extent of the block's colors along
+ * their principal axis, found by power iteration on the covariance matrix.
+ */
+static void
+pca_endpoints(GLubyte block[16][4], GLuint transparent,
+              GLfloat e0[3], GLfloat e1[3])
+{
+   GLfloat mean[3], cov[6], axis[3], tmin = 0.0F, tmax = 0.0F, len;
+   GLuint k, c, i, n = 0;
+
+   mean[0] = mean[1] = mean[2] = 0.0F;
+   for (k = 0; k < 16; k++) {
+      if (!(transparent & (1 << k))) {
+         for (c = 0; c < 3; c++)
+            mean[c] += block[k][c];
+         n++;
+      }
+   }
+   for (c = 0; c < 3; c++)
+      mean[c] /= (GLfloat) n;
+
+   for (i = 0; i < 6; i++)
+      cov[i] = 0.0F;
+   for (k = 0; k < 16; k++) {
+      if (!(transparent & (1 << k))) {
+         const GLfloat r = block[k][0] - mean[0];
+         const GLfloat g = block[k][1] - mean[1];
+         const GLfloat b = block[k][2] - mean[2];
+         cov[0] += r * r;
+         cov[1] += r * g;
+         cov[2] += r * b;
+         cov[3] += g * g;
+         cov[4] += g * b;
+         cov[5] += b * b;
+      }
+   }
+
+   /* start from the bounding box diagonal, which is rarely orthogonal
+    * to the principal axis
+    */
+   bbox_endpoints(block, transparent, e0, e1);
+   for (c = 0; c < 3; c++)
+      axis[c] = e0[c] - e1[c];
+
+   for (i = 0; i < 8; i++) {
+      const GLfloat x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+      const GLfloat y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+      const GLfloat z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+      const GLfloat m = MAX2(FABSF(x), MAX2(FABSF(y), FABSF(z)));
+      if (m < 1e-6F)
+         break;
+      axis[0] = x / m;
+      axis[1] = y / m;
+      axis[2] = z / m;
+   }
+
+   len = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+   if (len < 1e-6F) {
+      /* solid color (or nearly so) */
+      COPY_3V(e0, mean);
+      COPY_3V(e1, mean);
+      return;
+   }
+   len = 1.0F / len;
+
+   for (k = 0; k < 16; k++) {
+      if (!(transparent & (1 << k))) {
+         const GLfloat t = ((block[k][0] - mean[0]) * axis[0] +
+                            (block[k][1] - mean[1]) * axis[1] +
+                            (block[k][2] - mean[2]) * axis[2]) * len;
+         tmin = MIN2(tmin, t);
+         tmax = MAX2(tmax, t);
+      }
+   }
+   for (c = 0; c < 3; c++) {
+      e0[c] = mean[c] + tmax * axis[c];
+      e1[c] = mean[c] + tmin * axis[c];
+   }
+}
+
+
+/**
+ * Encode the 8-byte color block.  For RGBA DXT1, texels with alpha below
+ * 128 become transparent (which forces three color mode).
+ */
+static void
+encode_color_block(GLubyte block[16][4], GLenum format,
+                   GLboolean fast, GLubyte *out)
+{
+   GLuint transparent = 0, k;
+   struct color_fit best;
+   GLfloat e0[3], e1[3];
+
+   if (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) {
+      for (k = 0; k < 16; k++) {
+         if (block[k][ACOMP] < 128)
+            transparent |= 1 << k;
+      }
+   }
+
+   /* all texels transparent, unless a fit is found below */
+   best.c0 = best.c1 = 0;
+   best.indices = ~0u;
+   best.error = 0x7fffffff;
+
+   if (transparent == 0xffff) {
+      /* nothing to fit */
+   }
+   else if (fast) {
+      bbox_endpoints(block, transparent, e0, e1);
+      fit_color_mode(block, transparent, format, !transparent,
+                     e0, e1, 0, &best);
+   }
+   else {
+      pca_endpoints(block, transparent, e0, e1);
+      if (!transparent)
+         fit_color_mode(block, transparent, format, GL_TRUE,
+                        e0, e1, 2, &best);
+      if (is_dxt1(format) && (transparent || best.error > 0)) {
+         /* three color mode (the only choice with transparent texels)
+          * sometimes suits blocks with one dominant color better
+          */
+         struct color_fit fit;
+         fit_color_mode(block, transparent, format, GL_FALSE,
+                        e0, e1, 2, &fit);
+         if (transparent || fit.error < best.error)
+            best = fit;
+      }
+   }
+
+   out[0] = best.c0 & 0xff;
+   out[1] = best.c0 >> 8;
+   out[2] = best.c1 & 0xff;
+   out[3] = best.c1 >> 8;
+   out[4] = best.indices & 0xff;
+   out[5] = (best.indices >> 8) & 0xff;
+   out[6] = (best.indices >> 16) & 0xff;
+   out[7] = best.indices >> 24;
+}
+
+
+static void
+encode_alpha_dxt3(GLubyte block[16][4], GLubyte *out)
+{
+   GLuint k;
+   for (k = 0; k < 8; k++) {
+      const GLuint lo = (block[2 * k][ACOMP] * 15 + 127) / 255;
+      const GLuint hi = (block[2 * k + 1][ACOMP] * 15 + 127) / 255;
+      out[k] = lo | (hi << 4);
+   }
+}
+
+
+/**
+ * Choose the nearest alpha code for each texel.
+ * \return sum of squared alpha errors
+ */
+static GLint
+fit_alpha_codes(GLubyte block[16][4], GLuint a0, GLuint a1,
+                GLubyte codes[16])
+{
+   GLubyte pal[8];
+   GLint error = 0;
+   GLuint k, c;
+
+   make_alpha_palette(a0, a1, pal);
+   for (k = 0; k < 16; k++) {
+      GLint bestDist = 256 * 256;
+      for (c = 0; c < 8; c++) {
+         const GLint d = block[k][ACOMP] - pal[c];
+         if (d * d < bestDist) {
+            bestDist = d * d;
+            codes[k] = c;
+         }
+      }
+      error += bestDist;
+   }
+   return error;
+}
+
+
+/**
+ * Encode a DXT5 alpha block.  The high quality mode also tries the six
+ * value mode, which has exact 0 and 255 and so suits blocks with cut-out
+ * edges.
+ */
+static void
+encode_alpha_dxt5(GLubyte block[16][4], GLboolean fast, GLubyte *out)
+{
+   GLuint amin = 255, amax = 0, a0, a1, lo, hi, k;
+   GLubyte codes[16];
+   GLint error;
+
+   for (k = 0; k < 16; k++) {
+      amin = MIN2(amin, block[k][ACOMP]);
+      amax = MAX2(amax, block[k][ACOMP]);
+   }
+
+   /* eight value mode (or one value, if amax == amin) */
+   a0 = amax;
+   a1 = amin;
+   error = fit_alpha_codes(block, a0, a1, codes);
+
+   if (!fast && error > 0) {
+      GLuint imin = 255, imax = 0;
+      GLubyte codes6[16];
+      for (k = 0; k < 16; k++) {
+         const GLuint a = block[k][ACOMP];
+         if (a != 0 && a != 255) {
+            imin = MIN2(imin, a);
+            imax = MAX2(imax, a);
          }
       }
+      if (imin > imax)
+         imin = imax = 0;  /* only 0 and 255 */
+      if (fit_alpha_codes(block, imin, imax, codes6) < error) {
+         a0 = imin;
+         a1 = imax;
+         MEMCPY(codes, codes6, sizeof(codes));
+      }
    }
-   if (dxtlibhandle) {
-      ctx->Mesa_DXTn = GL_TRUE;
-      _mesa_warning(ctx, "software DXTn compression/decompression available");
+
+   lo = hi = 0;
+   for (k = 0; k < 8; k++) {
+      lo |= codes[k] << (3 * k);
+      hi |= codes[k + 8] << (3 * k);
    }
-#else
-   (void) ctx;
-#endif
+   out[0] = a0;
+   out[1] = a1;
+   out[2] = lo & 0xff;
+   out[3] = (lo >> 8) & 0xff;
+   out[4] = lo >> 16;
+   out[5] = hi & 0xff;
+   out[6] = (hi >> 8) & 0xff;
+   out[7] = hi >> 16;
 }
 
+
+/**
+ * Don't give a thread a band of fewer blocks than this.
+ */
+#define MIN_BAND_BLOCKS 256
+
+
+/**
+ * An image to compress, split into bands of block rows for
+ * encode_block_rows().
+ */
+struct dxt_encode
+{
+   GLenum format;
+   GLboolean fast;
+   GLint comps;                 /**< 3 or 4 */
+   GLint width, height;
+   const GLchan *src;
+   GLint srcRowStride;          /**< in GLchans */
+   GLubyte *dst;
+   GLint dstRowStride;          /**< in bytes, per row of blocks */
+   GLint blockRows, rowsPerBand;
+};
+
+
+/**
+ * Get the 4x4 block at (x, y), replicating the last column and row
+ * when the block extends past the edge of the image.
+ */
+static void
+extract_block(const struct dxt_encode *enc, GLint x, GLint y,
+              GLubyte block[16][4])
+{
+   GLint i, j;
+   for (j = 0; j < 4; j++) {
+      const GLchan *row =
+         enc->src + MIN2(y + j, enc->height - 1) * enc->srcRowStride;
+      for (i = 0; i < 4; i++) {
+         const GLchan *p = row + MIN2(x + i, enc->width - 1) * enc->comps;
+         GLubyte *t = block[j * 4 + i];
+         t[RCOMP] = CHAN_TO_UBYTE(p[0]);
+         t[GCOMP] = CHAN_TO_UBYTE(p[1]);
+         t[BCOMP] = CHAN_TO_UBYTE(p[2]);
+         t[ACOMP] = enc->comps == 4 ? CHAN_TO_UBYTE(p[3]) : 255;
+      }
+   }
+}
+
+
+static void
+encode_block_rows(void *data, GLuint band, GLuint thread)
+{
+   const struct dxt_encode *enc = (const struct dxt_encode *) data;
+   const GLint blockBytes = is_dxt1(enc->format) ? 8 : 16;
+   const GLint first = band * enc->rowsPerBand;
+   const GLint last = MIN2(first + enc->rowsPerBand, enc->blockRows);
+   GLint by, x;
+   (void) thread;
+
+   for (by = first; by < last; by++) {
+      GLubyte *out = enc->dst + by * enc->dstRowStride;
+      for (x = 0; x < enc->width; x += 4) {
+         GLubyte block[16][4];
+         extract_block(enc, x, by * 4, block);
+         switch (enc->format) {
+         case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+            encode_alpha_dxt3(block, out);
+            encode_color_block(block, enc->format, enc->fast, out + 8);
+            break;
+         case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            encode_alpha_dxt5(block, enc->fast, out);
+            encode_color_block(block, enc->format, enc->fast, out + 8);
+            break;
+         default:
+            encode_color_block(block, enc->format, enc->fast, out);
+         }
+         out += blockBytes;
+      }
+   }
+}
+
+
+/**
+ * Compress a width x height RGB or RGBA GLchan image into DXT blocks.
+ * \param dstRowStride  bytes per row of blocks in the destination
+ */
+static void
+compress_dxt(GLcontext *ctx, GLenum format, GLint comps,
+             GLint width, GLint height,
+             const GLchan *src, GLint srcRowStride,
+             GLubyte *dst, GLint dstRowStride)
+{
+   struct _mesa_threadpool *pool = _mesa_get_threadpool();
+   const GLint blocksPerRow = (width + 3) / 4;
+   const GLint minRows = MAX2(MIN_BAND_BLOCKS / MAX2(blocksPerRow, 1), 1);
+   struct dxt_encode enc;
+   GLuint numBands;
+
+   if (width <= 0 || height <= 0)
+      return;
+
+   enc.format = format;
+   enc.fast = ctx->Hint.TextureCompression == GL_FASTEST;
+   enc.comps = comps;
+   enc.width = width;
+   enc.height = height;
+   enc.src = src;
+   enc.srcRowStride = srcRowStride;
+   enc.dst = dst;
+   enc.dstRowStride = dstRowStride;
+   enc.blockRows = (height + 3) / 4;
+
+   numBands = MIN2(_mesa_threadpool_size(pool),
+                   MAX2(enc.blockRows / minRows, 1));
+   enc.rowsPerBand = (enc.blockRows + numBands - 1) / numBands;
+   if (numBands > 1)
+      _mesa_threadpool_run(pool, numBands, encode_block_rows, &enc);
+   else
+      encode_block_rows(&enc, 0, 0);
+}
+
+/*@}*/
+
+
 /**
  * Called via TexFormat->StoreImage to store an RGB_DXT1 texture.
  */
@@ -239,14 +849,8 @@ texstore_rgb_dxt1(TEXSTORE_PARAMS)
                                         dstFormat->MesaFormat,
                                         texWidth, (GLubyte *) dstAddr);
 
-   if (ext_tx_compress_dxtn) {
-      (*ext_tx_compress_dxtn)(3, srcWidth, srcHeight, pixels,
-                              GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
-                              dst, dstRowStride);
-   }
-   else {
-      _mesa_warning(ctx, "external dxt library not available");
-   }
+   compress_dxt(ctx, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 3, srcWidth, srcHeight,
+                pixels, srcRowStride, dst, dstRowStride);
 
    if (tempImage)
       _mesa_free((void *) tempImage);
@@ -301,14 +905,9 @@ texstore_rgba_dxt1(TEXSTORE_PARAMS)
    dst = _mesa_compressed_image_address(dstXoffset, dstYoffset, 0,
                                         dstFormat->MesaFormat,
                                         texWidth, (GLubyte *) dstAddr);
-   if (ext_tx_compress_dxtn) {
-      (*ext_tx_compress_dxtn)(4, srcWidth, srcHeight, pixels,
-                              GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
-                              dst, dstRowStride);
-   }
-   else {
-      _mesa_warning(ctx, "external dxt library not available");
-   }
+
+   compress_dxt(ctx, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 4, srcWidth, srcHeight,
+                pixels, srcRowStride, dst, dstRowStride);
 
    if (tempImage)
       _mesa_free((void*) tempImage);
@@ -362,14 +961,9 @@ texstore_rgba_dxt3(TEXSTORE_PARAMS)
    dst = _mesa_compressed_image_address(dstXoffset, dstYoffset, 0,
                                         dstFormat->MesaFormat,
                                         texWidth, (GLubyte *) dstAddr);
-   if (ext_tx_compress_dxtn) {
-      (*ext_tx_compress_dxtn)(4, srcWidth, srcHeight, pixels,
-                              GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,
-                              dst, dstRowStride);
-   }
-   else {
-      _mesa_warning(ctx, "external dxt library not available");
-   }
+
+   compress_dxt(ctx, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 4, srcWidth, srcHeight,
+                pixels, srcRowStride, dst, dstRowStride);
 
    if (tempImage)
       _mesa_free((void *) tempImage);
@@ -423,14 +1017,9 @@ texstore_rgba_dxt5(TEXSTORE_PARAMS)
    dst = _mesa_compressed_image_address(dstXoffset, dstYoffset, 0,
                                         dstFormat->MesaFormat,
                                         texWidth, (GLubyte *) dstAddr);
-   if (ext_tx_compress_dxtn) {
-      (*ext_tx_compress_dxtn)(4, srcWidth, srcHeight, pixels,
-                              GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
-                              dst, dstRowStride);
-   }
-   else {
-      _mesa_warning(ctx, "external dxt library not available");
-   }
+
+   compress_dxt(ctx, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 4, srcWidth, srcHeight,
+                pixels, srcRowStride, dst, dstRowStride);
 
    if (tempImage)
       _mesa_free((void *) tempImage);
@@ -439,119 +1028,156 @@ texstore_rgba_dxt5(TEXSTORE_PARAMS)
 }
 
 
-static void
-fetch_texel_2d_rgb_dxt1( const struct gl_texture_image *texImage,
-                         GLint i, GLint j, GLint k, GLchan *texel )
-{
-   (void) k;
-   if (fetch_ext_rgb_dxt1) {
-      ASSERT (sizeof(GLchan) == sizeof(GLubyte));
-      fetch_ext_rgb_dxt1(texImage->RowStride,
-                         (GLubyte *)(texImage)->Data, i, j, texel);
-   }
-   else
-      _mesa_debug(NULL, "attempted to decode s3tc texture without library available\n");
-}
-
-
-static void
-fetch_texel_2d_f_rgb_dxt1( const struct gl_texture_image *texImage,
-                            GLint i, GLint j, GLint k, GLfloat *texel )
-{
-   /* just sample as GLchan and convert to float here */
-   GLchan rgba[4];
-   fetch_texel_2d_rgb_dxt1(texImage, i, j, k, rgba);
-   texel[RCOMP] = CHAN_TO_FLOAT(rgba[RCOMP]);
-   texel[GCOMP] = CHAN_TO_FLOAT(rgba[GCOMP]);
-   texel[BCOMP] = CHAN_TO_FLOAT(rgba[BCOMP]);
-   texel[ACOMP] = CHAN_TO_FLOAT(rgba[ACOMP]);
-}
+/**
+ * \name Decoded block cache
+ *
+ * A direct-mapped cache of decoded blocks, indexed by the low bits of the
+ * block's x and y, so any 64x64 texel region fits without conflicts.
+ * Entries are tagged with the block's address and raw contents, so they
+ * never go stale when the image is modified with glTexSubImage or
+ * glCompressedTexSubImage.
+ *
+ * The cache isn't locked.  It's only used by the thread which created it;
+ * other threads sampling the texture at the same time (see s_tiles.c)
+ * decode texels directly.
+ */
+/*@{*/
 
+#define BLOCK_CACHE_SIZE 256
 
-static void
-fetch_texel_2d_rgba_dxt1( const struct gl_texture_image *texImage,
-                          GLint i, GLint j, GLint k, GLchan *texel )
+struct dxt_cache_entry
 {
-   (void) k;
-   if (fetch_ext_rgba_dxt1) {
-      fetch_ext_rgba_dxt1(texImage->RowStride,
-                          (GLubyte *)(texImage)->Data, i, j, texel);
-   }
-   else
-      _mesa_debug(NULL, "attempted to decode s3tc texture without library available\n");
-}
+   const GLubyte *Block;        /**< address of the cached block */
+   GLuint Raw[4];               /**< its contents when decoded */
+   GLubyte Texels[16][4];
+};
 
+struct dxt_block_cache
+{
+   unsigned long Owner;         /**< _glthread_GetID() of the user */
+   GLenum Format;
+   struct dxt_cache_entry Entries[BLOCK_CACHE_SIZE];
+};
 
-static void
-fetch_texel_2d_f_rgba_dxt1( const struct gl_texture_image *texImage,
-                            GLint i, GLint j, GLint k, GLfloat *texel )
-{
-   /* just sample as GLchan and convert to float here */
-   GLchan rgba[4];
-   fetch_texel_2d_rgba_dxt1(texImage, i, j, k, rgba);
-   texel[RCOMP] = CHAN_TO_FLOAT(rgba[RCOMP]);
-   texel[GCOMP] = CHAN_TO_FLOAT(rgba[GCOMP]);
-   texel[BCOMP] = CHAN_TO_FLOAT(rgba[BCOMP]);
-   texel[ACOMP] = CHAN_TO_FLOAT(rgba[ACOMP]);
-}
+_glthread_DECLARE_STATIC_MUTEX(BlockCacheMutex);
 
 
-static void
-fetch_texel_2d_rgba_dxt3( const struct gl_texture_image *texImage,
-                          GLint i, GLint j, GLint k, GLchan *texel )
+/**
+ * Get the texture image's block cache, creating it on first use.
+ * \return NULL if the calling thread shouldn't use the cache
+ */
+static INLINE struct dxt_block_cache *
+get_block_cache(const struct gl_texture_image *texImage, GLenum format)
 {
-   (void) k;
-   if (fetch_ext_rgba_dxt3) {
-      ASSERT (sizeof(GLchan) == sizeof(GLubyte));
-      fetch_ext_rgba_dxt3(texImage->RowStride, (GLubyte *)(texImage)->Data,
-                          i, j, texel);
+   struct dxt_block_cache *cache =
+      (struct dxt_block_cache *) texImage->DecodedBlocks;
+
+   if (!cache) {
+      _glthread_LOCK_MUTEX(BlockCacheMutex);
+      cache = (struct dxt_block_cache *) texImage->DecodedBlocks;
+      if (!cache) {
+         cache = CALLOC_STRUCT(dxt_block_cache);
+         if (cache) {
+            cache->Owner = _glthread_GetID();
+            cache->Format = format;
+            /* the cache is just a memo of the image's texels */
+            ((struct gl_texture_image *) texImage)->DecodedBlocks = cache;
+         }
+      }
+      _glthread_UNLOCK_MUTEX(BlockCacheMutex);
+      if (!cache)
+         return NULL;
    }
-   else
-      _mesa_debug(NULL, "attempted to decode s3tc texture without library available\n");
-}
 
+   if (cache->Owner != _glthread_GetID())
+      return NULL;
 
-static void
-fetch_texel_2d_f_rgba_dxt3( const struct gl_texture_image *texImage,
-                            GLint i, GLint j, GLint k, GLfloat *texel )
-{
-   /* just sample as GLchan and convert to float here */
-   GLchan rgba[4];
-   fetch_texel_2d_rgba_dxt3(texImage, i, j, k, rgba);
-   texel[RCOMP] = CHAN_TO_FLOAT(rgba[RCOMP]);
-   texel[GCOMP] = CHAN_TO_FLOAT(rgba[GCOMP]);
-   texel[BCOMP] = CHAN_TO_FLOAT(rgba[BCOMP]);
-   texel[ACOMP] = CHAN_TO_FLOAT(rgba[ACOMP]);
+   if (cache->Format != format) {
+      /* RGB and RGBA DXT1 decode the same blocks differently */
+      _mesa_bzero(cache->Entries, sizeof(cache->Entries));
+      cache->Format = format;
+   }
+   return cache;
 }
 
 
-static void
-fetch_texel_2d_rgba_dxt5( const struct gl_texture_image *texImage,
-                          GLint i, GLint j, GLint k, GLchan *texel )
+/**
+ * Fetch texel (i, j) of a DXT image as RGBA ubytes.
+ * \param tmp  storage for the texel if it isn't in the cache
+ * \return pointer to the texel
+ */
+static INLINE const GLubyte *
+fetch_dxt_texel(const struct gl_texture_image *texImage, GLint i, GLint j,
+                GLenum format, GLubyte tmp[4])
 {
-   (void) k;
-   if (fetch_ext_rgba_dxt5) {
-      fetch_ext_rgba_dxt5(texImage->RowStride, (GLubyte *)(texImage)->Data,
-                          i, j, texel);
+   const GLuint blockBytes = is_dxt1(format) ? 8 : 16;
+   const GLubyte *blk = (const GLubyte *) texImage->Data +
+      ((texImage->RowStride + 3) / 4 * (j / 4) + i / 4) * blockBytes;
+   const GLuint k = (j & 3) * 4 + (i & 3);
+   struct dxt_block_cache *cache = get_block_cache(texImage, format);
+
+   if (cache) {
+      /* blocks are at least 8-byte aligned */
+      const GLuint *raw = (const GLuint *) blk;
+      struct dxt_cache_entry *e =
+         &cache->Entries[((j >> 2) & 15) * 16 + ((i >> 2) & 15)];
+      if (e->Block != blk || e->Raw[0] != raw[0] || e->Raw[1] != raw[1] ||
+          (blockBytes == 16 && (e->Raw[2] != raw[2] || e->Raw[3] != raw[3]))) {
+         decode_dxt_block(blk, format, e->Texels);
+         e->Block = blk;
+         e->Raw[0] = raw[0];
+         e->Raw[1] = raw[1];
+         if (blockBytes == 16) {
+            e->Raw[2] = raw[2];
+            e->Raw[3] = raw[3];
+         }
+      }
+      return e->Texels[k];
+   }
+   else {
+      decode_dxt_texel(blk, format, k, tmp);
+      return tmp;
    }
-   else
-      _mesa_debug(NULL, "attempted to decode s3tc texture without library available\n");
 }
 
+/*@}*/
 
-static void
-fetch_texel_2d_f_rgba_dxt5( const struct gl_texture_image *texImage,
-                            GLint i, GLint j, GLint k, GLfloat *texel )
-{
-   /* just sample as GLchan and convert to float here */
-   GLchan rgba[4];
-   fetch_texel_2d_rgba_dxt5(texImage, i, j, k, rgba);
-   texel[RCOMP] = CHAN_TO_FLOAT(rgba[RCOMP]);
-   texel[GCOMP] = CHAN_TO_FLOAT(rgba[GCOMP]);
-   texel[BCOMP] = CHAN_TO_FLOAT(rgba[BCOMP]);
-   texel[ACOMP] = CHAN_TO_FLOAT(rgba[ACOMP]);
+
+/**
+ * Generate the GLchan and float fetch functions for a DXT format.
+ */
+#define FETCH_DXT(NAME, FORMAT)						\
+static void								\
+fetch_texel_2d_##NAME( const struct gl_texture_image *texImage,	\
+                       GLint i, GLint j, GLint k, GLchan *texel )	\
+{									\
+   GLubyte tmp[4];							\
+   const GLubyte *rgba = fetch_dxt_texel(texImage, i, j, FORMAT, tmp);	\
+   (void) k;								\
+   texel[RCOMP] = UBYTE_TO_CHAN(rgba[RCOMP]);				\
+   texel[GCOMP] = UBYTE_TO_CHAN(rgba[GCOMP]);				\
+   texel[BCOMP] = UBYTE_TO_CHAN(rgba[BCOMP]);				\
+   texel[ACOMP] = UBYTE_TO_CHAN(rgba[ACOMP]);				\
+}									\
+									\
+static void								\
+fetch_texel_2d_f_##NAME( const struct gl_texture_image *texImage,	\
+                         GLint i, GLint j, GLint k, GLfloat *texel )	\
+{									\
+   GLubyte tmp[4];							\
+   const GLubyte *rgba = fetch_dxt_texel(texImage, i, j, FORMAT, tmp);	\
+   (void) k;								\
+   texel[RCOMP] = UBYTE_TO_FLOAT(rgba[RCOMP]);				\
+   texel[GCOMP] = UBYTE_TO_FLOAT(rgba[GCOMP]);				\
+   texel[BCOMP] = UBYTE_TO_FLOAT(rgba[BCOMP]);				\
+   texel[ACOMP] = UBYTE_TO_FLOAT(rgba[ACOMP]);				\
 }
 
+FETCH_DXT(rgb_dxt1, GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+FETCH_DXT(rgba_dxt1, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT)
+FETCH_DXT(rgba_dxt3, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT)
+FETCH_DXT(rgba_dxt5, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+
 
 const struct gl_texture_format _mesa_texformat_rgb_dxt1 = {
    MESA_FORMAT_RGB_DXT1,		/* MesaFormat */
@@ -717,6 +717,8 @@ _mesa_delete_texture_image( GLcontext *ctx, struct gl_texture_image *texImage )
    ASSERT(texImage->Data == NULL);
    if (texImage->ImageOffsets)
       _mesa_free(texImage->ImageOffsets);
+   if (texImage->DecodedBlocks)
+      _mesa_free(texImage->DecodedBlocks);
    _mesa_free(texImage);
 }
 
@@ -1165,6 +1167,10 @@ clear_teximage_fields(struct gl_texture_image *img)
    img->HeightLog2 = 0;
    img->DepthLog2 = 0;
    img->Data = NULL;
+   if (img->DecodedBlocks) {
+      _mesa_free(img->DecodedBlocks);
+      img->DecodedBlocks = NULL;
+   }
    img->TexFormat = &_mesa_null_texformat;
    img->FetchTexelc = NULL;
    img->FetchTexelf = NULL;
@@ -2468,6 +2474,7 @@ _mesa_TexImage1D( GLenum target, GLint level, GLint internalFormat,
 	 
 	 /* state update */
 	 texObj->_Complete = GL_FALSE;
+	 texObj->ImageStamp++;
 	 ctx->NewState |= _NEW_TEXTURE;
       }
    out:
@@ -2571,6 +2578,7 @@ _mesa_TexImage2D( GLenum target, GLint level, GLint internalFormat,
 
 	 /* state update */
 	 texObj->_Complete = GL_FALSE;
+	 texObj->ImageStamp++;
 	 ctx->NewState |= _NEW_TEXTURE;
       }
    out:
@@ -2672,6 +2680,7 @@ _mesa_TexImage3D( GLenum target, GLint level, GLint internalFormat,
 
 	 /* state update */
 	 texObj->_Complete = GL_FALSE;
+	 texObj->ImageStamp++;
 	 ctx->NewState |= _NEW_TEXTURE;
       }
    out:
@@ -2766,6 +2775,7 @@ _mesa_TexSubImage1D( GLenum target, GLint level,
       (*ctx->Driver.TexSubImage1D)(ctx, target, level, xoffset, width,
 				   format, type, pixels, &ctx->Unpack,
 				   texObj, texImage);
+      texObj->ImageStamp++;
       ctx->NewState |= _NEW_TEXTURE;
    }
  out:
@@ -2824,6 +2834,7 @@ _mesa_TexSubImage2D( GLenum target, GLint level,
       (*ctx->Driver.TexSubImage2D)(ctx, target, level, xoffset, yoffset,
 				   width, height, format, type, pixels,
 				   &ctx->Unpack, texObj, texImage);
+      texObj->ImageStamp++;
       ctx->NewState |= _NEW_TEXTURE;
    }
  out:
@@ -2879,6 +2890,7 @@ _mesa_TexSubImage3D( GLenum target, GLint level,
 				   width, height, depth,
 				   format, type, pixels,
 				   &ctx->Unpack, texObj, texImage );
+      texObj->ImageStamp++;
       ctx->NewState |= _NEW_TEXTURE;
    }
  out:
@@ -2943,6 +2955,7 @@ _mesa_CopyTexImage1D( GLenum target, GLint level,
 
       /* state update */
       texObj->_Complete = GL_FALSE;
+      texObj->ImageStamp++;
       ctx->NewState |= _NEW_TEXTURE;
    }
  out:
@@ -3009,6 +3022,7 @@ _mesa_CopyTexImage2D( GLenum target, GLint level, GLenum internalFormat,
 
       /* state update */
       texObj->_Complete = GL_FALSE;
+      texObj->ImageStamp++;
       ctx->NewState |= _NEW_TEXTURE;
    }
  out:
@@ -3055,6 +3069,7 @@ _mesa_CopyTexSubImage1D( GLenum target, GLint level,
 
       ASSERT(ctx->Driver.CopyTexSubImage1D);
       (*ctx->Driver.CopyTexSubImage1D)(ctx, target, level, xoffset, x, y, width);
+      texObj->ImageStamp++;
       ctx->NewState |= _NEW_TEXTURE;
    }
  out:
@@ -3103,6 +3118,7 @@ _mesa_CopyTexSubImage2D( GLenum target, GLint level,
       ASSERT(ctx->Driver.CopyTexSubImage2D);
       (*ctx->Driver.CopyTexSubImage2D)(ctx, target, level,
 				       xoffset, yoffset, x, y, width, height);
+      texObj->ImageStamp++;
       ctx->NewState |= _NEW_TEXTURE;
    }
  out:
@@ -3154,6 +3170,7 @@ _mesa_CopyTexSubImage3D( GLenum target, GLint level,
       (*ctx->Driver.CopyTexSubImage3D)(ctx, target, level,
 				       xoffset, yoffset, zoffset,
 				       x, y, width, height);
+      texObj->ImageStamp++;
       ctx->NewState |= _NEW_TEXTURE;
    }
  out:
@@ -3403,6 +3420,7 @@ _mesa_CompressedTexImage1DARB(GLenum target, GLint level,
 
 	 /* state update */
 	 texObj->_Complete = GL_FALSE;
+	 texObj->ImageStamp++;
 	 ctx->NewState |= _NEW_TEXTURE;
       }
    out:
@@ -3500,6 +3518,7 @@ _mesa_CompressedTexImage2DARB(GLenum target, GLint level,
 	 
 	 /* state update */
 	 texObj->_Complete = GL_FALSE;
+	 texObj->ImageStamp++;
 	 ctx->NewState |= _NEW_TEXTURE;
       }
    out:
@@ -3596,6 +3615,7 @@ _mesa_CompressedTexImage3DARB(GLenum target, GLint level,
 	 
 	 /* state update */
 	 texObj->_Complete = GL_FALSE;
+	 texObj->ImageStamp++;
 	 ctx->NewState |= _NEW_TEXTURE;
       }
    out:
@@ -3689,6 +3709,7 @@ _mesa_CompressedTexSubImage1DARB(GLenum target, GLint level, GLint xoffset,
 						format, imageSize, data,
 						texObj, texImage);
       }
+      texObj->ImageStamp++;
       ctx->NewState |= _NEW_TEXTURE;
    }
  out:
@@ -3747,6 +3768,7 @@ _mesa_CompressedTexSubImage2DARB(GLenum target, GLint level, GLint xoffset,
 						format, imageSize, data,
 						texObj, texImage);
       }
+      texObj->ImageStamp++;
       ctx->NewState |= _NEW_TEXTURE;
    }
  out:
@@ -3806,6 +3828,7 @@ _mesa_CompressedTexSubImage3DARB(GLenum target, GLint level, GLint xoffset,
 						format, imageSize, data,
 						texObj, texImage);
       }
+      texObj->ImageStamp++;
       ctx->NewState |= _NEW_TEXTURE;
    }
  out:
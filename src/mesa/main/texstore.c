@@ -646,6 +646,89 @@ _mesa_make_temp_chan_image(GLcontext *ctx, GLuint dims,
 }
 
 
+#if defined(__SSE2__)
+
+/*
+ * SSE2 helpers for swizzle_copy() and the texstore row converters below.
+ * Four texels are handled at a time as 32-bit words, with component N of
+ * a texel in byte N of its word (SSE2 implies little endian).
+ */
+
+#include <emmintrin.h>
+
+
+/**
+ * Load four texels of three or four GLubyte components as 32-bit words.
+ * With three components the fourth byte of each word is garbage and 16
+ * bytes are read, so there must be two more texels after the four.
+ */
+static INLINE __m128i
+load_ubyte_texels_sse2(const GLubyte *src, GLuint srcComponents)
+{
+   const __m128i v = _mm_loadu_si128((const __m128i *) src);
+   if (srcComponents == 4) {
+      return v;
+   }
+   else {
+      const __m128i t01 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+      const __m128i t23 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6),
+                                             _mm_srli_si128(v, 9));
+      return _mm_unpacklo_epi64(t01, t23);
+   }
+}
+
+
+/**
+ * swizzle_copy() for four destination components.  Each destination byte
+ * is either kept in place, moved from another source byte with a shift or
+ * set to a constant.
+ * \return number of texels done
+ */
+static GLuint
+swizzle_copy_4_sse2(GLubyte *dst, const GLubyte *src, GLuint srcComponents,
+                    const GLubyte *map, GLuint count)
+{
+   const __m128i byteMask = _mm_set1_epi32(0xff);
+   __m128i srcShift[4], dstShift[4];
+   GLuint keep = 0x0, ones = 0x0, numMoves = 0;
+   GLuint c, i;
+   __m128i keepMask, onesMask;
+
+   for (c = 0; c < 4; c++) {
+      if (map[c] == ONE) {
+         ones |= 0xffu << (8 * c);
+      }
+      else if (map[c] == c) {
+         keep |= 0xffu << (8 * c);
+      }
+      else if (map[c] != ZERO) {
+         srcShift[numMoves] = _mm_cvtsi32_si128(8 * map[c]);
+         dstShift[numMoves] = _mm_cvtsi32_si128(8 * c);
+         numMoves++;
+      }
+   }
+   keepMask = _mm_set1_epi32(keep);
+   onesMask = _mm_set1_epi32(ones);
+
+   for (i = 0; i + 4 + 2 * (srcComponents == 3) <= count; i += 4) {
+      const __m128i w = load_ubyte_texels_sse2(src, srcComponents);
+      __m128i out = _mm_or_si128(_mm_and_si128(w, keepMask), onesMask);
+      for (c = 0; c < numMoves; c++) {
+         const __m128i comp =
+            _mm_and_si128(_mm_srl_epi32(w, srcShift[c]), byteMask);
+         out = _mm_or_si128(out, _mm_sll_epi32(comp, dstShift[c]));
+      }
+      _mm_storeu_si128((__m128i *) dst, out);
+      src += 4 * srcComponents;
+      dst += 16;
+   }
+
+   return i;
+}
+
+#endif /* __SSE2__ */
+
+
 /**
  * Copy GLubyte pixels from <src> to <dst> with swizzling.
  * \param dst  destination pixels
@@ -667,6 +750,16 @@ swizzle_copy(GLubyte *dst, GLuint dstComponents, const GLubyte *src,
    tmp[ZERO] = 0x0;
    tmp[ONE] = 0xff;
 
+#if defined(__SSE2__)
+   if (dstComponents == 4 && srcComponents >= 3) {
+      const GLuint done = swizzle_copy_4_sse2(dst, src, srcComponents,
+                                              map, count);
+      dst += 4 * done;
+      src += srcComponents * done;
+      count -= done;
+   }
+#endif
+
    switch (dstComponents) {
    case 4:
       for (i = 0; i < count; i++) {
@@ -915,6 +1008,397 @@ memcpy_texture(GLcontext *ctx,
 
 
 
+/*
+ * Row converters for common (source format/type, texture format) pairs
+ * that would otherwise go through _mesa_make_temp_chan_image().  They
+ * convert straight from the user's image to the texture, one row at a
+ * time, and give exactly the same texels as the general paths.
+ */
+
+typedef void (*texstore_row_func)(GLubyte *dst, const GLvoid *src, GLuint n);
+
+struct texstore_row_converter
+{
+   const struct gl_texture_format *dstFormat;
+   GLenum baseInternalFormat;
+   GLenum srcFormat;
+   GLenum srcType;
+   texstore_row_func convert;
+};
+
+
+/** 16-bit texel packings for pack_ubyte_row_16() */
+enum {
+   PACKING_565,
+   PACKING_565_REV,
+   PACKING_4444,
+   PACKING_4444_REV,
+   PACKING_1555,
+   PACKING_1555_REV
+};
+
+
+/**
+ * Pack a row of GLubyte RGB(A) texels into one of the 16-bit formats.
+ * \param srcComponents  3 or 4, alpha is 0xff for 3 and byte 3 for 4
+ * \param rIdx, gIdx, bIdx  byte offsets of red, green and blue in a texel
+ * \param packing  one of the PACKING_x values
+ */
+static INLINE void
+pack_ubyte_row_16(GLushort *dst, const GLubyte *src, GLuint n,
+                  GLuint srcComponents, GLuint rIdx, GLuint gIdx, GLuint bIdx,
+                  GLuint packing)
+{
+   GLuint i = 0;
+
+#if defined(__SSE2__)
+   {
+      const __m128i byteMask = _mm_set1_epi32(0xff);
+      const __m128i mask_f0 = _mm_set1_epi32(0xf0);
+      const __m128i mask_f8 = _mm_set1_epi32(0xf8);
+      const __m128i mask_fc = _mm_set1_epi32(0xfc);
+      const __m128i alphaBit = _mm_set1_epi32(0x8000);
+      const __m128i zero = _mm_setzero_si128();
+
+      for (; i + 8 + 2 * (srcComponents == 3) <= n; i += 8) {
+         __m128i p[2], v;
+         GLuint j;
+
+         for (j = 0; j < 2; j++) {
+            const __m128i w =
+               load_ubyte_texels_sse2(src + 4 * j * srcComponents,
+                                      srcComponents);
+            const __m128i r =
+               _mm_and_si128(_mm_srli_epi32(w, 8 * rIdx), byteMask);
+            const __m128i g =
+               _mm_and_si128(_mm_srli_epi32(w, 8 * gIdx), byteMask);
+            const __m128i b =
+               _mm_and_si128(_mm_srli_epi32(w, 8 * bIdx), byteMask);
+            const __m128i a =
+               srcComponents == 4 ? _mm_srli_epi32(w, 24) : byteMask;
+
+            if (packing == PACKING_565 || packing == PACKING_565_REV) {
+               p[j] = _mm_or_si128(
+                         _mm_or_si128(
+                            _mm_slli_epi32(_mm_and_si128(r, mask_f8), 8),
+                            _mm_slli_epi32(_mm_and_si128(g, mask_fc), 3)),
+                         _mm_srli_epi32(b, 3));
+            }
+            else if (packing == PACKING_4444 || packing == PACKING_4444_REV) {
+               p[j] = _mm_or_si128(
+                         _mm_or_si128(
+                            _mm_slli_epi32(_mm_and_si128(a, mask_f0), 8),
+                            _mm_slli_epi32(_mm_and_si128(r, mask_f0), 4)),
+                         _mm_or_si128(_mm_and_si128(g, mask_f0),
+                                      _mm_srli_epi32(b, 4)));
+            }
+            else {
+               p[j] = _mm_or_si128(
+                         _mm_or_si128(
+                            _mm_slli_epi32(_mm_and_si128(r, mask_f8), 7),
+                            _mm_slli_epi32(_mm_and_si128(g, mask_f8), 2)),
+                         _mm_or_si128(_mm_srli_epi32(b, 3),
+                                      _mm_andnot_si128(_mm_cmpeq_epi32(a, zero),
+                                                       alphaBit)));
+            }
+
+            /* sign extend so the signed pack below keeps all 16 bits */
+            p[j] = _mm_srai_epi32(_mm_slli_epi32(p[j], 16), 16);
+         }
+
+         v = _mm_packs_epi32(p[0], p[1]);
+         if (packing == PACKING_565_REV ||
+             packing == PACKING_4444_REV ||
+             packing == PACKING_1555_REV) {
+            /* the _REV packings are the byte swapped ones */
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+         }
+         _mm_storeu_si128((__m128i *) (dst + i), v);
+         src += 8 * srcComponents;
+      }
+   }
+#endif /* __SSE2__ */
+
+   for (; i < n; i++) {
+      const GLubyte r = src[rIdx], g = src[gIdx], b = src[bIdx];
+      const GLubyte a = srcComponents == 4 ? src[3] : 0xff;
+      switch (packing) {
+      case PACKING_565:
+         dst[i] = PACK_COLOR_565( r, g, b );
+         break;
+      case PACKING_565_REV:
+         dst[i] = PACK_COLOR_565_REV( r, g, b );
+         break;
+      case PACKING_4444:
+         dst[i] = PACK_COLOR_4444( a, r, g, b );
+         break;
+      case PACKING_4444_REV:
+         dst[i] = PACK_COLOR_4444_REV( a, r, g, b );
+         break;
+      case PACKING_1555:
+         dst[i] = PACK_COLOR_1555( a, r, g, b );
+         break;
+      default:
+         dst[i] = PACK_COLOR_1555_REV( a, r, g, b );
+      }
+      src += srcComponents;
+   }
+}
+
+
+#define PACK_UBYTE_ROW_16(NAME, COMPS, R, G, B, PACKING)		\
+static void								\
+NAME(GLubyte *dst, const GLvoid *src, GLuint n)			\
+{									\
+   pack_ubyte_row_16((GLushort *) dst, (const GLubyte *) src, n,	\
+                     COMPS, R, G, B, PACKING);				\
+}
+
+PACK_UBYTE_ROW_16(rgba_ubyte_to_565, 4, 0, 1, 2, PACKING_565)
+PACK_UBYTE_ROW_16(bgra_ubyte_to_565, 4, 2, 1, 0, PACKING_565)
+PACK_UBYTE_ROW_16(rgb_ubyte_to_565, 3, 0, 1, 2, PACKING_565)
+PACK_UBYTE_ROW_16(rgba_ubyte_to_565_rev, 4, 0, 1, 2, PACKING_565_REV)
+PACK_UBYTE_ROW_16(bgra_ubyte_to_565_rev, 4, 2, 1, 0, PACKING_565_REV)
+PACK_UBYTE_ROW_16(rgb_ubyte_to_565_rev, 3, 0, 1, 2, PACKING_565_REV)
+PACK_UBYTE_ROW_16(rgba_ubyte_to_4444, 4, 0, 1, 2, PACKING_4444)
+PACK_UBYTE_ROW_16(bgra_ubyte_to_4444, 4, 2, 1, 0, PACKING_4444)
+PACK_UBYTE_ROW_16(rgb_ubyte_to_4444, 3, 0, 1, 2, PACKING_4444)
+PACK_UBYTE_ROW_16(rgba_ubyte_to_4444_rev, 4, 0, 1, 2, PACKING_4444_REV)
+PACK_UBYTE_ROW_16(bgra_ubyte_to_4444_rev, 4, 2, 1, 0, PACKING_4444_REV)
+PACK_UBYTE_ROW_16(rgb_ubyte_to_4444_rev, 3, 0, 1, 2, PACKING_4444_REV)
+PACK_UBYTE_ROW_16(rgba_ubyte_to_1555, 4, 0, 1, 2, PACKING_1555)
+PACK_UBYTE_ROW_16(bgra_ubyte_to_1555, 4, 2, 1, 0, PACKING_1555)
+PACK_UBYTE_ROW_16(rgb_ubyte_to_1555, 3, 0, 1, 2, PACKING_1555)
+PACK_UBYTE_ROW_16(rgba_ubyte_to_1555_rev, 4, 0, 1, 2, PACKING_1555_REV)
+PACK_UBYTE_ROW_16(bgra_ubyte_to_1555_rev, 4, 2, 1, 0, PACKING_1555_REV)
+PACK_UBYTE_ROW_16(rgb_ubyte_to_1555_rev, 3, 0, 1, 2, PACKING_1555_REV)
+
+
+#if CHAN_TYPE == GL_UNSIGNED_BYTE
+
+/**
+ * Convert a row of GL_FLOAT RGB(A) texels to 8-bit components packed in
+ * 32-bit words.  The values are clamped and converted the same way as
+ * _mesa_unpack_color_span_chan() does it.
+ * \param srcComponents  3 or 4, alpha is 1.0 for 3
+ * \param rIdx, gIdx, bIdx  offsets of red, green and blue in a texel
+ * \param rShift, gShift, bShift, aShift  where the components go in a word
+ */
+static INLINE void
+pack_float_row_8888(GLuint *dst, const GLfloat *src, GLuint n,
+                    GLuint srcComponents, GLuint rIdx, GLuint gIdx, GLuint bIdx,
+                    GLuint rShift, GLuint gShift, GLuint bShift, GLuint aShift)
+{
+   GLuint i = 0;
+
+#if defined(__SSE2__) && defined(USE_IEEE) && !defined(DEBUG)
+   /* this is CLAMPED_FLOAT_TO_UBYTE(), four components at a time */
+   if (srcComponents == 4) {
+      const __m128 zero = _mm_setzero_ps();
+      const __m128 one = _mm_set1_ps(1.0F);
+      const __m128 scale = _mm_set1_ps(255.0F / 256.0F);
+      const __m128 bias = _mm_set1_ps(32768.0F);
+      const __m128i byteMask = _mm_set1_epi32(0xff);
+
+      for (; i + 4 <= n; i += 4) {
+         __m128 c[4];
+         __m128i ub[4];
+         GLuint j;
+
+         c[0] = _mm_loadu_ps(src + 0);
+         c[1] = _mm_loadu_ps(src + 4);
+         c[2] = _mm_loadu_ps(src + 8);
+         c[3] = _mm_loadu_ps(src + 12);
+         _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+
+         for (j = 0; j < 4; j++) {
+            /* max() first so that NaN becomes 0, like CLAMP() */
+            const __m128 f = _mm_min_ps(_mm_max_ps(c[j], zero), one);
+            const __m128 t = _mm_add_ps(_mm_mul_ps(f, scale), bias);
+            ub[j] = _mm_and_si128(_mm_castps_si128(t), byteMask);
+         }
+
+         _mm_storeu_si128((__m128i *) (dst + i),
+            _mm_or_si128(
+               _mm_or_si128(_mm_sll_epi32(ub[rIdx], _mm_cvtsi32_si128(rShift)),
+                            _mm_sll_epi32(ub[gIdx], _mm_cvtsi32_si128(gShift))),
+               _mm_or_si128(_mm_sll_epi32(ub[bIdx], _mm_cvtsi32_si128(bShift)),
+                            _mm_sll_epi32(ub[3], _mm_cvtsi32_si128(aShift)))));
+         src += 16;
+      }
+   }
+#endif
+
+   for (; i < n; i++) {
+      const GLfloat a = srcComponents == 4 ? src[3] : 1.0F;
+      GLchan r, g, b, alpha;
+      CLAMPED_FLOAT_TO_CHAN(r, CLAMP(src[rIdx], 0.0F, 1.0F));
+      CLAMPED_FLOAT_TO_CHAN(g, CLAMP(src[gIdx], 0.0F, 1.0F));
+      CLAMPED_FLOAT_TO_CHAN(b, CLAMP(src[bIdx], 0.0F, 1.0F));
+      CLAMPED_FLOAT_TO_CHAN(alpha, CLAMP(a, 0.0F, 1.0F));
+      dst[i] = ((GLuint) r << rShift) | ((GLuint) g << gShift) |
+               ((GLuint) b << bShift) | ((GLuint) alpha << aShift);
+      src += srcComponents;
+   }
+}
+
+
+#define PACK_FLOAT_ROW_8888(NAME, COMPS, R, G, B, RS, GS, BS, AS)	\
+static void								\
+NAME(GLubyte *dst, const GLvoid *src, GLuint n)			\
+{									\
+   pack_float_row_8888((GLuint *) dst, (const GLfloat *) src, n,	\
+                       COMPS, R, G, B, RS, GS, BS, AS);		\
+}
+
+PACK_FLOAT_ROW_8888(rgba_float_to_8888, 4, 0, 1, 2, 24, 16, 8, 0)
+PACK_FLOAT_ROW_8888(bgra_float_to_8888, 4, 2, 1, 0, 24, 16, 8, 0)
+PACK_FLOAT_ROW_8888(rgb_float_to_8888, 3, 0, 1, 2, 24, 16, 8, 0)
+PACK_FLOAT_ROW_8888(rgba_float_to_8888_rev, 4, 0, 1, 2, 0, 8, 16, 24)
+PACK_FLOAT_ROW_8888(bgra_float_to_8888_rev, 4, 2, 1, 0, 0, 8, 16, 24)
+PACK_FLOAT_ROW_8888(rgb_float_to_8888_rev, 3, 0, 1, 2, 0, 8, 16, 24)
+PACK_FLOAT_ROW_8888(rgba_float_to_argb8888, 4, 0, 1, 2, 16, 8, 0, 24)
+PACK_FLOAT_ROW_8888(bgra_float_to_argb8888, 4, 2, 1, 0, 16, 8, 0, 24)
+PACK_FLOAT_ROW_8888(rgb_float_to_argb8888, 3, 0, 1, 2, 16, 8, 0, 24)
+PACK_FLOAT_ROW_8888(rgba_float_to_argb8888_rev, 4, 0, 1, 2, 8, 16, 24, 0)
+PACK_FLOAT_ROW_8888(bgra_float_to_argb8888_rev, 4, 2, 1, 0, 8, 16, 24, 0)
+PACK_FLOAT_ROW_8888(rgb_float_to_argb8888_rev, 3, 0, 1, 2, 8, 16, 24, 0)
+
+/* MESA_FORMAT_RGBA is R, G, B, A in memory */
+#ifdef MESA_LITTLE_ENDIAN
+#define rgba_float_to_chan rgba_float_to_8888_rev
+#define bgra_float_to_chan bgra_float_to_8888_rev
+#define rgb_float_to_chan rgb_float_to_8888_rev
+#else
+#define rgba_float_to_chan rgba_float_to_8888
+#define bgra_float_to_chan bgra_float_to_8888
+#define rgb_float_to_chan rgb_float_to_8888
+#endif
+
+#endif /* CHAN_TYPE == GL_UNSIGNED_BYTE */
+
+
+static const struct texstore_row_converter row_converters[] = {
+   { &_mesa_texformat_rgb565, GL_RGB, GL_RGBA, GL_UNSIGNED_BYTE,
+     rgba_ubyte_to_565 },
+   { &_mesa_texformat_rgb565, GL_RGB, GL_BGRA, GL_UNSIGNED_BYTE,
+     bgra_ubyte_to_565 },
+   { &_mesa_texformat_rgb565, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE,
+     rgb_ubyte_to_565 },
+   { &_mesa_texformat_rgb565_rev, GL_RGB, GL_RGBA, GL_UNSIGNED_BYTE,
+     rgba_ubyte_to_565_rev },
+   { &_mesa_texformat_rgb565_rev, GL_RGB, GL_BGRA, GL_UNSIGNED_BYTE,
+     bgra_ubyte_to_565_rev },
+   { &_mesa_texformat_rgb565_rev, GL_RGB, GL_RGB, GL_UNSIGNED_BYTE,
+     rgb_ubyte_to_565_rev },
+   { &_mesa_texformat_argb4444, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE,
+     rgba_ubyte_to_4444 },
+   { &_mesa_texformat_argb4444, GL_RGBA, GL_BGRA, GL_UNSIGNED_BYTE,
+     bgra_ubyte_to_4444 },
+   { &_mesa_texformat_argb4444, GL_RGBA, GL_RGB, GL_UNSIGNED_BYTE,
+     rgb_ubyte_to_4444 },
+   { &_mesa_texformat_argb4444_rev, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE,
+     rgba_ubyte_to_4444_rev },
+   { &_mesa_texformat_argb4444_rev, GL_RGBA, GL_BGRA, GL_UNSIGNED_BYTE,
+     bgra_ubyte_to_4444_rev },
+   { &_mesa_texformat_argb4444_rev, GL_RGBA, GL_RGB, GL_UNSIGNED_BYTE,
+     rgb_ubyte_to_4444_rev },
+   { &_mesa_texformat_argb1555, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE,
+     rgba_ubyte_to_1555 },
+   { &_mesa_texformat_argb1555, GL_RGBA, GL_BGRA, GL_UNSIGNED_BYTE,
+     bgra_ubyte_to_1555 },
+   { &_mesa_texformat_argb1555, GL_RGBA, GL_RGB, GL_UNSIGNED_BYTE,
+     rgb_ubyte_to_1555 },
+   { &_mesa_texformat_argb1555_rev, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE,
+     rgba_ubyte_to_1555_rev },
+   { &_mesa_texformat_argb1555_rev, GL_RGBA, GL_BGRA, GL_UNSIGNED_BYTE,
+     bgra_ubyte_to_1555_rev },
+   { &_mesa_texformat_argb1555_rev, GL_RGBA, GL_RGB, GL_UNSIGNED_BYTE,
+     rgb_ubyte_to_1555_rev },
+#if CHAN_TYPE == GL_UNSIGNED_BYTE
+   { &_mesa_texformat_rgba, GL_RGBA, GL_RGBA, GL_FLOAT,
+     rgba_float_to_chan },
+   { &_mesa_texformat_rgba, GL_RGBA, GL_BGRA, GL_FLOAT,
+     bgra_float_to_chan },
+   { &_mesa_texformat_rgba, GL_RGBA, GL_RGB, GL_FLOAT,
+     rgb_float_to_chan },
+   { &_mesa_texformat_rgba8888, GL_RGBA, GL_RGBA, GL_FLOAT,
+     rgba_float_to_8888 },
+   { &_mesa_texformat_rgba8888, GL_RGBA, GL_BGRA, GL_FLOAT,
+     bgra_float_to_8888 },
+   { &_mesa_texformat_rgba8888, GL_RGBA, GL_RGB, GL_FLOAT,
+     rgb_float_to_8888 },
+   { &_mesa_texformat_rgba8888_rev, GL_RGBA, GL_RGBA, GL_FLOAT,
+     rgba_float_to_8888_rev },
+   { &_mesa_texformat_rgba8888_rev, GL_RGBA, GL_BGRA, GL_FLOAT,
+     bgra_float_to_8888_rev },
+   { &_mesa_texformat_rgba8888_rev, GL_RGBA, GL_RGB, GL_FLOAT,
+     rgb_float_to_8888_rev },
+   { &_mesa_texformat_argb8888, GL_RGBA, GL_RGBA, GL_FLOAT,
+     rgba_float_to_argb8888 },
+   { &_mesa_texformat_argb8888, GL_RGBA, GL_BGRA, GL_FLOAT,
+     bgra_float_to_argb8888 },
+   { &_mesa_texformat_argb8888, GL_RGBA, GL_RGB, GL_FLOAT,
+     rgb_float_to_argb8888 },
+   { &_mesa_texformat_argb8888_rev, GL_RGBA, GL_RGBA, GL_FLOAT,
+     rgba_float_to_argb8888_rev },
+   { &_mesa_texformat_argb8888_rev, GL_RGBA, GL_BGRA, GL_FLOAT,
+     bgra_float_to_argb8888_rev },
+   { &_mesa_texformat_argb8888_rev, GL_RGBA, GL_RGB, GL_FLOAT,
+     rgb_float_to_argb8888_rev },
+#endif
+};
+
+
+/**
+ * Store a texture image with one of the row converters above, if there is
+ * one for these formats and no pixel transfer ops are enabled.
+ * 1D, 2D and 3D images supported.
+ * \return GL_TRUE if the image was stored, GL_FALSE if the caller has to
+ */
+static GLboolean
+texstore_with_row_converter(TEXSTORE_PARAMS)
+{
+   const struct texstore_row_converter *conv = NULL;
+   GLint srcRowStride, img, row;
+   GLuint i;
+
+   if (ctx->_ImageTransferState || srcPacking->SwapBytes)
+      return GL_FALSE;
+
+   for (i = 0; i < Elements(row_converters); i++) {
+      if (row_converters[i].dstFormat == dstFormat &&
+          row_converters[i].baseInternalFormat == baseInternalFormat &&
+          row_converters[i].srcFormat == srcFormat &&
+          row_converters[i].srcType == srcType) {
+         conv = &row_converters[i];
+         break;
+      }
+   }
+   if (!conv)
+      return GL_FALSE;
+
+   srcRowStride = _mesa_image_row_stride(srcPacking, srcWidth,
+                                         srcFormat, srcType);
+   for (img = 0; img < srcDepth; img++) {
+      const GLubyte *srcRow = (const GLubyte *)
+         _mesa_image_address(dims, srcPacking, srcAddr, srcWidth, srcHeight,
+                             srcFormat, srcType, img, 0, 0);
+      GLubyte *dstRow = (GLubyte *) dstAddr
+         + dstImageOffsets[dstZoffset + img] * dstFormat->TexelBytes
+         + dstYoffset * dstRowStride
+         + dstXoffset * dstFormat->TexelBytes;
+      for (row = 0; row < srcHeight; row++) {
+         conv->convert(dstRow, srcRow, srcWidth);
+         dstRow += dstRowStride;
+         srcRow += srcRowStride;
+      }
+   }
+   return GL_TRUE;
+}
+
+
+
 /**
  * Store an image in any of the formats:
  *   _mesa_texformat_rgba
@@ -944,6 +1428,13 @@ _mesa_texstore_rgba(TEXSTORE_PARAMS)
           baseInternalFormat == GL_INTENSITY);
    ASSERT(dstFormat->TexelBytes == components * sizeof(GLchan));
 
+   if (texstore_with_row_converter(ctx, dims, baseInternalFormat, dstFormat,
+                                   dstAddr, dstXoffset, dstYoffset, dstZoffset,
+                                   dstRowStride, dstImageOffsets,
+                                   srcWidth, srcHeight, srcDepth,
+                                   srcFormat, srcType, srcAddr, srcPacking))
+      return GL_TRUE;
+
    if (!ctx->_ImageTransferState &&
        !srcPacking->SwapBytes &&
        baseInternalFormat == srcFormat &&
@@ -1175,6 +1666,13 @@ _mesa_texstore_rgb565(TEXSTORE_PARAMS)
           dstFormat == &_mesa_texformat_rgb565_rev);
    ASSERT(dstFormat->TexelBytes == 2);
 
+   if (texstore_with_row_converter(ctx, dims, baseInternalFormat, dstFormat,
+                                   dstAddr, dstXoffset, dstYoffset, dstZoffset,
+                                   dstRowStride, dstImageOffsets,
+                                   srcWidth, srcHeight, srcDepth,
+                                   srcFormat, srcType, srcAddr, srcPacking))
+      return GL_TRUE;
+
    if (!ctx->_ImageTransferState &&
        !srcPacking->SwapBytes &&
        dstFormat == &_mesa_texformat_rgb565 &&
@@ -1189,42 +1687,6 @@ _mesa_texstore_rgb565(TEXSTORE_PARAMS)
                      srcWidth, srcHeight, srcDepth, srcFormat, srcType,
                      srcAddr, srcPacking);
    }
-   else if (!ctx->_ImageTransferState &&
-            !srcPacking->SwapBytes &&
-            baseInternalFormat == GL_RGB &&
-            srcFormat == GL_RGB &&
-            srcType == GL_UNSIGNED_BYTE &&
-            dims == 2) {
-      /* do optimized tex store */
-      const GLint srcRowStride = _mesa_image_row_stride(srcPacking, srcWidth,
-                                                        srcFormat, srcType);
-      const GLubyte *src = (const GLubyte *)
-         _mesa_image_address(dims, srcPacking, srcAddr, srcWidth, srcHeight,
-                             srcFormat, srcType, 0, 0, 0);
-      GLubyte *dst = (GLubyte *) dstAddr
-                   + dstYoffset * dstRowStride
-                   + dstXoffset * dstFormat->TexelBytes;
-      GLint row, col;
-      for (row = 0; row < srcHeight; row++) {
-         const GLubyte *srcUB = (const GLubyte *) src;
-         GLushort *dstUS = (GLushort *) dst;
-         /* check for byteswapped format */
-         if (dstFormat == &_mesa_texformat_rgb565) {
-            for (col = 0; col < srcWidth; col++) {
-               dstUS[col] = PACK_COLOR_565( srcUB[0], srcUB[1], srcUB[2] );
-               srcUB += 3;
-            }
-         }
-         else {
-            for (col = 0; col < srcWidth; col++) {
-               dstUS[col] = PACK_COLOR_565_REV( srcUB[0], srcUB[1], srcUB[2] );
-               srcUB += 3;
-            }
-         }
-         dst += dstRowStride;
-         src += srcRowStride;
-      }
-   }
    else {
       /* general path */
       const GLchan *tempImage = _mesa_make_temp_chan_image(ctx, dims,
@@ -1283,6 +1745,13 @@ _mesa_texstore_rgba8888(TEXSTORE_PARAMS)
           dstFormat == &_mesa_texformat_rgba8888_rev);
    ASSERT(dstFormat->TexelBytes == 4);
 
+   if (texstore_with_row_converter(ctx, dims, baseInternalFormat, dstFormat,
+                                   dstAddr, dstXoffset, dstYoffset, dstZoffset,
+                                   dstRowStride, dstImageOffsets,
+                                   srcWidth, srcHeight, srcDepth,
+                                   srcFormat, srcType, srcAddr, srcPacking))
+      return GL_TRUE;
+
    if (!ctx->_ImageTransferState &&
        !srcPacking->SwapBytes &&
        dstFormat == &_mesa_texformat_rgba8888 &&
@@ -1406,6 +1875,13 @@ _mesa_texstore_argb8888(TEXSTORE_PARAMS)
           dstFormat == &_mesa_texformat_argb8888_rev);
    ASSERT(dstFormat->TexelBytes == 4);
 
+   if (texstore_with_row_converter(ctx, dims, baseInternalFormat, dstFormat,
+                                   dstAddr, dstXoffset, dstYoffset, dstZoffset,
+                                   dstRowStride, dstImageOffsets,
+                                   srcWidth, srcHeight, srcDepth,
+                                   srcFormat, srcType, srcAddr, srcPacking))
+      return GL_TRUE;
+
    if (!ctx->_ImageTransferState &&
        !srcPacking->SwapBytes &&
        dstFormat == &_mesa_texformat_argb8888 &&
@@ -1854,6 +2330,13 @@ _mesa_texstore_argb4444(TEXSTORE_PARAMS)
           dstFormat == &_mesa_texformat_argb4444_rev);
    ASSERT(dstFormat->TexelBytes == 2);
 
+   if (texstore_with_row_converter(ctx, dims, baseInternalFormat, dstFormat,
+                                   dstAddr, dstXoffset, dstYoffset, dstZoffset,
+                                   dstRowStride, dstImageOffsets,
+                                   srcWidth, srcHeight, srcDepth,
+                                   srcFormat, srcType, srcAddr, srcPacking))
+      return GL_TRUE;
+
    if (!ctx->_ImageTransferState &&
        !srcPacking->SwapBytes &&
        dstFormat == &_mesa_texformat_argb4444 &&
@@ -1923,6 +2406,13 @@ _mesa_texstore_argb1555(TEXSTORE_PARAMS)
           dstFormat == &_mesa_texformat_argb1555_rev);
    ASSERT(dstFormat->TexelBytes == 2);
 
+   if (texstore_with_row_converter(ctx, dims, baseInternalFormat, dstFormat,
+                                   dstAddr, dstXoffset, dstYoffset, dstZoffset,
+                                   dstRowStride, dstImageOffsets,
+                                   srcWidth, srcHeight, srcDepth,
+                                   srcFormat, srcType, srcAddr, srcPacking))
+      return GL_TRUE;
+
    if (!ctx->_ImageTransferState &&
        !srcPacking->SwapBytes &&
        dstFormat == &_mesa_texformat_argb1555 &&
@@ -0,0 +1,239 @@
+/**
+ * \file threadpool.c
+ * Simple worker thread pool for data-parallel software rendering tasks.
+ *
+ * There is one pool per process.  It's created on first use and sized
+ * by the MESA_NUM_THREADS environment variable (default 1, meaning all
+ * work is done serially on the calling thread and no threads are ever
+ * created).  Work is submitted as a number of independent tasks which
+ * are handed out dynamically to the calling thread and the workers;
+ * _mesa_threadpool_run() returns when all tasks have completed.
+ */
+
+/*
+ * Mesa 3-D graphics library
+ * Version:  7.1
+ *
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "glheader.h"
+#include "imports.h"
+#include "macros.h"
+#include "glapi/glthread.h"
+#include "threadpool.h"
+
+
+#ifdef PTHREADS
+
+struct worker {
+   struct _mesa_threadpool *Pool;
+   GLuint Index;
+   pthread_t Thread;
+};
+
+#endif
+
+
+/**
+ * The thread pool data structure.
+ */
+struct _mesa_threadpool {
+   GLuint NumThreads;            /**< number of threads, including caller */
+#ifdef PTHREADS
+   struct worker Workers[MAX_POOL_THREADS];
+   pthread_mutex_t RunMutex;     /**< held for the duration of a run */
+   pthread_mutex_t Mutex;        /**< protects the fields below */
+   pthread_cond_t WorkCond;      /**< signalled when a run starts */
+   pthread_cond_t DoneCond;      /**< signalled when the last worker is done */
+   GLuint Generation;            /**< incremented for each run */
+   GLuint Active;                /**< number of workers still busy */
+   _mesa_threadpool_task Func;
+   void *Data;
+   GLuint NumTasks;
+   GLuint NextTask;
+#endif
+};
+
+
+static struct _mesa_threadpool *Pool = NULL;
+_glthread_DECLARE_STATIC_MUTEX(PoolMutex);
+
+
+#ifdef PTHREADS
+
+/**
+ * Grab and execute tasks from the current run until there are none left.
+ */
+static void
+run_tasks(struct _mesa_threadpool *pool, GLuint thread)
+{
+   for (;;) {
+      GLuint task;
+
+      pthread_mutex_lock(&pool->Mutex);
+      task = pool->NextTask;
+      if (task < pool->NumTasks)
+         pool->NextTask++;
+      pthread_mutex_unlock(&pool->Mutex);
+
+      if (task >= pool->NumTasks)
+         return;
+
+      pool->Func(pool->Data, task, thread);
+   }
+}
+
+
+static void *
+worker_main(void *arg)
+{
+   struct worker *w = (struct worker *) arg;
+   struct _mesa_threadpool *pool = w->Pool;
+   GLuint generation = 0;
+
+   pthread_mutex_lock(&pool->Mutex);
+   for (;;) {
+      while (pool->Generation == generation)
+         pthread_cond_wait(&pool->WorkCond, &pool->Mutex);
+      generation = pool->Generation;
+      pthread_mutex_unlock(&pool->Mutex);
+
+      run_tasks(pool, w->Index);
+
+      pthread_mutex_lock(&pool->Mutex);
+      if (--pool->Active == 0)
+         pthread_cond_signal(&pool->DoneCond);
+   }
+
+   return NULL;
+}
+
+
+/**
+ * Start the worker threads.  If a thread can't be created we simply
+ * continue with fewer threads.
+ */
+static void
+start_workers(struct _mesa_threadpool *pool, GLuint numThreads)
+{
+   GLuint i;
+
+   pthread_mutex_init(&pool->RunMutex, NULL);
+   pthread_mutex_init(&pool->Mutex, NULL);
+   pthread_cond_init(&pool->WorkCond, NULL);
+   pthread_cond_init(&pool->DoneCond, NULL);
+
+   pool->NumThreads = 1;
+   for (i = 1; i < numThreads; i++) {
+      struct worker *w = &pool->Workers[i];
+      w->Pool = pool;
+      w->Index = i;
+      if (pthread_create(&w->Thread, NULL, worker_main, w) != 0) {
+         _mesa_warning(NULL, "Mesa: couldn't create worker thread %u", i);
+         break;
+      }
+      pool->NumThreads++;
+   }
+}
+
+#endif /* PTHREADS */
+
+
+/**
+ * Return the process-wide thread pool, creating it if needed.
+ */
+struct _mesa_threadpool *
+_mesa_get_threadpool(void)
+{
+   _glthread_LOCK_MUTEX(PoolMutex);
+   if (!Pool) {
+      struct _mesa_threadpool *pool = CALLOC_STRUCT(_mesa_threadpool);
+      if (pool) {
+         const char *env = _mesa_getenv("MESA_NUM_THREADS");
+         GLint numThreads = env ? _mesa_atoi(env) : 1;
+         numThreads = CLAMP(numThreads, 1, MAX_POOL_THREADS);
+         pool->NumThreads = 1;
+#ifdef PTHREADS
+         if (numThreads > 1)
+            start_workers(pool, numThreads);
+#endif
+         Pool = pool;
+      }
+   }
+   _glthread_UNLOCK_MUTEX(PoolMutex);
+   return Pool;
+}
+
+
+/**
+ * Return number of threads in the pool, including the calling thread.
+ */
+GLuint
+_mesa_threadpool_size(const struct _mesa_threadpool *pool)
+{
+   return pool ? pool->NumThreads : 1;
+}
+
+
+/**
+ * Execute func(data, task, thread) for each task in [0, numTasks) and
+ * wait for completion.  The calling thread takes part in the work as
+ * thread 0.  If the pool is already busy (a run from another thread, or
+ * a nested run from inside a task) the tasks are executed serially on
+ * the calling thread instead of blocking.
+ */
+void
+_mesa_threadpool_run(struct _mesa_threadpool *pool, GLuint numTasks,
+                     _mesa_threadpool_task func, void *data)
+{
+   GLuint i;
+
+#ifdef PTHREADS
+   if (pool && pool->NumThreads > 1 && numTasks > 1 &&
+       pthread_mutex_trylock(&pool->RunMutex) == 0) {
+      pthread_mutex_lock(&pool->Mutex);
+      pool->Func = func;
+      pool->Data = data;
+      pool->NumTasks = numTasks;
+      pool->NextTask = 0;
+      pool->Active = pool->NumThreads - 1;
+      pool->Generation++;
+      pthread_cond_broadcast(&pool->WorkCond);
+      pthread_mutex_unlock(&pool->Mutex);
+
+      run_tasks(pool, 0);
+
+      pthread_mutex_lock(&pool->Mutex);
+      while (pool->Active > 0)
+         pthread_cond_wait(&pool->DoneCond, &pool->Mutex);
+      pthread_mutex_unlock(&pool->Mutex);
+
+      pthread_mutex_unlock(&pool->RunMutex);
+      return;
+   }
+#else
+   (void) pool;
+#endif
+
+   for (i = 0; i < numTasks; i++)
+      func(data, i, 0);
+}
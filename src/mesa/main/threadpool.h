@@ -0,0 +1,69 @@
+/**
+ * \file threadpool.h
+ * Simple worker thread pool for data-parallel software rendering tasks.
+ */
+
+/*
+ * Mesa 3-D graphics library
+ * Version:  7.1
+ *
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+
+#include "glheader.h"
+
+
+/**
+ * Upper bound on the number of threads in a pool (including the caller).
+ */
+#define MAX_POOL_THREADS 64
+
+
+/**
+ * A task callback.
+ * \param data  the pointer passed to _mesa_threadpool_run()
+ * \param task  task number in [0, numTasks)
+ * \param thread  index of the executing thread in [0, pool size).  The
+ *                calling thread is always thread 0.  Callers can use this
+ *                to index per-thread scratch storage.
+ */
+typedef void (*_mesa_threadpool_task)(void *data, GLuint task, GLuint thread);
+
+
+struct _mesa_threadpool;
+
+
+extern struct _mesa_threadpool *
+_mesa_get_threadpool(void);
+
+extern GLuint
+_mesa_threadpool_size(const struct _mesa_threadpool *pool);
+
+extern void
+_mesa_threadpool_run(struct _mesa_threadpool *pool, GLuint numTasks,
+                     _mesa_threadpool_task func, void *data);
+
+
+#endif
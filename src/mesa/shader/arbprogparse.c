@@ -41,6 +41,7 @@
 #include "macros.h"
 #include "mtypes.h"
 #include "prog_instruction.h"
+#include "prog_diskcache.h"
 
 
 /* For ARB programs, use the NV instruction limits */
@@ -3679,6 +3680,82 @@ enable_parser_extensions(GLcontext *ctx, grammar id)
 }
 
 
+#define NUM_PARSER_EXTENSIONS 7
+
+/**
+ * Get the extension flags that enable_parser_extensions() looks at, which
+ * are part of the key for the program's on-disk cache entry.
+ */
+static void
+get_parser_extensions(const GLcontext *ctx,
+                      GLboolean ext[NUM_PARSER_EXTENSIONS])
+{
+   ext[0] = ctx->Extensions.ARB_fragment_program_shadow;
+   ext[1] = ctx->Extensions.EXT_point_parameters;
+   ext[2] = ctx->Extensions.EXT_secondary_color;
+   ext[3] = ctx->Extensions.EXT_fog_coord;
+   ext[4] = ctx->Extensions.NV_texture_rectangle;
+   ext[5] = ctx->Extensions.ARB_draw_buffers;
+   ext[6] = ctx->Extensions.MESA_texture_array;
+}
+
+
+/**
+ * Look for the program in the on-disk cache (see prog_diskcache.c).
+ * A hit has the same effect as a successful _mesa_parse_arb_program()
+ * followed by the copying done by the callers below.
+ * \return GL_TRUE if found
+ */
+static GLboolean
+load_cached_program(GLcontext *ctx, GLenum target,
+                    const GLubyte *str, GLsizei len,
+                    struct gl_program *program)
+{
+   GLboolean ext[NUM_PARSER_EXTENSIONS];
+   GLubyte *strz;
+
+   if (len < 0)
+      return GL_FALSE;
+
+   strz = (GLubyte *) _mesa_malloc(len + 1);
+   if (!strz)
+      return GL_FALSE;
+
+   get_parser_extensions(ctx, ext);
+   if (!_mesa_load_cached_program(ctx, target, str, len, ext, sizeof(ext),
+                                  program, NULL)) {
+      _mesa_free(strz);
+      return GL_FALSE;
+   }
+
+   _mesa_set_program_error(ctx, -1, NULL);
+
+   _mesa_memcpy(strz, str, len);
+   strz[len] = '\0';
+   if (program->String)
+      _mesa_free(program->String);
+   program->String = strz;
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Put a successfully parsed program into the on-disk cache.
+ */
+static void
+store_cached_program(GLcontext *ctx, GLenum target,
+                     const GLubyte *str, GLsizei len,
+                     const struct gl_program *program)
+{
+   GLboolean ext[NUM_PARSER_EXTENSIONS];
+
+   get_parser_extensions(ctx, ext);
+   _mesa_store_cached_program(ctx, target, str, len, ext, sizeof(ext),
+                              program, NULL);
+}
+
+
 /**
  * This kicks everything off.
  *
@@ -3900,6 +3977,10 @@ _mesa_parse_arb_fragment_program(GLcontext* ctx, GLenum target,
    GLuint i;
 
    ASSERT(target == GL_FRAGMENT_PROGRAM_ARB);
+   if (load_cached_program(ctx, target, (const GLubyte *) str, len,
+                           &program->Base))
+      return;
+
    if (!_mesa_parse_arb_program(ctx, target, (const GLubyte*) str, len, &ap)) {
       /* Error in the program. Just return. */
       return;
@@ -3941,6 +4022,9 @@ _mesa_parse_arb_fragment_program(GLcontext* ctx, GLenum target,
       _mesa_free_parameter_list(program->Base.Parameters);
    program->Base.Parameters    = ap.Base.Parameters;
 
+   store_cached_program(ctx, target, (const GLubyte *) str, len,
+                        &program->Base);
+
 #if DEBUG_FP
    _mesa_printf("____________Fragment program %u ________\n", program->Base.ID);
    _mesa_print_program(&program->Base);
@@ -3963,6 +4047,10 @@ _mesa_parse_arb_vertex_program(GLcontext *ctx, GLenum target,
 
    ASSERT(target == GL_VERTEX_PROGRAM_ARB);
 
+   if (load_cached_program(ctx, target, (const GLubyte *) str, len,
+                           &program->Base))
+      return;
+
    if (!_mesa_parse_arb_program(ctx, target, (const GLubyte*) str, len, &ap)) {
       /* Error in the program. Just return. */
       return;
@@ -3994,6 +4082,9 @@ _mesa_parse_arb_vertex_program(GLcontext *ctx, GLenum target,
       _mesa_free_parameter_list(program->Base.Parameters);
    program->Base.Parameters = ap.Base.Parameters; 
 
+   store_cached_program(ctx, target, (const GLubyte *) str, len,
+                        &program->Base);
+
 #if DEBUG_VP
    _mesa_printf("____________Vertex program %u __________\n", program->Base.Id);
    _mesa_print_program(&program->Base);
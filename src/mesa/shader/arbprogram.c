@@ -37,6 +37,7 @@
 #include "macros.h"
 #include "mtypes.h"
 #include "program.h"
+#include "prog_execute_sse.h"
 
 
 void GLAPIENTRY
@@ -228,6 +229,7 @@ _mesa_ProgramStringARB(GLenum target, GLenum format, GLsizei len,
        && ctx->Extensions.ARB_vertex_program) {
       struct gl_vertex_program *prog = ctx->VertexProgram.Current;
       _mesa_parse_arb_vertex_program(ctx, target, string, len, prog);
+      _mesa_free_program_sse(&prog->Base);
       
       if (ctx->Driver.ProgramStringNotify)
 	 ctx->Driver.ProgramStringNotify( ctx, target, &prog->Base );
@@ -236,6 +238,7 @@ _mesa_ProgramStringARB(GLenum target, GLenum format, GLsizei len,
             && ctx->Extensions.ARB_fragment_program) {
       struct gl_fragment_program *prog = ctx->FragmentProgram.Current;
       _mesa_parse_arb_fragment_program(ctx, target, string, len, prog);
+      _mesa_free_program_sse(&prog->Base);
 
       if (ctx->Driver.ProgramStringNotify)
 	 ctx->Driver.ProgramStringNotify( ctx, target, &prog->Base );
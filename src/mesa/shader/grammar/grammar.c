@@ -720,6 +720,82 @@ static void cond_destroy (cond **co)
     }
 }
 
+/*
+    first character set typedef
+
+    Holds the characters that a specifier or a rule can start with, see compute_first_sets().
+*/
+typedef struct first_set_
+{
+    byte m_bits[32];
+    int m_any;          /* any character, the bits are not used */
+} first_set;
+
+static void first_set_clear (first_set *fs)
+{
+    int i;
+
+    for (i = 0; i < 32; i++)
+        fs->m_bits[i] = 0;
+    fs->m_any = 0;
+}
+
+static int first_set_has (const first_set *fs, byte c)
+{
+    return fs->m_any || (fs->m_bits[c >> 3] & (1 << (c & 7)));
+}
+
+/*
+    the following return 1 if the set has changed, 0 otherwise
+*/
+static int first_set_fill (first_set *fs)
+{
+    if (fs->m_any)
+        return 0;
+
+    fs->m_any = 1;
+    return 1;
+}
+
+static int first_set_add_range (first_set *fs, byte first, byte last)
+{
+    int changed = 0;
+    unsigned int c;
+
+    if (fs->m_any)
+        return 0;
+
+    for (c = first; c <= last; c++)
+        if (!(fs->m_bits[c >> 3] & (1 << (c & 7))))
+        {
+            fs->m_bits[c >> 3] |= 1 << (c & 7);
+            changed = 1;
+        }
+
+    return changed;
+}
+
+static int first_set_merge (first_set *fs, const first_set *src)
+{
+    int changed = 0;
+    int i;
+
+    if (fs->m_any)
+        return 0;
+
+    if (src->m_any)
+        return first_set_fill (fs);
+
+    for (i = 0; i < 32; i++)
+        if (src->m_bits[i] & ~fs->m_bits[i])
+        {
+            fs->m_bits[i] |= src->m_bits[i];
+            changed = 1;
+        }
+
+    return changed;
+}
+
 /*
     specifier type typedef
 */
@@ -747,6 +823,7 @@ typedef struct spec_
     emit *m_emits;
     error *m_errtext;
     cond *m_cond;
+    first_set m_first;
     struct spec_ *next;
 } spec;
 
@@ -763,6 +840,7 @@ static void spec_create (spec **sp)
         (**sp).m_emits = NULL;
         (**sp).m_errtext = NULL;
         (**sp).m_cond = NULL;
+        first_set_clear (&(**sp).m_first);
         (**sp).next = NULL;
     }
 }
@@ -801,6 +879,10 @@ typedef struct rule_
     spec *m_specs;
     struct rule_ *next;
     int m_referenced;
+    first_set m_first;
+    int m_may_raise;            /* can raise an error */
+    int m_bounded;              /* cannot reach itself through the rules it references */
+    int m_memoize;              /* the result depends only on the text position */
 } rule;
 
 static void rule_create (rule **ru)
@@ -812,6 +894,10 @@ static void rule_create (rule **ru)
         (**ru).m_specs = NULL;
         (**ru).next = NULL;
         (**ru).m_referenced = 0;
+        first_set_clear (&(**ru).m_first);
+        (**ru).m_may_raise = 0;
+        (**ru).m_bounded = 0;
+        (**ru).m_memoize = 0;
     }
 }
 
@@ -1040,6 +1126,129 @@ static int bytepool_reserve (bytepool *by, unsigned int n)
     return 1;
 }
 
+/*
+    rule memo entry typedef
+*/
+typedef struct memo_entry_
+{
+    rule *m_rule;
+    int m_end;                  /* text position after the match, -1 if it did not match */
+    unsigned int m_prod;        /* offset of the produced bytes in the memo byte pool */
+    unsigned int m_prod_size;
+    int m_next;                 /* next entry at the same text position, -1 if none */
+} memo_entry;
+
+/*
+    rule memo typedef - remembers the results of matching rules at text positions,
+    so that backtracking does not parse the same part of the text over and over again;
+    it is only valid for a single grammar_fast_check call
+*/
+typedef struct rule_memo_
+{
+    int *m_heads;               /* first entry for every text position, -1 if none */
+    int m_length;               /* number of text positions */
+    memo_entry *m_entries;      /* entries in the order they were recorded */
+    unsigned int m_size;
+    unsigned int m_count;
+    bytepool *m_prod;
+    unsigned int m_prod_len;
+} rule_memo;
+
+static void rule_memo_destroy (rule_memo **me)
+{
+    if (*me != NULL)
+    {
+        mem_free ((void **) &(**me).m_heads);
+        mem_free ((void **) &(**me).m_entries);
+        bytepool_destroy (&(**me).m_prod);
+        mem_free ((void **) me);
+    }
+}
+
+/*
+    creates a memo for a text of the specified length, including the terminating zero
+*/
+static void rule_memo_create (rule_memo **me, int len)
+{
+    *me = (rule_memo *) (mem_alloc (sizeof (rule_memo)));
+    if (*me != NULL)
+    {
+        int i;
+
+        (**me).m_length = len;
+        (**me).m_size = 1024;
+        (**me).m_count = 0;
+        (**me).m_prod_len = 0;
+        (**me).m_heads = (int *) (mem_alloc (sizeof (int) * len));
+        (**me).m_entries = (memo_entry *) (mem_alloc (sizeof (memo_entry) * (**me).m_size));
+        bytepool_create (&(**me).m_prod, 4096);
+
+        if ((**me).m_heads == NULL || (**me).m_entries == NULL || (**me).m_prod == NULL)
+        {
+            rule_memo_destroy (me);
+            return;
+        }
+
+        for (i = 0; i < len; i++)
+            (**me).m_heads[i] = -1;
+    }
+}
+
+/*
+    returns the entry for the specified rule and text position,
+    returns NULL if the rule has not been matched there yet
+*/
+static memo_entry *rule_memo_find (rule_memo *me, rule *ru, int index)
+{
+    int i;
+
+    for (i = me->m_heads[index]; i != -1; i = me->m_entries[i].m_next)
+        if (me->m_entries[i].m_rule == ru)
+            return &me->m_entries[i];
+
+    return NULL;
+}
+
+/*
+    records the result of matching the rule at the text position, end is -1 for no match,
+    returns 0 on success,
+    returns 1 otherwise
+*/
+static int rule_memo_insert (rule_memo *me, rule *ru, int index, int end, const byte *prod,
+    unsigned int size)
+{
+    memo_entry *en;
+
+    if (me->m_count == me->m_size)
+    {
+        memo_entry *entries = (memo_entry *) (mem_realloc (me->m_entries,
+            sizeof (memo_entry) * me->m_size, sizeof (memo_entry) * me->m_size * 2));
+
+        if (entries == NULL)
+            return 1;
+
+        me->m_entries = entries;
+        me->m_size *= 2;
+    }
+
+    if (bytepool_reserve (me->m_prod, me->m_prod_len + size))
+        return 1;
+
+    en = &me->m_entries[me->m_count];
+    en->m_rule = ru;
+    en->m_end = end;
+    en->m_prod = me->m_prod_len;
+    en->m_prod_size = size;
+    en->m_next = me->m_heads[index];
+    me->m_heads[index] = (int) me->m_count++;
+
+    if (size != 0)
+        mem_copy (me->m_prod->_F + me->m_prod_len, prod, size);
+    me->m_prod_len += size;
+
+    return 0;
+}
+
 /*
     string to string map typedef
 */
@@ -2230,6 +2439,193 @@ static int update_dependencies (dict *di, map_rule *mapr, byte **syntax_symbol,
     return 0;
 }
 
+/*
+    updates the first character set of a specifier from its contents,
+    returns 1 if the set has changed, 0 otherwise
+*/
+static int update_spec_first_set (dict *di, rule *ru, spec *sp)
+{
+    switch (sp->m_spec_type)
+    {
+    case st_false:
+        return 0;
+    case st_true:
+    case st_identifier_loop:
+        /* can match without eating a character */
+        return first_set_fill (&sp->m_first);
+    case st_debug:
+        return ru->m_oper == op_and ? first_set_fill (&sp->m_first) : 0;
+    case st_byte:
+        return first_set_add_range (&sp->m_first, sp->m_byte[0], sp->m_byte[0]);
+    case st_byte_range:
+        return first_set_add_range (&sp->m_first, sp->m_byte[0], sp->m_byte[1]);
+    case st_string:
+        /* the string filter swallows the errors it raises, but the first one still sticks */
+        if (sp->m_string[0] == '\0' || (di->m_string != NULL && di->m_string->m_may_raise))
+            return first_set_fill (&sp->m_first);
+        return first_set_add_range (&sp->m_first, sp->m_string[0], sp->m_string[0]);
+    case st_identifier:
+        return first_set_merge (&sp->m_first, &sp->m_rule->m_first);
+    }
+
+    return 0;
+}
+
+/*
+    computes the first character sets of all the rules and specifiers
+
+    The set of a specifier holds all the characters at which evaluating the specifier can end
+    up in anything else than a plain mismatch, that is, a match or an error being raised.
+    A specifier that can match without eating a character, or that raises an error when it
+    does not match, gets all the characters. The matching functions skip a specifier if the
+    current character is not in its set, which cuts off most of the alternatives tried in
+    .or rules without changing the result of parsing.
+
+    Rules reference each other recursively, so the sets are grown until nothing changes.
+*/
+static void compute_first_sets (dict *di)
+{
+    int changed;
+
+    do
+    {
+        rule *ru;
+
+        changed = 0;
+        for (ru = di->m_rulez; ru != NULL; ru = ru->next)
+        {
+            spec *sp;
+
+            for (sp = ru->m_specs; sp != NULL; sp = sp->next)
+            {
+                changed |= update_spec_first_set (di, ru, sp);
+
+                /* .and rules start with their first specifier, .or rules with any of them */
+                if (ru->m_oper == op_or)
+                    changed |= first_set_merge (&ru->m_first, &sp->m_first);
+                else if (sp == ru->m_specs)
+                {
+                    if (sp->m_errtext)
+                        changed |= first_set_fill (&ru->m_first);
+                    else
+                        changed |= first_set_merge (&ru->m_first, &sp->m_first);
+                }
+
+                if (!ru->m_may_raise &&
+                    ((ru->m_oper == op_and && sp->m_errtext) ||
+                     ((sp->m_spec_type == st_identifier || sp->m_spec_type == st_identifier_loop) &&
+                      sp->m_rule->m_may_raise)))
+                {
+                    ru->m_may_raise = 1;
+                    changed = 1;
+                }
+            }
+        }
+    }
+    while (changed);
+}
+
+/*
+    returns 1 if the result of evaluating the specifier can change while the text is being
+    parsed, that is, if it writes regbytes or tests regbytes and some of them are written
+*/
+static int spec_depends_on_regbytes (spec *sp, int regbytes_written)
+{
+    emit *em;
+
+    for (em = sp->m_emits; em != NULL; em = em->m_next)
+        if (em->m_emit_dest == ed_regbyte)
+            return 1;
+
+    return regbytes_written && sp->m_cond != NULL &&
+        (sp->m_cond->m_operands[0].m_type == cot_regbyte ||
+         sp->m_cond->m_operands[1].m_type == cot_regbyte);
+}
+
+/*
+    finds the rules that are worth memoizing
+
+    Matching such a rule at a given text position always gives the same result and the same
+    output within a single check, so fast_match needs to do it only once. Rules that depend
+    on regbytes written during parsing, directly or through the rules they reference, are
+    excluded.
+
+    Backtracking gets costly only when rules nest, as in expressions, since a failed
+    alternative may then have parsed an arbitrarily large part of the text. Rules whose
+    nesting depth is bounded are cheaper to match again than to look up, so only the rules
+    that can reach a recursive rule are memoized.
+*/
+static void find_memoizable_rules (dict *di)
+{
+    int regbytes_written = 0;
+    int changed;
+    rule *ru;
+    spec *sp;
+    emit *em;
+
+    for (ru = di->m_rulez; ru != NULL; ru = ru->next)
+        for (sp = ru->m_specs; sp != NULL; sp = sp->next)
+            for (em = sp->m_emits; em != NULL; em = em->m_next)
+                if (em->m_emit_dest == ed_regbyte)
+                    regbytes_written = 1;
+
+    /* a rule is bounded once all the rules it references are, recursive rules never are */
+    for (ru = di->m_rulez; ru != NULL; ru = ru->next)
+        ru->m_bounded = 0;
+
+    do
+    {
+        changed = 0;
+        for (ru = di->m_rulez; ru != NULL; ru = ru->next)
+        {
+            if (ru->m_bounded)
+                continue;
+
+            for (sp = ru->m_specs; sp != NULL; sp = sp->next)
+                if ((sp->m_spec_type == st_identifier || sp->m_spec_type == st_identifier_loop) &&
+                    !sp->m_rule->m_bounded)
+                    break;
+
+            if (sp == NULL)
+            {
+                ru->m_bounded = 1;
+                changed = 1;
+            }
+        }
+    }
+    while (changed);
+
+    for (ru = di->m_rulez; ru != NULL; ru = ru->next)
+        ru->m_memoize = 1;
+
+    do
+    {
+        changed = 0;
+        for (ru = di->m_rulez; ru != NULL; ru = ru->next)
+        {
+            if (!ru->m_memoize)
+                continue;
+
+            for (sp = ru->m_specs; sp != NULL; sp = sp->next)
+            {
+                if (spec_depends_on_regbytes (sp, regbytes_written) ||
+                    ((sp->m_spec_type == st_identifier || sp->m_spec_type == st_identifier_loop) &&
+                     !sp->m_rule->m_memoize))
+                {
+                    ru->m_memoize = 0;
+                    changed = 1;
+                    break;
+                }
+            }
+        }
+    }
+    while (changed);
+
+    for (ru = di->m_rulez; ru != NULL; ru = ru->next)
+        if (ru->m_bounded)
+            ru->m_memoize = 0;
+}
+
 static int satisfies_condition (cond *co, regbyte_ctx *ctx)
 {
     byte values[2];
@@ -2297,7 +2693,12 @@ match (dict *di, const byte *text, int *index, rule *ru, barray **ba, int filter
       int i, len, save_ind = ind;
         barray *array = NULL;
 
-        if (satisfies_condition (sp->m_cond, ctx))
+        /* don't read past the end of the text for specifiers that match anything */
+        if (!sp->m_first.m_any && !first_set_has (&sp->m_first, text[ind]))
+        {
+            status = mr_not_matched;
+        }
+        else if (satisfies_condition (sp->m_cond, ctx))
         {
             switch (sp->m_spec_type)
             {
@@ -2519,7 +2920,11 @@ match (dict *di, const byte *text, int *index, rule *ru, barray **ba, int filter
 
 static match_result
 fast_match (dict *di, const byte *text, int *index, rule *ru, int *_PP, bytepool *_BP,
-            int filtering_string, regbyte_ctx **rbc)
+            int filtering_string, regbyte_ctx **rbc, rule_memo *memo);
+
+static match_result
+fast_match_rule (dict *di, const byte *text, int *index, rule *ru, int *_PP, bytepool *_BP,
+                 int filtering_string, regbyte_ctx **rbc, rule_memo *memo)
 {
    int ind = *index;
     int _P = filtering_string ? 0 : *_PP;
@@ -2533,19 +2938,21 @@ fast_match (dict *di, const byte *text, int *index, rule *ru, int *_PP, bytepool
     {
       int i, len, save_ind = ind;
 
+        /* the specifier's own emits go first, the output of the rules it invokes follows,
+         * space is reserved only when something is actually written
+         */
         _P2 = _P + (sp->m_emits ? emit_size (sp->m_emits) : 0);
-        if (bytepool_reserve (_BP, _P2))
+
+        if (!sp->m_first.m_any && !first_set_has (&sp->m_first, text[ind]))
         {
-            free_regbyte_ctx_stack (ctx, *rbc);
-            return mr_internal_error;
+            status = mr_not_matched;
         }
-
-        if (satisfies_condition (sp->m_cond, ctx))
+        else if (satisfies_condition (sp->m_cond, ctx))
         {
             switch (sp->m_spec_type)
             {
             case st_identifier:
-                status = fast_match (di, text, &ind, sp->m_rule, &_P2, _BP, filtering_string, &ctx);
+                status = fast_match (di, text, &ind, sp->m_rule, &_P2, _BP, filtering_string, &ctx, memo);
 
                 if (status == mr_internal_error)
                 {
@@ -2563,7 +2970,8 @@ fast_match (dict *di, const byte *text, int *index, rule *ru, int *_PP, bytepool
                     match_result result;
                     regbyte_ctx *null_ctx = NULL;
 
-                    result = fast_match (di, text + ind, &filter_index, di->m_string, NULL, _BP, 1, &null_ctx);
+                    result = fast_match (di, text + ind, &filter_index, di->m_string, NULL, _BP, 1, &null_ctx,
+                        NULL);
 
                     if (result == mr_internal_error)
                     {
@@ -2624,7 +3032,7 @@ fast_match (dict *di, const byte *text, int *index, rule *ru, int *_PP, bytepool
                     match_result result;
 
                     save_ind = ind;
-                    result = fast_match (di, text, &ind, sp->m_rule, &_P2, _BP, filtering_string, &ctx);
+                    result = fast_match (di, text, &ind, sp->m_rule, &_P2, _BP, filtering_string, &ctx, memo);
 
                     if (result == mr_error_raised)
                     {
@@ -2637,7 +3045,8 @@ fast_match (dict *di, const byte *text, int *index, rule *ru, int *_PP, bytepool
                         {
                             if (sp->m_emits != NULL)
                             {
-                                if (emit_push (sp->m_emits, _BP->_F + _P, text[ind - 1], save_ind, &ctx))
+                                if (bytepool_reserve (_BP, _P2) ||
+                                    emit_push (sp->m_emits, _BP->_F + _P, text[ind - 1], save_ind, &ctx))
                                 {
                                     free_regbyte_ctx_stack (ctx, *rbc);
                                     return mr_internal_error;
@@ -2646,11 +3055,6 @@ fast_match (dict *di, const byte *text, int *index, rule *ru, int *_PP, bytepool
 
                             _P = _P2;
                             _P2 += sp->m_emits ? emit_size (sp->m_emits) : 0;
-                            if (bytepool_reserve (_BP, _P2))
-                            {
-                                free_regbyte_ctx_stack (ctx, *rbc);
-                                return mr_internal_error;
-                            }
                         }
                     }
                     else if (result == mr_internal_error)
@@ -2695,7 +3099,8 @@ fast_match (dict *di, const byte *text, int *index, rule *ru, int *_PP, bytepool
         {
             if (sp->m_emits != NULL) {
                 const byte ch = (ind <= 0) ? 0 : text[ind - 1];
-                if (emit_push (sp->m_emits, _BP->_F + _P, ch, save_ind, &ctx))
+                if (bytepool_reserve (_BP, _P2) ||
+                    emit_push (sp->m_emits, _BP->_F + _P, ch, save_ind, &ctx))
                 {
                     free_regbyte_ctx_stack (ctx, *rbc);
                     return mr_internal_error;
@@ -2732,6 +3137,56 @@ fast_match (dict *di, const byte *text, int *index, rule *ru, int *_PP, bytepool
     return mr_not_matched;
 }
 
+/*
+    matches the rule, looking the result up in the memo first if the rule can be memoized
+*/
+static match_result
+fast_match (dict *di, const byte *text, int *index, rule *ru, int *_PP, bytepool *_BP,
+            int filtering_string, regbyte_ctx **rbc, rule_memo *memo)
+{
+    memo_entry *en;
+    int ind = *index;
+    int _P;
+    match_result result;
+
+    /* the terminating zero can be matched, so the text position can go past it */
+    if (filtering_string || memo == NULL || !ru->m_memoize || ind >= memo->m_length)
+        return fast_match_rule (di, text, index, ru, _PP, _BP, filtering_string, rbc, memo);
+
+    en = rule_memo_find (memo, ru, ind);
+    if (en != NULL)
+    {
+        if (en->m_end < 0)
+            return mr_not_matched;
+
+        if (bytepool_reserve (_BP, *_PP + en->m_prod_size))
+            return mr_internal_error;
+
+        if (en->m_prod_size != 0)
+            mem_copy (_BP->_F + *_PP, memo->m_prod->_F + en->m_prod, en->m_prod_size);
+        *_PP += en->m_prod_size;
+        *index = en->m_end;
+        return mr_matched;
+    }
+
+    /* errors end the check, so only plain matches and mismatches are recorded */
+    _P = *_PP;
+    result = fast_match_rule (di, text, index, ru, _PP, _BP, filtering_string, rbc, memo);
+
+    if (result == mr_matched)
+    {
+        if (rule_memo_insert (memo, ru, ind, *index, _BP->_F + _P, *_PP - _P))
+            return mr_internal_error;
+    }
+    else if (result == mr_not_matched)
+    {
+        if (rule_memo_insert (memo, ru, ind, -1, NULL, 0))
+            return mr_internal_error;
+    }
+
+    return result;
+}
+
 static byte *
 error_get_token (error *er, dict *di, const byte *text, int ind)
 {
@@ -2979,6 +3434,9 @@ grammar grammar_load_from_text (const byte *text)
         return 0;
     }
 
+    compute_first_sets (g->di);
+    find_memoizable_rules (g->di);
+
     dict_append (&g_dicts, g->di);
     id = g->di->m_id;
     g->di = NULL;
@@ -3038,19 +3496,29 @@ static int _grammar_check (grammar id, const byte *text, byte **prod, unsigned i
     {
         regbyte_ctx *rbc = NULL;
         bytepool *bp = NULL;
+        rule_memo *memo = NULL;
         int _P = 0;
 
         bytepool_create (&bp, estimate_prod_size);
         if (bp == NULL)
             return 0;
 
-        if (fast_match (di, text, &index, di->m_syntax, &_P, bp, 0, &rbc) != mr_matched)
+        rule_memo_create (&memo, str_length (text) + 1);
+        if (memo == NULL)
+        {
+            bytepool_destroy (&bp);
+            return 0;
+        }
+
+        if (fast_match (di, text, &index, di->m_syntax, &_P, bp, 0, &rbc, memo) != mr_matched)
         {
+            rule_memo_destroy (&memo);
             bytepool_destroy (&bp);
             free_regbyte_ctx_stack (rbc, NULL);
             return 0;
         }
 
+        rule_memo_destroy (&memo);
         free_regbyte_ctx_stack (rbc, NULL);
 
         *prod = bp->_F;
@@ -0,0 +1,339 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  7.1
+ *
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file prog_cache.c
+ * Cache of programs generated from fixed-function state.
+ *
+ * The vertex and fragment programs which replace fixed-function T&L and
+ * texture combining are looked up by a key describing the state they
+ * implement.  Each context has its own caches: the generated programs
+ * hold per-context state, such as the parameter values loaded into them at
+ * draw time and driver data tied to the context which created them, so
+ * they can't be shared with other contexts.
+ *
+ * The number of programs kept is bounded; when the cache is full the least
+ * recently used program is dropped.  Programs are reference counted so
+ * that a program dropped from the cache stays alive as long as the context
+ * still uses it.
+ */
+
+
+#include "main/glheader.h"
+#include "main/imports.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
+#include "prog_cache.h"
+
+
+struct cache_item
+{
+   GLuint hash;
+   GLuint keysize;
+   void *key;
+   struct gl_program *program;
+   struct cache_item *next;             /**< next item in the hash chain */
+   struct cache_item *prev_used;        /**< more recently used item */
+   struct cache_item *next_used;        /**< less recently used item */
+};
+
+struct gl_program_cache
+{
+   const char *name;                    /**< for MESA_PROFILE reports */
+   struct cache_item **items;
+   GLuint size;                         /**< number of chains, power of two */
+   GLuint n_items, max_items;
+   struct cache_item *first_used, *last_used;
+   GLuint hits, misses, evictions;      /**< for profiling */
+};
+
+
+static GLuint
+hash_key(const void *key, GLuint keysize)
+{
+   const GLuint *ikey = (const GLuint *) key;
+   GLuint hash = 0, i;
+
+   ASSERT(keysize >= sizeof(GLuint));
+
+   for (i = 0; i < keysize / sizeof(GLuint); i++) {
+      hash += ikey[i];
+      hash += (hash << 10);
+      hash ^= (hash >> 6);
+   }
+
+   return hash;
+}
+
+
+static struct cache_item *
+lookup(const struct gl_program_cache *cache, GLuint hash,
+       const void *key, GLuint keysize)
+{
+   struct cache_item *c;
+
+   for (c = cache->items[hash & (cache->size - 1)]; c; c = c->next) {
+      if (c->hash == hash && c->keysize == keysize &&
+          _mesa_memcmp(c->key, key, keysize) == 0)
+         return c;
+   }
+
+   return NULL;
+}
+
+
+static void
+unlink_used(struct gl_program_cache *cache, struct cache_item *c)
+{
+   if (c->prev_used)
+      c->prev_used->next_used = c->next_used;
+   else
+      cache->first_used = c->next_used;
+
+   if (c->next_used)
+      c->next_used->prev_used = c->prev_used;
+   else
+      cache->last_used = c->prev_used;
+}
+
+
+static void
+link_used(struct gl_program_cache *cache, struct cache_item *c)
+{
+   c->prev_used = NULL;
+   c->next_used = cache->first_used;
+   if (cache->first_used)
+      cache->first_used->prev_used = c;
+   else
+      cache->last_used = c;
+   cache->first_used = c;
+}
+
+
+/**
+ * Drop a reference to a program, deleting it if it was the last one.
+ */
+static void
+unreference_program(GLcontext *ctx, struct gl_program *prog)
+{
+   prog->RefCount--;
+   if (prog->RefCount <= 0)
+      ctx->Driver.DeleteProgram(ctx, prog);
+}
+
+
+static void
+rehash(struct gl_program_cache *cache)
+{
+   struct cache_item **items;
+   struct cache_item *c, *next;
+   GLuint size, i;
+
+   size = cache->size * 2;
+   items = (struct cache_item **) _mesa_calloc(size * sizeof(*items));
+   if (!items)
+      return;   /* just keep the longer chains */
+
+   for (i = 0; i < cache->size; i++)
+      for (c = cache->items[i]; c; c = next) {
+         next = c->next;
+         c->next = items[c->hash & (size - 1)];
+         items[c->hash & (size - 1)] = c;
+      }
+
+   _mesa_free(cache->items);
+   cache->items = items;
+   cache->size = size;
+}
+
+
+/**
+ * Remove the least recently used item.
+ */
+static void
+evict(GLcontext *ctx, struct gl_program_cache *cache)
+{
+   struct cache_item *c = cache->last_used;
+   struct cache_item **p = &cache->items[c->hash & (cache->size - 1)];
+
+   while (*p != c)
+      p = &(*p)->next;
+   *p = c->next;
+
+   unlink_used(cache, c);
+   cache->n_items--;
+   cache->evictions++;
+
+   unreference_program(ctx, c->program);
+   _mesa_free(c->key);
+   _mesa_free(c);
+}
+
+
+/**
+ * Create a new, empty program cache.
+ * \param name  what to call the cache in MESA_PROFILE reports
+ * \param maxItems  number of programs to keep at most
+ */
+struct gl_program_cache *
+_mesa_new_program_cache(const char *name, GLuint maxItems)
+{
+   struct gl_program_cache *cache = CALLOC_STRUCT(gl_program_cache);
+   if (!cache)
+      return NULL;
+
+   cache->size = 32;
+   cache->items = (struct cache_item **)
+      _mesa_calloc(cache->size * sizeof(*cache->items));
+   if (!cache->items) {
+      _mesa_free(cache);
+      return NULL;
+   }
+
+   cache->name = name;
+   cache->max_items = MAX2(maxItems, 1);
+   return cache;
+}
+
+
+/**
+ * Free a program cache, along with the programs the context doesn't use.
+ * Reports the hit rate if MESA_PROFILE is set.
+ */
+void
+_mesa_delete_program_cache(GLcontext *ctx, struct gl_program_cache *cache)
+{
+   struct cache_item *c, *next;
+
+   if (!cache)
+      return;
+
+   if (_mesa_getenv("MESA_PROFILE") && cache->hits + cache->misses) {
+      _mesa_printf("%s: %u hits, %u misses (%.1f%%), %u evictions\n",
+                   cache->name, cache->hits, cache->misses,
+                   100.0 * cache->hits / ((GLdouble) cache->hits +
+                                          cache->misses),
+                   cache->evictions);
+   }
+
+   for (c = cache->first_used; c; c = next) {
+      next = c->next_used;
+      unreference_program(ctx, c->program);
+      _mesa_free(c->key);
+      _mesa_free(c);
+   }
+
+   _mesa_free(cache->items);
+   _mesa_free(cache);
+}
+
+
+/**
+ * Look for the program generated for the given key.
+ * \return the program, with a new reference which the caller must drop
+ *         with _mesa_program_cache_release(), or NULL if not found
+ */
+struct gl_program *
+_mesa_search_program_cache(struct gl_program_cache *cache,
+                           const void *key, GLuint keySize)
+{
+   const GLuint hash = hash_key(key, keySize);
+   struct gl_program *prog = NULL;
+   struct cache_item *c;
+
+   if (!cache)
+      return NULL;
+
+   c = lookup(cache, hash, key, keySize);
+   if (c) {
+      if (c != cache->first_used) {
+         unlink_used(cache, c);
+         link_used(cache, c);
+      }
+      prog = c->program;
+      prog->RefCount++;
+      cache->hits++;
+   }
+   else {
+      cache->misses++;
+   }
+
+   return prog;
+}
+
+
+/**
+ * Add a newly generated program to the cache, which takes its own reference
+ * to it.  The least recently used programs are dropped if the cache is full.
+ */
+void
+_mesa_program_cache_insert(GLcontext *ctx, struct gl_program_cache *cache,
+                           const void *key, GLuint keySize,
+                           struct gl_program *prog)
+{
+   const GLuint hash = hash_key(key, keySize);
+   struct cache_item *c;
+
+   if (!cache)
+      return;
+
+   c = CALLOC_STRUCT(cache_item);
+   if (c)
+      c->key = _mesa_malloc(keySize);
+   if (!c || !c->key) {
+      /* not caching the program is fine */
+      _mesa_free(c);
+      return;
+   }
+
+   _mesa_memcpy(c->key, key, keySize);
+   c->keysize = keySize;
+   c->hash = hash;
+   c->program = prog;
+   prog->RefCount++;
+
+   if (cache->n_items >= cache->size && cache->size < cache->max_items)
+      rehash(cache);
+
+   c->next = cache->items[hash & (cache->size - 1)];
+   cache->items[hash & (cache->size - 1)] = c;
+   link_used(cache, c);
+   cache->n_items++;
+
+   while (cache->n_items > cache->max_items)
+      evict(ctx, cache);
+}
+
+
+/**
+ * Drop a reference to a program obtained from the cache, or to a program
+ * which was added to it.
+ */
+void
+_mesa_program_cache_release(GLcontext *ctx, struct gl_program_cache *cache,
+                            struct gl_program *prog)
+{
+   (void) cache;
+   unreference_program(ctx, prog);
+}
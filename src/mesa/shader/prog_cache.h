@@ -0,0 +1,60 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  7.1
+ *
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef PROG_CACHE_H
+#define PROG_CACHE_H
+
+
+#include "main/mtypes.h"
+
+
+/** Default limit on the number of programs kept by a cache */
+#define PROGRAM_CACHE_MAX_ITEMS 1024
+
+
+struct gl_program_cache;
+
+
+extern struct gl_program_cache *
+_mesa_new_program_cache(const char *name, GLuint maxItems);
+
+extern void
+_mesa_delete_program_cache(GLcontext *ctx, struct gl_program_cache *cache);
+
+extern struct gl_program *
+_mesa_search_program_cache(struct gl_program_cache *cache,
+                           const void *key, GLuint keySize);
+
+extern void
+_mesa_program_cache_insert(GLcontext *ctx, struct gl_program_cache *cache,
+                           const void *key, GLuint keySize,
+                           struct gl_program *prog);
+
+extern void
+_mesa_program_cache_release(GLcontext *ctx, struct gl_program_cache *cache,
+                            struct gl_program *prog);
+
+
+#endif /* PROG_CACHE_H */
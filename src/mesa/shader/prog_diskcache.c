@@ -0,0 +1,927 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  7.1
+ *
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file prog_diskcache.c
+ * On-disk cache of translated programs.
+ *
+ * Turning a GLSL shader or an ARB program string into Mesa instructions
+ * goes through the grammar engine, and for GLSL the AST and the code
+ * generator too, and applications redo exactly the same work each time
+ * they start.  When the MESA_SHADER_CACHE_DIR environment variable names
+ * a directory, the result of each successful translation is written to a
+ * file there and read back the next time the same source is translated
+ * under the same conditions.
+ *
+ * An entry is keyed by the source text, the kind of program, the
+ * context's implementation limits (ctx->Const), whatever other state the
+ * caller says the translation depends on, and the Mesa build.  The build
+ * is identified by a hash of the library file the code was loaded from,
+ * so a rebuild never reads entries written by different code; where the
+ * file can't be found the cache is not used.  The file
+ * name is a hash of the key.  The key itself is stored in the file and
+ * compared on load, and the rest of the entry is checksummed, so hash
+ * collisions and stale, truncated or half-written files are just misses.
+ * Entries are in native byte order; they are only meant to be read back
+ * by the same build on the same machine.
+ */
+
+
+#include "main/glheader.h"
+#include "main/imports.h"
+#include "main/macros.h"
+#include "main/version.h"
+#include "glapi/glthread.h"
+#include "prog_instruction.h"
+#include "prog_parameter.h"
+#include "prog_diskcache.h"
+
+
+/** Bump this whenever the layout of an entry changes */
+#define CACHE_FORMAT_VERSION 1
+
+/** Identifies the build which wrote an entry, see get_build_id() */
+static char CacheBuildId[64];
+static GLboolean CacheBuildIdDone = GL_FALSE;
+
+_glthread_DECLARE_STATIC_MUTEX(CacheBuildIdMutex);
+
+/** String length used for a NULL string */
+#define NO_STRING 0xffffffff
+
+
+/**
+ * Growable byte buffer that keys and entries are serialized into.
+ */
+struct cache_buffer
+{
+   GLubyte *Data;
+   GLuint Size, Alloc;
+   GLboolean Error;   /**< ran out of memory */
+};
+
+
+/**
+ * Cursor for deserializing an entry.
+ */
+struct cache_reader
+{
+   const GLubyte *Data;
+   GLuint Size, Pos;
+   GLboolean Error;   /**< ran past the end, or out of memory */
+};
+
+
+static void
+put_bytes(struct cache_buffer *buf, const void *data, GLuint n)
+{
+   if (buf->Error || n == 0)
+      return;
+
+   if (buf->Size + n > buf->Alloc) {
+      GLuint alloc = MAX2(2 * buf->Alloc, buf->Size + n);
+      alloc = MAX2(alloc, 1024);
+      buf->Data = (GLubyte *) _mesa_realloc(buf->Data, buf->Size, alloc);
+      if (!buf->Data) {
+         buf->Size = buf->Alloc = 0;
+         buf->Error = GL_TRUE;
+         return;
+      }
+      buf->Alloc = alloc;
+   }
+
+   _mesa_memcpy(buf->Data + buf->Size, data, n);
+   buf->Size += n;
+}
+
+
+static void
+put_uint(struct cache_buffer *buf, GLuint value)
+{
+   put_bytes(buf, &value, sizeof(value));
+}
+
+
+static void
+put_string(struct cache_buffer *buf, const char *s)
+{
+   if (s) {
+      GLuint len = _mesa_strlen(s);
+      put_uint(buf, len);
+      put_bytes(buf, s, len);
+   }
+   else {
+      put_uint(buf, NO_STRING);
+   }
+}
+
+
+static void
+get_bytes(struct cache_reader *rd, void *data, GLuint n)
+{
+   if (rd->Error || n > rd->Size - rd->Pos) {
+      rd->Error = GL_TRUE;
+      _mesa_bzero(data, n);
+      return;
+   }
+   _mesa_memcpy(data, rd->Data + rd->Pos, n);
+   rd->Pos += n;
+}
+
+
+static GLuint
+get_uint(struct cache_reader *rd)
+{
+   GLuint value;
+   get_bytes(rd, &value, sizeof(value));
+   return value;
+}
+
+
+/**
+ * \return  a new string, or NULL if none was stored or on error
+ */
+static char *
+get_string(struct cache_reader *rd)
+{
+   GLuint len = get_uint(rd);
+   char *s;
+
+   if (rd->Error || len == NO_STRING)
+      return NULL;
+
+   if (len > rd->Size - rd->Pos) {
+      rd->Error = GL_TRUE;
+      return NULL;
+   }
+
+   s = (char *) _mesa_malloc(len + 1);
+   if (!s) {
+      rd->Error = GL_TRUE;
+      return NULL;
+   }
+   get_bytes(rd, s, len);
+   s[len] = '\0';
+   return s;
+}
+
+
+#define FNV_INIT 0x811c9dc5
+#define DJB_INIT 5381
+
+
+/** FNV-1a hash, continuing from h */
+static GLuint
+hash_fnv(GLuint h, const GLubyte *data, GLuint n)
+{
+   GLuint i;
+   for (i = 0; i < n; i++) {
+      h ^= data[i];
+      h *= 0x01000193;
+   }
+   return h;
+}
+
+
+/** Bernstein's hash, xor variant, continuing from h */
+static GLuint
+hash_djb(GLuint h, const GLubyte *data, GLuint n)
+{
+   GLuint i;
+   for (i = 0; i < n; i++)
+      h = (h * 33) ^ data[i];
+   return h;
+}
+
+
+#if defined(__linux__)
+
+#include <unistd.h>
+
+
+static unsigned long
+process_id(void)
+{
+   return (unsigned long) getpid();
+}
+
+
+/**
+ * Hash the library (or executable) that this code was loaded from, which
+ * is found in /proc/self/maps.
+ * \return GL_TRUE for success
+ */
+static GLboolean
+hash_library(GLuint *fnv, GLuint *djb)
+{
+   const unsigned long addr = (unsigned long) hash_library;
+   char line[1024], *path = NULL;
+   GLubyte *buf;
+   FILE *f;
+   size_t n;
+
+   f = fopen("/proc/self/maps", "r");
+   if (!f)
+      return GL_FALSE;
+
+   while (fgets(line, sizeof(line), f)) {
+      unsigned long start, end;
+      int pos = 0;
+      if (sscanf(line, "%lx-%lx %*s %*s %*s %*s %n", &start, &end, &pos) == 2 &&
+          addr >= start && addr < end && pos > 0 && line[pos] == '/') {
+         path = line + pos;
+         pos = _mesa_strlen(path) - 1;
+         if (path[pos] == '\n')
+            path[pos] = '\0';
+         break;
+      }
+   }
+   fclose(f);
+
+   if (!path)
+      return GL_FALSE;
+
+   buf = (GLubyte *) _mesa_malloc(65536);
+   f = fopen(path, "rb");
+   if (!buf || !f) {
+      if (buf)
+         _mesa_free(buf);
+      if (f)
+         fclose(f);
+      return GL_FALSE;
+   }
+
+   *fnv = FNV_INIT;
+   *djb = DJB_INIT;
+   while ((n = fread(buf, 1, 65536, f)) > 0) {
+      *fnv = hash_fnv(*fnv, buf, (GLuint) n);
+      *djb = hash_djb(*djb, buf, (GLuint) n);
+   }
+
+   _mesa_free(buf);
+   fclose(f);
+   return GL_TRUE;
+}
+
+#else
+
+static unsigned long
+process_id(void)
+{
+   return 0;
+}
+
+
+static GLboolean
+hash_library(GLuint *fnv, GLuint *djb)
+{
+   (void) fnv;
+   (void) djb;
+   return GL_FALSE;
+}
+
+#endif
+
+
+/**
+ * Identify the running build of Mesa.  The version number isn't enough,
+ * since development builds share it, and a date stamp compiled into this
+ * file misses changes to the rest of the library.
+ * \return  the ID, or NULL if it can't be determined
+ */
+static const char *
+get_build_id(void)
+{
+   _glthread_LOCK_MUTEX(CacheBuildIdMutex);
+   if (!CacheBuildIdDone) {
+      GLuint fnv, djb;
+      if (hash_library(&fnv, &djb))
+         _mesa_sprintf(CacheBuildId, "Mesa " MESA_VERSION_STRING " %08x%08x",
+                       fnv, djb);
+      CacheBuildIdDone = GL_TRUE;
+   }
+   _glthread_UNLOCK_MUTEX(CacheBuildIdMutex);
+
+   return CacheBuildId[0] ? CacheBuildId : NULL;
+}
+
+
+/**
+ * Gather everything the translation result depends on.
+ */
+static void
+build_key(struct cache_buffer *key, const GLcontext *ctx, GLenum type,
+          const GLubyte *source, GLuint len,
+          const void *state, GLuint stateSize)
+{
+   put_uint(key, CACHE_FORMAT_VERSION);
+   put_string(key, get_build_id());
+   put_uint(key, sizeof(struct prog_instruction));
+   put_uint(key, type);
+   put_bytes(key, &ctx->Const, sizeof(ctx->Const));
+   put_uint(key, stateSize);
+   put_bytes(key, state, stateSize);
+   put_uint(key, len);
+   put_bytes(key, source, len);
+}
+
+
+/**
+ * \return  new string with the path of the entry for the key, or NULL
+ */
+static char *
+entry_path(const char *dir, const struct cache_buffer *key,
+           const char *suffix)
+{
+   char *path = (char *) _mesa_malloc(_mesa_strlen(dir) +
+                                      _mesa_strlen(suffix) + 20);
+   if (path) {
+      _mesa_sprintf(path, "%s/%08x%08x%s", dir,
+                    hash_fnv(FNV_INIT, key->Data, key->Size),
+                    hash_djb(DJB_INIT, key->Data, key->Size), suffix);
+   }
+   return path;
+}
+
+
+static void
+put_instruction(struct cache_buffer *buf, const struct prog_instruction *inst)
+{
+   const struct prog_dst_register *dst = &inst->DstReg;
+   GLuint i;
+
+   put_uint(buf, inst->Opcode);
+#if FEATURE_MESA_program_debug
+   put_uint(buf, (GLuint) inst->StringPos);
+#endif
+
+   for (i = 0; i < 3; i++) {
+      const struct prog_src_register *src = inst->SrcReg + i;
+      put_uint(buf, src->File);
+      put_uint(buf, (GLuint) src->Index);
+      put_uint(buf, src->Swizzle);
+      put_uint(buf, src->RelAddr);
+      put_uint(buf, src->NegateBase);
+      put_uint(buf, src->Abs);
+      put_uint(buf, src->NegateAbs);
+   }
+
+   put_uint(buf, dst->File);
+   put_uint(buf, dst->Index);
+   put_uint(buf, dst->WriteMask);
+   put_uint(buf, dst->CondMask);
+   put_uint(buf, dst->CondSwizzle);
+   put_uint(buf, dst->CondSrc);
+
+   put_uint(buf, inst->CondUpdate);
+   put_uint(buf, inst->CondDst);
+   put_uint(buf, inst->SaturateMode);
+   put_uint(buf, inst->Precision);
+   put_uint(buf, inst->TexSrcUnit);
+   put_uint(buf, inst->TexSrcTarget);
+   put_uint(buf, (GLuint) inst->BranchTarget);
+   put_uint(buf, (GLuint) inst->Sampler);
+
+   put_string(buf, inst->Comment);
+   /* only PRINT has Data, and it's a string */
+   put_string(buf, (const char *) inst->Data);
+}
+
+
+static void
+get_instruction(struct cache_reader *rd, struct prog_instruction *inst)
+{
+   struct prog_dst_register *dst = &inst->DstReg;
+   GLuint i;
+
+   inst->Opcode = (gl_inst_opcode) get_uint(rd);
+#if FEATURE_MESA_program_debug
+   inst->StringPos = (GLshort) get_uint(rd);
+#endif
+
+   for (i = 0; i < 3; i++) {
+      struct prog_src_register *src = inst->SrcReg + i;
+      src->File = get_uint(rd);
+      src->Index = (GLint) get_uint(rd);
+      src->Swizzle = get_uint(rd);
+      src->RelAddr = get_uint(rd);
+      src->NegateBase = get_uint(rd);
+      src->Abs = get_uint(rd);
+      src->NegateAbs = get_uint(rd);
+   }
+
+   dst->File = get_uint(rd);
+   dst->Index = get_uint(rd);
+   dst->WriteMask = get_uint(rd);
+   dst->CondMask = get_uint(rd);
+   dst->CondSwizzle = get_uint(rd);
+   dst->CondSrc = get_uint(rd);
+
+   inst->CondUpdate = get_uint(rd);
+   inst->CondDst = get_uint(rd);
+   inst->SaturateMode = get_uint(rd);
+   inst->Precision = get_uint(rd);
+   inst->TexSrcUnit = get_uint(rd);
+   inst->TexSrcTarget = get_uint(rd);
+   inst->BranchTarget = (GLint) get_uint(rd);
+   inst->Sampler = (GLint) get_uint(rd);
+
+   inst->Comment = get_string(rd);
+   inst->Data = get_string(rd);
+}
+
+
+static void
+free_instructions(struct prog_instruction *inst, GLuint count)
+{
+   GLuint i;
+   for (i = 0; i < count; i++) {
+      if (inst[i].Data)
+         _mesa_free(inst[i].Data);
+      if (inst[i].Comment)
+         _mesa_free((char *) inst[i].Comment);
+   }
+   _mesa_free(inst);
+}
+
+
+static void
+put_parameter_list(struct cache_buffer *buf,
+                   const struct gl_program_parameter_list *list)
+{
+   GLuint i, j;
+
+   put_uint(buf, list != NULL);
+   if (!list)
+      return;
+
+   put_uint(buf, list->NumParameters);
+   put_uint(buf, list->StateFlags);
+   for (i = 0; i < list->NumParameters; i++) {
+      const struct gl_program_parameter *p = list->Parameters + i;
+      put_string(buf, p->Name);
+      put_uint(buf, p->Type);
+      put_uint(buf, p->DataType);
+      put_uint(buf, p->Size);
+      for (j = 0; j < STATE_LENGTH; j++)
+         put_uint(buf, p->StateIndexes[j]);
+      put_bytes(buf, list->ParameterValues[i], 4 * sizeof(GLfloat));
+   }
+}
+
+
+/**
+ * Read back a list written by put_parameter_list(), exactly as it was
+ * (not through _mesa_add_parameter(), which would merge and pad entries).
+ * \return  the list, or NULL if none was stored or on error
+ */
+static struct gl_program_parameter_list *
+get_parameter_list(struct cache_reader *rd)
+{
+   struct gl_program_parameter_list *list;
+   GLuint i, j, n;
+
+   if (!get_uint(rd))
+      return NULL;
+
+   n = get_uint(rd);
+   if (rd->Error || n > rd->Size - rd->Pos) {
+      rd->Error = GL_TRUE;
+      return NULL;
+   }
+
+   list = _mesa_new_parameter_list();
+   if (!list) {
+      rd->Error = GL_TRUE;
+      return NULL;
+   }
+   list->StateFlags = get_uint(rd);
+
+   if (n > 0) {
+      list->Parameters = (struct gl_program_parameter *)
+         _mesa_calloc(n * sizeof(struct gl_program_parameter));
+      list->ParameterValues = (GLfloat (*)[4])
+         _mesa_align_malloc(n * 4 * sizeof(GLfloat), 16);
+      if (!list->Parameters || !list->ParameterValues)
+         rd->Error = GL_TRUE;
+      else
+         list->Size = n;
+   }
+
+   for (i = 0; i < list->Size && !rd->Error; i++) {
+      struct gl_program_parameter *p = list->Parameters + i;
+      p->Name = get_string(rd);
+      list->NumParameters = i + 1;
+      p->Type = (enum register_file) get_uint(rd);
+      p->DataType = get_uint(rd);
+      p->Size = get_uint(rd);
+      for (j = 0; j < STATE_LENGTH; j++)
+         p->StateIndexes[j] = (gl_state_index) get_uint(rd);
+      get_bytes(rd, list->ParameterValues[i], 4 * sizeof(GLfloat));
+   }
+
+   if (rd->Error) {
+      _mesa_free_parameter_list(list);
+      return NULL;
+   }
+   return list;
+}
+
+
+/**
+ * Serialize everything that the GLSL compiler or the ARB program parser
+ * sets in a program.
+ * \return GL_FALSE if the program can't be cached
+ */
+static GLboolean
+put_program(struct cache_buffer *buf, const struct gl_program *prog)
+{
+   GLuint i;
+
+   put_uint(buf, prog->Target);
+   put_uint(buf, prog->InputsRead);
+   put_uint(buf, prog->OutputsWritten);
+   for (i = 0; i < MAX_TEXTURE_IMAGE_UNITS; i++)
+      put_uint(buf, prog->TexturesUsed[i]);
+   put_uint(buf, prog->ShadowSamplers);
+
+   put_uint(buf, prog->NumInstructions);
+   put_uint(buf, prog->NumTemporaries);
+   put_uint(buf, prog->NumParameters);
+   put_uint(buf, prog->NumAttributes);
+   put_uint(buf, prog->NumAddressRegs);
+   put_uint(buf, prog->NumAluInstructions);
+   put_uint(buf, prog->NumTexInstructions);
+   put_uint(buf, prog->NumTexIndirections);
+   put_uint(buf, prog->NumNativeInstructions);
+   put_uint(buf, prog->NumNativeTemporaries);
+   put_uint(buf, prog->NumNativeParameters);
+   put_uint(buf, prog->NumNativeAttributes);
+   put_uint(buf, prog->NumNativeAddressRegs);
+   put_uint(buf, prog->NumNativeAluInstructions);
+   put_uint(buf, prog->NumNativeTexInstructions);
+   put_uint(buf, prog->NumNativeTexIndirections);
+
+   switch (prog->Target) {
+   case GL_VERTEX_PROGRAM_ARB:
+      {
+         const struct gl_vertex_program *vp
+            = (const struct gl_vertex_program *) prog;
+         put_uint(buf, vp->IsPositionInvariant);
+      }
+      break;
+   case GL_FRAGMENT_PROGRAM_ARB:
+      {
+         const struct gl_fragment_program *fp
+            = (const struct gl_fragment_program *) prog;
+         put_uint(buf, fp->FogOption);
+         put_uint(buf, fp->UsesKill);
+      }
+      break;
+   default:
+      return GL_FALSE;
+   }
+
+   for (i = 0; i < prog->NumInstructions; i++) {
+      const struct prog_instruction *inst = prog->Instructions + i;
+      if (inst->Data && inst->Opcode != OPCODE_PRINT)
+         return GL_FALSE;
+      put_instruction(buf, inst);
+   }
+
+   put_parameter_list(buf, prog->Parameters);
+   put_parameter_list(buf, prog->Varying);
+   put_parameter_list(buf, prog->Attributes);
+
+   return !buf->Error;
+}
+
+
+/**
+ * Deserialize a program written by put_program() into 'prog'.  On error,
+ * 'prog' is left unchanged.
+ */
+static GLboolean
+get_program(struct cache_reader *rd, struct gl_program *prog)
+{
+   struct gl_program base;
+   GLboolean posInvariant = GL_FALSE, usesKill = GL_FALSE;
+   GLenum fogOption = GL_NONE;
+   GLuint i;
+
+   if (get_uint(rd) != prog->Target)
+      return GL_FALSE;
+
+   _mesa_bzero(&base, sizeof(base));
+
+   base.InputsRead = get_uint(rd);
+   base.OutputsWritten = get_uint(rd);
+   for (i = 0; i < MAX_TEXTURE_IMAGE_UNITS; i++)
+      base.TexturesUsed[i] = get_uint(rd);
+   base.ShadowSamplers = get_uint(rd);
+
+   base.NumInstructions = get_uint(rd);
+   base.NumTemporaries = get_uint(rd);
+   base.NumParameters = get_uint(rd);
+   base.NumAttributes = get_uint(rd);
+   base.NumAddressRegs = get_uint(rd);
+   base.NumAluInstructions = get_uint(rd);
+   base.NumTexInstructions = get_uint(rd);
+   base.NumTexIndirections = get_uint(rd);
+   base.NumNativeInstructions = get_uint(rd);
+   base.NumNativeTemporaries = get_uint(rd);
+   base.NumNativeParameters = get_uint(rd);
+   base.NumNativeAttributes = get_uint(rd);
+   base.NumNativeAddressRegs = get_uint(rd);
+   base.NumNativeAluInstructions = get_uint(rd);
+   base.NumNativeTexInstructions = get_uint(rd);
+   base.NumNativeTexIndirections = get_uint(rd);
+
+   if (prog->Target == GL_VERTEX_PROGRAM_ARB) {
+      posInvariant = (GLboolean) get_uint(rd);
+   }
+   else {
+      fogOption = get_uint(rd);
+      usesKill = (GLboolean) get_uint(rd);
+   }
+
+   if (rd->Error || base.NumInstructions > rd->Size - rd->Pos)
+      return GL_FALSE;
+
+   base.Instructions = _mesa_alloc_instructions(base.NumInstructions);
+   if (!base.Instructions)
+      return GL_FALSE;
+   for (i = 0; i < base.NumInstructions; i++)
+      get_instruction(rd, base.Instructions + i);
+
+   base.Parameters = get_parameter_list(rd);
+   base.Varying = get_parameter_list(rd);
+   base.Attributes = get_parameter_list(rd);
+
+   if (rd->Error) {
+      free_instructions(base.Instructions, base.NumInstructions);
+      if (base.Parameters)
+         _mesa_free_parameter_list(base.Parameters);
+      if (base.Varying)
+         _mesa_free_parameter_list(base.Varying);
+      if (base.Attributes)
+         _mesa_free_parameter_list(base.Attributes);
+      return GL_FALSE;
+   }
+
+   /* success, replace the program's contents */
+   if (prog->Instructions)
+      free_instructions(prog->Instructions, prog->NumInstructions);
+   if (prog->Parameters)
+      _mesa_free_parameter_list(prog->Parameters);
+   if (prog->Varying)
+      _mesa_free_parameter_list(prog->Varying);
+   if (prog->Attributes)
+      _mesa_free_parameter_list(prog->Attributes);
+
+   prog->Instructions = base.Instructions;
+   prog->Parameters = base.Parameters;
+   prog->Varying = base.Varying;
+   prog->Attributes = base.Attributes;
+
+   prog->InputsRead = base.InputsRead;
+   prog->OutputsWritten = base.OutputsWritten;
+   _mesa_memcpy(prog->TexturesUsed, base.TexturesUsed,
+                sizeof(prog->TexturesUsed));
+   prog->ShadowSamplers = base.ShadowSamplers;
+
+   prog->NumInstructions = base.NumInstructions;
+   prog->NumTemporaries = base.NumTemporaries;
+   prog->NumParameters = base.NumParameters;
+   prog->NumAttributes = base.NumAttributes;
+   prog->NumAddressRegs = base.NumAddressRegs;
+   prog->NumAluInstructions = base.NumAluInstructions;
+   prog->NumTexInstructions = base.NumTexInstructions;
+   prog->NumTexIndirections = base.NumTexIndirections;
+   prog->NumNativeInstructions = base.NumNativeInstructions;
+   prog->NumNativeTemporaries = base.NumNativeTemporaries;
+   prog->NumNativeParameters = base.NumNativeParameters;
+   prog->NumNativeAttributes = base.NumNativeAttributes;
+   prog->NumNativeAddressRegs = base.NumNativeAddressRegs;
+   prog->NumNativeAluInstructions = base.NumNativeAluInstructions;
+   prog->NumNativeTexInstructions = base.NumNativeTexInstructions;
+   prog->NumNativeTexIndirections = base.NumNativeTexIndirections;
+
+   if (prog->Target == GL_VERTEX_PROGRAM_ARB) {
+      struct gl_vertex_program *vp = (struct gl_vertex_program *) prog;
+      vp->IsPositionInvariant = posInvariant;
+   }
+   else {
+      struct gl_fragment_program *fp = (struct gl_fragment_program *) prog;
+      fp->FogOption = fogOption;
+      fp->UsesKill = usesKill;
+   }
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Read the entry at 'path' and check that it was stored under 'key'.
+ * \return  the entry's payload (to be freed by the caller), or NULL
+ */
+static GLubyte *
+read_entry(const char *path, const struct cache_buffer *key,
+           GLuint *payloadSize)
+{
+   GLuint header[3];  /* key size, payload size, payload checksum */
+   GLubyte *storedKey, *payload = NULL;
+   long fileSize;
+   FILE *f;
+
+   f = fopen(path, "rb");
+   if (!f)
+      return NULL;
+
+   /* the payload size must account for the rest of the file, so that a
+    * corrupt header can't make us allocate more than that
+    */
+   if (fseek(f, 0, SEEK_END) != 0 ||
+       (fileSize = ftell(f)) < (long) (sizeof(header) + key->Size) ||
+       fseek(f, 0, SEEK_SET) != 0 ||
+       fread(header, sizeof(header), 1, f) != 1 ||
+       header[0] != key->Size ||
+       header[1] != (unsigned long) fileSize - sizeof(header) - key->Size) {
+      fclose(f);
+      return NULL;
+   }
+
+   storedKey = (GLubyte *) _mesa_malloc(key->Size);
+   if (storedKey &&
+       fread(storedKey, 1, key->Size, f) == key->Size &&
+       _mesa_memcmp(storedKey, key->Data, key->Size) == 0) {
+      payload = (GLubyte *) _mesa_malloc(header[1]);
+      if (payload &&
+          (fread(payload, 1, header[1], f) != header[1] ||
+           hash_djb(DJB_INIT, payload, header[1]) != header[2])) {
+         _mesa_free(payload);
+         payload = NULL;
+      }
+   }
+
+   if (storedKey)
+      _mesa_free(storedKey);
+   fclose(f);
+
+   *payloadSize = header[1];
+   return payload;
+}
+
+
+/**
+ * Write an entry to a temporary file and rename it into place, so that
+ * readers never see a partial entry.  The temporary file's name includes
+ * the process and thread, since others may be writing the same entry.
+ * Errors are ignored, the entry just won't be there next time.
+ */
+static void
+write_entry(const char *dir, const struct cache_buffer *key,
+            const struct cache_buffer *payload)
+{
+   char suffix[48], *path, *tmpPath;
+   GLuint header[3];
+   FILE *f;
+
+   _mesa_sprintf(suffix, ".%lu.%lu.tmp", process_id(),
+                 (unsigned long) _glthread_GetID());
+   path = entry_path(dir, key, "");
+   tmpPath = entry_path(dir, key, suffix);
+
+   if (path && tmpPath) {
+      f = fopen(tmpPath, "wb");
+      if (f) {
+         GLboolean ok;
+
+         header[0] = key->Size;
+         header[1] = payload->Size;
+         header[2] = hash_djb(DJB_INIT, payload->Data, payload->Size);
+
+         ok = fwrite(header, sizeof(header), 1, f) == 1 &&
+              fwrite(key->Data, 1, key->Size, f) == key->Size &&
+              fwrite(payload->Data, 1, payload->Size, f) == payload->Size;
+         ok = (fclose(f) == 0) && ok;
+
+         if (!ok || rename(tmpPath, path) != 0)
+            remove(tmpPath);
+      }
+   }
+
+   if (path)
+      _mesa_free(path);
+   if (tmpPath)
+      _mesa_free(tmpPath);
+}
+
+
+/**
+ * Look for a cached translation of a program.
+ *
+ * \param type  GL_VERTEX/FRAGMENT_SHADER for GLSL or
+ *              GL_VERTEX/FRAGMENT_PROGRAM_ARB for ARB programs
+ * \param source  the source text
+ * \param state  any state besides ctx->Const that the result depends on
+ * \param prog  the program to fill in
+ * \param infoLog  returns the compiler's log, if not NULL
+ * \return GL_TRUE if found, and 'prog' was filled in
+ */
+GLboolean
+_mesa_load_cached_program(GLcontext *ctx, GLenum type,
+                          const GLubyte *source, GLuint len,
+                          const void *state, GLuint stateSize,
+                          struct gl_program *prog, GLchar **infoLog)
+{
+   const char *dir = _mesa_getenv("MESA_SHADER_CACHE_DIR");
+   struct cache_buffer key;
+   struct cache_reader rd;
+   GLubyte *payload = NULL;
+   GLboolean found = GL_FALSE;
+
+   if (!dir || !dir[0] || !get_build_id())
+      return GL_FALSE;
+
+   _mesa_bzero(&key, sizeof(key));
+   build_key(&key, ctx, type, source, len, state, stateSize);
+
+   if (!key.Error) {
+      char *path = entry_path(dir, &key, "");
+      if (path) {
+         payload = read_entry(path, &key, &rd.Size);
+         _mesa_free(path);
+      }
+   }
+
+   if (payload) {
+      rd.Data = payload;
+      rd.Pos = 0;
+      rd.Error = GL_FALSE;
+      found = get_program(&rd, prog);
+      if (found && infoLog)
+         *infoLog = get_string(&rd);
+      _mesa_free(payload);
+   }
+
+   if (key.Data)
+      _mesa_free(key.Data);
+
+   return found;
+}
+
+
+/**
+ * Add a successfully translated program to the cache.
+ * The parameters are the same as for _mesa_load_cached_program().
+ */
+void
+_mesa_store_cached_program(GLcontext *ctx, GLenum type,
+                           const GLubyte *source, GLuint len,
+                           const void *state, GLuint stateSize,
+                           const struct gl_program *prog,
+                           const GLchar *infoLog)
+{
+   const char *dir = _mesa_getenv("MESA_SHADER_CACHE_DIR");
+   struct cache_buffer key, payload;
+
+   if (!dir || !dir[0] || !get_build_id())
+      return;
+
+   _mesa_bzero(&key, sizeof(key));
+   _mesa_bzero(&payload, sizeof(payload));
+
+   build_key(&key, ctx, type, source, len, state, stateSize);
+   if (put_program(&payload, prog)) {
+      put_string(&payload, infoLog);
+      if (!key.Error && !payload.Error)
+         write_entry(dir, &key, &payload);
+   }
+
+   if (key.Data)
+      _mesa_free(key.Data);
+   if (payload.Data)
+      _mesa_free(payload.Data);
+}
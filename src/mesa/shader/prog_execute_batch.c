@@ -0,0 +1,594 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  7.1
+ *
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file prog_execute_batch.c
+ * Interpret a vertex program on a batch of vertices at once.
+ *
+ * Each instruction is decoded once and then applied to all the vertices
+ * of the batch.  Registers are laid out so that one channel of a
+ * register is contiguous for the whole batch, which leaves simple loops
+ * over the vertices for the compiler to vectorize.  This saves the
+ * per-vertex instruction decode, swizzling and register lookup of
+ * prog_execute.c, and gives the same results.
+ *
+ * Only straight-line ARB vertex programs without condition codes or
+ * texture fetches are handled, see _mesa_can_execute_program_batch().
+ * This covers the fixed-function programs from t_vp_build.c and most
+ * application programs; the rest go to the regular interpreter.
+ */
+
+
+#include "main/glheader.h"
+#include "main/context.h"
+#include "main/imports.h"
+#include "main/macros.h"
+#include "prog_instruction.h"
+#include "prog_parameter.h"
+#include "prog_execute.h"
+#include "prog_execute_batch.h"
+
+
+static const GLfloat ZeroVec[4] = { 0.0F, 0.0F, 0.0F, 0.0F };
+
+
+/**
+ * Can _mesa_execute_program_batch() run this program?
+ */
+GLboolean
+_mesa_can_execute_program_batch(const struct gl_program *prog)
+{
+   GLuint pc, i;
+
+   if (prog->Target != GL_VERTEX_PROGRAM_ARB ||
+       ((const struct gl_vertex_program *) prog)->IsNVProgram)
+      return GL_FALSE;
+
+   for (pc = 0; pc < prog->NumInstructions; pc++) {
+      const struct prog_instruction *inst = prog->Instructions + pc;
+
+      switch (inst->Opcode) {
+      case OPCODE_END:
+         return GL_TRUE;
+      case OPCODE_NOP:
+         continue;
+      case OPCODE_ARL:
+         break;
+      case OPCODE_ABS: case OPCODE_ADD: case OPCODE_CMP: case OPCODE_COS:
+      case OPCODE_DP3: case OPCODE_DP4: case OPCODE_DPH: case OPCODE_DST:
+      case OPCODE_EX2: case OPCODE_FLR: case OPCODE_FRC: case OPCODE_LG2:
+      case OPCODE_LIT: case OPCODE_LRP: case OPCODE_MAD: case OPCODE_MAX:
+      case OPCODE_MIN: case OPCODE_MOV: case OPCODE_MUL: case OPCODE_POW:
+      case OPCODE_RCP: case OPCODE_RSQ: case OPCODE_SEQ: case OPCODE_SFL:
+      case OPCODE_SGE: case OPCODE_SGT: case OPCODE_SIN: case OPCODE_SLE:
+      case OPCODE_SLT: case OPCODE_SNE: case OPCODE_STR: case OPCODE_SUB:
+      case OPCODE_SWZ: case OPCODE_XPD:
+         if (inst->CondUpdate || inst->DstReg.CondMask != COND_TR)
+            return GL_FALSE;
+         if (inst->DstReg.File == PROGRAM_TEMPORARY) {
+            if (inst->DstReg.Index >= MAX_PROGRAM_TEMPS)
+               return GL_FALSE;
+         }
+         else if (inst->DstReg.File == PROGRAM_OUTPUT) {
+            if (inst->DstReg.Index >= MAX_PROGRAM_OUTPUTS)
+               return GL_FALSE;
+         }
+         else if (inst->DstReg.File != PROGRAM_WRITE_ONLY) {
+            return GL_FALSE;
+         }
+         break;
+      default:
+         return GL_FALSE;
+      }
+
+      for (i = 0; i < _mesa_num_inst_src_regs(inst->Opcode); i++) {
+         const struct prog_src_register *src = &inst->SrcReg[i];
+
+         switch (src->File) {
+         case PROGRAM_TEMPORARY:
+            if (src->RelAddr || src->Index >= MAX_PROGRAM_TEMPS)
+               return GL_FALSE;
+            break;
+         case PROGRAM_INPUT:
+            if (src->RelAddr || src->Index >= VERT_ATTRIB_MAX)
+               return GL_FALSE;
+            break;
+         case PROGRAM_OUTPUT:
+            if (src->RelAddr || src->Index >= MAX_PROGRAM_OUTPUTS)
+               return GL_FALSE;
+            break;
+         case PROGRAM_LOCAL_PARAM:
+         case PROGRAM_ENV_PARAM:
+         case PROGRAM_STATE_VAR:
+            break;
+         case PROGRAM_CONSTANT:
+         case PROGRAM_UNIFORM:
+         case PROGRAM_NAMED_PARAM:
+            if (src->RelAddr)
+               return GL_FALSE;
+            break;
+         default:
+            return GL_FALSE;
+         }
+      }
+   }
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Return the parameter which a source register refers to, as
+ * get_register_pointer() in prog_execute.c does.
+ * \param index  register index, including any address register offset
+ */
+static INLINE const GLfloat *
+param_pointer(const struct prog_batch_machine *m,
+              const struct prog_src_register *src, GLint index)
+{
+   if (src->RelAddr) {
+      if (src->File == PROGRAM_ENV_PARAM) {
+         if (index < 0 || index >= MAX_PROGRAM_ENV_PARAMS)
+            return ZeroVec;
+         return m->EnvParams[index];
+      }
+      else {
+         if (index < 0 || index >= (GLint) m->NumParams)
+            return ZeroVec;
+         return m->Params[index];
+      }
+   }
+
+   switch (src->File) {
+   case PROGRAM_LOCAL_PARAM:
+      return m->LocalParams[index];
+   case PROGRAM_ENV_PARAM:
+      return m->EnvParams[index];
+   default:
+      return m->Params[index];
+   }
+}
+
+
+/**
+ * Return channel 'chan' of source operand 'i' for the whole batch, with
+ * swizzling and negation applied as fetch_vector4() does.  This points
+ * straight at the register if no modifiers need applying, else at
+ * Scratch[i].
+ */
+static const GLfloat *
+fetch_channel(struct prog_batch_machine *m,
+              const struct prog_instruction *inst, GLuint i, GLuint chan)
+{
+   const struct prog_src_register *src = &inst->SrcReg[i];
+   const GLuint swz = GET_SWZ(src->Swizzle, chan);
+   const GLuint n = m->Count;
+   GLfloat *tmp = m->Scratch[i][chan];
+   const GLfloat *reg;
+   GLboolean negate, absolute, negateAbs;
+   GLuint l;
+
+   if (inst->Opcode == OPCODE_SWZ) {
+      /* per-component negation, no absolute value */
+      negate = (src->NegateBase >> chan) & 1;
+      absolute = negateAbs = GL_FALSE;
+
+      if (swz == SWIZZLE_ZERO || swz == SWIZZLE_ONE) {
+         GLfloat value = (swz == SWIZZLE_ONE) ? 1.0F : 0.0F;
+         if (negate)
+            value = -value;
+         for (l = 0; l < n; l++)
+            tmp[l] = value;
+         return tmp;
+      }
+   }
+   else {
+      negate = src->NegateBase != 0;
+      absolute = src->Abs;
+      negateAbs = src->NegateAbs;
+   }
+
+   switch (src->File) {
+   case PROGRAM_TEMPORARY:
+      reg = m->Temporaries[src->Index][swz];
+      break;
+   case PROGRAM_INPUT:
+      reg = m->Inputs[src->Index][swz];
+      break;
+   case PROGRAM_OUTPUT:
+      reg = m->Outputs[src->Index][swz];
+      break;
+   default:
+      if (src->RelAddr) {
+         for (l = 0; l < n; l++)
+            tmp[l] = param_pointer(m, src,
+                                   src->Index + m->AddressReg[l])[swz];
+      }
+      else {
+         const GLfloat value = param_pointer(m, src, src->Index)[swz];
+         for (l = 0; l < n; l++)
+            tmp[l] = value;
+      }
+      reg = tmp;
+      break;
+   }
+
+   if (!negate && !absolute && !negateAbs)
+      return reg;
+
+   for (l = 0; l < n; l++) {
+      GLfloat value = reg[l];
+      if (negate)
+         value = -value;
+      if (absolute)
+         value = FABSF(value);
+      if (negateAbs)
+         value = -value;
+      tmp[l] = value;
+   }
+   return tmp;
+}
+
+
+/**
+ * Fetch the channels of source operand 'i' selected by 'mask'.
+ */
+static INLINE void
+fetch(struct prog_batch_machine *m, const struct prog_instruction *inst,
+      GLuint i, GLuint mask, const GLfloat *channels[4])
+{
+   GLuint chan;
+
+   for (chan = 0; chan < 4; chan++) {
+      if (mask & (1 << chan))
+         channels[chan] = fetch_channel(m, inst, i, chan);
+   }
+}
+
+
+/**
+ * Store the instruction's result from Scratch[3], or from its first
+ * channel for all written channels if 'scalar' is set.
+ */
+static void
+store_result(struct prog_batch_machine *m,
+             const struct prog_instruction *inst, GLboolean scalar)
+{
+   const struct prog_dst_register *dst = &inst->DstReg;
+   const GLuint n = m->Count;
+   GLfloat (*reg)[PROG_BATCH_SIZE];
+   GLuint chan, l;
+
+   if (dst->File == PROGRAM_OUTPUT)
+      reg = m->Outputs[dst->Index];
+   else if (dst->File == PROGRAM_TEMPORARY)
+      reg = m->Temporaries[dst->Index];
+   else
+      return;  /* PROGRAM_WRITE_ONLY */
+
+   for (chan = 0; chan < 4; chan++) {
+      const GLfloat *value = m->Scratch[3][scalar ? 0 : chan];
+
+      if (!(dst->WriteMask & (1 << chan)))
+         continue;
+
+      if (inst->SaturateMode == SATURATE_ZERO_ONE) {
+         for (l = 0; l < n; l++)
+            reg[chan][l] = CLAMP(value[l], 0.0F, 1.0F);
+      }
+      else {
+         for (l = 0; l < n; l++)
+            reg[chan][l] = value[l];
+      }
+   }
+}
+
+
+/**
+ * Compute each written channel of a component-wise instruction.  EXPR
+ * may use 'chan' and 'l' to index the operands.
+ */
+#define COMPONENTWISE(EXPR)                             \
+   do {                                                 \
+      GLuint chan;                                      \
+      for (chan = 0; chan < 4; chan++) {                \
+         if (mask & (1 << chan)) {                      \
+            for (l = 0; l < n; l++)                     \
+               r[chan][l] = (EXPR);                     \
+         }                                              \
+      }                                                 \
+      store_result(m, inst, GL_FALSE);                  \
+   } while (0)
+
+/**
+ * Compute a single result which is replicated to all written channels.
+ */
+#define SCALAR(EXPR)                                    \
+   do {                                                 \
+      for (l = 0; l < n; l++)                           \
+         r[0][l] = (EXPR);                              \
+      store_result(m, inst, GL_TRUE);                   \
+   } while (0)
+
+
+/**
+ * Run the program on the m->Count vertices in the machine's Inputs.
+ */
+void
+_mesa_execute_program_batch(const struct gl_program *prog,
+                            struct prog_batch_machine *m)
+{
+   const GLuint n = m->Count;
+   GLfloat (*r)[PROG_BATCH_SIZE] = m->Scratch[3];
+   GLuint pc, l;
+
+   ASSERT(n <= PROG_BATCH_SIZE);
+
+   for (pc = 0; pc < prog->NumInstructions; pc++) {
+      const struct prog_instruction *inst = prog->Instructions + pc;
+      const GLuint mask = inst->DstReg.WriteMask;
+      const GLfloat *a[4], *b[4], *c[4];
+
+      switch (inst->Opcode) {
+      case OPCODE_END:
+         return;
+      case OPCODE_NOP:
+         break;
+      case OPCODE_ABS:
+         fetch(m, inst, 0, mask, a);
+         COMPONENTWISE(FABSF(a[chan][l]));
+         break;
+      case OPCODE_ADD:
+         fetch(m, inst, 0, mask, a);
+         fetch(m, inst, 1, mask, b);
+         COMPONENTWISE(a[chan][l] + b[chan][l]);
+         break;
+      case OPCODE_ARL:
+         fetch(m, inst, 0, WRITEMASK_X, a);
+         for (l = 0; l < n; l++)
+            m->AddressReg[l] = (GLint) FLOORF(a[0][l]);
+         break;
+      case OPCODE_CMP:
+         fetch(m, inst, 0, mask, a);
+         fetch(m, inst, 1, mask, b);
+         fetch(m, inst, 2, mask, c);
+         COMPONENTWISE(a[chan][l] < 0.0F ? b[chan][l] : c[chan][l]);
+         break;
+      case OPCODE_COS:
+         fetch(m, inst, 0, WRITEMASK_X, a);
+         SCALAR((GLfloat) _mesa_cos(a[0][l]));
+         break;
+      case OPCODE_DP3:
+         fetch(m, inst, 0, WRITEMASK_XYZ, a);
+         fetch(m, inst, 1, WRITEMASK_XYZ, b);
+         SCALAR(a[0][l] * b[0][l] + a[1][l] * b[1][l] + a[2][l] * b[2][l]);
+         break;
+      case OPCODE_DP4:
+         fetch(m, inst, 0, WRITEMASK_XYZW, a);
+         fetch(m, inst, 1, WRITEMASK_XYZW, b);
+         SCALAR(a[0][l] * b[0][l] + a[1][l] * b[1][l] +
+                a[2][l] * b[2][l] + a[3][l] * b[3][l]);
+         break;
+      case OPCODE_DPH:
+         fetch(m, inst, 0, WRITEMASK_XYZ, a);
+         fetch(m, inst, 1, WRITEMASK_XYZW, b);
+         SCALAR(a[0][l] * b[0][l] + a[1][l] * b[1][l] +
+                a[2][l] * b[2][l] + b[3][l]);
+         break;
+      case OPCODE_DST:
+         fetch(m, inst, 0, WRITEMASK_YZ, a);
+         fetch(m, inst, 1, WRITEMASK_YW, b);
+         for (l = 0; l < n; l++) {
+            r[0][l] = 1.0F;
+            r[1][l] = a[1][l] * b[1][l];
+            r[2][l] = a[2][l];
+            r[3][l] = b[3][l];
+         }
+         store_result(m, inst, GL_FALSE);
+         break;
+      case OPCODE_EX2:
+         fetch(m, inst, 0, WRITEMASK_X, a);
+         SCALAR((GLfloat) _mesa_pow(2.0, a[0][l]));
+         break;
+      case OPCODE_FLR:
+         fetch(m, inst, 0, mask, a);
+         COMPONENTWISE(FLOORF(a[chan][l]));
+         break;
+      case OPCODE_FRC:
+         fetch(m, inst, 0, mask, a);
+         COMPONENTWISE(a[chan][l] - FLOORF(a[chan][l]));
+         break;
+      case OPCODE_LG2:
+         fetch(m, inst, 0, WRITEMASK_X, a);
+         SCALAR(LOG2(a[0][l]));
+         break;
+      case OPCODE_LIT:
+         fetch(m, inst, 0, WRITEMASK_XYW, a);
+         for (l = 0; l < n; l++) {
+            const GLfloat epsilon = 1.0F / 256.0F;      /* from NV VP spec */
+            const GLfloat x = MAX2(a[0][l], 0.0F);
+            const GLfloat y = MAX2(a[1][l], 0.0F);
+            const GLfloat w = CLAMP(a[3][l], -(128.0F - epsilon),
+                                    (128.0F - epsilon));
+            r[0][l] = 1.0F;
+            r[1][l] = x;
+            if (x > 0.0F) {
+               if (y == 0.0 && w == 0.0)
+                  r[2][l] = 1.0;
+               else
+                  r[2][l] = EXPF(w * LOGF(y));
+            }
+            else {
+               r[2][l] = 0.0;
+            }
+            r[3][l] = 1.0F;
+         }
+         store_result(m, inst, GL_FALSE);
+         break;
+      case OPCODE_LRP:
+         fetch(m, inst, 0, mask, a);
+         fetch(m, inst, 1, mask, b);
+         fetch(m, inst, 2, mask, c);
+         COMPONENTWISE(a[chan][l] * b[chan][l] +
+                       (1.0F - a[chan][l]) * c[chan][l]);
+         break;
+      case OPCODE_MAD:
+         fetch(m, inst, 0, mask, a);
+         fetch(m, inst, 1, mask, b);
+         fetch(m, inst, 2, mask, c);
+         COMPONENTWISE(a[chan][l] * b[chan][l] + c[chan][l]);
+         break;
+      case OPCODE_MAX:
+         fetch(m, inst, 0, mask, a);
+         fetch(m, inst, 1, mask, b);
+         COMPONENTWISE(MAX2(a[chan][l], b[chan][l]));
+         break;
+      case OPCODE_MIN:
+         fetch(m, inst, 0, mask, a);
+         fetch(m, inst, 1, mask, b);
+         COMPONENTWISE(MIN2(a[chan][l], b[chan][l]));
+         break;
+      case OPCODE_MOV:
+      case OPCODE_SWZ:
+         fetch(m, inst, 0, mask, a);
+         COMPONENTWISE(a[chan][l]);
+         break;
+      case OPCODE_MUL:
+         fetch(m, inst, 0, mask, a);
+         fetch(m, inst, 1, mask, b);
+         COMPONENTWISE(a[chan][l] * b[chan][l]);
+         break;
+      case OPCODE_POW:
+         fetch(m, inst, 0, WRITEMASK_X, a);
+         fetch(m, inst, 1, WRITEMASK_X, b);
+         SCALAR((GLfloat) _mesa_pow(a[0][l], b[0][l]));
+         break;
+      case OPCODE_RCP:
+         fetch(m, inst, 0, WRITEMASK_X, a);
+         SCALAR(1.0F / a[0][l]);
+         break;
+      case OPCODE_RSQ:
+         fetch(m, inst, 0, WRITEMASK_X, a);
+         SCALAR(INV_SQRTF(FABSF(a[0][l])));
+         break;
+      case OPCODE_SEQ:
+         fetch(m, inst, 0, mask, a);
+         fetch(m, inst, 1, mask, b);
+         COMPONENTWISE((a[chan][l] == b[chan][l]) ? 1.0F : 0.0F);
+         break;
+      case OPCODE_SFL:
+         COMPONENTWISE(0.0F);
+         break;
+      case OPCODE_SGE:
+         fetch(m, inst, 0, mask, a);
+         fetch(m, inst, 1, mask, b);
+         COMPONENTWISE((a[chan][l] >= b[chan][l]) ? 1.0F : 0.0F);
+         break;
+      case OPCODE_SGT:
+         fetch(m, inst, 0, mask, a);
+         fetch(m, inst, 1, mask, b);
+         COMPONENTWISE((a[chan][l] > b[chan][l]) ? 1.0F : 0.0F);
+         break;
+      case OPCODE_SIN:
+         fetch(m, inst, 0, WRITEMASK_X, a);
+         SCALAR((GLfloat) _mesa_sin(a[0][l]));
+         break;
+      case OPCODE_SLE:
+         fetch(m, inst, 0, mask, a);
+         fetch(m, inst, 1, mask, b);
+         COMPONENTWISE((a[chan][l] <= b[chan][l]) ? 1.0F : 0.0F);
+         break;
+      case OPCODE_SLT:
+         fetch(m, inst, 0, mask, a);
+         fetch(m, inst, 1, mask, b);
+         COMPONENTWISE((a[chan][l] < b[chan][l]) ? 1.0F : 0.0F);
+         break;
+      case OPCODE_SNE:
+         fetch(m, inst, 0, mask, a);
+         fetch(m, inst, 1, mask, b);
+         COMPONENTWISE((a[chan][l] != b[chan][l]) ? 1.0F : 0.0F);
+         break;
+      case OPCODE_STR:
+         COMPONENTWISE(1.0F);
+         break;
+      case OPCODE_SUB:
+         fetch(m, inst, 0, mask, a);
+         fetch(m, inst, 1, mask, b);
+         COMPONENTWISE(a[chan][l] - b[chan][l]);
+         break;
+      case OPCODE_XPD:
+         fetch(m, inst, 0, WRITEMASK_XYZ, a);
+         fetch(m, inst, 1, WRITEMASK_XYZ, b);
+         for (l = 0; l < n; l++) {
+            r[0][l] = a[1][l] * b[2][l] - a[2][l] * b[1][l];
+            r[1][l] = a[2][l] * b[0][l] - a[0][l] * b[2][l];
+            r[2][l] = a[0][l] * b[1][l] - a[1][l] * b[0][l];
+            r[3][l] = 1.0;
+         }
+         store_result(m, inst, GL_FALSE);
+         break;
+      default:
+         _mesa_problem(NULL, "Bad opcode %d in _mesa_execute_program_batch",
+                       inst->Opcode);
+         return;
+      }
+   }
+}
+
+
+struct prog_batch_machine *
+_mesa_new_batch_machine(void)
+{
+   return CALLOC_STRUCT(prog_batch_machine);
+}
+
+
+void
+_mesa_free_batch_machine(struct prog_batch_machine *m)
+{
+   _mesa_free(m);
+}
+
+
+/**
+ * Prepare to run the program on the machine.
+ */
+void
+_mesa_init_batch_machine(GLcontext *ctx, struct prog_batch_machine *m,
+                         const struct gl_program *prog)
+{
+   ASSERT(prog->Target == GL_VERTEX_PROGRAM_ARB);
+
+   if (prog->Parameters) {
+      m->Params = (const GLfloat (*)[4]) prog->Parameters->ParameterValues;
+      m->NumParams = prog->Parameters->NumParameters;
+   }
+   else {
+      m->Params = NULL;
+      m->NumParams = 0;
+   }
+   m->LocalParams = (const GLfloat (*)[4]) prog->LocalParams;
+   m->EnvParams = (const GLfloat (*)[4]) ctx->VertexProgram.Parameters;
+   m->Count = 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  7.1
+ *
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PROG_EXECUTE_BATCH_H
+#define PROG_EXECUTE_BATCH_H
+
+
+#include "prog_execute.h"
+
+
+/** Number of vertices run through each instruction at once */
+#define PROG_BATCH_SIZE 16
+
+
+/**
+ * Machine state for interpreting a vertex program on a batch of
+ * vertices.  Registers are stored structure-of-arrays:
+ * Temporaries[reg][chan][vertex].
+ */
+struct prog_batch_machine
+{
+   GLfloat Temporaries[MAX_PROGRAM_TEMPS][4][PROG_BATCH_SIZE];
+   GLfloat Inputs[VERT_ATTRIB_MAX][4][PROG_BATCH_SIZE];
+   GLfloat Outputs[MAX_PROGRAM_OUTPUTS][4][PROG_BATCH_SIZE];
+   GLint AddressReg[PROG_BATCH_SIZE];
+
+   /** Operands 0..2 and result 3 of the current instruction */
+   GLfloat Scratch[4][4][PROG_BATCH_SIZE];
+
+   const GLfloat (*Params)[4];            /**< program parameters */
+   GLuint NumParams;
+   const GLfloat (*EnvParams)[4];
+   const GLfloat (*LocalParams)[4];
+
+   GLuint Count;                          /**< vertices in this batch */
+};
+
+
+extern GLboolean
+_mesa_can_execute_program_batch(const struct gl_program *prog);
+
+extern struct prog_batch_machine *
+_mesa_new_batch_machine(void);
+
+extern void
+_mesa_free_batch_machine(struct prog_batch_machine *m);
+
+extern void
+_mesa_init_batch_machine(GLcontext *ctx, struct prog_batch_machine *m,
+                         const struct gl_program *prog);
+
+extern void
+_mesa_execute_program_batch(const struct gl_program *prog,
+                            struct prog_batch_machine *m);
+
+
+#endif /* PROG_EXECUTE_BATCH_H */
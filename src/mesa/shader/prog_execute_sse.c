@@ -0,0 +1,1074 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  7.1
+ *
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file prog_execute_sse.c
+ * Translate vertex/fragment programs into x86-64 SSE code.
+ *
+ * The generated code runs a program on four vertices or fragments at
+ * once.  All registers live in a prog_soa_machine, laid out so that one
+ * channel of a register for all four lanes is a single SSE vector.
+ * Each instruction loads its operands, computes and stores its result;
+ * nothing is cached in registers between instructions.
+ *
+ * Arithmetic instructions are translated directly and give the same
+ * results as prog_execute.c.  Everything else (transcendentals, texture
+ * fetches, derivatives, pack/unpack) is handed back to the interpreter
+ * one lane at a time through a small single-instruction program.
+ * Programs with flow control, condition codes or relative addressing,
+ * and NV programs, aren't translated and are always interpreted.
+ *
+ * Set the MESA_NO_CODEGEN env var to disable.
+ */
+
+
+#include <stddef.h>
+#include "main/glheader.h"
+#include "main/context.h"
+#include "main/imports.h"
+#include "program.h"
+#include "prog_instruction.h"
+#include "prog_parameter.h"
+#include "prog_execute.h"
+#include "prog_execute_sse.h"
+#include "glapi/glthread.h"
+
+#if defined(USE_X86_64_ASM)
+#include "x86/rtasm/x86sse.h"
+#endif
+
+
+/**
+ * Native code for a program, hung off gl_program::NativeCode.
+ */
+struct prog_native_code
+{
+   /** The instructions which were translated, to detect changes */
+   const struct prog_instruction *Instructions;
+   GLuint NumInstructions;
+
+#if defined(USE_X86_64_ASM)
+   struct x86_function func;
+#endif
+   /** Entrypoint, or NULL if the program couldn't be translated */
+   void (*Func)(struct prog_soa_machine *m);
+
+   /** Single-instruction programs run by interpret_lanes(), per pc */
+   struct gl_program **Lane;
+};
+
+
+#if defined(USE_X86_64_ASM)
+
+/** Upper bound on the code emitted for one instruction */
+#define MAX_INST_CODE 2048
+
+/** Initial size of the buffer the code is generated into */
+#define INITIAL_CODE_SIZE (16 * MAX_INST_CODE)
+
+/** Pseudo register file for prog_soa_machine::Scratch */
+#define FILE_SCRATCH PROGRAM_FILE_MAX
+
+#define SOA_OFFSET(FIELD) ((GLint) offsetof(struct prog_soa_machine, FIELD))
+
+
+struct sse_codegen
+{
+   struct x86_function func;
+   const struct gl_program *prog;
+   GLboolean fragment;
+};
+
+
+/** Callee-saved registers for the machine and the parameter array */
+static struct x86_reg
+reg_machine(void)
+{
+   return x86_make_reg(file_REG32, reg_BX);
+}
+
+static struct x86_reg
+reg_params(void)
+{
+   return x86_make_reg(file_REG32, reg_BP);
+}
+
+static struct x86_reg
+xmm(GLuint i)
+{
+   return x86_make_reg(file_XMM, i);
+}
+
+static struct x86_reg
+soa_const(GLuint k)
+{
+   return x86_make_disp(reg_machine(), SOA_OFFSET(Consts) + k * 16);
+}
+
+/**
+ * One channel, all four lanes, of a machine register.
+ */
+static struct x86_reg
+soa_reg(GLuint file, GLuint index, GLuint chan)
+{
+   GLint base;
+
+   switch (file) {
+   case PROGRAM_TEMPORARY:
+      base = SOA_OFFSET(Temporaries);
+      break;
+   case PROGRAM_INPUT:
+      base = SOA_OFFSET(Inputs);
+      break;
+   case PROGRAM_OUTPUT:
+      base = SOA_OFFSET(Outputs);
+      break;
+   default:
+      ASSERT(file == FILE_SCRATCH);
+      base = SOA_OFFSET(Scratch);
+      break;
+   }
+
+   return x86_make_disp(reg_machine(), base + (index * 4 + chan) * 16);
+}
+
+
+/**
+ * Fragment program inputs are left for the interpreter to fetch itself
+ * so that texture instructions still find their derivatives.
+ */
+static GLboolean
+interpreter_reads_src(const struct sse_codegen *cg,
+                      const struct prog_src_register *src)
+{
+   return cg->fragment && src->File == PROGRAM_INPUT;
+}
+
+
+/**
+ * Load channel 'chan' of source operand 'i' into 'dst', with swizzling
+ * and negation applied as fetch_vector4() does.
+ */
+static void
+emit_fetch(struct sse_codegen *cg, const struct prog_instruction *inst,
+           GLuint i, GLuint chan, struct x86_reg dst)
+{
+   struct x86_function *p = &cg->func;
+   const struct prog_src_register *src = &inst->SrcReg[i];
+   const GLuint swz = GET_SWZ(src->Swizzle, chan);
+
+   if (swz == SWIZZLE_ZERO) {
+      sse_xorps(p, dst, dst);
+   }
+   else if (swz == SWIZZLE_ONE) {
+      sse_movaps(p, dst, soa_const(SOA_CONST_ONE));
+   }
+   else {
+      const GLint offset = (src->Index * 4 + swz) * sizeof(GLfloat);
+
+      switch (src->File) {
+      case PROGRAM_TEMPORARY:
+      case PROGRAM_INPUT:
+      case PROGRAM_OUTPUT:
+         sse_movaps(p, dst, soa_reg(src->File, src->Index, swz));
+         break;
+      case PROGRAM_LOCAL_PARAM:
+      case PROGRAM_ENV_PARAM:
+         {
+            struct x86_reg ptr = x86_make_reg(file_REG32, reg_AX);
+            x86_mov64(p, ptr,
+                      x86_make_disp(reg_machine(),
+                                    src->File == PROGRAM_LOCAL_PARAM
+                                    ? SOA_OFFSET(LocalParams)
+                                    : SOA_OFFSET(EnvParams)));
+            sse_movss(p, dst, x86_make_disp(ptr, offset));
+            sse_shufps(p, dst, dst, SHUF(0, 0, 0, 0));
+         }
+         break;
+      default:
+         /* state vars, constants, uniforms, named params */
+         sse_movss(p, dst, x86_make_disp(reg_params(), offset));
+         sse_shufps(p, dst, dst, SHUF(0, 0, 0, 0));
+         break;
+      }
+   }
+
+   if (inst->Opcode == OPCODE_SWZ) {
+      /* per-component negation */
+      if (src->NegateBase & (1 << chan))
+         sse_xorps(p, dst, soa_const(SOA_CONST_SIGN));
+   }
+   else {
+      if (src->NegateBase)
+         sse_xorps(p, dst, soa_const(SOA_CONST_SIGN));
+      if (src->Abs)
+         sse_andps(p, dst, soa_const(SOA_CONST_ABS));
+      if (src->NegateAbs)
+         sse_xorps(p, dst, soa_const(SOA_CONST_SIGN));
+   }
+}
+
+
+/**
+ * Store the instruction's result.  Channel c of the result is in
+ * register xmm<c>, or all channels are in xmm0 if 'scalar' is set.
+ */
+static void
+emit_store(struct sse_codegen *cg, const struct prog_instruction *inst,
+           GLboolean scalar)
+{
+   struct x86_function *p = &cg->func;
+   const struct prog_dst_register *dst = &inst->DstReg;
+   GLuint chan;
+
+   if (dst->File == PROGRAM_WRITE_ONLY)
+      return;
+
+   for (chan = 0; chan < 4; chan++) {
+      struct x86_reg value = xmm(scalar ? 0 : chan);
+
+      if (!(dst->WriteMask & (1 << chan)))
+         continue;
+
+      /* Clamp to [0,1], NaN becomes 0.  For scalar results only do it
+       * for the first channel written.
+       */
+      if (inst->SaturateMode == SATURATE_ZERO_ONE &&
+          (!scalar || !(dst->WriteMask & ((1 << chan) - 1)))) {
+         sse_maxps(p, value, soa_const(SOA_CONST_ZERO));
+         sse_minps(p, value, soa_const(SOA_CONST_ONE));
+      }
+
+      sse_movaps(p, soa_reg(dst->File, dst->Index, chan), value);
+   }
+}
+
+
+/**
+ * dst = FLOORF(xmm4), using xmm5 and xmm6.
+ * Truncate, step down where that rounded up, and keep the sign so that
+ * -0.0 stays -0.0.  Values too large to have a fraction (and NaN/Inf)
+ * are passed through.
+ */
+static void
+emit_floor(struct sse_codegen *cg, struct x86_reg dst)
+{
+   struct x86_function *p = &cg->func;
+
+   sse2_cvttps2dq(p, xmm(5), xmm(4));
+   sse2_cvtdq2ps(p, xmm(5), xmm(5));
+   sse_movaps(p, xmm(6), xmm(4));
+   sse_cmpps(p, xmm(6), xmm(5), cc_LessThan);
+   sse_andps(p, xmm(6), soa_const(SOA_CONST_ONE));
+   sse_subps(p, xmm(5), xmm(6));
+   sse_movaps(p, xmm(6), xmm(4));
+   sse_andps(p, xmm(6), soa_const(SOA_CONST_SIGN));
+   sse_orps(p, xmm(5), xmm(6));
+
+   sse_movaps(p, xmm(6), xmm(4));
+   sse_andps(p, xmm(6), soa_const(SOA_CONST_ABS));
+   sse_cmpps(p, xmm(6), soa_const(SOA_CONST_2_23), cc_LessThan);
+   sse_andps(p, xmm(5), xmm(6));
+   sse_andnps(p, xmm(6), xmm(4));
+   sse_orps(p, xmm(5), xmm(6));
+   sse_movaps(p, dst, xmm(5));
+}
+
+
+/**
+ * Component-wise two operand instructions.
+ */
+static void
+emit_binop(struct sse_codegen *cg, const struct prog_instruction *inst,
+           void (*op)(struct x86_function *, struct x86_reg, struct x86_reg))
+{
+   GLuint chan;
+
+   for (chan = 0; chan < 4; chan++) {
+      if (inst->DstReg.WriteMask & (1 << chan)) {
+         emit_fetch(cg, inst, 0, chan, xmm(chan));
+         emit_fetch(cg, inst, 1, chan, xmm(4));
+         op(&cg->func, xmm(chan), xmm(4));
+      }
+   }
+   emit_store(cg, inst, GL_FALSE);
+}
+
+
+/**
+ * SLT, SGE, etc.  The operands are swapped where needed so that NaN
+ * compares false, like the C comparisons in the interpreter.
+ */
+static void
+emit_setcc(struct sse_codegen *cg, const struct prog_instruction *inst,
+           GLubyte cc, GLboolean swap)
+{
+   struct x86_function *p = &cg->func;
+   GLuint chan;
+
+   for (chan = 0; chan < 4; chan++) {
+      if (inst->DstReg.WriteMask & (1 << chan)) {
+         emit_fetch(cg, inst, swap ? 1 : 0, chan, xmm(chan));
+         emit_fetch(cg, inst, swap ? 0 : 1, chan, xmm(4));
+         sse_cmpps(p, xmm(chan), xmm(4), cc);
+         sse_andps(p, xmm(chan), soa_const(SOA_CONST_ONE));
+      }
+   }
+   emit_store(cg, inst, GL_FALSE);
+}
+
+
+/**
+ * DP3, DP4 and DPH, summed in the same order as the interpreter.
+ */
+static void
+emit_dot(struct sse_codegen *cg, const struct prog_instruction *inst,
+         GLuint n, GLboolean homogeneous)
+{
+   struct x86_function *p = &cg->func;
+   GLuint chan;
+
+   emit_fetch(cg, inst, 0, 0, xmm(0));
+   emit_fetch(cg, inst, 1, 0, xmm(4));
+   sse_mulps(p, xmm(0), xmm(4));
+   for (chan = 1; chan < n; chan++) {
+      emit_fetch(cg, inst, 0, chan, xmm(5));
+      emit_fetch(cg, inst, 1, chan, xmm(4));
+      sse_mulps(p, xmm(5), xmm(4));
+      sse_addps(p, xmm(0), xmm(5));
+   }
+   if (homogeneous) {
+      emit_fetch(cg, inst, 1, 3, xmm(4));
+      sse_addps(p, xmm(0), xmm(4));
+   }
+   emit_store(cg, inst, GL_TRUE);
+}
+
+
+/**
+ * Hand an instruction to the interpreter: store the operands in
+ * Scratch[0..2], call prog_soa_machine::Interpret and pick the result
+ * up from Scratch[3].
+ */
+static void
+emit_interpret(struct sse_codegen *cg, const struct prog_instruction *inst,
+               GLuint pc)
+{
+   struct x86_function *p = &cg->func;
+   const GLuint numSrc = _mesa_num_inst_src_regs(inst->Opcode);
+   GLuint i, chan;
+
+   for (i = 0; i < numSrc; i++) {
+      if (interpreter_reads_src(cg, &inst->SrcReg[i]))
+         continue;
+      for (chan = 0; chan < 4; chan++) {
+         emit_fetch(cg, inst, i, chan, xmm(0));
+         sse_movaps(p, soa_reg(FILE_SCRATCH, i, chan), xmm(0));
+      }
+   }
+
+   x86_mov64(p, x86_fn_arg(p, 1), reg_machine());
+   x86_mov_reg_imm(p, x86_fn_arg(p, 2), pc);
+   x86_call_indirect(p, x86_make_disp(reg_machine(), SOA_OFFSET(Interpret)));
+
+   for (chan = 0; chan < 4; chan++) {
+      if (inst->DstReg.WriteMask & (1 << chan))
+         sse_movaps(p, xmm(chan), soa_reg(FILE_SCRATCH, 3, chan));
+   }
+   emit_store(cg, inst, GL_FALSE);
+}
+
+
+/**
+ * Emit code for one instruction.
+ */
+static void
+emit_instruction(struct sse_codegen *cg, const struct prog_instruction *inst,
+                 GLuint pc)
+{
+   struct x86_function *p = &cg->func;
+   const GLuint mask = inst->DstReg.WriteMask;
+   GLuint chan;
+
+   switch (inst->Opcode) {
+   case OPCODE_NOP:
+      break;
+   case OPCODE_ABS:
+      for (chan = 0; chan < 4; chan++) {
+         if (mask & (1 << chan)) {
+            emit_fetch(cg, inst, 0, chan, xmm(chan));
+            sse_andps(p, xmm(chan), soa_const(SOA_CONST_ABS));
+         }
+      }
+      emit_store(cg, inst, GL_FALSE);
+      break;
+   case OPCODE_ADD:
+      emit_binop(cg, inst, sse_addps);
+      break;
+   case OPCODE_CMP:
+      for (chan = 0; chan < 4; chan++) {
+         if (mask & (1 << chan)) {
+            emit_fetch(cg, inst, 0, chan, xmm(4));
+            sse_xorps(p, xmm(5), xmm(5));
+            sse_cmpps(p, xmm(4), xmm(5), cc_LessThan);
+            emit_fetch(cg, inst, 1, chan, xmm(chan));
+            sse_andps(p, xmm(chan), xmm(4));
+            emit_fetch(cg, inst, 2, chan, xmm(5));
+            sse_andnps(p, xmm(4), xmm(5));
+            sse_orps(p, xmm(chan), xmm(4));
+         }
+      }
+      emit_store(cg, inst, GL_FALSE);
+      break;
+   case OPCODE_DP3:
+      emit_dot(cg, inst, 3, GL_FALSE);
+      break;
+   case OPCODE_DP4:
+      emit_dot(cg, inst, 4, GL_FALSE);
+      break;
+   case OPCODE_DPH:
+      emit_dot(cg, inst, 3, GL_TRUE);
+      break;
+   case OPCODE_DST:
+      sse_movaps(p, xmm(0), soa_const(SOA_CONST_ONE));
+      if (mask & WRITEMASK_Y) {
+         emit_fetch(cg, inst, 0, 1, xmm(1));
+         emit_fetch(cg, inst, 1, 1, xmm(4));
+         sse_mulps(p, xmm(1), xmm(4));
+      }
+      if (mask & WRITEMASK_Z)
+         emit_fetch(cg, inst, 0, 2, xmm(2));
+      if (mask & WRITEMASK_W)
+         emit_fetch(cg, inst, 1, 3, xmm(3));
+      emit_store(cg, inst, GL_FALSE);
+      break;
+   case OPCODE_FLR:
+   case OPCODE_FRC:
+      for (chan = 0; chan < 4; chan++) {
+         if (mask & (1 << chan)) {
+            emit_fetch(cg, inst, 0, chan, xmm(4));
+            if (inst->Opcode == OPCODE_FLR) {
+               emit_floor(cg, xmm(chan));
+            }
+            else {
+               emit_floor(cg, xmm(5));
+               sse_movaps(p, xmm(chan), xmm(4));
+               sse_subps(p, xmm(chan), xmm(5));
+            }
+         }
+      }
+      emit_store(cg, inst, GL_FALSE);
+      break;
+   case OPCODE_KIL:
+      for (chan = 0; chan < 4; chan++) {
+         emit_fetch(cg, inst, 0, chan, xmm(4));
+         sse_xorps(p, xmm(5), xmm(5));
+         sse_cmpps(p, xmm(4), xmm(5), cc_LessThan);
+         if (chan == 0)
+            sse_movaps(p, xmm(0), xmm(4));
+         else
+            sse_orps(p, xmm(0), xmm(4));
+      }
+      sse_orps(p, xmm(0), x86_make_disp(reg_machine(), SOA_OFFSET(Kill)));
+      sse_movaps(p, x86_make_disp(reg_machine(), SOA_OFFSET(Kill)), xmm(0));
+      break;
+   case OPCODE_LRP:
+      for (chan = 0; chan < 4; chan++) {
+         if (mask & (1 << chan)) {
+            emit_fetch(cg, inst, 0, chan, xmm(4));
+            emit_fetch(cg, inst, 1, chan, xmm(chan));
+            sse_mulps(p, xmm(chan), xmm(4));
+            sse_movaps(p, xmm(5), soa_const(SOA_CONST_ONE));
+            sse_subps(p, xmm(5), xmm(4));
+            emit_fetch(cg, inst, 2, chan, xmm(6));
+            sse_mulps(p, xmm(5), xmm(6));
+            sse_addps(p, xmm(chan), xmm(5));
+         }
+      }
+      emit_store(cg, inst, GL_FALSE);
+      break;
+   case OPCODE_MAD:
+      for (chan = 0; chan < 4; chan++) {
+         if (mask & (1 << chan)) {
+            emit_fetch(cg, inst, 0, chan, xmm(chan));
+            emit_fetch(cg, inst, 1, chan, xmm(4));
+            sse_mulps(p, xmm(chan), xmm(4));
+            emit_fetch(cg, inst, 2, chan, xmm(4));
+            sse_addps(p, xmm(chan), xmm(4));
+         }
+      }
+      emit_store(cg, inst, GL_FALSE);
+      break;
+   case OPCODE_MAX:
+      emit_binop(cg, inst, sse_maxps);
+      break;
+   case OPCODE_MIN:
+      emit_binop(cg, inst, sse_minps);
+      break;
+   case OPCODE_MOV:
+   case OPCODE_SWZ:
+      for (chan = 0; chan < 4; chan++) {
+         if (mask & (1 << chan))
+            emit_fetch(cg, inst, 0, chan, xmm(chan));
+      }
+      emit_store(cg, inst, GL_FALSE);
+      break;
+   case OPCODE_MUL:
+      emit_binop(cg, inst, sse_mulps);
+      break;
+   case OPCODE_RCP:
+      emit_fetch(cg, inst, 0, 0, xmm(4));
+      sse_movaps(p, xmm(0), soa_const(SOA_CONST_ONE));
+      sse_divps(p, xmm(0), xmm(4));
+      emit_store(cg, inst, GL_TRUE);
+      break;
+   case OPCODE_RSQ:
+      /* not rsqrtps: the interpreter computes 1.0F / sqrt(fabs(x)) */
+      emit_fetch(cg, inst, 0, 0, xmm(4));
+      sse_andps(p, xmm(4), soa_const(SOA_CONST_ABS));
+      sse_sqrtps(p, xmm(4), xmm(4));
+      sse_movaps(p, xmm(0), soa_const(SOA_CONST_ONE));
+      sse_divps(p, xmm(0), xmm(4));
+      emit_store(cg, inst, GL_TRUE);
+      break;
+   case OPCODE_SEQ:
+      emit_setcc(cg, inst, cc_Equal, GL_FALSE);
+      break;
+   case OPCODE_SFL:
+      sse_xorps(p, xmm(0), xmm(0));
+      emit_store(cg, inst, GL_TRUE);
+      break;
+   case OPCODE_SGE:
+      emit_setcc(cg, inst, cc_LessThanEqual, GL_TRUE);
+      break;
+   case OPCODE_SGT:
+      emit_setcc(cg, inst, cc_LessThan, GL_TRUE);
+      break;
+   case OPCODE_SLE:
+      emit_setcc(cg, inst, cc_LessThanEqual, GL_FALSE);
+      break;
+   case OPCODE_SLT:
+      emit_setcc(cg, inst, cc_LessThan, GL_FALSE);
+      break;
+   case OPCODE_SNE:
+      emit_setcc(cg, inst, cc_NotEqual, GL_FALSE);
+      break;
+   case OPCODE_STR:
+      sse_movaps(p, xmm(0), soa_const(SOA_CONST_ONE));
+      emit_store(cg, inst, GL_TRUE);
+      break;
+   case OPCODE_SUB:
+      emit_binop(cg, inst, sse_subps);
+      break;
+   case OPCODE_XPD:
+      for (chan = 0; chan < 3; chan++) {
+         const GLuint i = (chan + 1) % 3, j = (chan + 2) % 3;
+         if (mask & (1 << chan)) {
+            emit_fetch(cg, inst, 0, i, xmm(chan));
+            emit_fetch(cg, inst, 1, j, xmm(4));
+            sse_mulps(p, xmm(chan), xmm(4));
+            emit_fetch(cg, inst, 0, j, xmm(5));
+            emit_fetch(cg, inst, 1, i, xmm(4));
+            sse_mulps(p, xmm(5), xmm(4));
+            sse_subps(p, xmm(chan), xmm(5));
+         }
+      }
+      sse_movaps(p, xmm(3), soa_const(SOA_CONST_ONE));
+      emit_store(cg, inst, GL_FALSE);
+      break;
+   default:
+      emit_interpret(cg, inst, pc);
+      break;
+   }
+}
+
+
+/**
+ * Check that the program only uses features we can translate.
+ */
+static GLboolean
+can_translate(const struct gl_program *prog)
+{
+   GLuint pc, i;
+
+   if (prog->Target == GL_FRAGMENT_PROGRAM_NV)
+      return GL_FALSE;
+   if (prog->Target == GL_VERTEX_PROGRAM_ARB &&
+       ((const struct gl_vertex_program *) prog)->IsNVProgram)
+      return GL_FALSE;
+
+   for (pc = 0; pc < prog->NumInstructions; pc++) {
+      const struct prog_instruction *inst = prog->Instructions + pc;
+
+      switch (inst->Opcode) {
+      case OPCODE_END:
+         return GL_TRUE;
+      case OPCODE_ARA:
+      case OPCODE_ARL:
+      case OPCODE_ARL_NV:
+      case OPCODE_ARR:
+      case OPCODE_BGNLOOP:
+      case OPCODE_BGNSUB:
+      case OPCODE_BRA:
+      case OPCODE_BRK:
+      case OPCODE_CAL:
+      case OPCODE_CONT:
+      case OPCODE_ELSE:
+      case OPCODE_ENDIF:
+      case OPCODE_ENDLOOP:
+      case OPCODE_ENDSUB:
+      case OPCODE_IF:
+      case OPCODE_KIL_NV:
+      case OPCODE_POPA:
+      case OPCODE_PRINT:
+      case OPCODE_PUSHA:
+      case OPCODE_RCC:
+      case OPCODE_RET:
+      case OPCODE_SSG:
+      case OPCODE_TXL:
+         return GL_FALSE;
+      case OPCODE_NOP:
+      case OPCODE_KIL:
+         break;
+      default:
+         if (inst->CondUpdate || inst->DstReg.CondMask != COND_TR)
+            return GL_FALSE;
+         if (inst->DstReg.File != PROGRAM_TEMPORARY &&
+             inst->DstReg.File != PROGRAM_OUTPUT &&
+             inst->DstReg.File != PROGRAM_WRITE_ONLY)
+            return GL_FALSE;
+         if (inst->DstReg.File == PROGRAM_TEMPORARY &&
+             inst->DstReg.Index >= MAX_PROGRAM_TEMPS)
+            return GL_FALSE;
+         if (inst->DstReg.File == PROGRAM_OUTPUT &&
+             inst->DstReg.Index >= MAX_PROGRAM_OUTPUTS)
+            return GL_FALSE;
+         break;
+      }
+
+      for (i = 0; i < _mesa_num_inst_src_regs(inst->Opcode); i++) {
+         const struct prog_src_register *src = &inst->SrcReg[i];
+
+         if (src->RelAddr)
+            return GL_FALSE;
+
+         switch (src->File) {
+         case PROGRAM_TEMPORARY:
+            if (src->Index >= MAX_PROGRAM_TEMPS)
+               return GL_FALSE;
+            break;
+         case PROGRAM_INPUT:
+            if (src->Index >= VERT_ATTRIB_MAX)
+               return GL_FALSE;
+            break;
+         case PROGRAM_OUTPUT:
+            if (src->Index >= MAX_PROGRAM_OUTPUTS)
+               return GL_FALSE;
+            break;
+         case PROGRAM_LOCAL_PARAM:
+         case PROGRAM_ENV_PARAM:
+         case PROGRAM_STATE_VAR:
+         case PROGRAM_CONSTANT:
+         case PROGRAM_UNIFORM:
+         case PROGRAM_NAMED_PARAM:
+            break;
+         default:
+            return GL_FALSE;
+         }
+      }
+   }
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Build the single-instruction program used to run 'inst' on one lane:
+ * operands come from temps 0..2, the result goes to temp 3.
+ */
+static struct gl_program *
+new_lane_program(const struct sse_codegen *cg,
+                 const struct prog_instruction *inst)
+{
+   struct gl_program *lane = CALLOC_STRUCT(gl_program);
+   struct prog_instruction *code;
+   GLuint i;
+
+   if (!lane)
+      return NULL;
+
+   code = _mesa_alloc_instructions(2);
+   if (!code) {
+      _mesa_free(lane);
+      return NULL;
+   }
+   _mesa_init_instructions(code, 2);
+
+   code[0] = *inst;
+   code[0].Comment = NULL;
+   code[0].Data = NULL;
+   for (i = 0; i < _mesa_num_inst_src_regs(inst->Opcode); i++) {
+      struct prog_src_register *src = &code[0].SrcReg[i];
+      if (interpreter_reads_src(cg, src))
+         continue;
+      src->File = PROGRAM_TEMPORARY;
+      src->Index = i;
+      src->Swizzle = SWIZZLE_NOOP;
+      src->NegateBase = 0;
+      src->Abs = GL_FALSE;
+      src->NegateAbs = GL_FALSE;
+   }
+   code[0].DstReg.File = PROGRAM_TEMPORARY;
+   code[0].DstReg.Index = 3;
+   code[0].DstReg.WriteMask = WRITEMASK_XYZW;
+   code[0].SaturateMode = SATURATE_OFF;
+
+   code[1].Opcode = OPCODE_END;
+
+   lane->Target = cg->prog->Target;
+   lane->Instructions = code;
+   lane->NumInstructions = 2;
+   return lane;
+}
+
+
+/**
+ * Make sure there's room for another instruction's code, growing the
+ * buffer if needed.  The buffer isn't executable and may move, which is
+ * fine since the code is position independent and there are no jumps
+ * between instructions.
+ */
+static GLboolean
+reserve_code(struct x86_function *p, GLuint *storeSize)
+{
+   const GLuint used = (GLuint) (p->csr - p->store);
+
+   if (*storeSize - used < MAX_INST_CODE) {
+      GLubyte *store = (GLubyte *) _mesa_realloc(p->store, *storeSize,
+                                                 *storeSize * 2);
+      if (!store)
+         return GL_FALSE;
+      p->store = store;
+      p->csr = store + used;
+      *storeSize *= 2;
+   }
+   return GL_TRUE;
+}
+
+
+/**
+ * Translate the program, filling in code->func and code->Func.
+ */
+static GLboolean
+translate_program(struct gl_program *prog, struct prog_native_code *code)
+{
+   struct sse_codegen cg;
+   struct x86_function *p = &cg.func;
+   GLuint pc, size, storeSize;
+
+   code->Lane = (struct gl_program **)
+      _mesa_calloc(prog->NumInstructions * sizeof(struct gl_program *));
+   if (!code->Lane)
+      return GL_FALSE;
+
+   _mesa_memset(&cg, 0, sizeof(cg));
+   cg.prog = prog;
+   cg.fragment = prog->Target != GL_VERTEX_PROGRAM_ARB;
+
+   /* Generate into ordinary memory, then copy the code to an executable
+    * block of just the right size.
+    */
+   storeSize = INITIAL_CODE_SIZE;
+   p->store = p->csr = (GLubyte *) _mesa_malloc(storeSize);
+   if (!p->store)
+      return GL_FALSE;
+
+   /* rbx = machine, rbp = parameters.  Three pushes leave the stack
+    * 16-byte aligned for calls to Interpret.
+    */
+   x86_push(p, reg_machine());
+   x86_push(p, reg_params());
+   x86_push(p, x86_make_reg(file_REG32, reg_AX));
+   x86_mov64(p, reg_machine(), x86_fn_arg(p, 1));
+   x86_mov64(p, reg_params(),
+             x86_make_disp(reg_machine(), SOA_OFFSET(Params)));
+
+   for (pc = 0; pc < prog->NumInstructions; pc++) {
+      const struct prog_instruction *inst = prog->Instructions + pc;
+
+      if (inst->Opcode == OPCODE_END)
+         break;
+
+      switch (inst->Opcode) {
+      case OPCODE_ABS: case OPCODE_ADD: case OPCODE_CMP: case OPCODE_DP3:
+      case OPCODE_DP4: case OPCODE_DPH: case OPCODE_DST: case OPCODE_FLR:
+      case OPCODE_FRC: case OPCODE_KIL: case OPCODE_LRP: case OPCODE_MAD:
+      case OPCODE_MAX: case OPCODE_MIN: case OPCODE_MOV: case OPCODE_MUL:
+      case OPCODE_NOP: case OPCODE_RCP: case OPCODE_RSQ: case OPCODE_SEQ:
+      case OPCODE_SFL: case OPCODE_SGE: case OPCODE_SGT: case OPCODE_SLE:
+      case OPCODE_SLT: case OPCODE_SNE: case OPCODE_STR: case OPCODE_SUB:
+      case OPCODE_SWZ: case OPCODE_XPD:
+         break;
+      default:
+         code->Lane[pc] = new_lane_program(&cg, inst);
+         if (!code->Lane[pc]) {
+            _mesa_free(p->store);
+            return GL_FALSE;
+         }
+         break;
+      }
+
+      if (!reserve_code(p, &storeSize)) {
+         _mesa_free(p->store);
+         return GL_FALSE;
+      }
+      emit_instruction(&cg, inst, pc);
+   }
+
+   if (!reserve_code(p, &storeSize)) {
+      _mesa_free(p->store);
+      return GL_FALSE;
+   }
+   x86_pop(p, x86_make_reg(file_REG32, reg_AX));
+   x86_pop(p, reg_params());
+   x86_pop(p, reg_machine());
+   x86_ret(p);
+
+   size = x86_get_label(p) - p->store;
+   if (!x86_init_func(&code->func, size)) {
+      /* out of executable memory, keep using the interpreter */
+      _mesa_free(p->store);
+      return GL_FALSE;
+   }
+   _mesa_memcpy(code->func.store, p->store, size);
+   _mesa_free(p->store);
+
+   code->Func = (void (*)(struct prog_soa_machine *)) x86_get_func(&code->func);
+   return GL_TRUE;
+}
+
+
+/**
+ * Called from the generated code: run instruction 'pc' with the
+ * interpreter for each live lane.
+ */
+static void
+interpret_lanes(struct prog_soa_machine *m, GLuint pc)
+{
+   const struct gl_program *lane = m->Program->NativeCode->Lane[pc];
+   struct gl_program_machine *machine = m->Machine;
+   GLuint l, i, c;
+
+   for (l = 0; l < 4; l++) {
+      if ((m->LaneMask & (1 << l)) && !m->Kill[l]) {
+         for (i = 0; i < 3; i++) {
+            for (c = 0; c < 4; c++)
+               machine->Temporaries[i][c] = m->Scratch[i][c][l];
+         }
+         machine->CurElement = m->Element + l;
+
+         _mesa_execute_program(m->Ctx, lane, machine);
+
+         for (c = 0; c < 4; c++)
+            m->Scratch[3][c][l] = machine->Temporaries[3][c];
+      }
+   }
+}
+
+/**
+ * Programs may be shared by contexts validating state in different
+ * threads, so the code is generated with this held.
+ */
+_glthread_DECLARE_STATIC_MUTEX(CompileMutex);
+
+#endif /* USE_X86_64_ASM */
+
+
+/**
+ * Generate SSE code for the program if we haven't already.
+ * Called at state validation time, not while rendering.
+ * \return GL_TRUE if the program has native code
+ */
+GLboolean
+_mesa_compile_program_sse(GLcontext *ctx, struct gl_program *prog)
+{
+#if defined(USE_X86_64_ASM)
+   struct prog_native_code *code;
+   GLboolean ok = GL_FALSE;
+
+   _glthread_LOCK_MUTEX(CompileMutex);
+
+   code = prog->NativeCode;
+   if (code) {
+      if (code->Instructions == prog->Instructions &&
+          code->NumInstructions == prog->NumInstructions) {
+         ok = code->Func != NULL;
+         _glthread_UNLOCK_MUTEX(CompileMutex);
+         return ok;
+      }
+      /* the program was changed underneath us */
+      _mesa_free_program_sse(prog);
+   }
+
+   if (prog->Instructions && !_mesa_getenv("MESA_NO_CODEGEN")) {
+      code = CALLOC_STRUCT(prog_native_code);
+      if (code) {
+         code->Instructions = prog->Instructions;
+         code->NumInstructions = prog->NumInstructions;
+
+         /* If translation fails, code->Func stays NULL and we won't try
+          * again.
+          */
+         if (can_translate(prog))
+            (void) translate_program(prog, code);
+
+         /* only publish the code once it's complete */
+         prog->NativeCode = code;
+         ok = code->Func != NULL;
+      }
+   }
+
+   _glthread_UNLOCK_MUTEX(CompileMutex);
+   return ok;
+#else
+   (void) ctx;
+   (void) prog;
+   return GL_FALSE;
+#endif
+}
+
+
+/**
+ * Can _mesa_execute_program_sse() be used for this program?
+ */
+GLboolean
+_mesa_program_has_sse_code(const struct gl_program *prog)
+{
+   const struct prog_native_code *code = prog->NativeCode;
+   return (code && code->Func &&
+           code->Instructions == prog->Instructions &&
+           code->NumInstructions == prog->NumInstructions);
+}
+
+
+/**
+ * Free the program's generated code.
+ */
+void
+_mesa_free_program_sse(struct gl_program *prog)
+{
+   struct prog_native_code *code = prog->NativeCode;
+
+   if (!code)
+      return;
+
+   if (code->Lane) {
+      GLuint pc;
+      for (pc = 0; pc < code->NumInstructions; pc++) {
+         if (code->Lane[pc]) {
+            _mesa_free(code->Lane[pc]->Instructions);
+            _mesa_free(code->Lane[pc]);
+         }
+      }
+      _mesa_free(code->Lane);
+   }
+
+#if defined(USE_X86_64_ASM)
+   x86_release_func(&code->func);
+#endif
+
+   _mesa_free(code);
+   prog->NativeCode = NULL;
+}
+
+
+struct prog_soa_machine *
+_mesa_new_soa_machine(void)
+{
+   struct prog_soa_machine *m = ALIGN_MALLOC_STRUCT(prog_soa_machine, 16);
+   if (m)
+      _mesa_bzero(m, sizeof(*m));
+   return m;
+}
+
+
+void
+_mesa_free_soa_machine(struct prog_soa_machine *m)
+{
+   ALIGN_FREE(m);
+}
+
+
+/**
+ * Prepare to run the program's generated code.
+ * \param machine  interpreter state for the instructions which are run
+ *                 one lane at a time, set up as for _mesa_execute_program()
+ */
+void
+_mesa_init_soa_machine(GLcontext *ctx, struct prog_soa_machine *m,
+                       const struct gl_program *prog,
+                       struct gl_program_machine *machine)
+{
+   fi_type one, twoPow23;
+   GLuint i;
+
+   one.f = 1.0F;
+   twoPow23.f = 8388608.0F;
+   for (i = 0; i < 4; i++) {
+      m->Consts[SOA_CONST_ZERO][i] = 0;
+      m->Consts[SOA_CONST_ONE][i] = one.i;
+      m->Consts[SOA_CONST_SIGN][i] = 0x80000000;
+      m->Consts[SOA_CONST_ABS][i] = 0x7fffffff;
+      m->Consts[SOA_CONST_2_23][i] = twoPow23.i;
+      m->Kill[i] = 0;
+   }
+
+   m->Params = prog->Parameters
+      ? (const GLfloat (*)[4]) prog->Parameters->ParameterValues : NULL;
+   m->LocalParams = (const GLfloat (*)[4]) prog->LocalParams;
+   if (prog->Target == GL_VERTEX_PROGRAM_ARB)
+      m->EnvParams = (const GLfloat (*)[4]) ctx->VertexProgram.Parameters;
+   else
+      m->EnvParams = (const GLfloat (*)[4]) ctx->FragmentProgram.Parameters;
+
+#if defined(USE_X86_64_ASM)
+   m->Interpret = interpret_lanes;
+#endif
+   m->Ctx = ctx;
+   m->Program = prog;
+   m->Machine = machine;
+   m->Element = 0;
+   m->LaneMask = 0xf;
+}
+
+
+/**
+ * Run the program on the four lanes of the machine.
+ */
+void
+_mesa_execute_program_sse(struct prog_soa_machine *m)
+{
+   ASSERT(_mesa_program_has_sse_code(m->Program));
+   m->Program->NativeCode->Func(m);
+}
@@ -0,0 +1,103 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  7.1
+ *
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PROG_EXECUTE_SSE_H
+#define PROG_EXECUTE_SSE_H
+
+
+#include "prog_execute.h"
+
+
+/**
+ * Indexes into prog_soa_machine::Consts[]
+ */
+enum {
+   SOA_CONST_ZERO,
+   SOA_CONST_ONE,
+   SOA_CONST_SIGN,      /**< sign bit only */
+   SOA_CONST_ABS,       /**< all bits but the sign */
+   SOA_CONST_2_23,      /**< 2^23, floats above this have no fraction */
+   SOA_CONST_COUNT
+};
+
+
+/**
+ * Machine state for running generated code on four vertices or
+ * fragments at once.  Registers are stored structure-of-arrays:
+ * Temporaries[reg][chan][lane].  Must be 16-byte aligned, use
+ * _mesa_new_soa_machine().
+ */
+struct prog_soa_machine
+{
+   GLfloat Temporaries[MAX_PROGRAM_TEMPS][4][4];
+   GLfloat Inputs[VERT_ATTRIB_MAX][4][4];  /**< vertex or fragment attribs */
+   GLfloat Outputs[MAX_PROGRAM_OUTPUTS][4][4];
+
+   /** Operands 0..2 and result 3 of instructions run by the interpreter */
+   GLfloat Scratch[4][4][4];
+
+   GLuint Kill[4];                        /**< non-zero if lane did KIL */
+   GLuint Consts[SOA_CONST_COUNT][4];     /**< used by the generated code */
+
+   const GLfloat (*Params)[4];            /**< program parameters */
+   const GLfloat (*EnvParams)[4];
+   const GLfloat (*LocalParams)[4];
+
+   /** For instructions which are run by the interpreter, one lane at a time */
+   /*@{*/
+   void (*Interpret)(struct prog_soa_machine *m, GLuint pc);
+   GLcontext *Ctx;
+   const struct gl_program *Program;
+   struct gl_program_machine *Machine;
+   GLuint Element;    /**< fragment span index of lane 0 */
+   GLuint LaneMask;   /**< bitmask of lanes holding real vertices/fragments */
+   /*@}*/
+};
+
+
+extern GLboolean
+_mesa_compile_program_sse(GLcontext *ctx, struct gl_program *prog);
+
+extern GLboolean
+_mesa_program_has_sse_code(const struct gl_program *prog);
+
+extern void
+_mesa_free_program_sse(struct gl_program *prog);
+
+extern struct prog_soa_machine *
+_mesa_new_soa_machine(void);
+
+extern void
+_mesa_free_soa_machine(struct prog_soa_machine *m);
+
+extern void
+_mesa_init_soa_machine(GLcontext *ctx, struct prog_soa_machine *m,
+                       const struct gl_program *prog,
+                       struct gl_program_machine *machine);
+
+extern void
+_mesa_execute_program_sse(struct prog_soa_machine *m);
+
+
+#endif /* PROG_EXECUTE_SSE_H */
@@ -0,0 +1,974 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  7.1
+ *
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file prog_optimize.c
+ * Remove redundant work from the instructions of a vertex or fragment
+ * program.
+ *
+ * The GLSL code generator and the fixed-function program builders copy
+ * values through temporaries and compute channels nobody reads.  Since
+ * the interpreters run every instruction for every vertex or fragment,
+ * these passes pay for themselves quickly:
+ *
+ *  - copy propagation: operands which read the result of a MOV read the
+ *    MOV's source instead, until either register is written again;
+ *  - move coalescing: a MOV of a temporary which isn't used afterwards is
+ *    folded into the instruction which computed the temporary;
+ *  - dead code elimination: writemasks are reduced to the channels that
+ *    are read later, and instructions left with nothing to write go away;
+ *  - temporary compaction: the remaining temporaries are renumbered.
+ *
+ * Only temporaries are optimized; outputs, condition codes and the other
+ * register files keep their values.  Liveness is computed per channel
+ * over the program's control flow.  Subroutine calls and returns make
+ * every temporary live, so no assumptions about callers or callees are
+ * made.  Programs with relative addressing of temporaries are left alone.
+ */
+
+
+#include "main/glheader.h"
+#include "main/context.h"
+#include "main/imports.h"
+#include "main/macros.h"
+#include "prog_instruction.h"
+#include "prog_print.h"
+#include "prog_optimize.h"
+
+
+/** Temporaries per word of a channel set: four channel bits each */
+#define TEMPS_PER_WORD 8
+
+
+/**
+ * State shared by the optimization passes.
+ */
+struct opt_state
+{
+   struct gl_program *prog;
+   GLuint Words;             /**< GLuints per channel set */
+   GLuint *LiveIn;           /**< temp channels live before each inst */
+   GLuint *LiveOut;          /**< temp channels live after each inst */
+   GLboolean *BlockStart;    /**< is the instruction a branch target? */
+   GLboolean *Remove;        /**< has the instruction been deleted? */
+   struct prog_optimize_stats *Stats;
+};
+
+
+static INLINE GLuint
+get_channels(const GLuint *set, GLuint temp)
+{
+   return (set[temp / TEMPS_PER_WORD] >> ((temp % TEMPS_PER_WORD) * 4)) & 0xf;
+}
+
+static INLINE void
+add_channels(GLuint *set, GLuint temp, GLuint mask)
+{
+   set[temp / TEMPS_PER_WORD] |= mask << ((temp % TEMPS_PER_WORD) * 4);
+}
+
+static INLINE void
+remove_channels(GLuint *set, GLuint temp, GLuint mask)
+{
+   set[temp / TEMPS_PER_WORD] &= ~(mask << ((temp % TEMPS_PER_WORD) * 4));
+}
+
+
+static GLboolean
+is_flow_opcode(gl_inst_opcode opcode)
+{
+   switch (opcode) {
+   case OPCODE_BGNLOOP:
+   case OPCODE_BGNSUB:
+   case OPCODE_BRA:
+   case OPCODE_BRK:
+   case OPCODE_CAL:
+   case OPCODE_CONT:
+   case OPCODE_ELSE:
+   case OPCODE_END:
+   case OPCODE_ENDIF:
+   case OPCODE_ENDLOOP:
+   case OPCODE_ENDSUB:
+   case OPCODE_IF:
+   case OPCODE_RET:
+      return GL_TRUE;
+   default:
+      return GL_FALSE;
+   }
+}
+
+
+/**
+ * Does the instruction compute a value into its DstReg?
+ */
+static GLboolean
+has_dst_reg(const struct prog_instruction *inst)
+{
+   switch (inst->Opcode) {
+   case OPCODE_NOP:
+   case OPCODE_KIL:
+   case OPCODE_KIL_NV:
+   case OPCODE_PRINT:
+   case OPCODE_PUSHA:
+   case OPCODE_POPA:
+      return GL_FALSE;
+   default:
+      return !is_flow_opcode(inst->Opcode);
+   }
+}
+
+
+static GLboolean
+writes_temp(const struct prog_instruction *inst)
+{
+   return has_dst_reg(inst) && inst->DstReg.File == PROGRAM_TEMPORARY;
+}
+
+
+static GLuint
+num_src_regs(const struct prog_instruction *inst)
+{
+   if (inst->Opcode == OPCODE_IF)
+      return inst->SrcReg[0].File != PROGRAM_UNDEFINED ? 1 : 0;
+   return _mesa_num_inst_src_regs(inst->Opcode);
+}
+
+
+/**
+ * Which components of source operand 'src', after swizzling, does the
+ * instruction use?
+ */
+static GLuint
+src_lanes(const struct prog_instruction *inst, GLuint src)
+{
+   switch (inst->Opcode) {
+   case OPCODE_ABS:
+   case OPCODE_ADD:
+   case OPCODE_CMP:
+   case OPCODE_FLR:
+   case OPCODE_FRC:
+   case OPCODE_INT:
+   case OPCODE_LRP:
+   case OPCODE_MAD:
+   case OPCODE_MAX:
+   case OPCODE_MIN:
+   case OPCODE_MOV:
+   case OPCODE_MUL:
+   case OPCODE_SEQ:
+   case OPCODE_SGE:
+   case OPCODE_SGT:
+   case OPCODE_SLE:
+   case OPCODE_SLT:
+   case OPCODE_SNE:
+   case OPCODE_SSG:
+   case OPCODE_SUB:
+   case OPCODE_SWZ:
+      /* component-wise */
+      return inst->DstReg.WriteMask;
+   case OPCODE_ARL:
+   case OPCODE_COS:
+   case OPCODE_EX2:
+   case OPCODE_EXP:
+   case OPCODE_IF:
+   case OPCODE_LG2:
+   case OPCODE_LOG:
+   case OPCODE_POW:
+   case OPCODE_RCC:
+   case OPCODE_RCP:
+   case OPCODE_RSQ:
+   case OPCODE_SCS:
+   case OPCODE_SIN:
+      /* scalar */
+      return WRITEMASK_X;
+   case OPCODE_DP3:
+   case OPCODE_XPD:
+      return WRITEMASK_XYZ;
+   case OPCODE_DPH:
+      return src == 0 ? WRITEMASK_XYZ : WRITEMASK_XYZW;
+   default:
+      return WRITEMASK_XYZW;
+   }
+}
+
+
+/**
+ * Which channels of its register does source operand 'src' read?
+ */
+static GLuint
+src_channels(const struct prog_instruction *inst, GLuint src)
+{
+   const GLuint lanes = src_lanes(inst, src);
+   const GLuint swizzle = inst->SrcReg[src].Swizzle;
+   GLuint c, channels = 0x0;
+
+   for (c = 0; c < 4; c++) {
+      if (lanes & (1 << c)) {
+         const GLuint swz = GET_SWZ(swizzle, c);
+         if (swz <= SWIZZLE_W)
+            channels |= 1 << swz;
+      }
+   }
+   return channels;
+}
+
+
+/**
+ * Do the passes know how to handle the program?
+ */
+static GLboolean
+check_program(const struct gl_program *prog)
+{
+   const GLuint n = prog->NumInstructions;
+   GLuint i, j;
+
+   for (i = 0; i < n; i++) {
+      const struct prog_instruction *inst = prog->Instructions + i;
+
+      if (inst->Opcode >= MAX_OPCODE)
+         return GL_FALSE;
+
+      for (j = 0; j < num_src_regs(inst); j++) {
+         if (inst->SrcReg[j].File == PROGRAM_TEMPORARY &&
+             (inst->SrcReg[j].RelAddr ||
+              inst->SrcReg[j].Index < 0 ||
+              inst->SrcReg[j].Index >= MAX_PROGRAM_TEMPS))
+            return GL_FALSE;
+      }
+      if (writes_temp(inst) && inst->DstReg.Index >= MAX_PROGRAM_TEMPS)
+         return GL_FALSE;
+
+      switch (inst->Opcode) {
+      case OPCODE_BRA:
+      case OPCODE_BRK:
+      case OPCODE_CAL:
+      case OPCODE_CONT:
+      case OPCODE_ELSE:
+      case OPCODE_ENDLOOP:
+      case OPCODE_IF:
+         if (inst->BranchTarget < 0 || inst->BranchTarget > (GLint) n)
+            return GL_FALSE;
+         break;
+      default:
+         ;
+      }
+   }
+   return GL_TRUE;
+}
+
+
+/**
+ * Get the instructions which may execute after instruction i, other
+ * than through a subroutine call or return.
+ * \return number of successors
+ */
+static GLuint
+get_successors(const struct gl_program *prog, GLuint i, GLuint succ[2])
+{
+   const struct prog_instruction *inst = prog->Instructions + i;
+   GLuint n = 0;
+
+   switch (inst->Opcode) {
+   case OPCODE_END:
+      return 0;
+   case OPCODE_ELSE:
+   case OPCODE_ENDLOOP:
+      succ[n++] = inst->BranchTarget;
+      return n;
+   case OPCODE_BRA:
+   case OPCODE_BRK:
+   case OPCODE_CONT:
+   case OPCODE_IF:
+      /* the branch may or may not be taken */
+      succ[n++] = inst->BranchTarget;
+      break;
+   default:
+      ;
+   }
+   if (i + 1 < prog->NumInstructions)
+      succ[n++] = i + 1;
+   return n;
+}
+
+
+/**
+ * Compute the temporary channels live before and after each instruction
+ * by iterating the usual backward data flow equations to a fixed point.
+ */
+static void
+compute_liveness(struct opt_state *s)
+{
+   const struct gl_program *prog = s->prog;
+   const GLuint n = prog->NumInstructions, words = s->Words;
+   GLboolean changed;
+   GLuint i, j, w;
+
+   _mesa_bzero(s->LiveIn, n * words * sizeof(GLuint));
+
+   do {
+      changed = GL_FALSE;
+
+      for (i = n; i-- > 0; ) {
+         const struct prog_instruction *inst = prog->Instructions + i;
+         GLuint *in = s->LiveIn + i * words;
+         GLuint *out = s->LiveOut + i * words;
+         GLuint newIn[MAX_PROGRAM_TEMPS / TEMPS_PER_WORD];
+
+         if (inst->Opcode == OPCODE_CAL ||
+             inst->Opcode == OPCODE_RET ||
+             inst->Opcode == OPCODE_ENDSUB) {
+            /* the callee, or the caller, may read anything */
+            for (w = 0; w < words; w++)
+               out[w] = ~0u;
+         }
+         else {
+            GLuint succ[2], numSucc;
+
+            numSucc = get_successors(prog, i, succ);
+            _mesa_bzero(out, words * sizeof(GLuint));
+            for (j = 0; j < numSucc; j++) {
+               const GLuint *succIn;
+               if (succ[j] >= n)
+                  continue;
+               succIn = s->LiveIn + succ[j] * words;
+               for (w = 0; w < words; w++)
+                  out[w] |= succIn[w];
+            }
+         }
+
+         for (w = 0; w < words; w++)
+            newIn[w] = out[w];
+         if (inst->Opcode == OPCODE_CAL) {
+            for (w = 0; w < words; w++)
+               newIn[w] = ~0u;
+         }
+         else {
+            if (writes_temp(inst) && inst->DstReg.CondMask == COND_TR)
+               remove_channels(newIn, inst->DstReg.Index,
+                               inst->DstReg.WriteMask);
+            for (j = 0; j < num_src_regs(inst); j++) {
+               if (inst->SrcReg[j].File == PROGRAM_TEMPORARY)
+                  add_channels(newIn, inst->SrcReg[j].Index,
+                               src_channels(inst, j));
+            }
+         }
+
+         for (w = 0; w < words; w++) {
+            if (newIn[w] != in[w]) {
+               in[w] = newIn[w];
+               changed = GL_TRUE;
+            }
+         }
+      }
+   } while (changed);
+}
+
+
+/**
+ * Mark the instructions which control flow may jump to.  No pass moves
+ * a value across such an instruction.
+ */
+static void
+find_block_starts(struct opt_state *s)
+{
+   const struct gl_program *prog = s->prog;
+   const GLuint n = prog->NumInstructions;
+   GLuint i;
+
+   _mesa_bzero(s->BlockStart, n * sizeof(GLboolean));
+   for (i = 0; i < n; i++) {
+      const struct prog_instruction *inst = prog->Instructions + i;
+      if (is_flow_opcode(inst->Opcode) &&
+          inst->BranchTarget >= 0 && inst->BranchTarget < (GLint) n)
+         s->BlockStart[inst->BranchTarget] = GL_TRUE;
+   }
+}
+
+
+/**
+ * Turn an instruction into a NOP, to be deleted by remove_instructions().
+ */
+static void
+kill_instruction(struct opt_state *s, GLuint i)
+{
+   struct prog_instruction *inst = s->prog->Instructions + i;
+
+   inst->Opcode = OPCODE_NOP;
+   inst->SrcReg[0].File = PROGRAM_UNDEFINED;
+   inst->SrcReg[1].File = PROGRAM_UNDEFINED;
+   inst->SrcReg[2].File = PROGRAM_UNDEFINED;
+   inst->DstReg.File = PROGRAM_UNDEFINED;
+   inst->CondUpdate = GL_FALSE;
+   s->Remove[i] = GL_TRUE;
+}
+
+
+static GLboolean
+is_param_file(enum register_file file)
+{
+   switch (file) {
+   case PROGRAM_LOCAL_PARAM:
+   case PROGRAM_ENV_PARAM:
+   case PROGRAM_STATE_VAR:
+   case PROGRAM_NAMED_PARAM:
+   case PROGRAM_CONSTANT:
+   case PROGRAM_UNIFORM:
+      return GL_TRUE;
+   default:
+      return GL_FALSE;
+   }
+}
+
+
+/**
+ * Can the result of this instruction be propagated to its readers?
+ */
+static GLboolean
+is_copy(const struct prog_instruction *mov)
+{
+   const struct prog_src_register *src = &mov->SrcReg[0];
+   GLuint c;
+
+   if (mov->Opcode != OPCODE_MOV ||
+       mov->DstReg.File != PROGRAM_TEMPORARY ||
+       mov->DstReg.CondMask != COND_TR ||
+       mov->CondUpdate ||
+       mov->SaturateMode != SATURATE_OFF)
+      return GL_FALSE;
+
+   if (src->File != PROGRAM_TEMPORARY &&
+       src->File != PROGRAM_INPUT &&
+       !is_param_file(src->File))
+      return GL_FALSE;
+
+   if (src->RelAddr || src->Abs || src->NegateAbs ||
+       (src->NegateBase != NEGATE_NONE && src->NegateBase != NEGATE_XYZW))
+      return GL_FALSE;
+
+   if (src->File == PROGRAM_TEMPORARY && src->Index == mov->DstReg.Index)
+      return GL_FALSE;
+
+   for (c = 0; c < 4; c++) {
+      if (GET_SWZ(src->Swizzle, c) > SWIZZLE_W)
+         return GL_FALSE;
+   }
+   return GL_TRUE;
+}
+
+
+/**
+ * May operand 'src' of the instruction be replaced by 'copy'?
+ * Besides the operand's own modifiers, this keeps the rule of the ARB
+ * program extensions that an instruction reads at most one program
+ * parameter and one vertex attribute, which some drivers rely on.
+ */
+static GLboolean
+can_substitute(const struct prog_instruction *inst, GLuint src,
+               const struct prog_src_register *copy)
+{
+   const struct prog_src_register *reg = &inst->SrcReg[src];
+   GLuint j;
+
+   /* derivatives are only implemented for inputs */
+   if (inst->Opcode == OPCODE_DDX || inst->Opcode == OPCODE_DDY)
+      return GL_FALSE;
+
+   if (inst->Opcode != OPCODE_SWZ &&
+       reg->NegateBase != NEGATE_NONE && reg->NegateBase != NEGATE_XYZW)
+      return GL_FALSE;
+
+   if (copy->File == PROGRAM_TEMPORARY)
+      return GL_TRUE;
+
+   for (j = 0; j < num_src_regs(inst); j++) {
+      const struct prog_src_register *other = &inst->SrcReg[j];
+      if (j == src)
+         continue;
+      if (copy->File == PROGRAM_INPUT) {
+         if (other->File == PROGRAM_INPUT && other->Index != copy->Index)
+            return GL_FALSE;
+      }
+      else if (is_param_file(other->File)) {
+         if (other->File != copy->File ||
+             other->Index != copy->Index ||
+             other->RelAddr)
+            return GL_FALSE;
+      }
+   }
+   return GL_TRUE;
+}
+
+
+/**
+ * Make the operand read 'copy' (the source of a MOV) instead of the
+ * MOV's destination.
+ */
+static void
+substitute(struct prog_instruction *inst, GLuint src,
+           const struct prog_src_register *copy)
+{
+   struct prog_src_register *reg = &inst->SrcReg[src];
+   GLuint swz[4], c;
+
+   for (c = 0; c < 4; c++) {
+      const GLuint s = GET_SWZ(reg->Swizzle, c);
+      if (s <= SWIZZLE_W) {
+         swz[c] = GET_SWZ(copy->Swizzle, s);
+         /* SWZ negates per component, and its constant 0 and 1
+          * components must keep their sign
+          */
+         if (inst->Opcode == OPCODE_SWZ && copy->NegateBase)
+            reg->NegateBase ^= 1 << c;
+      }
+      else {
+         swz[c] = s;
+      }
+   }
+
+   if (inst->Opcode != OPCODE_SWZ)
+      reg->NegateBase ^= copy->NegateBase;
+   reg->Swizzle = MAKE_SWIZZLE4(swz[0], swz[1], swz[2], swz[3]);
+   reg->File = copy->File;
+   reg->Index = copy->Index;
+}
+
+
+/**
+ * Copy propagation: within a basic block, replace reads of the
+ * destination of a MOV by reads of its source, as long as neither
+ * register has been written since.  The MOVs themselves are left to
+ * dead code elimination.
+ */
+static void
+propagate_copies(struct opt_state *s)
+{
+   struct gl_program *prog = s->prog;
+   const GLuint n = prog->NumInstructions;
+   GLuint i, j, k;
+
+   for (i = 0; i < n; i++) {
+      const struct prog_instruction *mov = prog->Instructions + i;
+      const struct prog_src_register *copy = &mov->SrcReg[0];
+      const GLuint temp = mov->DstReg.Index;
+      GLuint valid;
+
+      if (!is_copy(mov))
+         continue;
+
+      /* channels of 'temp' which still hold the MOV's result */
+      valid = mov->DstReg.WriteMask;
+
+      for (j = i + 1; j < n && valid; j++) {
+         struct prog_instruction *inst = prog->Instructions + j;
+
+         if (s->BlockStart[j] || is_flow_opcode(inst->Opcode))
+            break;
+
+         for (k = 0; k < num_src_regs(inst); k++) {
+            const struct prog_src_register *reg = &inst->SrcReg[k];
+            GLuint channels;
+
+            if (reg->File != PROGRAM_TEMPORARY || reg->Index != (GLint) temp)
+               continue;
+
+            channels = src_channels(inst, k);
+            if (channels && (channels & ~valid) == 0 &&
+                can_substitute(inst, k, copy)) {
+               substitute(inst, k, copy);
+               s->Stats->CopiesPropagated++;
+            }
+         }
+
+         if (has_dst_reg(inst)) {
+            if (inst->DstReg.File == PROGRAM_TEMPORARY &&
+                inst->DstReg.Index == temp)
+               valid &= ~inst->DstReg.WriteMask;
+            if (inst->DstReg.File == copy->File &&
+                inst->DstReg.Index == copy->Index)
+               break;
+         }
+      }
+   }
+}
+
+
+/**
+ * Does the instruction read any of the 'mask' channels of the register?
+ */
+static GLboolean
+reads_channels(const struct prog_instruction *inst,
+               enum register_file file, GLuint index, GLuint mask)
+{
+   GLuint j;
+
+   for (j = 0; j < num_src_regs(inst); j++) {
+      const struct prog_src_register *reg = &inst->SrcReg[j];
+      if (reg->File == file &&
+          (reg->RelAddr || reg->Index == (GLint) index) &&
+          (src_channels(inst, j) & mask))
+         return GL_TRUE;
+   }
+   return GL_FALSE;
+}
+
+
+/**
+ * Fold "MOV dst, temp" into the instruction which computed 'temp', if
+ * 'temp' isn't used again:
+ *
+ *    MUL TEMP[1].xyz, a, b;            MUL OUTPUT[0].xyz, a, b;
+ *    ...                         =>    ...
+ *    MOV OUTPUT[0].xyz, TEMP[1];
+ *
+ * The instructions in between must not touch the moved channels of
+ * either register.
+ */
+static GLboolean
+coalesce_move(struct opt_state *s, GLuint j)
+{
+   struct gl_program *prog = s->prog;
+   struct prog_instruction *mov = prog->Instructions + j;
+   const struct prog_src_register *src = &mov->SrcReg[0];
+   const struct prog_dst_register *dst = &mov->DstReg;
+   const GLuint mask = dst->WriteMask;
+   const GLuint words = s->Words;
+   struct prog_instruction *producer;
+   GLuint temp, extra, c, i;
+
+   if (mov->Opcode != OPCODE_MOV ||
+       mov->CondUpdate ||
+       dst->CondMask != COND_TR ||
+       (dst->File != PROGRAM_TEMPORARY && dst->File != PROGRAM_OUTPUT))
+      return GL_FALSE;
+
+   if (src->File != PROGRAM_TEMPORARY || src->RelAddr ||
+       src->NegateBase || src->Abs || src->NegateAbs)
+      return GL_FALSE;
+
+   temp = src->Index;
+   if (dst->File == PROGRAM_TEMPORARY && dst->Index == temp)
+      return GL_FALSE;
+
+   for (c = 0; c < 4; c++) {
+      if ((mask & (1 << c)) && GET_SWZ(src->Swizzle, c) != c)
+         return GL_FALSE;
+   }
+
+   /* the moved channels of 'temp' must not be read later */
+   if (get_channels(s->LiveOut + j * words, temp) & mask)
+      return GL_FALSE;
+
+   /* find the instruction that computed them, in the same block */
+   producer = NULL;
+   for (i = j; i > 0 && !s->BlockStart[i]; ) {
+      struct prog_instruction *inst = prog->Instructions + --i;
+
+      if (is_flow_opcode(inst->Opcode))
+         return GL_FALSE;
+
+      if (writes_temp(inst) && inst->DstReg.Index == temp &&
+          (inst->DstReg.WriteMask & mask)) {
+         producer = inst;
+         break;
+      }
+
+      if (reads_channels(inst, PROGRAM_TEMPORARY, temp, mask) ||
+          reads_channels(inst, (enum register_file) dst->File,
+                         dst->Index, mask))
+         return GL_FALSE;
+      if (has_dst_reg(inst) && inst->DstReg.File == dst->File &&
+          inst->DstReg.Index == dst->Index &&
+          (inst->DstReg.WriteMask & mask))
+         return GL_FALSE;
+   }
+
+   if (!producer ||
+       producer->DstReg.CondMask != COND_TR ||
+       (producer->DstReg.WriteMask & mask) != mask)
+      return GL_FALSE;
+
+   /* other channels the producer writes to 'temp' are dropped */
+   extra = producer->DstReg.WriteMask & ~mask;
+   if (extra && (producer->CondUpdate ||
+                 (get_channels(s->LiveOut + i * words, temp) & extra)))
+      return GL_FALSE;
+
+   if (mov->SaturateMode != SATURATE_OFF &&
+       mov->SaturateMode != producer->SaturateMode) {
+      if (producer->SaturateMode != SATURATE_OFF || producer->CondUpdate)
+         return GL_FALSE;
+      producer->SaturateMode = mov->SaturateMode;
+   }
+
+   producer->DstReg.File = dst->File;
+   producer->DstReg.Index = dst->Index;
+   producer->DstReg.WriteMask = mask;
+   kill_instruction(s, j);
+   s->Stats->MovesCoalesced++;
+   return GL_TRUE;
+}
+
+
+static void
+coalesce_moves(struct opt_state *s)
+{
+   GLuint j;
+
+   compute_liveness(s);
+   for (j = 0; j < s->prog->NumInstructions; j++) {
+      if (coalesce_move(s, j))
+         compute_liveness(s);
+   }
+}
+
+
+/**
+ * Dead code elimination: narrow the writemasks of instructions to the
+ * channels which are read later, and delete instructions which are left
+ * without any.  Repeated until nothing changes, since each deletion may
+ * make the operands of other instructions unused.
+ */
+static void
+remove_dead_code(struct opt_state *s)
+{
+   struct gl_program *prog = s->prog;
+   GLboolean progress;
+   GLuint i;
+
+   do {
+      progress = GL_FALSE;
+      compute_liveness(s);
+
+      for (i = 0; i < prog->NumInstructions; i++) {
+         struct prog_instruction *inst = prog->Instructions + i;
+         GLuint live;
+
+         /* the condition codes are set from all written channels */
+         if (!writes_temp(inst) || inst->CondUpdate)
+            continue;
+
+         live = get_channels(s->LiveOut + i * s->Words, inst->DstReg.Index);
+         if ((inst->DstReg.WriteMask & live) == 0) {
+            kill_instruction(s, i);
+            s->Stats->DeadRemoved++;
+            progress = GL_TRUE;
+         }
+         else if (inst->DstReg.WriteMask & ~live) {
+            inst->DstReg.WriteMask &= live;
+            s->Stats->WritesNarrowed++;
+            progress = GL_TRUE;
+         }
+      }
+   } while (progress);
+}
+
+
+/**
+ * Delete the instructions marked for removal and fix up branch targets.
+ */
+static void
+remove_instructions(struct opt_state *s)
+{
+   struct gl_program *prog = s->prog;
+   const GLuint n = prog->NumInstructions;
+   GLuint *newIndex;
+   GLuint i, count;
+
+   newIndex = (GLuint *) _mesa_malloc((n + 1) * sizeof(GLuint));
+   if (!newIndex)
+      return;
+
+   /* a target which is deleted becomes the next instruction kept */
+   count = 0;
+   for (i = 0; i < n; i++) {
+      newIndex[i] = count;
+      if (!s->Remove[i])
+         count++;
+   }
+   newIndex[n] = count;
+
+   for (i = 0; i < n; i++) {
+      struct prog_instruction *inst = prog->Instructions + i;
+
+      if (s->Remove[i]) {
+         if (inst->Data)
+            _mesa_free(inst->Data);
+         if (inst->Comment)
+            _mesa_free((char *) inst->Comment);
+         continue;
+      }
+      if (inst->BranchTarget >= 0 && inst->BranchTarget <= (GLint) n)
+         inst->BranchTarget = newIndex[inst->BranchTarget];
+      prog->Instructions[newIndex[i]] = *inst;
+   }
+
+   for (i = 0; i < count; i++)
+      s->Remove[i] = GL_FALSE;
+   prog->NumInstructions = count;
+
+   _mesa_free(newIndex);
+}
+
+
+/**
+ * Renumber the temporaries still in use to 0..n-1.
+ */
+static void
+compact_temporaries(struct gl_program *prog)
+{
+   GLint map[MAX_PROGRAM_TEMPS];
+   GLuint i, j, count;
+
+   for (i = 0; i < MAX_PROGRAM_TEMPS; i++)
+      map[i] = -1;
+
+   for (i = 0; i < prog->NumInstructions; i++) {
+      const struct prog_instruction *inst = prog->Instructions + i;
+      for (j = 0; j < num_src_regs(inst); j++) {
+         if (inst->SrcReg[j].File == PROGRAM_TEMPORARY)
+            map[inst->SrcReg[j].Index] = 0;
+      }
+      if (writes_temp(inst))
+         map[inst->DstReg.Index] = 0;
+   }
+
+   count = 0;
+   for (i = 0; i < MAX_PROGRAM_TEMPS; i++) {
+      if (map[i] == 0)
+         map[i] = count++;
+   }
+
+   for (i = 0; i < prog->NumInstructions; i++) {
+      struct prog_instruction *inst = prog->Instructions + i;
+      for (j = 0; j < num_src_regs(inst); j++) {
+         if (inst->SrcReg[j].File == PROGRAM_TEMPORARY)
+            inst->SrcReg[j].Index = map[inst->SrcReg[j].Index];
+      }
+      if (writes_temp(inst))
+         inst->DstReg.Index = map[inst->DstReg.Index];
+   }
+
+   prog->NumTemporaries = count;
+}
+
+
+/**
+ * Count the temporaries which the program's instructions use.
+ */
+static GLuint
+count_temporaries(const struct gl_program *prog)
+{
+   GLuint i, j, numTemps = 0;
+
+   for (i = 0; i < prog->NumInstructions; i++) {
+      const struct prog_instruction *inst = prog->Instructions + i;
+      for (j = 0; j < num_src_regs(inst); j++) {
+         if (inst->SrcReg[j].File == PROGRAM_TEMPORARY)
+            numTemps = MAX2(numTemps, (GLuint) inst->SrcReg[j].Index + 1);
+      }
+      if (writes_temp(inst))
+         numTemps = MAX2(numTemps, inst->DstReg.Index + 1);
+   }
+   return numTemps;
+}
+
+
+/**
+ * Run all the optimization passes on the program.
+ * \param stats  returns what was done
+ * \return GL_FALSE if the program was left unchanged because the passes
+ *         can't handle it, or memory ran out
+ */
+GLboolean
+_mesa_optimize_program_stats(struct gl_program *prog,
+                             struct prog_optimize_stats *stats)
+{
+   struct opt_state s;
+   GLuint n = prog->NumInstructions;
+
+   _mesa_bzero(stats, sizeof(*stats));
+   stats->InstructionsBefore = stats->InstructionsAfter = n;
+   stats->TemporariesBefore = stats->TemporariesAfter = prog->NumTemporaries;
+
+   if (n == 0 || !check_program(prog))
+      return GL_FALSE;
+
+   s.prog = prog;
+   s.Stats = stats;
+   s.Words = (count_temporaries(prog) + TEMPS_PER_WORD - 1) / TEMPS_PER_WORD;
+   if (s.Words == 0)
+      s.Words = 1;
+   s.LiveIn = (GLuint *) _mesa_malloc(n * s.Words * sizeof(GLuint));
+   s.LiveOut = (GLuint *) _mesa_malloc(n * s.Words * sizeof(GLuint));
+   s.BlockStart = (GLboolean *) _mesa_malloc(n * sizeof(GLboolean));
+   s.Remove = (GLboolean *) _mesa_calloc(n * sizeof(GLboolean));
+
+   if (s.LiveIn && s.LiveOut && s.BlockStart && s.Remove) {
+      find_block_starts(&s);
+      propagate_copies(&s);
+      remove_dead_code(&s);
+      coalesce_moves(&s);
+      remove_dead_code(&s);
+      remove_instructions(&s);
+      compact_temporaries(prog);
+   }
+
+   if (s.LiveIn)
+      _mesa_free(s.LiveIn);
+   if (s.LiveOut)
+      _mesa_free(s.LiveOut);
+   if (s.BlockStart)
+      _mesa_free(s.BlockStart);
+   if (s.Remove)
+      _mesa_free(s.Remove);
+
+   stats->InstructionsAfter = prog->NumInstructions;
+   stats->TemporariesAfter = prog->NumTemporaries;
+   return prog->NumInstructions != n || stats->WritesNarrowed ||
+          stats->CopiesPropagated;
+}
+
+
+/**
+ * Optimize a program after code generation, unless disabled with
+ * MESA_PROGRAM_OPT=0.  With MESA_PROGRAM_OPT=stats, the instruction and
+ * temporary counts before and after are printed.
+ * \return GL_TRUE if the program was changed
+ */
+GLboolean
+_mesa_optimize_program(struct gl_program *prog)
+{
+   const char *env = _mesa_getenv("MESA_PROGRAM_OPT");
+   struct prog_optimize_stats stats;
+   GLboolean changed;
+
+   if (env && _mesa_strcmp(env, "0") == 0)
+      return GL_FALSE;
+
+   changed = _mesa_optimize_program_stats(prog, &stats);
+
+   if (env && _mesa_strcmp(env, "stats") == 0)
+      _mesa_print_optimize_stats(prog, &stats);
+
+   return changed;
+}
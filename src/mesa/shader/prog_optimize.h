@@ -0,0 +1,55 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  7.1
+ *
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef PROG_OPTIMIZE_H
+#define PROG_OPTIMIZE_H
+
+
+#include "main/mtypes.h"
+
+
+/**
+ * What _mesa_optimize_program() did to a program.
+ */
+struct prog_optimize_stats
+{
+   GLuint InstructionsBefore, InstructionsAfter;
+   GLuint TemporariesBefore, TemporariesAfter;
+   GLuint CopiesPropagated;   /**< source operands replaced by a MOV's src */
+   GLuint MovesCoalesced;     /**< MOVs folded into the computing inst */
+   GLuint DeadRemoved;        /**< instructions whose result was unused */
+   GLuint WritesNarrowed;     /**< writemasks reduced to the used channels */
+};
+
+
+extern GLboolean
+_mesa_optimize_program(struct gl_program *prog);
+
+extern GLboolean
+_mesa_optimize_program_stats(struct gl_program *prog,
+                             struct prog_optimize_stats *stats);
+
+
+#endif /* PROG_OPTIMIZE_H */
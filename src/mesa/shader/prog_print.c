@@ -32,6 +32,7 @@
 #include "context.h"
 #include "imports.h"
 #include "prog_instruction.h"
+#include "prog_optimize.h"
 #include "prog_parameter.h"
 #include "prog_print.h"
 #include "prog_statevars.h"
@@ -756,3 +757,24 @@ _mesa_print_parameter_list(const struct gl_program_parameter_list *list)
                    param->Name, v[0], v[1], v[2], v[3]);
    }
 }
+
+
+/**
+ * Print what _mesa_optimize_program() did to a program.
+ */
+void
+_mesa_print_optimize_stats(const struct gl_program *prog,
+                           const struct prog_optimize_stats *stats)
+{
+   const char *kind = (prog->Target == GL_VERTEX_PROGRAM_ARB)
+      ? "vertex" : "fragment";
+
+   _mesa_printf("Optimized %s program %u: %u -> %u instructions, "
+                "%u -> %u temporaries\n", kind, prog->Id,
+                stats->InstructionsBefore, stats->InstructionsAfter,
+                stats->TemporariesBefore, stats->TemporariesAfter);
+   _mesa_printf("  %u copies propagated, %u moves coalesced, "
+                "%u dead instructions, %u writemasks narrowed\n",
+                stats->CopiesPropagated, stats->MovesCoalesced,
+                stats->DeadRemoved, stats->WritesNarrowed);
+}
@@ -68,5 +68,11 @@ _mesa_print_program_parameters(GLcontext *ctx, const struct gl_program *prog);
 extern void
 _mesa_print_parameter_list(const struct gl_program_parameter_list *list);
 
+struct prog_optimize_stats;
+
+extern void
+_mesa_print_optimize_stats(const struct gl_program *prog,
+                           const struct prog_optimize_stats *stats);
+
 
 #endif /* PROG_PRINT_H */
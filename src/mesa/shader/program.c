@@ -33,6 +33,8 @@
 #include "context.h"
 #include "hash.h"
 #include "program.h"
+#include "prog_cache.h"
+#include "prog_execute_sse.h"
 #include "prog_parameter.h"
 #include "prog_instruction.h"
 
@@ -75,6 +77,14 @@ _mesa_init_program(GLcontext *ctx)
    ctx->FragmentProgram.Current->Base.RefCount++;
 #endif
 
+   /* programs generated from fixed-function state */
+   ctx->VertexProgram.Cache =
+      _mesa_new_program_cache("fixed-function vertex program cache",
+                              PROGRAM_CACHE_MAX_ITEMS);
+   ctx->FragmentProgram.Cache =
+      _mesa_new_program_cache("texenv fragment program cache",
+                              PROGRAM_CACHE_MAX_ITEMS);
+
    /* XXX probably move this stuff */
 #if FEATURE_ATI_fragment_shader
    ctx->ATIFragmentShader.Enabled = GL_FALSE;
@@ -105,6 +115,15 @@ _mesa_free_program_data(GLcontext *ctx)
          ctx->Driver.DeleteProgram(ctx, &(ctx->FragmentProgram.Current->Base));
    }
 #endif
+   /* programs generated from fixed-function state */
+   if (ctx->VertexProgram._TnlProgram)
+      _mesa_program_cache_release(ctx, ctx->VertexProgram.Cache,
+                                  &ctx->VertexProgram._TnlProgram->Base);
+   if (ctx->FragmentProgram._TexEnvProgram)
+      _mesa_program_cache_release(ctx, ctx->FragmentProgram.Cache,
+                                  &ctx->FragmentProgram._TexEnvProgram->Base);
+   _mesa_delete_program_cache(ctx, ctx->VertexProgram.Cache);
+   _mesa_delete_program_cache(ctx, ctx->FragmentProgram.Cache);
    /* XXX probably move this stuff */
 #if FEATURE_ATI_fragment_shader
    if (ctx->ATIFragmentShader.Current) {
@@ -319,6 +338,8 @@ _mesa_delete_program(GLcontext *ctx, struct gl_program *prog)
    if (prog->String)
       _mesa_free(prog->String);
 
+   _mesa_free_program_sse(prog);
+
    if (prog->Instructions) {
       GLuint i;
       for (i = 0; i < prog->NumInstructions; i++) {
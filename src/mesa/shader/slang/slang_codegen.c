@@ -238,8 +238,20 @@ _slang_attach_storage(slang_ir_node *n, slang_variable *var)
    if (!n->Store) {
       /* need to setup storage */
       if (n->Var && n->Var->aux) {
-         /* node storage info = var storage info */
-         n->Store = (slang_ir_storage *) n->Var->aux;
+         const slang_ir_storage *store = (slang_ir_storage *) n->Var->aux;
+         if (store->File == PROGRAM_STATE_VAR) {
+            /* A pre-defined uniform of the shared built-in library.
+             * Its parameter is allocated per program, so that has to be
+             * done in a private copy of the storage info.
+             */
+            n->Store = _slang_new_ir_storage(store->File, store->Index,
+                                             store->Size);
+            n->Store->Swizzle = store->Swizzle;
+         }
+         else {
+            /* node storage info = var storage info */
+            n->Store = (slang_ir_storage *) n->Var->aux;
+         }
       }
       else {
          /* alloc new storage info */
@@ -1169,6 +1181,24 @@ slang_inline_function_call(slang_assemble_ctx * A, slang_function *fun,
       }
    }
 
+   /* The copied code still looks up the function's parameters and its
+    * top-level locals in the function's own scope.  Give this instance
+    * its own copies of the ones that were not substituted, so that code
+    * generation never modifies the function (which may belong to the
+    * shared built-in library).
+    */
+   for (i = 0; i < fun->parameters->num_variables; i++) {
+      if (i >= totalArgs || paramMode[i] != SUBST) {
+         slang_variable *p = slang_variable_scope_grow(inlined->locals);
+         if (!p || !slang_variable_copy(p, fun->parameters->variables[i])) {
+            slang_info_log_memory(A->log);
+            break;
+         }
+      }
+   }
+   inlined->locals->outer_scope = fun->parameters->outer_scope;
+   slang_replace_scope(top, fun->parameters, inlined->locals);
+
    _slang_free(paramMode);
    _slang_free(substOld);
    _slang_free(substNew);
@@ -30,8 +30,10 @@
 
 #include "main/imports.h"
 #include "main/context.h"
+#include "glapi/glthread.h"
 #include "shader/program.h"
 #include "shader/prog_parameter.h"
+#include "shader/prog_diskcache.h"
 #include "shader/grammar/grammar_mesa.h"
 #include "slang_codegen.h"
 #include "slang_compile.h"
@@ -72,13 +74,14 @@ slang_var_pool_alloc(slang_var_pool * pool, unsigned int size)
  */
 
 GLvoid
-_slang_code_unit_ctr(slang_code_unit * self,
-                     struct slang_code_object_ * object)
+_slang_code_unit_ctr(slang_code_unit * self, slang_atom_pool * atoms,
+                     slang_var_pool * varpool)
 {
    _slang_variable_scope_ctr(&self->vars);
    _slang_function_scope_ctr(&self->funs);
    _slang_struct_scope_ctr(&self->structs);
-   self->object = object;
+   self->atoms = atoms;
+   self->varpool = varpool;
 }
 
 GLvoid
@@ -96,11 +99,7 @@ _slang_code_unit_dtr(slang_code_unit * self)
 GLvoid
 _slang_code_object_ctr(slang_code_object * self)
 {
-   GLuint i;
-
-   for (i = 0; i < SLANG_BUILTIN_TOTAL; i++)
-      _slang_code_unit_ctr(&self->builtin[i], self);
-   _slang_code_unit_ctr(&self->unit, self);
+   _slang_code_unit_ctr(&self->unit, &self->atompool, &self->varpool);
    self->varpool.next_addr = 0;
    slang_atom_pool_construct(&self->atompool);
 }
@@ -108,10 +107,6 @@ _slang_code_object_ctr(slang_code_object * self)
 GLvoid
 _slang_code_object_dtr(slang_code_object * self)
 {
-   GLuint i;
-
-   for (i = 0; i < SLANG_BUILTIN_TOTAL; i++)
-      _slang_code_unit_dtr(&self->builtin[i]);
    _slang_code_unit_dtr(&self->unit);
    slang_atom_pool_destruct(&self->atompool);
 }
@@ -1833,7 +1828,7 @@ parse_code_unit(slang_parse_ctx * C, slang_code_unit * unit,
    o.funs = &unit->funs;
    o.structs = &unit->structs;
    o.vars = &unit->vars;
-   o.global_pool = &unit->object->varpool;
+   o.global_pool = unit->varpool;
    o.program = program;
    o.vartable = _slang_new_var_table(maxRegs);
    _slang_push_var_table(o.vartable);
@@ -1871,7 +1866,8 @@ parse_code_unit(slang_parse_ctx * C, slang_code_unit * unit,
 static GLboolean
 compile_binary(const byte * prod, slang_code_unit * unit,
                slang_unit_type type, slang_info_log * infolog,
-               slang_code_unit * builtin, slang_code_unit * downlink,
+               const slang_code_unit * builtin,
+               const slang_code_unit * downlink,
                struct gl_program *program)
 {
    slang_parse_ctx C;
@@ -1883,16 +1879,17 @@ compile_binary(const byte * prod, slang_code_unit * unit,
    C.L = infolog;
    C.parsing_builtin = (builtin == NULL);
    C.global_scope = GL_TRUE;
-   C.atoms = &unit->object->atompool;
+   C.atoms = unit->atoms;
    C.type = type;
 
    if (!check_revision(&C))
       return GL_FALSE;
 
+   /* The scopes of the downlink are only ever searched, never changed. */
    if (downlink != NULL) {
-      unit->vars.outer_scope = &downlink->vars;
-      unit->funs.outer_scope = &downlink->funs;
-      unit->structs.outer_scope = &downlink->structs;
+      unit->vars.outer_scope = (slang_variable_scope *) &downlink->vars;
+      unit->funs.outer_scope = (slang_function_scope *) &downlink->funs;
+      unit->structs.outer_scope = (slang_struct_scope *) &downlink->structs;
    }
 
    /* parse translation unit */
@@ -1902,7 +1899,7 @@ compile_binary(const byte * prod, slang_code_unit * unit,
 static GLboolean
 compile_with_grammar(grammar id, const char *source, slang_code_unit * unit,
                      slang_unit_type type, slang_info_log * infolog,
-                     slang_code_unit * builtin,
+                     const slang_code_unit * builtin,
                      struct gl_program *program)
 {
    byte *prod;
@@ -1961,8 +1958,7 @@ compile_with_grammar(grammar id, const char *source, slang_code_unit * unit,
    slang_string_free(&preprocessed);
 
    /* Syntax is okay - translate it to internal representation. */
-   if (!compile_binary(prod, unit, type, infolog, builtin,
-                       &builtin[SLANG_BUILTIN_TOTAL - 1],
+   if (!compile_binary(prod, unit, type, infolog, builtin, builtin,
                        program)) {
       grammar_alloc_free(prod);
       return GL_FALSE;
@@ -1999,12 +1995,183 @@ static const byte slang_vertex_builtin_gc[] = {
 #include "library/slang_vertex_builtin_gc.h"
 };
 
+/**
+ * The built-in library, shared by all contexts.  It is built by the
+ * first compile that needs it and lives until the process exits.
+ */
+static slang_builtin_library *BuiltinLibrary = NULL;
+_glthread_DECLARE_STATIC_MUTEX(BuiltinLibraryMutex);
+
+
+static GLboolean
+compile_builtin_library(slang_builtin_library * lib, slang_info_log * infolog)
+{
+   slang_code_unit *units = lib->units;
+
+   /* compile core functionality first */
+   if (!compile_binary(slang_core_gc,
+                       &units[SLANG_BUILTIN_CORE],
+                       SLANG_UNIT_FRAGMENT_BUILTIN, infolog,
+                       NULL, NULL, NULL))
+      return GL_FALSE;
+
+#if FEATURE_ARB_shading_language_120
+   if (!compile_binary(slang_120_core_gc,
+                       &units[SLANG_BUILTIN_120_CORE],
+                       SLANG_UNIT_FRAGMENT_BUILTIN, infolog,
+                       NULL, &units[SLANG_BUILTIN_CORE], NULL))
+      return GL_FALSE;
+#endif
+
+   /* compile common functions and variables, link to core */
+   if (!compile_binary(slang_common_builtin_gc,
+                       &units[SLANG_BUILTIN_COMMON],
+                       SLANG_UNIT_FRAGMENT_BUILTIN, infolog, NULL,
+#if FEATURE_ARB_shading_language_120
+                       &units[SLANG_BUILTIN_120_CORE],
+#else
+                       &units[SLANG_BUILTIN_CORE],
+#endif
+                       NULL))
+      return GL_FALSE;
+
+   /* compile target-specific functions and variables, link to common */
+   if (!compile_binary(slang_fragment_builtin_gc,
+                       &units[SLANG_BUILTIN_FRAGMENT],
+                       SLANG_UNIT_FRAGMENT_BUILTIN, infolog, NULL,
+                       &units[SLANG_BUILTIN_COMMON], NULL))
+      return GL_FALSE;
+#if FEATURE_ARB_shading_language_120
+   if (!compile_binary(slang_120_fragment_gc,
+                       &units[SLANG_BUILTIN_FRAGMENT],
+                       SLANG_UNIT_FRAGMENT_BUILTIN, infolog, NULL,
+                       &units[SLANG_BUILTIN_COMMON], NULL))
+      return GL_FALSE;
+#endif
+
+   if (!compile_binary(slang_vertex_builtin_gc,
+                       &units[SLANG_BUILTIN_VERTEX],
+                       SLANG_UNIT_VERTEX_BUILTIN, infolog, NULL,
+                       &units[SLANG_BUILTIN_COMMON], NULL))
+      return GL_FALSE;
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Allocate and compile a built-in library in the current memory pool.
+ */
+static slang_builtin_library *
+new_builtin_library(GLcontext *ctx, slang_info_log * infolog)
+{
+   slang_builtin_library *lib;
+   GLuint i;
+
+   lib = (slang_builtin_library *) _mesa_calloc(sizeof(*lib));
+   if (!lib) {
+      slang_info_log_memory(infolog);
+      return NULL;
+   }
+
+   lib->Const = ctx->Const;
+   slang_atom_pool_construct(&lib->atompool);
+   lib->varpool.next_addr = 0;
+   for (i = 0; i < SLANG_BUILTIN_TOTAL; i++)
+      _slang_code_unit_ctr(&lib->units[i], &lib->atompool, &lib->varpool);
+
+   if (!compile_builtin_library(lib, infolog)) {
+      for (i = 0; i < SLANG_BUILTIN_TOTAL; i++)
+         _slang_code_unit_dtr(&lib->units[i]);
+      slang_atom_pool_destruct(&lib->atompool);
+      _mesa_free(lib);
+      return NULL;
+   }
+   return lib;
+}
+
+
+static void
+delete_builtin_library(slang_builtin_library * lib)
+{
+   GLuint i;
+
+   for (i = 0; i < SLANG_BUILTIN_TOTAL; i++)
+      _slang_code_unit_dtr(&lib->units[i]);
+   slang_atom_pool_destruct(&lib->atompool);
+   _mesa_free(lib);
+}
+
+
+/**
+ * Return the shared built-in library, compiling it on first use.
+ * Everything the library allocates goes to its own memory pool, not to
+ * the pool of the shader being compiled, so that it outlives the shader.
+ *
+ * Array sizes such as gl_MaxLights are taken from the implementation
+ * limits while the library is compiled.  A context whose limits differ
+ * from those of the shared library gets a private library instead, which
+ * is allocated in the shader's pool and which the caller must delete.
+ *
+ * \param isPrivate  returns whether the library is private
+ * \return NULL if the library could not be compiled
+ */
+static slang_builtin_library *
+get_builtin_library(GLcontext *ctx, slang_info_log * infolog,
+                    GLboolean *isPrivate)
+{
+   slang_builtin_library *lib;
+
+   *isPrivate = GL_FALSE;
+
+   _glthread_LOCK_MUTEX(BuiltinLibraryMutex);
+
+   if (!BuiltinLibrary) {
+      void *shaderPool = ctx->Shader.MemPool;
+      struct slang_mempool_ *pool = _slang_new_mempool(512 * 1024);
+
+      if (pool) {
+         ctx->Shader.MemPool = pool;
+         BuiltinLibrary = new_builtin_library(ctx, infolog);
+         ctx->Shader.MemPool = shaderPool;
+         if (BuiltinLibrary)
+            BuiltinLibrary->mempool = pool;
+         else
+            _slang_delete_mempool(pool);
+      }
+      else {
+         slang_info_log_memory(infolog);
+      }
+      lib = BuiltinLibrary;
+   }
+   else if (_mesa_memcmp(&BuiltinLibrary->Const, &ctx->Const,
+                         sizeof(ctx->Const)) == 0) {
+      lib = BuiltinLibrary;
+   }
+   else {
+      lib = NULL;
+      *isPrivate = GL_TRUE;
+   }
+
+   _glthread_UNLOCK_MUTEX(BuiltinLibraryMutex);
+
+   if (*isPrivate)
+      lib = new_builtin_library(ctx, infolog);
+
+   return lib;
+}
+
+
 static GLboolean
 compile_object(grammar * id, const char *source, slang_code_object * object,
                slang_unit_type type, slang_info_log * infolog,
                struct gl_program *program)
 {
-   slang_code_unit *builtins = NULL;
+   GET_CURRENT_CONTEXT(ctx);
+   slang_builtin_library *lib = NULL;
+   const slang_code_unit *builtin = NULL;
+   GLboolean isPrivate = GL_FALSE;
+   GLboolean success;
 
    /* load GLSL grammar */
    *id = grammar_load_from_text((const byte *) (slang_shader_syn));
@@ -2027,57 +2194,20 @@ compile_object(grammar * id, const char *source, slang_code_object * object,
    /* enable language extensions */
    grammar_set_reg8(*id, (const byte *) "parsing_builtin", 1);
 
-   /* if parsing user-specified shader, load built-in library */
+   /* if parsing user-specified shader, link to the built-in library */
    if (type == SLANG_UNIT_FRAGMENT_SHADER || type == SLANG_UNIT_VERTEX_SHADER) {
-      /* compile core functionality first */
-      if (!compile_binary(slang_core_gc,
-                          &object->builtin[SLANG_BUILTIN_CORE],
-                          SLANG_UNIT_FRAGMENT_BUILTIN, infolog,
-                          NULL, NULL, NULL))
+      lib = get_builtin_library(ctx, infolog, &isPrivate);
+      if (!lib)
          return GL_FALSE;
 
-#if FEATURE_ARB_shading_language_120
-      if (!compile_binary(slang_120_core_gc,
-                          &object->builtin[SLANG_BUILTIN_120_CORE],
-                          SLANG_UNIT_FRAGMENT_BUILTIN, infolog,
-                          NULL, &object->builtin[SLANG_BUILTIN_CORE], NULL))
-         return GL_FALSE;
-#endif
-
-      /* compile common functions and variables, link to core */
-      if (!compile_binary(slang_common_builtin_gc,
-                          &object->builtin[SLANG_BUILTIN_COMMON],
-                          SLANG_UNIT_FRAGMENT_BUILTIN, infolog, NULL,
-#if FEATURE_ARB_shading_language_120
-                          &object->builtin[SLANG_BUILTIN_120_CORE],
-#else
-                          &object->builtin[SLANG_BUILTIN_CORE],
-#endif
-                          NULL))
-         return GL_FALSE;
+      if (type == SLANG_UNIT_FRAGMENT_SHADER)
+         builtin = &lib->units[SLANG_BUILTIN_FRAGMENT];
+      else
+         builtin = &lib->units[SLANG_BUILTIN_VERTEX];
 
-      /* compile target-specific functions and variables, link to common */
-      if (type == SLANG_UNIT_FRAGMENT_SHADER) {
-         if (!compile_binary(slang_fragment_builtin_gc,
-                             &object->builtin[SLANG_BUILTIN_TARGET],
-                             SLANG_UNIT_FRAGMENT_BUILTIN, infolog, NULL,
-                             &object->builtin[SLANG_BUILTIN_COMMON], NULL))
-            return GL_FALSE;
-#if FEATURE_ARB_shading_language_120
-         if (!compile_binary(slang_120_fragment_gc,
-                             &object->builtin[SLANG_BUILTIN_TARGET],
-                             SLANG_UNIT_FRAGMENT_BUILTIN, infolog, NULL,
-                             &object->builtin[SLANG_BUILTIN_COMMON], NULL))
-            return GL_FALSE;
-#endif
-      }
-      else if (type == SLANG_UNIT_VERTEX_SHADER) {
-         if (!compile_binary(slang_vertex_builtin_gc,
-                             &object->builtin[SLANG_BUILTIN_TARGET],
-                             SLANG_UNIT_VERTEX_BUILTIN, infolog, NULL,
-                             &object->builtin[SLANG_BUILTIN_COMMON], NULL))
-            return GL_FALSE;
-      }
+      /* names already known to the library resolve to the library's atoms */
+      object->atompool.outer_pool = &lib->atompool;
+      object->varpool.next_addr = lib->varpool.next_addr;
 
       /* disable language extensions */
 #if NEW_SLANG /* allow-built-ins */
@@ -2085,12 +2215,16 @@ compile_object(grammar * id, const char *source, slang_code_object * object,
 #else
       grammar_set_reg8(*id, (const byte *) "parsing_builtin", 0);
 #endif
-      builtins = object->builtin;
    }
 
    /* compile the actual shader - pass-in built-in library for external shader */
-   return compile_with_grammar(*id, source, &object->unit, type, infolog,
-                               builtins, program);
+   success = compile_with_grammar(*id, source, &object->unit, type, infolog,
+                                  builtin, program);
+
+   if (isPrivate)
+      delete_builtin_library(lib);
+
+   return success;
 }
 
 
@@ -2119,6 +2253,19 @@ compile_shader(GLcontext *ctx, slang_code_object * object,
 
 
 
+/**
+ * Get the code generator options, which are part of the key for the
+ * shader's on-disk cache entry along with ctx->Const.
+ */
+static void
+get_codegen_options(const GLcontext *ctx, GLboolean options[3])
+{
+   options[0] = ctx->Shader.EmitHighLevelInstructions;
+   options[1] = ctx->Shader.EmitCondCodes;
+   options[2] = ctx->Shader.EmitComments;
+}
+
+
 GLboolean
 _slang_compile(GLcontext *ctx, struct gl_shader *shader)
 {
@@ -2126,6 +2273,8 @@ _slang_compile(GLcontext *ctx, struct gl_shader *shader)
    slang_info_log info_log;
    slang_code_object obj;
    slang_unit_type type;
+   GLboolean options[3];
+   GLchar *cachedLog = NULL;
 
    if (shader->Type == GL_VERTEX_SHADER) {
       type = SLANG_UNIT_VERTEX_SHADER;
@@ -2135,8 +2284,6 @@ _slang_compile(GLcontext *ctx, struct gl_shader *shader)
       type = SLANG_UNIT_FRAGMENT_SHADER;
    }
 
-   ctx->Shader.MemPool = _slang_new_mempool(1024*1024);
-
    /* XXX temporary hack */
    if (!shader->Programs) {
       GLenum progTarget;
@@ -2154,6 +2301,21 @@ _slang_compile(GLcontext *ctx, struct gl_shader *shader)
       shader->Programs[0]->Attributes = _mesa_new_parameter_list();
    }
 
+   /* skip the compiler if the result is in the on-disk cache */
+   get_codegen_options(ctx, options);
+   if (_mesa_load_cached_program(ctx, shader->Type,
+                                 (const GLubyte *) shader->Source,
+                                 _mesa_strlen(shader->Source),
+                                 options, sizeof(options),
+                                 shader->Programs[0], &cachedLog)) {
+      if (shader->InfoLog)
+         _mesa_free(shader->InfoLog);
+      shader->InfoLog = cachedLog;
+      return GL_TRUE;
+   }
+
+   ctx->Shader.MemPool = _slang_new_mempool(1024*1024);
+
    slang_info_log_construct(&info_log);
    _slang_code_object_ctr(&obj);
 
@@ -2174,6 +2336,14 @@ _slang_compile(GLcontext *ctx, struct gl_shader *shader)
       success = GL_FALSE;
    }
 
+   if (success) {
+      _mesa_store_cached_program(ctx, shader->Type,
+                                 (const GLubyte *) shader->Source,
+                                 _mesa_strlen(shader->Source),
+                                 options, sizeof(options),
+                                 shader->Programs[0], shader->InfoLog);
+   }
+
    slang_info_log_destruct(&info_log);
    _slang_code_object_dtr(&obj);
 
@@ -58,12 +58,13 @@ typedef struct slang_code_unit_
    slang_function_scope funs;
    slang_struct_scope structs;
    slang_unit_type type;
-   struct slang_code_object_ *object;
+   slang_atom_pool *atoms;      /**< where the unit's names are interned */
+   slang_var_pool *varpool;     /**< where the unit's globals are placed */
 } slang_code_unit;
 
 
 extern GLvoid
-_slang_code_unit_ctr (slang_code_unit *, struct slang_code_object_ *);
+_slang_code_unit_ctr (slang_code_unit *, slang_atom_pool *, slang_var_pool *);
 
 extern GLvoid
 _slang_code_unit_dtr (slang_code_unit *);
@@ -71,16 +72,30 @@ _slang_code_unit_dtr (slang_code_unit *);
 #define SLANG_BUILTIN_CORE   0
 #define SLANG_BUILTIN_120_CORE   1
 #define SLANG_BUILTIN_COMMON 2
-#define SLANG_BUILTIN_TARGET 3
+#define SLANG_BUILTIN_FRAGMENT 3
+#define SLANG_BUILTIN_VERTEX 4
 
-#define SLANG_BUILTIN_TOTAL  4
+#define SLANG_BUILTIN_TOTAL  5
+
+/**
+ * The built-in library: the units of both shader targets, compiled once
+ * and then shared, read-only, by all shaders of all contexts that have
+ * the same implementation limits.
+ */
+typedef struct slang_builtin_library_
+{
+   slang_code_unit units[SLANG_BUILTIN_TOTAL];
+   slang_var_pool varpool;
+   slang_atom_pool atompool;
+   struct gl_constants Const;       /**< limits the library was compiled for */
+   struct slang_mempool_ *mempool;  /**< holds everything of the library */
+} slang_builtin_library;
 
 typedef struct slang_code_object_
 {
-   slang_code_unit builtin[SLANG_BUILTIN_TOTAL];
    slang_code_unit unit;
    slang_var_pool varpool;
-   slang_atom_pool atompool;
+   slang_atom_pool atompool;    /**< outer pool is the library's */
 } slang_code_object;
 
 extern GLvoid
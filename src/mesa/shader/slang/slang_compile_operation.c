@@ -69,8 +69,37 @@ slang_operation_destruct(slang_operation * oper)
    oper->locals = NULL;
 }
 
+/**
+ * Make the operations in the tree rooted at \c oper that look up their
+ * variables in \c oldScope use \c newScope instead.  The initializers
+ * of the variables declared in the tree are updated too.
+ */
+void
+slang_replace_scope(slang_operation *oper,
+                    slang_variable_scope *oldScope,
+                    slang_variable_scope *newScope)
+{
+   GLuint i;
+
+   if (oper->locals != newScope &&
+       oper->locals->outer_scope == oldScope)
+      oper->locals->outer_scope = newScope;
+
+   for (i = 0; i < oper->locals->num_variables; i++) {
+      slang_variable *var = oper->locals->variables[i];
+      if (var->initializer)
+         slang_replace_scope(var->initializer, oldScope, newScope);
+   }
+
+   for (i = 0; i < oper->num_children; i++)
+      slang_replace_scope(&oper->children[i], oldScope, newScope);
+}
+
 /**
  * Recursively copy a slang_operation node.
+ * The variables that \c y declares are copied as well, and the copied
+ * children look them up in the copy, so code that refers to them can
+ * be generated without touching the original tree.
  * \return GL_TRUE for success, GL_FALSE if failure
  */
 GLboolean
@@ -114,6 +143,7 @@ slang_operation_copy(slang_operation * x, const slang_operation * y)
          slang_operation_destruct(&z);
          return GL_FALSE;
       }
+      slang_replace_scope(&z, y->locals, z.locals);
    }
 #if 0
    z.var = y->var;
@@ -34,6 +34,7 @@
 #include "main/macros.h"
 #include "shader/program.h"
 #include "shader/prog_instruction.h"
+#include "shader/prog_optimize.h"
 #include "shader/prog_parameter.h"
 #include "shader/prog_print.h"
 #include "shader/prog_statevars.h"
@@ -566,6 +567,14 @@ _slang_link(GLcontext *ctx,
       }
    }
 
+   /* clean up after the code generator before computing which inputs
+    * and outputs are really used
+    */
+   if (shProg->VertexProgram)
+      _mesa_optimize_program(&shProg->VertexProgram->Base);
+   if (shProg->FragmentProgram)
+      _mesa_optimize_program(&shProg->FragmentProgram->Base);
+
    if (shProg->VertexProgram) {
       _slang_update_inputs_outputs(&shProg->VertexProgram->Base);
       if (!(shProg->VertexProgram->Base.OutputsWritten & (1 << VERT_RESULT_HPOS))) {
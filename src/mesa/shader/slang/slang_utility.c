@@ -141,6 +141,7 @@ slang_atom_pool_construct(slang_atom_pool * pool)
 
    for (i = 0; i < SLANG_ATOM_POOL_SIZE; i++)
       pool->entries[i] = NULL;
+   pool->outer_pool = NULL;
 }
 
 void
@@ -162,7 +163,7 @@ slang_atom_pool_destruct (slang_atom_pool * pool)
 }
 
 /*
- * Search the atom pool for an atom with a given name.
+ * Search the atom pool and its outer pools for an atom with a given name.
  * If atom is not found, create and add it to the pool.
  * Returns ATOM_NULL if the atom was not found and the function failed
  * to create a new atom.
@@ -172,6 +173,7 @@ slang_atom_pool_atom(slang_atom_pool * pool, const char * id)
 {
    GLuint hash;
    const char * p = id;
+   const slang_atom_pool * outer;
    slang_atom_entry ** entry;
 
    /* Hash a given string to a number in the range [0, ATOM_POOL_SIZE). */
@@ -187,6 +189,18 @@ slang_atom_pool_atom(slang_atom_pool * pool, const char * id)
    }
    hash %= SLANG_ATOM_POOL_SIZE;
 
+   /* An atom that an outer pool already has must not be duplicated,
+    * because atoms are compared by address.
+    */
+   for (outer = pool->outer_pool; outer != NULL; outer = outer->outer_pool) {
+      const slang_atom_entry * e;
+
+      for (e = outer->entries[hash]; e != NULL; e = e->next) {
+         if (slang_string_compare(e->id, id) == 0)
+            return (slang_atom) e->id;
+      }
+   }
+
    /* Now the hash points to a linked list of atoms with names that
     * have the same hash value.  Search the linked list for a given
     * name.
@@ -89,6 +89,8 @@ typedef struct slang_atom_entry_
 typedef struct slang_atom_pool_
 {
 	slang_atom_entry *entries[SLANG_ATOM_POOL_SIZE];
+	/** Atoms of this pool are looked up here first; never modified. */
+	const struct slang_atom_pool_ *outer_pool;
 } slang_atom_pool;
 
 GLvoid slang_atom_pool_construct (slang_atom_pool *);
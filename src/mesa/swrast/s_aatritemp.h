@@ -41,6 +41,7 @@
 /*void triangle( GLcontext *ctx, GLuint v0, GLuint v1, GLuint v2, GLuint pv )*/
 {
    const SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   const SWthread *swthread = SWRAST_THREAD(ctx);
    const GLfloat *p0 = v0->attrib[FRAG_ATTRIB_WPOS];
    const GLfloat *p1 = v1->attrib[FRAG_ATTRIB_WPOS];
    const GLfloat *p2 = v2->attrib[FRAG_ATTRIB_WPOS];
@@ -207,6 +208,10 @@
          GLuint count;
          GLfloat coverage = 0.0F;
 
+         /* skip rows not owned by this (tile) thread */
+         if (iy < swthread->Ymin || iy >= swthread->Ymax)
+            continue;
+
          /* skip over fragments with zero coverage */
          while (startX < MAX_WIDTH) {
             coverage = compute_coveragef(pMin, pMid, pMax, startX, iy);
@@ -282,7 +287,11 @@
          GLint ix, left, startX = (GLint) (x + xAdj);
          GLuint count, n;
          GLfloat coverage = 0.0F;
-         
+
+         /* skip rows not owned by this (tile) thread */
+         if (iy < swthread->Ymin || iy >= swthread->Ymax)
+            continue;
+
          /* make sure we're not past the window edge */
          if (startX >= ctx->DrawBuffer->_Xmax) {
             startX = ctx->DrawBuffer->_Xmax - 1;
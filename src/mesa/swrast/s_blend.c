@@ -63,6 +63,12 @@
 #define DIV255(X)  (divtemp = (X), ((divtemp << 8) + divtemp + 256) >> 16)
 
 
+#if defined(__SSE2__)
+#define USE_SSE2_BLEND 1
+#include <emmintrin.h>
+#endif
+
+
 
 /**
  * Special case for glBlendFunc(GL_ZERO, GL_ONE).
@@ -463,6 +469,158 @@ blend_modulate(GLcontext *ctx, GLuint n, const GLubyte mask[],
 }
 
 
+#ifdef USE_SSE2_BLEND
+
+/*
+ * SSE2 versions of the GLubyte blend functions above.  Four pixels are
+ * blended per iteration and the results are identical to the C code.
+ * The leftover pixels (n % 4) are passed on to the C functions.
+ */
+
+
+/**
+ * Blended pixels for those of the four pixels at mask[0..3] which are
+ * enabled, the incoming pixels for the others.
+ */
+static INLINE __m128i
+sse2_blend_select(const GLubyte mask[], __m128i src, __m128i blended)
+{
+   const __m128i m = _mm_set_epi32(mask[3], mask[2], mask[1], mask[0]);
+   const __m128i keep = _mm_cmpeq_epi32(m, _mm_setzero_si128());
+   return _mm_or_si128(_mm_and_si128(keep, src),
+                       _mm_andnot_si128(keep, blended));
+}
+
+
+/**
+ * DIV255((s - d) * t) + d for four RGBA pixels unpacked to 16 bits
+ * (two per register), t being the source alpha.
+ */
+static INLINE __m128i
+sse2_transparency16(__m128i s, __m128i d)
+{
+   const __m128i round = _mm_set1_epi32(256);
+   const __m128i t = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+   const __m128i diff = _mm_sub_epi16(s, d);
+   const __m128i lo = _mm_mullo_epi16(diff, t);
+   const __m128i hi = _mm_mulhi_epi16(diff, t);
+   __m128i x0 = _mm_unpacklo_epi16(lo, hi);
+   __m128i x1 = _mm_unpackhi_epi16(lo, hi);
+   x0 = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(x0, 8), x0),
+                                     round), 16);
+   x1 = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(x1, 8), x1),
+                                     round), 16);
+   return _mm_add_epi16(_mm_packs_epi32(x0, x1), d);
+}
+
+
+static void _BLENDAPI
+blend_transparency_sse2(GLcontext *ctx, GLuint n, const GLubyte mask[],
+                        GLvoid *src, const GLvoid *dst, GLenum chanType)
+{
+   GLubyte (*rgba)[4] = (GLubyte (*)[4]) src;
+   const GLubyte (*dest)[4] = (const GLubyte (*)[4]) dst;
+   const __m128i zero = _mm_setzero_si128();
+   const GLuint n4 = n & ~3;
+   GLuint i;
+
+   ASSERT(chanType == GL_UNSIGNED_BYTE);
+
+   for (i = 0; i < n4; i += 4) {
+      const __m128i s = _mm_loadu_si128((const __m128i *) rgba[i]);
+      const __m128i d = _mm_loadu_si128((const __m128i *) dest[i]);
+      const __m128i r = _mm_packus_epi16(
+         sse2_transparency16(_mm_unpacklo_epi8(s, zero),
+                             _mm_unpacklo_epi8(d, zero)),
+         sse2_transparency16(_mm_unpackhi_epi8(s, zero),
+                             _mm_unpackhi_epi8(d, zero)));
+      _mm_storeu_si128((__m128i *) rgba[i],
+                       sse2_blend_select(mask + i, s, r));
+   }
+
+   if (n4 < n)
+      blend_transparency_ubyte(ctx, n - n4, mask + n4,
+                               rgba + n4, dest + n4, chanType);
+}
+
+
+/**
+ * Modulate four RGBA pixels unpacked to 16 bits.  DIV255(x) is the same
+ * as (x + 1 + (x >> 8)) >> 8 for x in [0, 255*255], which doesn't
+ * overflow 16 bits.
+ */
+static INLINE __m128i
+sse2_modulate16(__m128i s, __m128i d)
+{
+   const __m128i one = _mm_set1_epi16(1);
+   const __m128i x = _mm_mullo_epi16(s, d);
+   return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, one),
+                                       _mm_srli_epi16(x, 8)), 8);
+}
+
+
+static void _BLENDAPI
+blend_modulate_sse2(GLcontext *ctx, GLuint n, const GLubyte mask[],
+                    GLvoid *src, const GLvoid *dst, GLenum chanType)
+{
+   GLubyte (*rgba)[4] = (GLubyte (*)[4]) src;
+   const GLubyte (*dest)[4] = (const GLubyte (*)[4]) dst;
+   const __m128i zero = _mm_setzero_si128();
+   const GLuint n4 = n & ~3;
+   GLuint i;
+
+   ASSERT(chanType == GL_UNSIGNED_BYTE);
+
+   for (i = 0; i < n4; i += 4) {
+      const __m128i s = _mm_loadu_si128((const __m128i *) rgba[i]);
+      const __m128i d = _mm_loadu_si128((const __m128i *) dest[i]);
+      const __m128i r = _mm_packus_epi16(
+         sse2_modulate16(_mm_unpacklo_epi8(s, zero),
+                         _mm_unpacklo_epi8(d, zero)),
+         sse2_modulate16(_mm_unpackhi_epi8(s, zero),
+                         _mm_unpackhi_epi8(d, zero)));
+      _mm_storeu_si128((__m128i *) rgba[i],
+                       sse2_blend_select(mask + i, s, r));
+   }
+
+   if (n4 < n)
+      blend_modulate(ctx, n - n4, mask + n4, rgba + n4, dest + n4, chanType);
+}
+
+
+/**
+ * Add, min and max are a single instruction each.
+ */
+#define SSE2_BLEND_SIMPLE(NAME, OP, C_FUNC)                              \
+static void _BLENDAPI                                                   \
+NAME(GLcontext *ctx, GLuint n, const GLubyte mask[],                    \
+     GLvoid *src, const GLvoid *dst, GLenum chanType)                   \
+{                                                                       \
+   GLubyte (*rgba)[4] = (GLubyte (*)[4]) src;                           \
+   const GLubyte (*dest)[4] = (const GLubyte (*)[4]) dst;               \
+   const GLuint n4 = n & ~3;                                            \
+   GLuint i;                                                            \
+                                                                        \
+   ASSERT(chanType == GL_UNSIGNED_BYTE);                                \
+                                                                        \
+   for (i = 0; i < n4; i += 4) {                                        \
+      const __m128i s = _mm_loadu_si128((const __m128i *) rgba[i]);     \
+      const __m128i d = _mm_loadu_si128((const __m128i *) dest[i]);     \
+      _mm_storeu_si128((__m128i *) rgba[i],                             \
+                       sse2_blend_select(mask + i, s, OP(s, d)));       \
+   }                                                                    \
+                                                                        \
+   if (n4 < n)                                                          \
+      C_FUNC(ctx, n - n4, mask + n4, rgba + n4, dest + n4, chanType);   \
+}
+
+SSE2_BLEND_SIMPLE(blend_add_sse2, _mm_adds_epu8, blend_add)
+SSE2_BLEND_SIMPLE(blend_min_sse2, _mm_min_epu8, blend_min)
+SSE2_BLEND_SIMPLE(blend_max_sse2, _mm_max_epu8, blend_max)
+
+#endif /* USE_SSE2_BLEND */
+
+
 /**
  * Do any blending operation, using floating point.
  * \param n  number of pixels
@@ -905,6 +1063,12 @@ _swrast_choose_blend_func(GLcontext *ctx, GLenum chanType)
    }
    else if (eq == GL_MIN) {
       /* Note: GL_MIN ignores the blending weight factors */
+#if defined(USE_SSE2_BLEND)
+      if (chanType == GL_UNSIGNED_BYTE) {
+         swrast->BlendFunc = blend_min_sse2;
+      }
+      else
+#endif
 #if defined(USE_MMX_ASM)
       if (cpu_has_mmx && chanType == GL_UNSIGNED_BYTE) {
          swrast->BlendFunc = _mesa_mmx_blend_min;
@@ -915,6 +1079,12 @@ _swrast_choose_blend_func(GLcontext *ctx, GLenum chanType)
    }
    else if (eq == GL_MAX) {
       /* Note: GL_MAX ignores the blending weight factors */
+#if defined(USE_SSE2_BLEND)
+      if (chanType == GL_UNSIGNED_BYTE) {
+         swrast->BlendFunc = blend_max_sse2;
+      }
+      else
+#endif
 #if defined(USE_MMX_ASM)
       if (cpu_has_mmx && chanType == GL_UNSIGNED_BYTE) {
          swrast->BlendFunc = _mesa_mmx_blend_max;
@@ -928,6 +1098,12 @@ _swrast_choose_blend_func(GLcontext *ctx, GLenum chanType)
    }
    else if (eq == GL_FUNC_ADD && srcRGB == GL_SRC_ALPHA
             && dstRGB == GL_ONE_MINUS_SRC_ALPHA) {
+#if defined(USE_SSE2_BLEND)
+      if (chanType == GL_UNSIGNED_BYTE) {
+         swrast->BlendFunc = blend_transparency_sse2;
+      }
+      else
+#endif
 #if defined(USE_MMX_ASM)
       if (cpu_has_mmx && chanType == GL_UNSIGNED_BYTE) {
          swrast->BlendFunc = _mesa_mmx_blend_transparency;
@@ -944,6 +1120,12 @@ _swrast_choose_blend_func(GLcontext *ctx, GLenum chanType)
       }
    }
    else if (eq == GL_FUNC_ADD && srcRGB == GL_ONE && dstRGB == GL_ONE) {
+#if defined(USE_SSE2_BLEND)
+      if (chanType == GL_UNSIGNED_BYTE) {
+         swrast->BlendFunc = blend_add_sse2;
+      }
+      else
+#endif
 #if defined(USE_MMX_ASM)
       if (cpu_has_mmx && chanType == GL_UNSIGNED_BYTE) {
          swrast->BlendFunc = _mesa_mmx_blend_add;
@@ -957,6 +1139,12 @@ _swrast_choose_blend_func(GLcontext *ctx, GLenum chanType)
 	    ||
 	    ((eq == GL_FUNC_ADD || eq == GL_FUNC_SUBTRACT)
 	     && (srcRGB == GL_DST_COLOR && dstRGB == GL_ZERO))) {
+#if defined(USE_SSE2_BLEND)
+      if (chanType == GL_UNSIGNED_BYTE) {
+         swrast->BlendFunc = blend_modulate_sse2;
+      }
+      else
+#endif
 #if defined(USE_MMX_ASM)
       if (cpu_has_mmx && chanType == GL_UNSIGNED_BYTE) {
          swrast->BlendFunc = _mesa_mmx_blend_modulate;
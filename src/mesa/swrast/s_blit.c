@@ -231,6 +231,7 @@ blit_nearest(GLcontext *ctx,
 
       /* store pixel row in destination */
       drawRb->PutRow(ctx, drawRb, dstWidth, dstXpos, dstY, dstBuffer, NULL);
+      _swrast_hiz_update(ctx, drawRb, dstXpos, dstY, dstWidth, 1);
    }
 
    _mesa_free(srcBuffer);
@@ -440,6 +441,7 @@ blit_linear(GLcontext *ctx,
 
       /* store pixel row in destination */
       drawRb->PutRow(ctx, drawRb, dstWidth, dstXpos, dstY, dstBuffer, NULL);
+      _swrast_hiz_update(ctx, drawRb, dstXpos, dstY, dstWidth, 1);
    }
 
    _mesa_free(srcBuffer0);
@@ -542,6 +544,7 @@ simple_blit(GLcontext *ctx,
    for (row = 0; row < height; row++) {
       readRb->GetRow(ctx, readRb, width, srcX0, srcY, rowBuffer);
       drawRb->PutRow(ctx, drawRb, width, dstX0, dstY, rowBuffer, NULL);
+      _swrast_hiz_update(ctx, drawRb, dstX0, dstY, width, 1);
       srcY += yStep;
       dstY += yStep;
    }
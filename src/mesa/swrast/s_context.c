@@ -33,12 +33,14 @@
 #include "mtypes.h"
 #include "teximage.h"
 #include "swrast.h"
+#include "shader/prog_execute_sse.h"
 #include "shader/prog_statevars.h"
 #include "s_blend.h"
 #include "s_context.h"
 #include "s_lines.h"
 #include "s_points.h"
 #include "s_span.h"
+#include "s_tiles.h"
 #include "s_triangle.h"
 #include "s_texfilter.h"
 
@@ -264,6 +266,11 @@ _swrast_update_fragment_program(GLcontext *ctx, GLbitfield newState)
       if (fp->Base.Parameters->StateFlags & newState)
 #endif
          _mesa_load_state_parameters(ctx, fp->Base.Parameters);
+
+      /* Generate code here rather than in the span functions, which may
+       * be running in several threads.
+       */
+      _mesa_compile_program_sse(ctx, (struct gl_program *) &fp->Base);
    }
 }
 
@@ -337,7 +344,8 @@ _swrast_validate_triangle( GLcontext *ctx,
       swrast->Triangle = _swrast_add_spec_terms_triangle;
    }
 
-   swrast->Triangle( ctx, v0, v1, v2 );
+   if (v0)
+      swrast->Triangle( ctx, v0, v1, v2 );
 }
 
 /**
@@ -556,6 +564,9 @@ _swrast_update_active_attribs(GLcontext *ctx)
       /* fragment program/shader */
       attribsMask = ctx->FragmentProgram._Current->Base.InputsRead;
       attribsMask &= ~FRAG_BIT_WPOS; /* WPOS is always handled specially */
+      /* fog for the program's FogOption is applied by swrast */
+      if (swrast->_FogEnabled)
+         attribsMask |= FRAG_BIT_FOGC;
    }
    else if (ctx->ATIFragmentShader._Enabled) {
       attribsMask = ~0;  /* XXX fix me */
@@ -690,12 +701,41 @@ _swrast_validate_derived( GLcontext *ctx )
       if (swrast->NewState & (_NEW_PROGRAM | _NEW_BUFFERS))
          _swrast_update_color_outputs(ctx);
 
+      if (swrast->NewState & (_NEW_DEPTH |
+                              _NEW_STENCIL |
+                              _NEW_PROGRAM |
+                              _NEW_BUFFERS))
+         _swrast_update_hiz(ctx);
+
       swrast->NewState = 0;
       swrast->StateChanges = 0;
       swrast->InvalidateState = _swrast_invalidate_state;
    }
 }
 
+/**
+ * Called before binned triangles are rasterized by worker threads.
+ * Resolve the lazily-validated triangle and blend functions now so that
+ * the other threads only ever read them.
+ */
+void
+_swrast_validate_for_threads( GLcontext *ctx )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   if (swrast->Triangle == _swrast_validate_triangle)
+      _swrast_validate_triangle( ctx, NULL, NULL, NULL );
+   else
+      _swrast_validate_derived( ctx );
+
+   if (swrast->BlendFunc == _swrast_validate_blend_func) {
+      const struct gl_framebuffer *fb = ctx->DrawBuffer;
+      if (fb->_NumColorDrawBuffers[0] > 0)
+         _swrast_choose_blend_func( ctx,
+                                    fb->_ColorDrawBuffers[0][0]->DataType );
+   }
+}
+
 #define SWRAST_DEBUG 0
 
 /* Public entrypoints:  See also s_accum.c, s_bitmap.c, etc.
@@ -712,6 +752,11 @@ _swrast_Quad( GLcontext *ctx,
       _swrast_print_vertex( ctx, v2 );
       _swrast_print_vertex( ctx, v3 );
    }
+   if (SWRAST_CONTEXT(ctx)->Tiles) {
+      _swrast_Triangle( ctx, v0, v1, v3 );
+      _swrast_Triangle( ctx, v1, v2, v3 );
+      return;
+   }
    SWRAST_CONTEXT(ctx)->Triangle( ctx, v0, v1, v3 );
    SWRAST_CONTEXT(ctx)->Triangle( ctx, v1, v2, v3 );
 }
@@ -726,6 +771,12 @@ _swrast_Triangle( GLcontext *ctx, const SWvertex *v0,
       _swrast_print_vertex( ctx, v1 );
       _swrast_print_vertex( ctx, v2 );
    }
+   if (SWRAST_CONTEXT(ctx)->Tiles) {
+      if (_swrast_can_bin_triangles(ctx) &&
+          _swrast_bin_triangle( ctx, v0, v1, v2 ))
+         return;
+      _swrast_flush_tiles( ctx );
+   }
    SWRAST_CONTEXT(ctx)->Triangle( ctx, v0, v1, v2 );
 }
 
@@ -737,6 +788,7 @@ _swrast_Line( GLcontext *ctx, const SWvertex *v0, const SWvertex *v1 )
       _swrast_print_vertex( ctx, v0 );
       _swrast_print_vertex( ctx, v1 );
    }
+   _swrast_flush_tiles( ctx );
    SWRAST_CONTEXT(ctx)->Line( ctx, v0, v1 );
 }
 
@@ -747,6 +799,7 @@ _swrast_Point( GLcontext *ctx, const SWvertex *v0 )
       _mesa_debug(ctx, "_swrast_Point\n");
       _swrast_print_vertex( ctx, v0 );
    }
+   _swrast_flush_tiles( ctx );
    SWRAST_CONTEXT(ctx)->Point( ctx, v0 );
 }
 
@@ -756,6 +809,9 @@ _swrast_InvalidateState( GLcontext *ctx, GLbitfield new_state )
    if (SWRAST_DEBUG) {
       _mesa_debug(ctx, "_swrast_InvalidateState\n");
    }
+   _swrast_flush_tiles( ctx );
+   if (new_state & _NEW_TEXTURE)
+      SWRAST_CONTEXT(ctx)->TexelCacheStamp++;
    SWRAST_CONTEXT(ctx)->InvalidateState( ctx, new_state );
 }
 
@@ -794,6 +850,79 @@ _swrast_allow_pixel_fog( GLcontext *ctx, GLboolean value )
    SWRAST_CONTEXT(ctx)->AllowPixelFog = value;
 }
 
+/**
+ * Allow triangles to be binned into screen tiles and rasterized by
+ * the Mesa thread pool (see s_tiles.c).  This only has an effect when
+ * the MESA_NUM_THREADS environment variable asks for more than one
+ * thread.  Drivers must only enable this if their renderbuffer
+ * Put/GetRow functions and triangle functions can be safely called from
+ * multiple threads for different pixels at once.
+ */
+void
+_swrast_allow_tile_binning( GLcontext *ctx, GLboolean value )
+{
+   if (SWRAST_DEBUG) {
+      _mesa_debug(ctx, "_swrast_allow_tile_binning %d\n", value);
+   }
+   if (value)
+      (void) _swrast_create_tiles( ctx );
+   else
+      _swrast_destroy_tiles( ctx );
+}
+
+
+/**
+ * Allocate the scratch storage for one rasterizing thread.
+ */
+GLboolean
+_swrast_init_thread( GLcontext *ctx, SWthread *thread )
+{
+   thread->SpanArrays = MALLOC_STRUCT(sw_span_arrays);
+   if (!thread->SpanArrays)
+      return GL_FALSE;
+
+   thread->SpanArrays->ChanType = CHAN_TYPE;
+#if CHAN_TYPE == GL_UNSIGNED_BYTE
+   thread->SpanArrays->rgba = thread->SpanArrays->rgba8;
+#elif CHAN_TYPE == GL_UNSIGNED_SHORT
+   thread->SpanArrays->rgba = thread->SpanArrays->rgba16;
+#else
+   thread->SpanArrays->rgba = thread->SpanArrays->attribs[FRAG_ATTRIB_COL0];
+#endif
+
+   thread->TexelBuffer = (GLchan *) MALLOC(ctx->Const.MaxTextureImageUnits *
+                                           MAX_WIDTH * 4 * sizeof(GLchan));
+   if (!thread->TexelBuffer) {
+      FREE(thread->SpanArrays);
+      thread->SpanArrays = NULL;
+      return GL_FALSE;
+   }
+
+   thread->FragProgSoA = NULL;
+   thread->TexelCache = NULL;
+
+   thread->Ymin = 0;
+   thread->Ymax = MAX_HEIGHT;
+
+   return GL_TRUE;
+}
+
+
+void
+_swrast_free_thread( SWthread *thread )
+{
+   FREE( thread->SpanArrays );
+   FREE( thread->TexelBuffer );
+   thread->SpanArrays = NULL;
+   thread->TexelBuffer = NULL;
+   if (thread->FragProgSoA) {
+      _mesa_free_soa_machine( thread->FragProgSoA );
+      thread->FragProgSoA = NULL;
+   }
+   _swrast_free_texel_cache( thread->TexelCache );
+   thread->TexelCache = NULL;
+}
+
 
 GLboolean
 _swrast_CreateContext( GLcontext *ctx )
@@ -808,6 +937,8 @@ _swrast_CreateContext( GLcontext *ctx )
    if (!swrast)
       return GL_FALSE;
 
+   _swrast_init_thread_tsd();
+
    swrast->NewState = ~0;
 
    swrast->choose_point = _swrast_choose_point;
@@ -834,33 +965,16 @@ _swrast_CreateContext( GLcontext *ctx )
    for (i = 0; i < MAX_TEXTURE_IMAGE_UNITS; i++)
       swrast->TextureSample[i] = NULL;
 
-   swrast->SpanArrays = MALLOC_STRUCT(sw_span_arrays);
-   if (!swrast->SpanArrays) {
+   if (!_swrast_init_thread(ctx, &swrast->Thread)) {
       FREE(swrast);
       return GL_FALSE;
    }
-   swrast->SpanArrays->ChanType = CHAN_TYPE;
-#if CHAN_TYPE == GL_UNSIGNED_BYTE
-   swrast->SpanArrays->rgba = swrast->SpanArrays->rgba8;
-#elif CHAN_TYPE == GL_UNSIGNED_SHORT
-   swrast->SpanArrays->rgba = swrast->SpanArrays->rgba16;
-#else
-   swrast->SpanArrays->rgba = swrast->SpanArrays->attribs[FRAG_ATTRIB_COL0];
-#endif
 
    /* init point span buffer */
    swrast->PointSpan.primitive = GL_POINT;
    swrast->PointSpan.end = 0;
    swrast->PointSpan.facing = 0;
-   swrast->PointSpan.array = swrast->SpanArrays;
-
-   swrast->TexelBuffer = (GLchan *) MALLOC(ctx->Const.MaxTextureImageUnits *
-                                           MAX_WIDTH * 4 * sizeof(GLchan));
-   if (!swrast->TexelBuffer) {
-      FREE(swrast->SpanArrays);
-      FREE(swrast);
-      return GL_FALSE;
-   }
+   swrast->PointSpan.array = swrast->Thread.SpanArrays;
 
    ctx->swrast_context = swrast;
 
@@ -876,8 +990,9 @@ _swrast_DestroyContext( GLcontext *ctx )
       _mesa_debug(ctx, "_swrast_DestroyContext\n");
    }
 
-   FREE( swrast->SpanArrays );
-   FREE( swrast->TexelBuffer );
+   _swrast_destroy_tiles( ctx );
+   _swrast_free_hiz( ctx );
+   _swrast_free_thread( &swrast->Thread );
    FREE( swrast );
 
    ctx->swrast_context = 0;
@@ -895,6 +1010,8 @@ void
 _swrast_flush( GLcontext *ctx )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   /* rasterize any binned triangles */
+   _swrast_flush_tiles(ctx);
    /* flush any pending fragments from rendering points */
    if (swrast->PointSpan.end > 0) {
       if (ctx->Visual.rgbMode) {
@@ -925,16 +1042,23 @@ _swrast_render_start( GLcontext *ctx )
    if (swrast->Driver.SpanRenderStart)
       swrast->Driver.SpanRenderStart( ctx );
    swrast->PointSpan.end = 0;
+   _swrast_check_hiz( ctx );
+   _swrast_set_rasterizing_thread( &swrast->Thread );
 }
  
 void
 _swrast_render_finish( GLcontext *ctx )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   /* binned triangles must be drawn before the driver's span finish */
+   _swrast_flush_tiles(ctx);
+
    if (swrast->Driver.SpanRenderFinish)
       swrast->Driver.SpanRenderFinish( ctx );
 
    _swrast_flush(ctx);
+   _swrast_set_rasterizing_thread( NULL );
 }
 
 
@@ -47,6 +47,7 @@
 #include "shader/prog_execute.h"
 #include "swrast.h"
 #include "s_span.h"
+#include "s_hiz.h"
 
 
 typedef void (*texture_sample_func)(GLcontext *ctx,
@@ -108,6 +109,43 @@ typedef void (*validate_texture_image_func)(GLcontext *ctx,
 			        _NEW_DEPTH)
 
 
+/**
+ * \struct SWthread
+ * \brief Per-thread scratch storage used while rasterizing.
+ *
+ * The context has one of these for the application's thread.  When
+ * triangle binning is enabled each worker thread gets its own, see
+ * s_tiles.c.
+ */
+typedef struct swrast_thread
+{
+   /**
+    * Typically, we'll allocate a sw_span structure as a local variable
+    * and set its 'array' pointer to point to this object.  The reason is
+    * this object is big and causes problems when allocated on the stack
+    * on some systems.
+    */
+   SWspanarrays *SpanArrays;
+
+   /** Buffer for saving the sampled texture colors.
+    * Needed for GL_ARB_texture_env_crossbar implementation.
+    */
+   GLchan *TexelBuffer;
+
+   /** State used during execution of fragment programs */
+   struct gl_program_machine FragProgMachine;
+
+   /** For fragment programs translated to SSE code, allocated on demand */
+   struct prog_soa_machine *FragProgSoA;
+
+   /** Decoded texel tiles (s_texfilter.c), allocated on demand */
+   struct swrast_texel_cache *TexelCache;
+
+   /** Window rows [Ymin, Ymax) this thread may rasterize triangles into */
+   GLint Ymin, Ymax;
+} SWthread;
+
+
 /**
  * \struct SWcontext
  * \brief  Per-context state that's private to the software rasterizer module.
@@ -149,6 +187,9 @@ typedef struct
    /** Indicates how each attrib is to be interpolated (lines/tris) */
    GLenum _InterpMode[FRAG_ATTRIB_MAX]; /* GL_FLAT or GL_SMOOTH (for now) */
 
+   /** HiZ, if triangles may be culled against it (s_hiz.c) */
+   const struct swrast_hiz *_HiZ;
+
    /* Accum buffer temporaries.
     */
    GLboolean _IntegerAccumMode;	/**< Storing unscaled integers? */
@@ -204,12 +245,22 @@ typedef struct
    /*@}*/
 
    /**
-    * Typically, we'll allocate a sw_span structure as a local variable
-    * and set its 'array' pointer to point to this object.  The reason is
-    * this object is big and causes problems when allocated on the stack
-    * on some systems.
+    * Scratch storage for the calling thread.  Use SWRAST_THREAD() rather
+    * than accessing this directly from rasterization code.
     */
-   SWspanarrays *SpanArrays;
+   SWthread Thread;
+
+   /** Triangle binning state for multithreaded rasterization (s_tiles.c) */
+   struct swrast_tiles *Tiles;
+
+   /** Hierarchical Z tiles of the last depth buffer used (s_hiz.c) */
+   struct swrast_hiz *HiZ;
+
+   /**
+    * Bumped on texture binding changes, to flush texel caches.  Changes
+    * to the images themselves bump gl_texture_object::ImageStamp.
+    */
+   GLuint TexelCacheStamp;
 
    /**
     * Used to buffer N GL_POINTS, instead of rendering one by one.
@@ -221,16 +272,8 @@ typedef struct
    blend_func BlendFunc;
    texture_sample_func TextureSample[MAX_TEXTURE_IMAGE_UNITS];
 
-   /** Buffer for saving the sampled texture colors.
-    * Needed for GL_ARB_texture_env_crossbar implementation.
-    */
-   GLchan *TexelBuffer;
-
    validate_texture_image_func ValidateTextureImage;
 
-   /** State used during execution of fragment programs */
-   struct gl_program_machine FragProgMachine;
-
 } SWcontext;
 
 
@@ -240,9 +283,37 @@ _swrast_validate_derived( GLcontext *ctx );
 extern void
 _swrast_update_texture_samplers(GLcontext *ctx);
 
+extern void
+_swrast_validate_for_threads(GLcontext *ctx);
+
+extern GLboolean
+_swrast_init_thread(GLcontext *ctx, SWthread *thread);
+
+extern void
+_swrast_free_thread(SWthread *thread);
+
 
 #define SWRAST_CONTEXT(ctx) ((SWcontext *)ctx->swrast_context)
 
+/**
+ * Return the SWthread scratch storage for the current thread.
+ */
+#define SWRAST_THREAD(ctx)					\
+   (SWRAST_CONTEXT(ctx)->Tiles ? _swrast_get_thread(ctx)	\
+                               : &SWRAST_CONTEXT(ctx)->Thread)
+
+extern SWthread *
+_swrast_get_thread(GLcontext *ctx);
+
+extern SWthread *
+_swrast_rasterizing_thread(void);
+
+extern void
+_swrast_set_rasterizing_thread(SWthread *thread);
+
+extern void
+_swrast_init_thread_tsd(void);
+
 #define RENDER_START(SWctx, GLctx)			\
    do {							\
       if ((SWctx)->Driver.SpanRenderStart) {		\
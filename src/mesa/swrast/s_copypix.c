@@ -795,6 +795,7 @@ copy_depth_stencil_pixels(GLcontext *ctx,
          }
          else {
             _swrast_put_row(ctx, depthDrawRb, width, destX, dy, zVals, zBytes);
+            _swrast_hiz_update(ctx, depthDrawRb, destX, dy, width, 1);
          }
       }
    }
@@ -881,6 +882,7 @@ fast_copy_pixels(GLcontext *ctx,
       GLuint temp[MAX_WIDTH][4];
       srcRb->GetRow(ctx, srcRb, width, srcX, srcY, temp);
       dstRb->PutRow(ctx, dstRb, width, dstX, dstY, temp, NULL);
+      _swrast_hiz_update(ctx, dstRb, dstX, dstY, width, 1);
       srcY += yStep;
       dstY += yStep;
    }
@@ -31,9 +31,212 @@
 
 #include "s_depth.h"
 #include "s_context.h"
+#include "s_hiz.h"
 #include "s_span.h"
 
 
+#if defined(__SSE2__)
+
+/*
+ * SSE2 versions of the span depth tests, sixteen fragments at a time.
+ * Only the comparison funcs are done here; GL_ALWAYS and GL_NEVER are
+ * cheap enough already.  As in the scalar code, fragments whose mask is
+ * zero are skipped, failing fragments get a zero mask and passing ones
+ * keep their mask value.
+ *
+ * SSE2 only has signed compares, so both Z values are biased by flipping
+ * the top bit first.
+ */
+#define USE_SSE2_DEPTH 1
+
+#include <emmintrin.h>
+
+
+static INLINE GLboolean
+sse2_depth_func_ok(GLenum func)
+{
+   return func != GL_ALWAYS && func != GL_NEVER;
+}
+
+
+/**
+ * Compare two sets of biased 32-bit Z values, all ones where passed.
+ */
+static INLINE __m128i
+sse2_depth_compare32(GLenum func, __m128i z, __m128i zb)
+{
+   const __m128i ones = _mm_cmpeq_epi32(z, z);
+
+   switch (func) {
+   case GL_LESS:
+      return _mm_cmplt_epi32(z, zb);
+   case GL_LEQUAL:
+      return _mm_xor_si128(_mm_cmpgt_epi32(z, zb), ones);
+   case GL_GEQUAL:
+      return _mm_xor_si128(_mm_cmplt_epi32(z, zb), ones);
+   case GL_GREATER:
+      return _mm_cmpgt_epi32(z, zb);
+   case GL_EQUAL:
+      return _mm_cmpeq_epi32(z, zb);
+   default:
+      ASSERT(func == GL_NOTEQUAL);
+      return _mm_xor_si128(_mm_cmpeq_epi32(z, zb), ones);
+   }
+}
+
+
+/**
+ * As above, for biased 16-bit Z values.
+ */
+static INLINE __m128i
+sse2_depth_compare16(GLenum func, __m128i z, __m128i zb)
+{
+   const __m128i ones = _mm_cmpeq_epi16(z, z);
+
+   switch (func) {
+   case GL_LESS:
+      return _mm_cmplt_epi16(z, zb);
+   case GL_LEQUAL:
+      return _mm_xor_si128(_mm_cmpgt_epi16(z, zb), ones);
+   case GL_GEQUAL:
+      return _mm_xor_si128(_mm_cmplt_epi16(z, zb), ones);
+   case GL_GREATER:
+      return _mm_cmpgt_epi16(z, zb);
+   case GL_EQUAL:
+      return _mm_cmpeq_epi16(z, zb);
+   default:
+      ASSERT(func == GL_NOTEQUAL);
+      return _mm_xor_si128(_mm_cmpeq_epi16(z, zb), ones);
+   }
+}
+
+
+/**
+ * Combine the compare results for sixteen fragments with the mask.
+ * \param pass  byte per fragment, all ones if the Z test passed
+ * \return  byte per fragment, all ones if the fragment passed
+ */
+static INLINE __m128i
+sse2_depth_update_mask(GLubyte mask[], __m128i pass)
+{
+   const __m128i m = _mm_loadu_si128((const __m128i *) mask);
+   pass = _mm_andnot_si128(_mm_cmpeq_epi8(m, _mm_setzero_si128()), pass);
+   _mm_storeu_si128((__m128i *) mask, _mm_and_si128(m, pass));
+   return pass;
+}
+
+
+/**
+ * Depth test for 16-bit Z buffers.  n must be a multiple of 16 and the
+ * fragment Z values must fit in 16 bits.
+ */
+static GLuint
+depth_test_span16_sse2( GLcontext *ctx, GLuint n,
+                        GLushort zbuffer[], const GLuint z[], GLubyte mask[] )
+{
+   const GLenum func = ctx->Depth.Func;
+   const __m128i bias32 = _mm_set1_epi32(0x8000);
+   const __m128i bias16 = _mm_set1_epi16((short) 0x8000);
+   GLuint passed = 0, i, k;
+
+   ASSERT((n & 15) == 0);
+
+   for (i = 0; i < n; i += 16) {
+      __m128i zv[2], zb[2], pass;
+      GLuint bits;
+
+      for (k = 0; k < 2; k++) {
+         const GLuint *zk = z + i + 8 * k;
+         const __m128i z0 = _mm_loadu_si128((const __m128i *) zk);
+         const __m128i z1 = _mm_loadu_si128((const __m128i *) (zk + 4));
+         zv[k] = _mm_packs_epi32(_mm_sub_epi32(z0, bias32),
+                                 _mm_sub_epi32(z1, bias32));
+         zb[k] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)
+                                               (zbuffer + i + 8 * k)),
+                               bias16);
+      }
+
+      pass = _mm_packs_epi16(sse2_depth_compare16(func, zv[0], zb[0]),
+                             sse2_depth_compare16(func, zv[1], zb[1]));
+      pass = sse2_depth_update_mask(mask + i, pass);
+
+      bits = _mm_movemask_epi8(pass);
+      if (bits && ctx->Depth.Mask) {
+         /* Update Z buffer */
+         __m128i p[2];
+         p[0] = _mm_unpacklo_epi8(pass, pass);
+         p[1] = _mm_unpackhi_epi8(pass, pass);
+         for (k = 0; k < 2; k++) {
+            const __m128i zk = _mm_or_si128(_mm_and_si128(p[k], zv[k]),
+                                            _mm_andnot_si128(p[k], zb[k]));
+            _mm_storeu_si128((__m128i *) (zbuffer + i + 8 * k),
+                             _mm_xor_si128(zk, bias16));
+         }
+      }
+      passed += _mesa_bitcount(bits);
+   }
+
+   return passed;
+}
+
+
+/**
+ * Depth test for 32-bit Z buffers.  n must be a multiple of 16.
+ */
+static GLuint
+depth_test_span32_sse2( GLcontext *ctx, GLuint n,
+                        GLuint zbuffer[], const GLuint z[], GLubyte mask[] )
+{
+   const GLenum func = ctx->Depth.Func;
+   const __m128i bias = _mm_set1_epi32((GLint) 0x80000000);
+   GLuint passed = 0, i, k;
+
+   ASSERT((n & 15) == 0);
+
+   for (i = 0; i < n; i += 16) {
+      __m128i zv[4], zb[4], pass;
+      GLuint bits;
+
+      for (k = 0; k < 4; k++) {
+         zv[k] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)
+                                               (z + i + 4 * k)), bias);
+         zb[k] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)
+                                               (zbuffer + i + 4 * k)), bias);
+      }
+
+      pass = _mm_packs_epi16(
+                _mm_packs_epi32(sse2_depth_compare32(func, zv[0], zb[0]),
+                                sse2_depth_compare32(func, zv[1], zb[1])),
+                _mm_packs_epi32(sse2_depth_compare32(func, zv[2], zb[2]),
+                                sse2_depth_compare32(func, zv[3], zb[3])));
+      pass = sse2_depth_update_mask(mask + i, pass);
+
+      bits = _mm_movemask_epi8(pass);
+      if (bits && ctx->Depth.Mask) {
+         /* Update Z buffer */
+         const __m128i lo = _mm_unpacklo_epi8(pass, pass);
+         const __m128i hi = _mm_unpackhi_epi8(pass, pass);
+         __m128i p[4];
+         p[0] = _mm_unpacklo_epi16(lo, lo);
+         p[1] = _mm_unpackhi_epi16(lo, lo);
+         p[2] = _mm_unpacklo_epi16(hi, hi);
+         p[3] = _mm_unpackhi_epi16(hi, hi);
+         for (k = 0; k < 4; k++) {
+            const __m128i zk = _mm_or_si128(_mm_and_si128(p[k], zv[k]),
+                                            _mm_andnot_si128(p[k], zb[k]));
+            _mm_storeu_si128((__m128i *) (zbuffer + i + 4 * k),
+                             _mm_xor_si128(zk, bias));
+         }
+      }
+      passed += _mesa_bitcount(bits);
+   }
+
+   return passed;
+}
+
+#endif /* __SSE2__ */
+
+
 /**
  * Do depth test for a horizontal span of fragments.
  * Input:  zbuffer - array of z values in the zbuffer
@@ -46,6 +249,15 @@ depth_test_span16( GLcontext *ctx, GLuint n,
 {
    GLuint passed = 0;
 
+#ifdef USE_SSE2_DEPTH
+   if (n >= 16 && sse2_depth_func_ok(ctx->Depth.Func)) {
+      const GLuint n16 = n & ~15;
+      passed = depth_test_span16_sse2(ctx, n16, zbuffer, z, mask);
+      return passed + depth_test_span16(ctx, n - n16, zbuffer + n16,
+                                        z + n16, mask + n16);
+   }
+#endif
+
    /* switch cases ordered from most frequent to less frequent */
    switch (ctx->Depth.Func) {
       case GL_LESS:
@@ -275,6 +487,15 @@ depth_test_span32( GLcontext *ctx, GLuint n,
 {
    GLuint passed = 0;
 
+#ifdef USE_SSE2_DEPTH
+   if (n >= 16 && sse2_depth_func_ok(ctx->Depth.Func)) {
+      const GLuint n16 = n & ~15;
+      passed = depth_test_span32_sse2(ctx, n16, zbuffer, z, mask);
+      return passed + depth_test_span32(ctx, n - n16, zbuffer + n16,
+                                        z + n16, mask + n16);
+   }
+#endif
+
    /* switch cases ordered from most frequent to less frequent */
    switch (ctx->Depth.Func) {
       case GL_LESS:
@@ -528,6 +749,8 @@ depth_test_span( GLcontext *ctx, SWspan *span)
          ASSERT(rb->DataType == GL_UNSIGNED_INT);
          passed = depth_test_span32(ctx, count, zbuffer, zValues, mask);
       }
+      if (passed && ctx->Depth.Mask)
+         _swrast_hiz_update_span(ctx, rb, x, y, count);
    }
    else {
       /* read depth values from buffer, test, write back */
@@ -1074,6 +1297,8 @@ depth_test_pixels( GLcontext *ctx, SWspan *span )
          ASSERT(rb->DataType == GL_UNSIGNED_INT);
          direct_depth_test_pixels32(ctx, zStart, stride, count, x, y, z, mask);
       }
+      if (ctx->Depth.Mask)
+         _swrast_hiz_update_pixels(ctx, rb, count, x, y, z, mask);
    }
    else {
       /* read depth values from buffer, test, write back */
@@ -1405,6 +1630,7 @@ _swrast_clear_depth_buffer( GLcontext *ctx, struct gl_renderbuffer *rb )
             }
          }
       }
+      _swrast_hiz_clear(ctx, rb, x, y, width, height, clearValue);
    }
    else {
       /* Direct access not possible.  Use PutRow to write new values. */
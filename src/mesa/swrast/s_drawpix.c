@@ -733,6 +733,7 @@ draw_depth_stencil_pixels(GLcontext *ctx, GLint x, GLint y,
             _mesa_image_address2d(&clippedUnpack, pixels, width, height,
                                   GL_DEPTH_STENCIL_EXT, type, i, 0);
          depthRb->PutRow(ctx, depthRb, width, x, y + i, src, NULL);
+         _swrast_hiz_update(ctx, depthRb, x, y + i, width, 1);
       }
    }
    else {
@@ -793,6 +794,8 @@ draw_depth_stencil_pixels(GLcontext *ctx, GLint x, GLint y,
                   depthRb->PutRow(ctx, depthRb, width, x, y + i, zValues,NULL);
                }
             }
+            if (!zoom)
+               _swrast_hiz_update(ctx, depthRb, x, y + i, width, 1);
          }
 
          if (stencilMask != 0x0) {
@@ -27,6 +27,7 @@
 #include "main/context.h"
 #include "main/texstate.h"
 #include "shader/prog_instruction.h"
+#include "shader/prog_execute_sse.h"
 
 #include "s_fragprog.h"
 #include "s_span.h"
@@ -139,16 +140,57 @@ init_machine(GLcontext *ctx, struct gl_program_machine *machine,
 }
 
 
+/**
+ * Store the fragment program's results for fragment 'i' of the span.
+ */
+static void
+store_outputs(GLcontext *ctx, SWspan *span,
+              const struct gl_program_machine *machine, GLuint i)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   const GLbitfield outputsWritten
+      = ctx->FragmentProgram._Current->Base.OutputsWritten;
+
+   /* Store result color */
+   if (outputsWritten & (1 << FRAG_RESULT_COLR)) {
+      COPY_4V(span->array->attribs[FRAG_ATTRIB_COL0][i],
+              machine->Outputs[FRAG_RESULT_COLR]);
+   }
+   else {
+      /* Multiple drawbuffers / render targets
+       * Note that colors beyond 0 and 1 will overwrite other
+       * attributes, such as FOGC, TEX0, TEX1, etc.  That's OK.
+       */
+      GLuint output;
+      for (output = 0; output < swrast->_NumColorOutputs; output++) {
+         if (outputsWritten & (1 << (FRAG_RESULT_DATA0 + output))) {
+            COPY_4V(span->array->attribs[FRAG_ATTRIB_COL0+output][i],
+                    machine->Outputs[FRAG_RESULT_DATA0 + output]);
+         }
+      }
+   }
+
+   /* Store result depth/z */
+   if (outputsWritten & (1 << FRAG_RESULT_DEPR)) {
+      const GLfloat depth = machine->Outputs[FRAG_RESULT_DEPR][2];
+      if (depth <= 0.0)
+         span->array->z[i] = 0;
+      else if (depth >= 1.0)
+         span->array->z[i] = ctx->DrawBuffer->_DepthMax;
+      else
+         span->array->z[i] = IROUND(depth * ctx->DrawBuffer->_DepthMaxF);
+   }
+}
+
+
 /**
  * Run fragment program on the pixels in span from 'start' to 'end' - 1.
  */
 static void
 run_program(GLcontext *ctx, SWspan *span, GLuint start, GLuint end)
 {
-   SWcontext *swrast = SWRAST_CONTEXT(ctx);
    const struct gl_fragment_program *program = ctx->FragmentProgram._Current;
-   const GLbitfield outputsWritten = program->Base.OutputsWritten;
-   struct gl_program_machine *machine = &swrast->FragProgMachine;
+   struct gl_program_machine *machine = &SWRAST_THREAD(ctx)->FragProgMachine;
    GLuint i;
 
    for (i = start; i < end; i++) {
@@ -156,42 +198,90 @@ run_program(GLcontext *ctx, SWspan *span, GLuint start, GLuint end)
          init_machine(ctx, machine, program, span, i);
 
          if (_mesa_execute_program(ctx, &program->Base, machine)) {
+            store_outputs(ctx, span, machine, i);
+         }
+         else {
+            /* killed fragment */
+            span->array->mask[i] = GL_FALSE;
+            span->writeAll = GL_FALSE;
+         }
+      }
+   }
+}
 
-            /* Store result color */
-            if (outputsWritten & (1 << FRAG_RESULT_COLR)) {
-               COPY_4V(span->array->attribs[FRAG_ATTRIB_COL0][i],
-                       machine->Outputs[FRAG_RESULT_COLR]);
-            }
-            else {
-               /* Multiple drawbuffers / render targets
-                * Note that colors beyond 0 and 1 will overwrite other
-                * attributes, such as FOGC, TEX0, TEX1, etc.  That's OK.
-                */
-               GLuint output;
-               for (output = 0; output < swrast->_NumColorOutputs; output++) {
-                  if (outputsWritten & (1 << (FRAG_RESULT_DATA0 + output))) {
-                     COPY_4V(span->array->attribs[FRAG_ATTRIB_COL0+output][i],
-                             machine->Outputs[FRAG_RESULT_DATA0 + output]);
-                  }
-               }
-            }
 
-            /* Store result depth/z */
-            if (outputsWritten & (1 << FRAG_RESULT_DEPR)) {
-               const GLfloat depth = machine->Outputs[FRAG_RESULT_DEPR][2];
-               if (depth <= 0.0)
-                  span->array->z[i] = 0;
-               else if (depth >= 1.0)
-                  span->array->z[i] = ctx->DrawBuffer->_DepthMax;
-               else
-                  span->array->z[i] = IROUND(depth * ctx->DrawBuffer->_DepthMaxF);
+/**
+ * As above, but run the program's generated SSE code on four fragments
+ * at a time.
+ */
+static void
+run_program_sse(GLcontext *ctx, SWspan *span, GLuint start, GLuint end)
+{
+   SWthread *thread = SWRAST_THREAD(ctx);
+   const struct gl_fragment_program *program = ctx->FragmentProgram._Current;
+   const GLbitfield inputsRead = program->Base.InputsRead;
+   const GLbitfield outputsWritten = program->Base.OutputsWritten;
+   struct gl_program_machine *machine = &thread->FragProgMachine;
+   struct prog_soa_machine *soa = thread->FragProgSoA;
+   GLuint i, attr, lane, c;
+
+   init_machine(ctx, machine, program, span, start);
+   _mesa_init_soa_machine(ctx, soa, &program->Base, machine);
+
+   for (i = start; i < end; i += 4) {
+      const GLuint n = MIN2(end - i, 4);
+      GLuint mask = 0x0;
+
+      for (lane = 0; lane < n; lane++) {
+         if (span->array->mask[i + lane])
+            mask |= 1 << lane;
+      }
+      if (!mask)
+         continue;
+
+      if (ctx->Shader.CurrentProgram) {
+         /* Store front/back facing value in register FOGC.Y */
+         for (lane = 0; lane < n; lane++)
+            span->array->attribs[FRAG_ATTRIB_FOGC][i + lane][1]
+               = 1.0 - span->facing;
+      }
+
+      for (attr = 0; attr < FRAG_ATTRIB_MAX; attr++) {
+         if (inputsRead & (1 << attr)) {
+            for (lane = 0; lane < 4; lane++) {
+               /* unused lanes just repeat the last fragment */
+               const GLfloat *value
+                  = span->array->attribs[attr][i + MIN2(lane, n - 1)];
+               for (c = 0; c < 4; c++)
+                  soa->Inputs[attr][c][lane] = value[c];
             }
          }
-         else {
+      }
+
+      soa->Element = i;
+      soa->LaneMask = mask;
+      soa->Kill[0] = soa->Kill[1] = soa->Kill[2] = soa->Kill[3] = 0;
+
+      _mesa_execute_program_sse(soa);
+
+      for (lane = 0; lane < n; lane++) {
+         if (!(mask & (1 << lane)))
+            continue;
+
+         if (soa->Kill[lane]) {
             /* killed fragment */
-            span->array->mask[i] = GL_FALSE;
+            span->array->mask[i + lane] = GL_FALSE;
             span->writeAll = GL_FALSE;
          }
+         else {
+            for (attr = 0; attr < FRAG_RESULT_MAX; attr++) {
+               if (outputsWritten & (1 << attr)) {
+                  for (c = 0; c < 4; c++)
+                     machine->Outputs[attr][c] = soa->Outputs[attr][c][lane];
+               }
+            }
+            store_outputs(ctx, span, machine, i + lane);
+         }
       }
    }
 }
@@ -204,6 +294,7 @@ run_program(GLcontext *ctx, SWspan *span, GLuint start, GLuint end)
 void
 _swrast_exec_fragment_program( GLcontext *ctx, SWspan *span )
 {
+   SWthread *thread = SWRAST_THREAD(ctx);
    const struct gl_fragment_program *program = ctx->FragmentProgram._Current;
 
    /* incoming colors should be floats */
@@ -213,7 +304,13 @@ _swrast_exec_fragment_program( GLcontext *ctx, SWspan *span )
 
    ctx->_CurrentProgram = GL_FRAGMENT_PROGRAM_ARB; /* or NV, doesn't matter */
 
-   run_program(ctx, span, 0, span->end);
+   if (_mesa_program_has_sse_code(&program->Base) && !thread->FragProgSoA)
+      thread->FragProgSoA = _mesa_new_soa_machine();
+
+   if (_mesa_program_has_sse_code(&program->Base) && thread->FragProgSoA)
+      run_program_sse(ctx, span, 0, span->end);
+   else
+      run_program(ctx, span, 0, span->end);
 
    if (program->Base.OutputsWritten & (1 << FRAG_RESULT_COLR)) {
       span->interpMask &= ~SPAN_RGBA;
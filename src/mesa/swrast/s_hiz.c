@@ -0,0 +1,398 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  7.1
+ *
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+
+/**
+ * \file s_hiz.c
+ * Hierarchical Z buffer.
+ *
+ * For each depth buffer which can be accessed directly we keep the
+ * largest Z value of every tile of HIZ_TILE_WIDTH pixels.  When the
+ * depth test is GL_LESS or GL_LEQUAL the triangle rasterizers compare
+ * each span against the tiles of its row (see _swrast_hiz_cull_span())
+ * and don't generate fragments for the tiles at either end of the span
+ * which are entirely hidden.  A span which is completely hidden isn't
+ * rendered at all, so no Z, color or texture coordinates are
+ * interpolated for it.
+ *
+ * The tiles are only one row tall so that a depth write only needs the
+ * tiles of the row just written to be recomputed, which are in the cache
+ * anyway.  This also means the worker threads of s_tiles.c, which own
+ * whole rows, never share tiles.
+ *
+ * The tiles are recomputed from the depth buffer whenever the context
+ * starts using a different depth buffer, and are kept up to date by
+ * the depth clear, the depth test and the functions which write Z
+ * values directly (glDrawPixels, glCopyPixels, glBlitFramebuffer).
+ *
+ * The depth buffer may also be written by other contexts sharing it.
+ * Every write which may raise Z values changes the renderbuffer's
+ * DepthStamp, and the tiles are only used while the stamp is the one
+ * they were last brought up to date with.  Buffers whose memory was
+ * handed to the application (OSMesaGetDepthBuffer) aren't tracked.
+ */
+
+
+#include "glheader.h"
+#include "imports.h"
+#include "macros.h"
+
+#include "s_context.h"
+#include "s_hiz.h"
+
+
+/**
+ * Recompute tiles t0..t1 of row y from the depth buffer.
+ */
+static void
+compute_tiles(GLcontext *ctx, struct swrast_hiz *hiz, GLint y,
+              GLint t0, GLint t1)
+{
+   struct gl_renderbuffer *rb = hiz->Rb;
+   GLuint *tiles = hiz->MaxZ + y * hiz->TilesPerRow;
+   const GLint x0 = t0 << HIZ_TILE_SHIFT;
+   const GLint x1 = MIN2((t1 + 1) << HIZ_TILE_SHIFT, (GLint) hiz->Width);
+   GLint t, x;
+
+   if (rb->DataType == GL_UNSIGNED_SHORT) {
+      const GLushort *zRow = (const GLushort *) rb->GetPointer(ctx, rb, 0, y);
+      for (t = t0, x = x0; x < x1; t++) {
+         const GLint end = MIN2(x + HIZ_TILE_WIDTH, x1);
+         GLuint zMax = 0;
+         for (; x < end; x++)
+            zMax = MAX2(zMax, zRow[x]);
+         tiles[t] = zMax;
+      }
+   }
+   else {
+      const GLuint *zRow = (const GLuint *) rb->GetPointer(ctx, rb, 0, y);
+      ASSERT(rb->DataType == GL_UNSIGNED_INT);
+      for (t = t0, x = x0; x < x1; t++) {
+         const GLint end = MIN2(x + HIZ_TILE_WIDTH, x1);
+         GLuint zMax = 0;
+         for (; x < end; x++)
+            zMax = MAX2(zMax, zRow[x]);
+         tiles[t] = zMax;
+      }
+   }
+}
+
+
+/**
+ * Return the Hi-Z for rb if we're keeping track of its contents.
+ */
+static INLINE struct swrast_hiz *
+get_hiz(GLcontext *ctx, const struct gl_renderbuffer *rb)
+{
+   struct swrast_hiz *hiz = SWRAST_CONTEXT(ctx)->HiZ;
+   if (hiz && hiz->Rb == rb && hiz->Data == rb->Data &&
+       hiz->Width == rb->Width && hiz->Height == rb->Height &&
+       hiz->Stamp == rb->DepthStamp && !rb->AppAccess)
+      return hiz;
+   return NULL;
+}
+
+
+/**
+ * Note that Z values of rb may have been raised.  Other contexts' tiles
+ * for rb become stale; ours stay valid if they were brought up to date.
+ */
+static INLINE void
+raised_z(struct gl_renderbuffer *rb, struct swrast_hiz *hiz)
+{
+   rb->DepthStamp++;
+   if (hiz)
+      hiz->Stamp = rb->DepthStamp;
+}
+
+
+/**
+ * Can the current depth test raise the Z values it writes?
+ */
+static INLINE GLboolean
+depth_func_raises_z(const GLcontext *ctx)
+{
+   switch (ctx->Depth.Func) {
+   case GL_NEVER:
+   case GL_LESS:
+   case GL_LEQUAL:
+   case GL_EQUAL:
+      return GL_FALSE;
+   default:
+      return GL_TRUE;
+   }
+}
+
+
+/**
+ * Recompute the tiles covering the given region.
+ */
+static void
+update_tiles(GLcontext *ctx, struct swrast_hiz *hiz,
+             GLint x, GLint y, GLint width, GLint height)
+{
+   const GLint x1 = MIN2(x + width, (GLint) hiz->Width);
+   const GLint y1 = MIN2(y + height, (GLint) hiz->Height);
+
+   x = MAX2(x, 0);
+   y = MAX2(y, 0);
+
+   for (; y < y1 && x < x1; y++)
+      compute_tiles(ctx, hiz, y, x >> HIZ_TILE_SHIFT,
+                    (x1 - 1) >> HIZ_TILE_SHIFT);
+}
+
+
+/**
+ * Rebuild the Hi-Z tiles for the given depth buffer.
+ */
+static struct swrast_hiz *
+build_hiz(GLcontext *ctx, struct gl_renderbuffer *rb)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct swrast_hiz *hiz = swrast->HiZ;
+   const GLuint tilesPerRow = (rb->Width + HIZ_TILE_WIDTH - 1) >> HIZ_TILE_SHIFT;
+   GLuint y;
+
+   if (!hiz) {
+      hiz = swrast->HiZ = CALLOC_STRUCT(swrast_hiz);
+      if (!hiz)
+         return NULL;
+   }
+
+   if (!hiz->MaxZ || tilesPerRow * rb->Height >
+       hiz->TilesPerRow * hiz->Height) {
+      _mesa_free(hiz->MaxZ);
+      hiz->MaxZ = (GLuint *) _mesa_malloc(tilesPerRow * rb->Height *
+                                          sizeof(GLuint));
+      if (!hiz->MaxZ) {
+         hiz->Rb = NULL;
+         return NULL;
+      }
+   }
+
+   hiz->Rb = rb;
+   hiz->Data = rb->Data;
+   hiz->Width = rb->Width;
+   hiz->Height = rb->Height;
+   hiz->Stamp = rb->DepthStamp;
+   hiz->TilesPerRow = tilesPerRow;
+
+   for (y = 0; y < rb->Height; y++)
+      compute_tiles(ctx, hiz, y, 0, tilesPerRow - 1);
+
+   return hiz;
+}
+
+
+/**
+ * Called when depth test, stencil, fragment program or framebuffer state
+ * changes.  Decide whether triangles may be culled with Hi-Z and set
+ * swrast->_HiZ accordingly, building the tiles for the current depth
+ * buffer if needed.
+ */
+void
+_swrast_update_hiz(GLcontext *ctx)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct gl_framebuffer *fb = ctx->DrawBuffer;
+   struct gl_renderbuffer *rb = fb->_DepthBuffer;
+   const struct gl_fragment_program *fprog = ctx->FragmentProgram._Current;
+   struct swrast_hiz *hiz;
+
+   swrast->_HiZ = NULL;
+
+   if (!ctx->Depth.Test ||
+       (ctx->Depth.Func != GL_LESS && ctx->Depth.Func != GL_LEQUAL) ||
+       !rb || fb->Visual.depthBits == 0 ||
+       !rb->Data || rb->AppAccess || !rb->GetPointer(ctx, rb, 0, 0))
+      return;
+
+   /* the stencil ops must see fragments which fail the depth test */
+   if (ctx->Stencil.Enabled && fb->Visual.stencilBits > 0)
+      return;
+
+   /* Z comes from fragment program/shader */
+   if (fprog && (fprog->Base.OutputsWritten & (1 << FRAG_RESULT_DEPR)))
+      return;
+
+   hiz = get_hiz(ctx, rb);
+   if (!hiz) {
+      hiz = build_hiz(ctx, rb);
+      if (!hiz)
+         return;
+   }
+
+   hiz->FixedZ = fb->Visual.depthBits <= 16;
+   hiz->CullEqual = ctx->Depth.Func == GL_LESS;
+   swrast->_HiZ = hiz;
+}
+
+
+/**
+ * Called before rendering.  If the depth buffer was written by someone
+ * else since the tiles were computed, recompute them.
+ */
+void
+_swrast_check_hiz(GLcontext *ctx)
+{
+   const struct swrast_hiz *hiz = SWRAST_CONTEXT(ctx)->_HiZ;
+   if (hiz && !_swrast_hiz_current(hiz))
+      _swrast_update_hiz(ctx);
+}
+
+
+void
+_swrast_free_hiz(GLcontext *ctx)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   if (swrast->HiZ) {
+      _mesa_free(swrast->HiZ->MaxZ);
+      _mesa_free(swrast->HiZ);
+      swrast->HiZ = NULL;
+   }
+   swrast->_HiZ = NULL;
+}
+
+
+/**
+ * Update the Hi-Z tiles after Z values in the given region of rb were
+ * written.  Nothing is done unless rb is the buffer Hi-Z describes.
+ */
+void
+_swrast_hiz_update(GLcontext *ctx, struct gl_renderbuffer *rb,
+                   GLint x, GLint y, GLint width, GLint height)
+{
+   struct swrast_hiz *hiz = get_hiz(ctx, rb);
+
+   if (hiz)
+      update_tiles(ctx, hiz, x, y, width, height);
+   raised_z(rb, hiz);
+}
+
+
+/**
+ * Update the Hi-Z tiles after the depth test wrote a span of n Z values.
+ * Unless the depth test could have raised Z values, the tiles which the
+ * span only partly covers are still an upper bound, so only the tiles
+ * it covers entirely are recomputed.  This keeps the cost down for the
+ * short spans of small triangles.
+ */
+void
+_swrast_hiz_update_span(GLcontext *ctx, struct gl_renderbuffer *rb,
+                        GLint x, GLint y, GLuint n)
+{
+   struct swrast_hiz *hiz;
+   GLint x0, x1;
+
+   if (depth_func_raises_z(ctx)) {
+      _swrast_hiz_update(ctx, rb, x, y, n, 1);
+      return;
+   }
+
+   /* Z was only lowered, so everybody's tiles are still an upper bound */
+   hiz = get_hiz(ctx, rb);
+   if (!hiz)
+      return;
+
+   x0 = (x + HIZ_TILE_WIDTH - 1) & ~(HIZ_TILE_WIDTH - 1);
+   x1 = x + (GLint) n;
+   if (x1 < (GLint) rb->Width)
+      x1 &= ~(HIZ_TILE_WIDTH - 1);
+
+   if (x0 < x1)
+      update_tiles(ctx, hiz, x0, y, x1 - x0, 1);
+}
+
+
+/**
+ * As above, for Z values written at assorted locations where mask[i]
+ * is set.
+ */
+void
+_swrast_hiz_update_pixels(GLcontext *ctx, struct gl_renderbuffer *rb,
+                          GLuint n, const GLint x[], const GLint y[],
+                          const GLuint z[], const GLubyte mask[])
+{
+   struct swrast_hiz *hiz = get_hiz(ctx, rb);
+   GLuint i;
+
+   if (depth_func_raises_z(ctx))
+      raised_z(rb, hiz);
+
+   if (!hiz)
+      return;
+
+   /* an upper bound is good enough */
+   for (i = 0; i < n; i++) {
+      if (mask[i] && x[i] >= 0 && x[i] < (GLint) hiz->Width &&
+          y[i] >= 0 && y[i] < (GLint) hiz->Height) {
+         GLuint *tile = hiz->MaxZ + y[i] * hiz->TilesPerRow
+            + (x[i] >> HIZ_TILE_SHIFT);
+         *tile = MAX2(*tile, z[i]);
+      }
+   }
+}
+
+
+/**
+ * Update the Hi-Z tiles after a region of rb was cleared.
+ */
+void
+_swrast_hiz_clear(GLcontext *ctx, struct gl_renderbuffer *rb,
+                  GLint x, GLint y, GLint width, GLint height,
+                  GLuint clearValue)
+{
+   struct swrast_hiz *hiz = get_hiz(ctx, rb);
+   GLint x1, y1, t0, t1, t;
+
+   raised_z(rb, hiz);
+
+   if (!hiz)
+      return;
+
+   x1 = MIN2(x + width, (GLint) hiz->Width);
+   y1 = MIN2(y + height, (GLint) hiz->Height);
+   x = MAX2(x, 0);
+   y = MAX2(y, 0);
+   if (x >= x1)
+      return;
+
+   t0 = x >> HIZ_TILE_SHIFT;
+   t1 = (x1 - 1) >> HIZ_TILE_SHIFT;
+
+   for (; y < y1; y++) {
+      GLuint *tiles = hiz->MaxZ + y * hiz->TilesPerRow;
+      for (t = t0; t <= t1; t++)
+         tiles[t] = clearValue;
+
+      /* tiles at the edges which were only partly cleared */
+      if (x & (HIZ_TILE_WIDTH - 1))
+         compute_tiles(ctx, hiz, y, t0, t0);
+      if ((x1 & (HIZ_TILE_WIDTH - 1)) && x1 != (GLint) hiz->Width)
+         compute_tiles(ctx, hiz, y, t1, t1);
+   }
+}
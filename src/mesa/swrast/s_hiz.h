@@ -0,0 +1,182 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  7.1
+ *
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+
+#ifndef S_HIZ_H
+#define S_HIZ_H
+
+
+#include "mtypes.h"
+#include "macros.h"
+#include "s_span.h"
+
+
+/** Hi-Z tiles are HIZ_TILE_WIDTH pixels of one row */
+#define HIZ_TILE_SHIFT 3
+#define HIZ_TILE_WIDTH (1 << HIZ_TILE_SHIFT)
+
+
+/**
+ * Hierarchical Z: the largest depth value in each tile of a direct-access
+ * depth renderbuffer.  Triangle spans are tested against it before any
+ * fragments are generated, see _swrast_hiz_cull_span().
+ *
+ * The tiles only have to be an upper bound of the depth values, so
+ * writes which can only lower Z (like the GL_LESS-only fast triangle
+ * functions which write into the depth buffer themselves) may skip
+ * updating it.  Anything else writing depth values must call
+ * _swrast_hiz_update() or _swrast_hiz_update_pixels(), which also change
+ * the renderbuffer's DepthStamp so that other contexts drawing into the
+ * same buffer stop trusting their tiles.
+ */
+struct swrast_hiz
+{
+   struct gl_renderbuffer *Rb;  /**< the depth buffer described */
+   GLvoid *Data;                /**< Rb->Data when the tiles were computed */
+   GLuint Width, Height;        /**< size of Rb */
+   GLuint Stamp;                /**< Rb->DepthStamp the tiles agree with */
+   GLuint TilesPerRow;
+   GLuint *MaxZ;                /**< [Height][TilesPerRow] */
+
+   /** Current state, for _swrast_hiz_cull_span() */
+   /*@{*/
+   GLboolean FixedZ;            /**< span Z is GLfixed (depthBits <= 16) */
+   GLboolean CullEqual;         /**< GL_LESS: cull fragments with Z == MaxZ */
+   /*@}*/
+};
+
+
+extern void
+_swrast_update_hiz(GLcontext *ctx);
+
+extern void
+_swrast_check_hiz(GLcontext *ctx);
+
+extern void
+_swrast_free_hiz(GLcontext *ctx);
+
+extern void
+_swrast_hiz_update(GLcontext *ctx, struct gl_renderbuffer *rb,
+                   GLint x, GLint y, GLint width, GLint height);
+
+extern void
+_swrast_hiz_update_span(GLcontext *ctx, struct gl_renderbuffer *rb,
+                        GLint x, GLint y, GLuint n);
+
+extern void
+_swrast_hiz_update_pixels(GLcontext *ctx, struct gl_renderbuffer *rb,
+                          GLuint n, const GLint x[], const GLint y[],
+                          const GLuint z[], const GLubyte mask[]);
+
+extern void
+_swrast_hiz_clear(GLcontext *ctx, struct gl_renderbuffer *rb,
+                  GLint x, GLint y, GLint width, GLint height,
+                  GLuint clearValue);
+
+
+/**
+ * Do the tiles still describe the depth buffer's contents?
+ */
+static INLINE GLboolean
+_swrast_hiz_current(const struct swrast_hiz *hiz)
+{
+   return hiz->Stamp == hiz->Rb->DepthStamp;
+}
+
+
+/**
+ * Z value of fragment i of a span, computed the same way as in
+ * _swrast_span_interpolate_z().
+ */
+static INLINE GLuint
+hiz_span_z(const struct swrast_hiz *hiz, const SWspan *span, GLint i)
+{
+   if (hiz->FixedZ)
+      return FixedToInt(span->z + i * span->zStep);
+   else
+      return (GLuint) span->z + (GLuint) i * (GLuint) span->zStep;
+}
+
+
+/**
+ * Is the part of the span in tile t hidden?  Z is linear along the span
+ * so its smallest value in the tile is at one end of the tile.
+ */
+static INLINE GLboolean
+hiz_tile_hidden(const struct swrast_hiz *hiz, const SWspan *span,
+                const GLuint *tiles, GLint t)
+{
+   const GLint first = MAX2(t << HIZ_TILE_SHIFT, span->x) - span->x;
+   const GLint last = MIN2((t + 1) << HIZ_TILE_SHIFT,
+                           span->x + (GLint) span->end) - span->x - 1;
+   const GLuint zMin = hiz_span_z(hiz, span, span->zStep >= 0 ? first : last);
+   if (hiz->CullEqual)
+      return zMin >= tiles[t];
+   else
+      return zMin > tiles[t];
+}
+
+
+/**
+ * Find the part of a horizontal span which may pass the depth test.
+ * Leading and trailing tiles in which all the span's fragments are
+ * behind the Hi-Z value are left off.
+ * \param first  returns the index of the first fragment which may pass
+ * \return  index after the last fragment which may pass, 0 if none can
+ */
+static INLINE GLuint
+_swrast_hiz_cull_span(const struct swrast_hiz *hiz, const SWspan *span,
+                      GLint *first)
+{
+   const GLint x0 = span->x, x1 = span->x + span->end;
+   const GLint t1 = (x1 - 1) >> HIZ_TILE_SHIFT;
+   const GLuint *tiles;
+   GLint t0;
+
+   *first = 0;
+
+   if (span->y < 0 || span->y >= (GLint) hiz->Height ||
+       x0 < 0 || x1 > (GLint) hiz->Width)
+      return span->end;  /* to be clipped later */
+
+   tiles = hiz->MaxZ + span->y * hiz->TilesPerRow;
+
+   for (t0 = x0 >> HIZ_TILE_SHIFT; t0 <= t1; t0++) {
+      if (!hiz_tile_hidden(hiz, span, tiles, t0)) {
+         GLint t;
+         for (t = t1; t > t0; t--) {
+            if (!hiz_tile_hidden(hiz, span, tiles, t))
+               break;
+         }
+         *first = MAX2(t0 << HIZ_TILE_SHIFT, x0) - x0;
+         return MIN2((t + 1) << HIZ_TILE_SHIFT, x1) - x0;
+      }
+   }
+
+   return 0;
+}
+
+
+#endif /* S_HIZ_H */
@@ -34,6 +34,7 @@
 #include "imports.h"
 #include "pixel.h"
 #include "state.h"
+#include "threadpool.h"
 
 #include "s_context.h"
 #include "s_depth.h"
@@ -196,6 +197,311 @@ read_stencil_pixels( GLcontext *ctx,
 
 
 
+/*
+ * Row converters for fast_read_rgba_pixels(): they take a row of GLubyte
+ * RGBA pixels from a renderbuffer and store it in the client's format and
+ * type, with the same results as _mesa_pack_rgba_span_float() would give.
+ */
+
+/**
+ * \param clampLum  clamp the luminance of GL_FLOAT results to [0,1]
+ */
+typedef void (*read_row_func)(GLuint n, CONST GLubyte rgba[][4],
+                              GLvoid *dst, GLboolean clampLum);
+
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+/**
+ * Drop the alpha bytes of four RGBA pixels (optionally swapping red and
+ * blue).  The 12 result bytes are the low 12 bytes of the register.
+ */
+static INLINE __m128i
+rgba_to_rgb_sse2(__m128i p, GLboolean swap)
+{
+   const __m128i mask0 = _mm_setr_epi32(0xffffffff, 0x0000ffff, 0, 0);
+   const __m128i mask1 = _mm_setr_epi32(0, 0xffff0000, 0xffffffff, 0);
+   const __m128i rgb0 = _mm_setr_epi32(0x00ffffff, 0, 0x00ffffff, 0);
+   const __m128i rgb1 = _mm_setr_epi32(0xff000000, 0x0000ffff,
+                                       0xff000000, 0x0000ffff);
+   __m128i q;
+
+   if (swap) {
+      const __m128i ga = _mm_set1_epi32(0xff00ff00);
+      const __m128i rb = _mm_set1_epi32(0x000000ff);
+      p = _mm_or_si128(_mm_and_si128(p, ga),
+                       _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), rb),
+                                    _mm_slli_epi32(_mm_and_si128(p, rb), 16)));
+   }
+
+   /* squeeze each pair of pixels into 6 bytes of a 64-bit lane ... */
+   q = _mm_or_si128(_mm_and_si128(p, rgb0),
+                    _mm_and_si128(_mm_srli_epi64(p, 8), rgb1));
+   /* ... and then the two lanes together */
+   return _mm_or_si128(_mm_and_si128(q, mask0),
+                       _mm_and_si128(_mm_srli_si128(q, 2), mask1));
+}
+
+#endif /* __SSE2__ */
+
+
+static void
+read_row_rgb_ubyte(GLuint n, CONST GLubyte rgba[][4], GLvoid *dst,
+                   GLboolean clampLum)
+{
+   GLubyte *d = (GLubyte *) dst;
+   GLuint i = 0;
+   (void) clampLum;
+#if defined(__SSE2__)
+   /* 16 bytes are stored for every 12, so stop two pixels early */
+   for (; i + 6 <= n; i += 4) {
+      const __m128i p = _mm_loadu_si128((const __m128i *) rgba[i]);
+      _mm_storeu_si128((__m128i *) (d + i * 3), rgba_to_rgb_sse2(p, GL_FALSE));
+   }
+#endif
+   for (; i < n; i++) {
+      d[i * 3 + 0] = rgba[i][RCOMP];
+      d[i * 3 + 1] = rgba[i][GCOMP];
+      d[i * 3 + 2] = rgba[i][BCOMP];
+   }
+}
+
+
+static void
+read_row_bgr_ubyte(GLuint n, CONST GLubyte rgba[][4], GLvoid *dst,
+                   GLboolean clampLum)
+{
+   GLubyte *d = (GLubyte *) dst;
+   GLuint i = 0;
+   (void) clampLum;
+#if defined(__SSE2__)
+   for (; i + 6 <= n; i += 4) {
+      const __m128i p = _mm_loadu_si128((const __m128i *) rgba[i]);
+      _mm_storeu_si128((__m128i *) (d + i * 3), rgba_to_rgb_sse2(p, GL_TRUE));
+   }
+#endif
+   for (; i < n; i++) {
+      d[i * 3 + 0] = rgba[i][BCOMP];
+      d[i * 3 + 1] = rgba[i][GCOMP];
+      d[i * 3 + 2] = rgba[i][RCOMP];
+   }
+}
+
+
+static void
+read_row_bgra_ubyte(GLuint n, CONST GLubyte rgba[][4], GLvoid *dst,
+                    GLboolean clampLum)
+{
+   GLubyte *d = (GLubyte *) dst;
+   GLuint i = 0;
+   (void) clampLum;
+#if defined(__SSE2__)
+   {
+      const __m128i ga = _mm_set1_epi32(0xff00ff00);
+      const __m128i rb = _mm_set1_epi32(0x000000ff);
+      for (; i + 4 <= n; i += 4) {
+         const __m128i p = _mm_loadu_si128((const __m128i *) rgba[i]);
+         const __m128i q =
+            _mm_or_si128(_mm_and_si128(p, ga),
+                         _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), rb),
+                                      _mm_slli_epi32(_mm_and_si128(p, rb), 16)));
+         _mm_storeu_si128((__m128i *) (d + i * 4), q);
+      }
+   }
+#endif
+   for (; i < n; i++) {
+      d[i * 4 + 0] = rgba[i][BCOMP];
+      d[i * 4 + 1] = rgba[i][GCOMP];
+      d[i * 4 + 2] = rgba[i][RCOMP];
+      d[i * 4 + 3] = rgba[i][ACOMP];
+   }
+}
+
+
+static void
+read_row_luminance_ubyte(GLuint n, CONST GLubyte rgba[][4], GLvoid *dst,
+                         GLboolean clampLum)
+{
+   GLubyte *d = (GLubyte *) dst;
+   GLuint i;
+   (void) clampLum;
+   for (i = 0; i < n; i++) {
+      const GLfloat sum = UBYTE_TO_FLOAT(rgba[i][RCOMP])
+         + UBYTE_TO_FLOAT(rgba[i][GCOMP]) + UBYTE_TO_FLOAT(rgba[i][BCOMP]);
+      d[i] = FLOAT_TO_UBYTE(MIN2(sum, 1.0F));
+   }
+}
+
+
+static void
+read_row_luminance_alpha_ubyte(GLuint n, CONST GLubyte rgba[][4], GLvoid *dst,
+                               GLboolean clampLum)
+{
+   GLubyte *d = (GLubyte *) dst;
+   GLuint i;
+   (void) clampLum;
+   for (i = 0; i < n; i++) {
+      const GLfloat sum = UBYTE_TO_FLOAT(rgba[i][RCOMP])
+         + UBYTE_TO_FLOAT(rgba[i][GCOMP]) + UBYTE_TO_FLOAT(rgba[i][BCOMP]);
+      d[i * 2 + 0] = FLOAT_TO_UBYTE(MIN2(sum, 1.0F));
+      d[i * 2 + 1] = rgba[i][ACOMP];
+   }
+}
+
+
+static void
+read_row_rgba_float(GLuint n, CONST GLubyte rgba[][4], GLvoid *dst,
+                    GLboolean clampLum)
+{
+   GLfloat (*d)[4] = (GLfloat (*)[4]) dst;
+   GLuint i;
+   (void) clampLum;
+   for (i = 0; i < n; i++) {
+      d[i][RCOMP] = UBYTE_TO_FLOAT(rgba[i][RCOMP]);
+      d[i][GCOMP] = UBYTE_TO_FLOAT(rgba[i][GCOMP]);
+      d[i][BCOMP] = UBYTE_TO_FLOAT(rgba[i][BCOMP]);
+      d[i][ACOMP] = UBYTE_TO_FLOAT(rgba[i][ACOMP]);
+   }
+}
+
+
+static void
+read_row_rgb_float(GLuint n, CONST GLubyte rgba[][4], GLvoid *dst,
+                   GLboolean clampLum)
+{
+   GLfloat (*d)[3] = (GLfloat (*)[3]) dst;
+   GLuint i;
+   (void) clampLum;
+   for (i = 0; i < n; i++) {
+      d[i][0] = UBYTE_TO_FLOAT(rgba[i][RCOMP]);
+      d[i][1] = UBYTE_TO_FLOAT(rgba[i][GCOMP]);
+      d[i][2] = UBYTE_TO_FLOAT(rgba[i][BCOMP]);
+   }
+}
+
+
+static void
+read_row_bgra_float(GLuint n, CONST GLubyte rgba[][4], GLvoid *dst,
+                    GLboolean clampLum)
+{
+   GLfloat (*d)[4] = (GLfloat (*)[4]) dst;
+   GLuint i;
+   (void) clampLum;
+   for (i = 0; i < n; i++) {
+      d[i][0] = UBYTE_TO_FLOAT(rgba[i][BCOMP]);
+      d[i][1] = UBYTE_TO_FLOAT(rgba[i][GCOMP]);
+      d[i][2] = UBYTE_TO_FLOAT(rgba[i][RCOMP]);
+      d[i][3] = UBYTE_TO_FLOAT(rgba[i][ACOMP]);
+   }
+}
+
+
+static void
+read_row_luminance_float(GLuint n, CONST GLubyte rgba[][4], GLvoid *dst,
+                         GLboolean clampLum)
+{
+   GLfloat *d = (GLfloat *) dst;
+   GLuint i;
+   for (i = 0; i < n; i++) {
+      const GLfloat sum = UBYTE_TO_FLOAT(rgba[i][RCOMP])
+         + UBYTE_TO_FLOAT(rgba[i][GCOMP]) + UBYTE_TO_FLOAT(rgba[i][BCOMP]);
+      d[i] = clampLum ? MIN2(sum, 1.0F) : sum;
+   }
+}
+
+
+/**
+ * Choose a row converter for reading GLubyte RGBA pixels into the
+ * given format and type.
+ */
+static read_row_func
+choose_read_row_func(GLenum format, GLenum type)
+{
+   if (type == GL_UNSIGNED_BYTE) {
+      switch (format) {
+      case GL_RGB:
+         return read_row_rgb_ubyte;
+      case GL_BGR:
+         return read_row_bgr_ubyte;
+      case GL_BGRA:
+         return read_row_bgra_ubyte;
+      case GL_LUMINANCE:
+         return read_row_luminance_ubyte;
+      case GL_LUMINANCE_ALPHA:
+         return read_row_luminance_alpha_ubyte;
+      default:
+         return NULL;
+      }
+   }
+   else if (type == GL_FLOAT) {
+      switch (format) {
+      case GL_RGBA:
+         return read_row_rgba_float;
+      case GL_RGB:
+         return read_row_rgb_float;
+      case GL_BGRA:
+         return read_row_bgra_float;
+      case GL_LUMINANCE:
+         return read_row_luminance_float;
+      default:
+         return NULL;
+      }
+   }
+   return NULL;
+}
+
+
+/**
+ * Don't give a thread a band of fewer pixels than this.
+ */
+#define MIN_BAND_PIXELS (64 * 1024)
+
+
+/**
+ * A band of rows for read_rows(), so large images can be read on several
+ * threads.
+ */
+struct read_rows
+{
+   GLcontext *ctx;
+   struct gl_renderbuffer *rb;
+   read_row_func convert;      /**< NULL to read straight into dest */
+   GLboolean clampLum;
+   GLint x, y, width, height;
+   GLubyte *dest;
+   GLint dstStride;
+   GLint rowsPerBand;
+};
+
+
+static void
+read_rows(void *data, GLuint band, GLuint thread)
+{
+   const struct read_rows *r = (const struct read_rows *) data;
+   const GLint first = band * r->rowsPerBand;
+   const GLint last = MIN2(first + r->rowsPerBand, r->height);
+   GLubyte *dest = r->dest + first * r->dstStride;
+   GLint row;
+
+   (void) thread;
+
+   for (row = first; row < last; row++) {
+      if (r->convert) {
+         GLubyte tempRow[MAX_WIDTH][4];
+         r->rb->GetRow(r->ctx, r->rb, r->width, r->x, r->y + row, tempRow);
+         r->convert(r->width, (CONST GLubyte (*)[4]) tempRow, dest,
+                    r->clampLum);
+      }
+      else {
+         r->rb->GetRow(r->ctx, r->rb, r->width, r->x, r->y + row, dest);
+      }
+      dest += r->dstStride;
+   }
+}
+
+
 /**
  * Optimized glReadPixels for particular pixel formats when pixel
  * scaling, biasing, mapping, etc. are disabled.
@@ -210,7 +516,11 @@ fast_read_rgba_pixels( GLcontext *ctx,
                        const struct gl_pixelstore_attrib *packing,
                        GLbitfield transferOps)
 {
-   struct gl_renderbuffer *rb = ctx->ReadBuffer->_ColorReadBuffer;
+   struct gl_framebuffer *fb = ctx->ReadBuffer;
+   struct gl_renderbuffer *rb = fb->_ColorReadBuffer;
+   struct _mesa_threadpool *pool;
+   struct read_rows rows;
+   GLuint numBands;
 
    if (!rb)
       return GL_FALSE;
@@ -222,54 +532,61 @@ fast_read_rgba_pixels( GLcontext *ctx,
    ASSERT(y + height <= (GLint) rb->Height);
 
    /* check for things we can't handle here */
-   if (transferOps ||
-       packing->SwapBytes ||
+   if (packing->SwapBytes ||
        packing->LsbFirst) {
       return GL_FALSE;
    }
 
-   if (format == GL_RGBA && rb->DataType == type) {
-      const GLint dstStride = _mesa_image_row_stride(packing, width,
-                                                     format, type);
-      GLubyte *dest
-         = (GLubyte *) _mesa_image_address2d(packing, pixels, width, height,
-                                             format, type, 0, 0);
-      GLint row;
-      ASSERT(rb->GetRow);
-      for (row = 0; row < height; row++) {
-         rb->GetRow(ctx, rb, width, x, y + row, dest);
-         dest += dstStride;
-      }
-      return GL_TRUE;
+   if (!transferOps && format == GL_RGBA && rb->DataType == type) {
+      rows.convert = NULL;
    }
-
-   if (format == GL_RGB &&
-       rb->DataType == GL_UNSIGNED_BYTE &&
-       type == GL_UNSIGNED_BYTE) {
-      const GLint dstStride = _mesa_image_row_stride(packing, width,
-                                                     format, type);
-      GLubyte *dest
-         = (GLubyte *) _mesa_image_address2d(packing, pixels, width, height,
-                                             format, type, 0, 0);
-      GLint row;
-      ASSERT(rb->GetRow);
-      for (row = 0; row < height; row++) {
-         GLubyte tempRow[MAX_WIDTH][4];
-         GLint col;
-         rb->GetRow(ctx, rb, width, x, y + row, tempRow);
-         /* convert RGBA to RGB */
-         for (col = 0; col < width; col++) {
-            dest[col * 3 + 0] = tempRow[col][0];
-            dest[col * 3 + 1] = tempRow[col][1];
-            dest[col * 3 + 2] = tempRow[col][2];
-         }
-         dest += dstStride;
-      }
-      return GL_TRUE;
+   else if (rb->DataType == GL_UNSIGNED_BYTE &&
+            (transferOps & ~IMAGE_CLAMP_BIT) == 0 &&
+            fb->Visual.redBits >= 8 &&
+            fb->Visual.greenBits >= 8 &&
+            fb->Visual.blueBits >= 8) {
+      /* GLubyte colors are in [0,1] already, so clamping is a no-op.
+       * Shallow color buffers need adjust_colors() though.
+       */
+      rows.convert = choose_read_row_func(format, type);
+      if (!rows.convert)
+         return GL_FALSE;
+   }
+   else {
+      /* not handled */
+      return GL_FALSE;
    }
 
-   /* not handled */
-   return GL_FALSE;
+   ASSERT(rb->GetRow);
+   rows.ctx = ctx;
+   rows.rb = rb;
+   rows.clampLum = ctx->Color.ClampReadColor == GL_TRUE;
+   rows.x = x;
+   rows.y = y;
+   rows.width = width;
+   rows.height = height;
+   rows.dest = (GLubyte *) _mesa_image_address2d(packing, pixels, width, height,
+                                                 format, type, 0, 0);
+   rows.dstStride = _mesa_image_row_stride(packing, width, format, type);
+
+   /* Large images are done in bands of rows on several threads.
+    * Only renderbuffers kept in plain memory (rb->Data) are banded;
+    * driver GetRow functions (e.g. XGetImage in the Xlib driver) may
+    * not be called from several threads at once.
+    */
+   pool = _mesa_get_threadpool();
+   if (rb->Data)
+      numBands = MIN2(_mesa_threadpool_size(pool),
+                      MAX2(width * height / MIN_BAND_PIXELS, 1));
+   else
+      numBands = 1;
+   rows.rowsPerBand = (height + numBands - 1) / numBands;
+   if (numBands > 1)
+      _mesa_threadpool_run(pool, numBands, read_rows, &rows);
+   else
+      read_rows(&rows, 0, 0);
+
+   return GL_TRUE;
 }
 
 
@@ -405,7 +722,7 @@ read_rgba_pixels( GLcontext *ctx,
       /* no convolution */
       const GLint dstStride
          = _mesa_image_row_stride(packing, width, format, type);
-      GLfloat (*rgba)[4] = swrast->SpanArrays->attribs[FRAG_ATTRIB_COL0];
+      GLfloat (*rgba)[4] = swrast->Thread.SpanArrays->attribs[FRAG_ATTRIB_COL0];
       GLint row;
       GLubyte *dst
          = (GLubyte *) _mesa_image_address2d(packing, pixels, width, height,
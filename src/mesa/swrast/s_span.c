@@ -1247,7 +1247,8 @@ _swrast_write_rgba_span( GLcontext *ctx, SWspan *span)
    void * const origRgba = span->array->rgba;
    const GLboolean shader = (ctx->FragmentProgram._Current
                              || ctx->ATIFragmentShader._Enabled);
-   const GLboolean shaderOrTexture = shader || ctx->Texture._EnabledUnits;
+   const GLboolean shaderOrTexture = shader ||
+      (ctx->Texture._EnabledUnits && !(span->arrayMask & SPAN_TEXTURED));
    struct gl_framebuffer *fb = ctx->DrawBuffer;
    GLuint output;
 
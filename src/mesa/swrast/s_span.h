@@ -48,6 +48,7 @@
 #define SPAN_MASK       0x20  /**< was array.mask[] filled in by caller? */
 #define SPAN_LAMBDA     0x40  /**< array.lambda[] valid? */
 #define SPAN_COVERAGE   0x80  /**< array.coverage[] valid? */
+#define SPAN_TEXTURED   0x100 /**< arrayMask: array.rgba[] already textured */
 /*@}*/
 
 
@@ -167,7 +168,7 @@ do {						\
    (S).arrayAttribs = 0x0;			\
    (S).end = 0;					\
    (S).facing = 0;				\
-   (S).array = SWRAST_CONTEXT(ctx)->SpanArrays;	\
+   (S).array = SWRAST_THREAD(ctx)->SpanArrays;	\
 } while (0)
 
 
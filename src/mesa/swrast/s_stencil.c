@@ -33,6 +33,170 @@
 #include "s_span.h"
 
 
+#if defined(__SSE2__) && STENCIL_BITS == 8
+
+/*
+ * SSE2 versions of the stencil test and stencil ops, sixteen 8-bit
+ * stencil values at a time.  The results are identical to the C loops
+ * below, which handle the remaining n % 16 values.
+ *
+ * SSE2 only has signed byte compares so values are biased by flipping
+ * the top bit when comparing.
+ */
+#define USE_SSE2_STENCIL 1
+
+#include <emmintrin.h>
+
+
+/**
+ * Return all ones in the bytes where a < b, as unsigned values.
+ */
+static INLINE __m128i
+sse2_cmplt_epu8(__m128i a, __m128i b)
+{
+   const __m128i bias = _mm_set1_epi8((char) 0x80);
+   return _mm_cmplt_epi8(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+}
+
+
+static INLINE GLboolean
+sse2_stencil_op_ok(GLenum oper)
+{
+   switch (oper) {
+   case GL_ZERO:
+   case GL_REPLACE:
+   case GL_INCR:
+   case GL_DECR:
+   case GL_INCR_WRAP_EXT:
+   case GL_DECR_WRAP_EXT:
+   case GL_INVERT:
+      return GL_TRUE;
+   default:
+      return GL_FALSE;
+   }
+}
+
+
+/**
+ * apply_stencil_op() for n a multiple of 16.  All the ops are done as
+ * stencil = (invmask & s) | (wrtmask & op(s)) where mask[i] is set.
+ */
+static void
+apply_stencil_op_sse2( const GLcontext *ctx, GLenum oper, GLuint face,
+                       GLuint n, GLstencil stencil[], const GLubyte mask[] )
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i ones = _mm_cmpeq_epi8(zero, zero);
+   const __m128i ref = _mm_set1_epi8((char) ctx->Stencil.Ref[face]);
+   const __m128i wrtmask = _mm_set1_epi8((char) ctx->Stencil.WriteMask[face]);
+   const __m128i stencilMax =
+      _mm_set1_epi8((char) ((1 << ctx->DrawBuffer->Visual.stencilBits) - 1));
+   GLuint i;
+
+   ASSERT((n & 15) == 0);
+
+   for (i = 0; i < n; i += 16) {
+      const __m128i m = _mm_loadu_si128((const __m128i *) (mask + i));
+      const __m128i s = _mm_loadu_si128((const __m128i *) (stencil + i));
+      /* bits of s which may change */
+      const __m128i wrt = _mm_andnot_si128(_mm_cmpeq_epi8(m, zero), wrtmask);
+      __m128i op;
+
+      switch (oper) {
+      case GL_ZERO:
+         op = zero;
+         break;
+      case GL_REPLACE:
+         op = ref;
+         break;
+      case GL_INCR:
+         /* subtracting all ones adds one */
+         op = _mm_sub_epi8(s, sse2_cmplt_epu8(s, stencilMax));
+         break;
+      case GL_DECR:
+         op = _mm_subs_epu8(s, _mm_set1_epi8(1));
+         break;
+      case GL_INCR_WRAP_EXT:
+         op = _mm_sub_epi8(s, ones);
+         break;
+      case GL_DECR_WRAP_EXT:
+         op = _mm_add_epi8(s, ones);
+         break;
+      default:
+         ASSERT(oper == GL_INVERT);
+         op = _mm_xor_si128(s, ones);
+      }
+
+      _mm_storeu_si128((__m128i *) (stencil + i),
+                       _mm_or_si128(_mm_andnot_si128(wrt, s),
+                                    _mm_and_si128(wrt, op)));
+   }
+}
+
+
+static INLINE GLboolean
+sse2_stencil_func_ok(GLenum func)
+{
+   return func != GL_ALWAYS && func != GL_NEVER;
+}
+
+
+/**
+ * The comparison part of do_stencil_test() for n a multiple of 16.
+ */
+static void
+stencil_test_sse2( GLcontext *ctx, GLuint face, GLuint n,
+                   const GLstencil stencil[], GLubyte mask[], GLubyte fail[] )
+{
+   const GLenum func = ctx->Stencil.Function[face];
+   const __m128i valueMask = _mm_set1_epi8((char) ctx->Stencil.ValueMask[face]);
+   const __m128i r = _mm_and_si128(_mm_set1_epi8((char) ctx->Stencil.Ref[face]),
+                                   valueMask);
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i one = _mm_set1_epi8(1);
+   GLuint i;
+
+   ASSERT((n & 15) == 0);
+
+   for (i = 0; i < n; i += 16) {
+      const __m128i m = _mm_loadu_si128((const __m128i *) (mask + i));
+      const __m128i s = _mm_and_si128(_mm_loadu_si128((const __m128i *)
+                                                      (stencil + i)),
+                                      valueMask);
+      __m128i pass, f;
+
+      switch (func) {
+      case GL_LESS:
+         pass = sse2_cmplt_epu8(r, s);
+         break;
+      case GL_LEQUAL:
+         pass = _mm_cmpeq_epi8(_mm_min_epu8(r, s), r);
+         break;
+      case GL_GREATER:
+         pass = sse2_cmplt_epu8(s, r);
+         break;
+      case GL_GEQUAL:
+         pass = _mm_cmpeq_epi8(_mm_max_epu8(r, s), r);
+         break;
+      case GL_EQUAL:
+         pass = _mm_cmpeq_epi8(r, s);
+         break;
+      default:
+         ASSERT(func == GL_NOTEQUAL);
+         pass = _mm_andnot_si128(_mm_cmpeq_epi8(r, s), _mm_cmpeq_epi8(r, r));
+      }
+
+      /* fail = mask && !pass */
+      f = _mm_andnot_si128(_mm_or_si128(pass, _mm_cmpeq_epi8(m, zero)),
+                           one);
+      _mm_storeu_si128((__m128i *) (fail + i), f);
+      _mm_storeu_si128((__m128i *) (mask + i), _mm_and_si128(m, pass));
+   }
+}
+
+#endif /* USE_SSE2_STENCIL */
+
+
 
 /* Stencil Logic:
 
@@ -70,6 +234,16 @@ apply_stencil_op( const GLcontext *ctx, GLenum oper, GLuint face,
    const GLstencil stencilMax = (1 << ctx->DrawBuffer->Visual.stencilBits) - 1;
    GLuint i;
 
+#ifdef USE_SSE2_STENCIL
+   if (n >= 16 && sse2_stencil_op_ok(oper)) {
+      const GLuint n16 = n & ~15;
+      apply_stencil_op_sse2(ctx, oper, face, n16, stencil, mask);
+      stencil += n16;
+      mask += n16;
+      n -= n16;
+   }
+#endif
+
    switch (oper) {
       case GL_KEEP:
          /* do nothing */
@@ -230,12 +404,20 @@ do_stencil_test( GLcontext *ctx, GLuint face, GLuint n, GLstencil stencil[],
 {
    GLubyte fail[MAX_WIDTH];
    GLboolean allfail = GL_FALSE;
-   GLuint i;
+   GLuint i, start = 0;
    GLstencil r, s;
    const GLuint valueMask = ctx->Stencil.ValueMask[face];
 
    ASSERT(n <= MAX_WIDTH);
 
+#ifdef USE_SSE2_STENCIL
+   if (n >= 16 && sse2_stencil_func_ok(ctx->Stencil.Function[face])) {
+      /* the loops below finish off the last n % 16 values */
+      start = n & ~15;
+      stencil_test_sse2(ctx, face, start, stencil, mask, fail);
+   }
+#endif
+
    /*
     * Perform stencil test.  The results of this operation are stored
     * in the fail[] array:
@@ -261,7 +443,7 @@ do_stencil_test( GLcontext *ctx, GLuint face, GLuint n, GLstencil stencil[],
 	 break;
       case GL_LESS:
 	 r = (GLstencil) (ctx->Stencil.Ref[face] & valueMask);
-	 for (i=0;i<n;i++) {
+	 for (i=start;i<n;i++) {
 	    if (mask[i]) {
 	       s = (GLstencil) (stencil[i] & valueMask);
 	       if (r < s) {
@@ -280,7 +462,7 @@ do_stencil_test( GLcontext *ctx, GLuint face, GLuint n, GLstencil stencil[],
 	 break;
       case GL_LEQUAL:
 	 r = (GLstencil) (ctx->Stencil.Ref[face] & valueMask);
-	 for (i=0;i<n;i++) {
+	 for (i=start;i<n;i++) {
 	    if (mask[i]) {
 	       s = (GLstencil) (stencil[i] & valueMask);
 	       if (r <= s) {
@@ -299,7 +481,7 @@ do_stencil_test( GLcontext *ctx, GLuint face, GLuint n, GLstencil stencil[],
 	 break;
       case GL_GREATER:
 	 r = (GLstencil) (ctx->Stencil.Ref[face] & valueMask);
-	 for (i=0;i<n;i++) {
+	 for (i=start;i<n;i++) {
 	    if (mask[i]) {
 	       s = (GLstencil) (stencil[i] & valueMask);
 	       if (r > s) {
@@ -318,7 +500,7 @@ do_stencil_test( GLcontext *ctx, GLuint face, GLuint n, GLstencil stencil[],
 	 break;
       case GL_GEQUAL:
 	 r = (GLstencil) (ctx->Stencil.Ref[face] & valueMask);
-	 for (i=0;i<n;i++) {
+	 for (i=start;i<n;i++) {
 	    if (mask[i]) {
 	       s = (GLstencil) (stencil[i] & valueMask);
 	       if (r >= s) {
@@ -337,7 +519,7 @@ do_stencil_test( GLcontext *ctx, GLuint face, GLuint n, GLstencil stencil[],
 	 break;
       case GL_EQUAL:
 	 r = (GLstencil) (ctx->Stencil.Ref[face] & valueMask);
-	 for (i=0;i<n;i++) {
+	 for (i=start;i<n;i++) {
 	    if (mask[i]) {
 	       s = (GLstencil) (stencil[i] & valueMask);
 	       if (r == s) {
@@ -356,7 +538,7 @@ do_stencil_test( GLcontext *ctx, GLuint face, GLuint n, GLstencil stencil[],
 	 break;
       case GL_NOTEQUAL:
 	 r = (GLstencil) (ctx->Stencil.Ref[face] & valueMask);
-	 for (i=0;i<n;i++) {
+	 for (i=start;i<n;i++) {
 	    if (mask[i]) {
 	       s = (GLstencil) (stencil[i] & valueMask);
 	       if (r != s) {
@@ -1076,6 +1076,7 @@ void
 _swrast_texture_span( GLcontext *ctx, SWspan *span )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   GLchan *texelBuffer = SWRAST_THREAD(ctx)->TexelBuffer;
    GLchan primary_rgba[MAX_WIDTH][4];
    GLuint unit;
 
@@ -1100,7 +1101,7 @@ _swrast_texture_span( GLcontext *ctx, SWspan *span )
          const struct gl_texture_object *curObj = texUnit->_Current;
          GLfloat *lambda = span->array->lambda[unit];
          GLchan (*texels)[4] = (GLchan (*)[4])
-            (swrast->TexelBuffer + unit * (span->end * 4 * sizeof(GLchan)));
+            (texelBuffer + unit * (span->end * 4 * sizeof(GLchan)));
 
          /* adjust texture lod (lambda) */
          if (span->arrayMask & SPAN_LAMBDA) {
@@ -1154,13 +1155,13 @@ _swrast_texture_span( GLcontext *ctx, SWspan *span )
          if (texUnit->_CurrentCombine != &texUnit->_EnvMode ) {
             texture_combine( ctx, unit, span->end,
                              (CONST GLchan (*)[4]) primary_rgba,
-                             swrast->TexelBuffer,
+                             texelBuffer,
                              span->array->rgba );
          }
          else {
             /* conventional texture blend */
             const GLchan (*texels)[4] = (const GLchan (*)[4])
-               (swrast->TexelBuffer + unit *
+               (texelBuffer + unit *
                 (span->end * 4 * sizeof(GLchan)));
             texture_apply( ctx, texUnit, span->end,
                            (CONST GLchan (*)[4]) primary_rgba, texels,
@@ -908,6 +908,213 @@ sample_lambda_1d( GLcontext *ctx,
 }
 
 
+/**********************************************************************/
+/*                         Texel tile cache                           */
+/**********************************************************************/
+
+/*
+ * Compressed textures are sampled through a small per-thread cache of
+ * decoded TEXEL_TILE x TEXEL_TILE tiles, much like the texture cache of
+ * a GPU, so that neighbouring fragments don't decode the same texels
+ * over and over.  Only one lookup is needed when a bilinear footprint
+ * lies within a tile.  For uncompressed formats a texel fetch is about
+ * as cheap as a cache lookup, so they bypass the cache.
+ *
+ * Lines are tagged with the texture object's ImageStamp, which is bumped
+ * whenever the object's images change, in any context of the share
+ * group.  The whole cache is flushed on texture state changes, since
+ * texture objects (and the images they own) may be freed and their
+ * memory reused once they're unbound (see _swrast_InvalidateState()).
+ *
+ * Only rasterizing threads use the cache; vertex programs sampling
+ * textures on tnl worker threads fetch texels directly.
+ */
+
+#define TEXEL_TILE_SHIFT 2
+#define TEXEL_TILE (1 << TEXEL_TILE_SHIFT)
+#define TEXEL_CACHE_LINES 512  /**< a power of two */
+
+
+struct swrast_texel_cache_line
+{
+   const struct gl_texture_image *Image;
+   GLuint Stamp;                /**< gl_texture_object::ImageStamp */
+   GLuint Tile;                 /**< tile row << 16 | tile column */
+   GLchan Texels[TEXEL_TILE * TEXEL_TILE][4];
+};
+
+
+struct swrast_texel_cache
+{
+   GLuint Stamp;                /**< SWcontext::TexelCacheStamp */
+   GLuint Hits, Misses;         /**< for profiling */
+   struct swrast_texel_cache_line Line[TEXEL_CACHE_LINES];
+};
+
+
+/**
+ * Return the calling thread's texel cache if the texture is compressed
+ * and the thread is rasterizing, else NULL.
+ */
+static struct swrast_texel_cache *
+get_texel_cache(GLcontext *ctx, const struct gl_texture_object *tObj)
+{
+   const struct gl_texture_image *img = tObj->Image[0][tObj->BaseLevel];
+   const GLuint stamp = SWRAST_CONTEXT(ctx)->TexelCacheStamp;
+   SWthread *thread;
+   struct swrast_texel_cache *cache;
+
+   if (!img || !img->IsCompressed)
+      return NULL;
+
+   thread = _swrast_rasterizing_thread();
+   if (!thread)
+      return NULL;
+
+   cache = thread->TexelCache;
+   if (!cache) {
+      cache = thread->TexelCache = CALLOC_STRUCT(swrast_texel_cache);
+      if (!cache)
+         return NULL;
+      cache->Stamp = stamp - 1;
+   }
+
+   if (cache->Stamp != stamp) {
+      GLuint k;
+      for (k = 0; k < TEXEL_CACHE_LINES; k++)
+         cache->Line[k].Image = NULL;
+      cache->Stamp = stamp;
+   }
+
+   return cache;
+}
+
+
+/**
+ * Decode the tile of img whose first texel is (x, y) into the line.
+ */
+static void
+fill_texel_cache_line(struct swrast_texel_cache_line *line,
+                      const struct gl_texture_image *img,
+                      GLint x, GLint y, GLuint tile)
+{
+   const GLint w = MIN2(TEXEL_TILE, (GLint) img->Width - x);
+   const GLint h = MIN2(TEXEL_TILE, (GLint) img->Height - y);
+   GLint i, j;
+
+   for (j = 0; j < h; j++) {
+      for (i = 0; i < w; i++) {
+         img->FetchTexelc(img, x + i, y + j, 0,
+                          line->Texels[(j << TEXEL_TILE_SHIFT) + i]);
+      }
+   }
+   line->Image = img;
+   line->Stamp = img->TexObject->ImageStamp;
+   line->Tile = tile;
+}
+
+
+/**
+ * Return the cache line holding texel (i, j), decoding its tile on a miss.
+ */
+static INLINE const struct swrast_texel_cache_line *
+texel_cache_lookup(struct swrast_texel_cache *cache,
+                   const struct gl_texture_image *img, GLint i, GLint j)
+{
+   const GLuint ti = (GLuint) i >> TEXEL_TILE_SHIFT;
+   const GLuint tj = (GLuint) j >> TEXEL_TILE_SHIFT;
+   const GLuint tile = (tj << 16) | ti;
+   struct swrast_texel_cache_line *line =
+      &cache->Line[(ti + tj * 67 + img->WidthLog2 * 131) &
+                   (TEXEL_CACHE_LINES - 1)];
+
+   if (line->Image == img && line->Tile == tile &&
+       line->Stamp == img->TexObject->ImageStamp) {
+      cache->Hits++;
+   }
+   else {
+      cache->Misses++;
+      fill_texel_cache_line(line, img, i & ~(TEXEL_TILE - 1),
+                            j & ~(TEXEL_TILE - 1), tile);
+   }
+   return line;
+}
+
+
+#define TEXEL_CACHE_TEXEL(LINE, I, J)                            \
+   (LINE)->Texels[(((J) & (TEXEL_TILE - 1)) << TEXEL_TILE_SHIFT) | \
+                  ((I) & (TEXEL_TILE - 1))]
+
+
+/**
+ * Fetch texel (i, j) of a 2D image, through the cache if there is one.
+ */
+static INLINE void
+fetch_texel_2d(struct swrast_texel_cache *cache,
+               const struct gl_texture_image *img,
+               GLint i, GLint j, GLchan rgba[4])
+{
+   if (cache) {
+      const struct swrast_texel_cache_line *line =
+         texel_cache_lookup(cache, img, i, j);
+      COPY_CHAN4(rgba, TEXEL_CACHE_TEXEL(line, i, j));
+   }
+   else {
+      img->FetchTexelc(img, i, j, 0, rgba);
+   }
+}
+
+
+/**
+ * Fetch the four texels of a bilinear footprint, none of which is a
+ * border color.  When they all lie in one tile only one lookup is needed.
+ */
+static INLINE void
+fetch_texel_quad_2d(struct swrast_texel_cache *cache,
+                    const struct gl_texture_image *img,
+                    GLint i0, GLint j0, GLint i1, GLint j1,
+                    GLchan t00[4], GLchan t10[4],
+                    GLchan t01[4], GLchan t11[4])
+{
+   if (cache && i1 == i0 + 1 && j1 == j0 + 1 &&
+       (i0 & (TEXEL_TILE - 1)) != TEXEL_TILE - 1 &&
+       (j0 & (TEXEL_TILE - 1)) != TEXEL_TILE - 1) {
+      const struct swrast_texel_cache_line *line =
+         texel_cache_lookup(cache, img, i0, j0);
+      COPY_CHAN4(t00, TEXEL_CACHE_TEXEL(line, i0, j0));
+      COPY_CHAN4(t10, TEXEL_CACHE_TEXEL(line, i1, j0));
+      COPY_CHAN4(t01, TEXEL_CACHE_TEXEL(line, i0, j1));
+      COPY_CHAN4(t11, TEXEL_CACHE_TEXEL(line, i1, j1));
+   }
+   else {
+      fetch_texel_2d(cache, img, i0, j0, t00);
+      fetch_texel_2d(cache, img, i1, j0, t10);
+      fetch_texel_2d(cache, img, i0, j1, t01);
+      fetch_texel_2d(cache, img, i1, j1, t11);
+   }
+}
+
+
+/**
+ * Free a thread's texel cache, reporting its hit rate if MESA_PROFILE
+ * is set.
+ */
+void
+_swrast_free_texel_cache(struct swrast_texel_cache *cache)
+{
+   if (!cache)
+      return;
+   if (_mesa_getenv("MESA_PROFILE") && cache->Hits + cache->Misses) {
+      _mesa_printf("swrast texel cache: %u hits, %u misses (%.1f%%)\n",
+                   cache->Hits, cache->Misses,
+                   100.0 * cache->Hits / ((GLdouble) cache->Hits +
+                                          cache->Misses));
+   }
+   _mesa_free(cache);
+}
+
+
+
 /**********************************************************************/
 /*                    2-D Texture Sampling Functions                  */
 /**********************************************************************/
@@ -920,6 +1127,7 @@ static INLINE void
 sample_2d_nearest(GLcontext *ctx,
                   const struct gl_texture_object *tObj,
                   const struct gl_texture_image *img,
+                  struct swrast_texel_cache *cache,
                   const GLfloat texcoord[4],
                   GLchan rgba[])
 {
@@ -940,7 +1148,7 @@ sample_2d_nearest(GLcontext *ctx,
       COPY_CHAN4(rgba, tObj->_BorderChan);
    }
    else {
-      img->FetchTexelc(img, i, j, 0, rgba);
+      fetch_texel_2d(cache, img, i, j, rgba);
    }
 }
 
@@ -954,6 +1162,7 @@ static INLINE void
 sample_2d_linear(GLcontext *ctx,
                  const struct gl_texture_object *tObj,
                  const struct gl_texture_image *img,
+                 struct swrast_texel_cache *cache,
                  const GLfloat texcoord[4],
                  GLchan rgba[])
 {
@@ -982,29 +1191,34 @@ sample_2d_linear(GLcontext *ctx,
    }
 
    /* fetch four texel colors */
-   if (useBorderColor & (I0BIT | J0BIT)) {
-      COPY_CHAN4(t00, tObj->_BorderChan);
-   }
-   else {
-      img->FetchTexelc(img, i0, j0, 0, t00);
-   }
-   if (useBorderColor & (I1BIT | J0BIT)) {
-      COPY_CHAN4(t10, tObj->_BorderChan);
+   if (!useBorderColor) {
+      fetch_texel_quad_2d(cache, img, i0, j0, i1, j1, t00, t10, t01, t11);
    }
    else {
-      img->FetchTexelc(img, i1, j0, 0, t10);
-   }
-   if (useBorderColor & (I0BIT | J1BIT)) {
-      COPY_CHAN4(t01, tObj->_BorderChan);
-   }
-   else {
-      img->FetchTexelc(img, i0, j1, 0, t01);
-   }
-   if (useBorderColor & (I1BIT | J1BIT)) {
-      COPY_CHAN4(t11, tObj->_BorderChan);
-   }
-   else {
-      img->FetchTexelc(img, i1, j1, 0, t11);
+      if (useBorderColor & (I0BIT | J0BIT)) {
+         COPY_CHAN4(t00, tObj->_BorderChan);
+      }
+      else {
+         fetch_texel_2d(cache, img, i0, j0, t00);
+      }
+      if (useBorderColor & (I1BIT | J0BIT)) {
+         COPY_CHAN4(t10, tObj->_BorderChan);
+      }
+      else {
+         fetch_texel_2d(cache, img, i1, j0, t10);
+      }
+      if (useBorderColor & (I0BIT | J1BIT)) {
+         COPY_CHAN4(t01, tObj->_BorderChan);
+      }
+      else {
+         fetch_texel_2d(cache, img, i0, j1, t01);
+      }
+      if (useBorderColor & (I1BIT | J1BIT)) {
+         COPY_CHAN4(t11, tObj->_BorderChan);
+      }
+      else {
+         fetch_texel_2d(cache, img, i1, j1, t11);
+      }
    }
 
    a = FRAC(u);
@@ -1021,6 +1235,7 @@ static INLINE void
 sample_2d_linear_repeat(GLcontext *ctx,
                         const struct gl_texture_object *tObj,
                         const struct gl_texture_image *img,
+                        struct swrast_texel_cache *cache,
                         const GLfloat texcoord[4],
                         GLchan rgba[])
 {
@@ -1042,10 +1257,7 @@ sample_2d_linear_repeat(GLcontext *ctx,
    COMPUTE_LINEAR_REPEAT_TEXEL_LOCATION(texcoord[0], u, width,  i0, i1);
    COMPUTE_LINEAR_REPEAT_TEXEL_LOCATION(texcoord[1], v, height, j0, j1);
 
-   img->FetchTexelc(img, i0, j0, 0, t00);
-   img->FetchTexelc(img, i1, j0, 0, t10);
-   img->FetchTexelc(img, i0, j1, 0, t01);
-   img->FetchTexelc(img, i1, j1, 0, t11);
+   fetch_texel_quad_2d(cache, img, i0, j0, i1, j1, t00, t10, t01, t11);
 
    a = FRAC(u);
    b = FRAC(v);
@@ -1060,10 +1272,12 @@ sample_2d_nearest_mipmap_nearest(GLcontext *ctx,
                                  GLuint n, const GLfloat texcoord[][4],
                                  const GLfloat lambda[], GLchan rgba[][4])
 {
+   struct swrast_texel_cache *cache = get_texel_cache(ctx, tObj);
    GLuint i;
    for (i = 0; i < n; i++) {
       GLint level = nearest_mipmap_level(tObj, lambda[i]);
-      sample_2d_nearest(ctx, tObj, tObj->Image[0][level], texcoord[i], rgba[i]);
+      sample_2d_nearest(ctx, tObj, tObj->Image[0][level], cache,
+                        texcoord[i], rgba[i]);
    }
 }
 
@@ -1075,11 +1289,13 @@ sample_2d_linear_mipmap_nearest(GLcontext *ctx,
                                 GLuint n, const GLfloat texcoord[][4],
                                 const GLfloat lambda[], GLchan rgba[][4])
 {
+   struct swrast_texel_cache *cache = get_texel_cache(ctx, tObj);
    GLuint i;
    ASSERT(lambda != NULL);
    for (i = 0; i < n; i++) {
       GLint level = nearest_mipmap_level(tObj, lambda[i]);
-      sample_2d_linear(ctx, tObj, tObj->Image[0][level], texcoord[i], rgba[i]);
+      sample_2d_linear(ctx, tObj, tObj->Image[0][level], cache,
+                       texcoord[i], rgba[i]);
    }
 }
 
@@ -1091,19 +1307,22 @@ sample_2d_nearest_mipmap_linear(GLcontext *ctx,
                                 GLuint n, const GLfloat texcoord[][4],
                                 const GLfloat lambda[], GLchan rgba[][4])
 {
+   struct swrast_texel_cache *cache = get_texel_cache(ctx, tObj);
    GLuint i;
    ASSERT(lambda != NULL);
    for (i = 0; i < n; i++) {
       GLint level = linear_mipmap_level(tObj, lambda[i]);
       if (level >= tObj->_MaxLevel) {
-         sample_2d_nearest(ctx, tObj, tObj->Image[0][tObj->_MaxLevel],
+         sample_2d_nearest(ctx, tObj, tObj->Image[0][tObj->_MaxLevel], cache,
                            texcoord[i], rgba[i]);
       }
       else {
          GLchan t0[4], t1[4];  /* texels */
          const GLfloat f = FRAC(lambda[i]);
-         sample_2d_nearest(ctx, tObj, tObj->Image[0][level  ], texcoord[i], t0);
-         sample_2d_nearest(ctx, tObj, tObj->Image[0][level+1], texcoord[i], t1);
+         sample_2d_nearest(ctx, tObj, tObj->Image[0][level  ], cache,
+                           texcoord[i], t0);
+         sample_2d_nearest(ctx, tObj, tObj->Image[0][level+1], cache,
+                           texcoord[i], t1);
          lerp_rgba(rgba[i], f, t0, t1);
       }
    }
@@ -1118,19 +1337,22 @@ sample_2d_linear_mipmap_linear( GLcontext *ctx,
                                 GLuint n, const GLfloat texcoord[][4],
                                 const GLfloat lambda[], GLchan rgba[][4] )
 {
+   struct swrast_texel_cache *cache = get_texel_cache(ctx, tObj);
    GLuint i;
    ASSERT(lambda != NULL);
    for (i = 0; i < n; i++) {
       GLint level = linear_mipmap_level(tObj, lambda[i]);
       if (level >= tObj->_MaxLevel) {
-         sample_2d_linear(ctx, tObj, tObj->Image[0][tObj->_MaxLevel],
+         sample_2d_linear(ctx, tObj, tObj->Image[0][tObj->_MaxLevel], cache,
                           texcoord[i], rgba[i]);
       }
       else {
          GLchan t0[4], t1[4];  /* texels */
          const GLfloat f = FRAC(lambda[i]);
-         sample_2d_linear(ctx, tObj, tObj->Image[0][level  ], texcoord[i], t0);
-         sample_2d_linear(ctx, tObj, tObj->Image[0][level+1], texcoord[i], t1);
+         sample_2d_linear(ctx, tObj, tObj->Image[0][level  ], cache,
+                          texcoord[i], t0);
+         sample_2d_linear(ctx, tObj, tObj->Image[0][level+1], cache,
+                          texcoord[i], t1);
          lerp_rgba(rgba[i], f, t0, t1);
       }
    }
@@ -1143,6 +1365,7 @@ sample_2d_linear_mipmap_linear_repeat( GLcontext *ctx,
                                        GLuint n, const GLfloat texcoord[][4],
                                        const GLfloat lambda[], GLchan rgba[][4] )
 {
+   struct swrast_texel_cache *cache = get_texel_cache(ctx, tObj);
    GLuint i;
    ASSERT(lambda != NULL);
    ASSERT(tObj->WrapS == GL_REPEAT);
@@ -1151,30 +1374,299 @@ sample_2d_linear_mipmap_linear_repeat( GLcontext *ctx,
       GLint level = linear_mipmap_level(tObj, lambda[i]);
       if (level >= tObj->_MaxLevel) {
          sample_2d_linear_repeat(ctx, tObj, tObj->Image[0][tObj->_MaxLevel],
-                                 texcoord[i], rgba[i]);
+                                 cache, texcoord[i], rgba[i]);
       }
       else {
          GLchan t0[4], t1[4];  /* texels */
          const GLfloat f = FRAC(lambda[i]);
-         sample_2d_linear_repeat(ctx, tObj, tObj->Image[0][level  ], texcoord[i], t0);
-         sample_2d_linear_repeat(ctx, tObj, tObj->Image[0][level+1], texcoord[i], t1);
+         sample_2d_linear_repeat(ctx, tObj, tObj->Image[0][level  ], cache,
+                                 texcoord[i], t0);
+         sample_2d_linear_repeat(ctx, tObj, tObj->Image[0][level+1], cache,
+                                 texcoord[i], t1);
          lerp_rgba(rgba[i], f, t0, t1);
       }
    }
 }
 
 
+#if defined(__SSE2__) && CHAN_TYPE == GL_UNSIGNED_BYTE
+
+/*
+ * SSE2 versions of the 2D GL_LINEAR and GL_LINEAR_MIPMAP_LINEAR samplers
+ * for MESA_FORMAT_RGBA/RGB textures with GL_REPEAT or GL_CLAMP_TO_EDGE
+ * wrapping (so the border color is never needed).  The four texels of up
+ * to four fragments are gathered directly from the image data, then the
+ * filtering is done with one fragment's RGBA per SSE register.
+ *
+ * The results are bit-exact with the scalar lerp_rgba_2d()/lerp_rgba():
+ * the integer weights are computed the same way and ILERP() is emulated
+ * with floats, which is exact since |IT * (B - A)| < 2^24.
+ */
+#define USE_SSE2_LINEAR_2D 1
+
+#include <emmintrin.h>
+
+
+/**
+ * Can sse2_sample_linear_2d() and friends be used for the given levels?
+ */
+static GLboolean
+sse2_linear_2d_ok(const struct gl_texture_object *tObj,
+                  GLint minLevel, GLint maxLevel)
+{
+   const struct gl_texture_format *format =
+      tObj->Image[0][tObj->BaseLevel]->TexFormat;
+   GLint level;
+
+   if ((tObj->WrapS != GL_REPEAT && tObj->WrapS != GL_CLAMP_TO_EDGE) ||
+       (tObj->WrapT != GL_REPEAT && tObj->WrapT != GL_CLAMP_TO_EDGE))
+      return GL_FALSE;
+
+   if (format->MesaFormat != MESA_FORMAT_RGBA &&
+       format->MesaFormat != MESA_FORMAT_RGB)
+      return GL_FALSE;
+
+   for (level = minLevel; level <= maxLevel; level++) {
+      const struct gl_texture_image *img = tObj->Image[0][level];
+      if (!img || img->Border != 0 || img->TexFormat != format)
+         return GL_FALSE;
+   }
+   return GL_TRUE;
+}
+
+
+/**
+ * Compute the bilinear weights and fetch the four texels for (s,t) of
+ * fragment k.  Corner c (00, 10, 01, 11) is stored at t[16 * c + 4 * k],
+ * so one 16-byte load gets the same corner of four fragments.
+ */
+static INLINE void
+sse2_fetch_linear_2d(GLcontext *ctx, const struct gl_texture_object *tObj,
+                     const struct gl_texture_image *img,
+                     const GLfloat texcoord[4],
+                     GLubyte t[64], GLuint k, GLfloat *ia, GLfloat *ib)
+{
+   const GLint width = img->Width2;
+   const GLint height = img->Height2;
+   const GLubyte *data = (const GLubyte *) img->Data;
+   GLubyte *d00 = t + 4 * k, *d10 = t + 16 + 4 * k;
+   GLubyte *d01 = t + 32 + 4 * k, *d11 = t + 48 + 4 * k;
+   /* initialized only to silence warnings, the wrap modes are checked
+    * by sse2_linear_2d_ok()
+    */
+   GLint i0 = 0, j0 = 0, i1 = 0, j1 = 0;
+   GLfloat u = 0.0F, v = 0.0F;
+
+   ASSERT(k < 4);
+
+   COMPUTE_LINEAR_TEXEL_LOCATIONS(tObj->WrapS, texcoord[0], u, width,  i0, i1);
+   COMPUTE_LINEAR_TEXEL_LOCATIONS(tObj->WrapT, texcoord[1], v, height, j0, j1);
+
+   *ia = (GLfloat) IROUND_POS(FRAC(u) * ILERP_SCALE);
+   *ib = (GLfloat) IROUND_POS(FRAC(v) * ILERP_SCALE);
+
+   if (img->TexFormat->MesaFormat == MESA_FORMAT_RGBA) {
+      COPY_4UBV(d00, data + 4 * (j0 * img->RowStride + i0));
+      COPY_4UBV(d10, data + 4 * (j0 * img->RowStride + i1));
+      COPY_4UBV(d01, data + 4 * (j1 * img->RowStride + i0));
+      COPY_4UBV(d11, data + 4 * (j1 * img->RowStride + i1));
+   }
+   else {
+      const GLubyte *t00 = data + 3 * (j0 * img->RowStride + i0);
+      const GLubyte *t10 = data + 3 * (j0 * img->RowStride + i1);
+      const GLubyte *t01 = data + 3 * (j1 * img->RowStride + i0);
+      const GLubyte *t11 = data + 3 * (j1 * img->RowStride + i1);
+      ASSERT(img->TexFormat->MesaFormat == MESA_FORMAT_RGB);
+      ASSIGN_4V(d00, t00[0], t00[1], t00[2], CHAN_MAX);
+      ASSIGN_4V(d10, t10[0], t10[1], t10[2], CHAN_MAX);
+      ASSIGN_4V(d01, t01[0], t01[1], t01[2], CHAN_MAX);
+      ASSIGN_4V(d11, t11[0], t11[1], t11[2], CHAN_MAX);
+   }
+}
+
+
+/**
+ * ILERP(IT, A, B) for four channels.  IT, A and B hold integer values.
+ */
+static INLINE __m128
+sse2_ilerp(__m128 it, __m128 a, __m128 b)
+{
+   const __m128 x = _mm_mul_ps(_mm_mul_ps(it, _mm_sub_ps(b, a)),
+                               _mm_set1_ps(1.0F / ILERP_SCALE));
+   /* floor(x), as done by the arithmetic shift in ILERP */
+   __m128 f = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+   f = _mm_sub_ps(f, _mm_and_ps(_mm_cmpgt_ps(f, x), _mm_set1_ps(1.0F)));
+   return _mm_add_ps(a, f);
+}
+
+
+/**
+ * Bilinear filtering of the texels gathered by sse2_fetch_linear_2d()
+ * for four fragments.  Returns each fragment's color as integer floats.
+ */
+static INLINE void
+sse2_lerp_2d(const GLubyte t[64], const GLfloat ia[4], const GLfloat ib[4],
+             __m128 result[4])
+{
+   const __m128i zero = _mm_setzero_si128();
+   __m128i c[4][2];
+   GLuint k;
+
+   for (k = 0; k < 4; k++) {
+      const __m128i texels = _mm_loadu_si128((const __m128i *) (t + 16 * k));
+      c[k][0] = _mm_unpacklo_epi8(texels, zero);
+      c[k][1] = _mm_unpackhi_epi8(texels, zero);
+   }
+
+   for (k = 0; k < 4; k++) {
+      const GLuint h = k >> 1;
+      __m128 t00, t10, t01, t11, a, b;
+      if (k & 1) {
+         t00 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(c[0][h], zero));
+         t10 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(c[1][h], zero));
+         t01 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(c[2][h], zero));
+         t11 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(c[3][h], zero));
+      }
+      else {
+         t00 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(c[0][h], zero));
+         t10 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(c[1][h], zero));
+         t01 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(c[2][h], zero));
+         t11 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(c[3][h], zero));
+      }
+      a = _mm_set1_ps(ia[k]);
+      b = _mm_set1_ps(ib[k]);
+      result[k] = sse2_ilerp(b, sse2_ilerp(a, t00, t10),
+                                sse2_ilerp(a, t01, t11));
+   }
+}
+
+
+/**
+ * Store four fragment colors (integer floats in [0,255]).
+ */
+static INLINE void
+sse2_store_rgba(GLchan rgba[][4], const __m128 color[4], GLuint count)
+{
+   const __m128i lo = _mm_packs_epi32(_mm_cvttps_epi32(color[0]),
+                                      _mm_cvttps_epi32(color[1]));
+   const __m128i hi = _mm_packs_epi32(_mm_cvttps_epi32(color[2]),
+                                      _mm_cvttps_epi32(color[3]));
+   const __m128i packed = _mm_packus_epi16(lo, hi);
+   if (count == 4) {
+      _mm_storeu_si128((__m128i *) rgba, packed);
+   }
+   else {
+      GLubyte temp[16];
+      _mm_storeu_si128((__m128i *) temp, packed);
+      _mesa_memcpy(rgba, temp, count * 4 * sizeof(GLchan));
+   }
+}
+
+
+/**
+ * GL_LINEAR sampling of the given image, four fragments at a time.
+ */
+static void
+sse2_sample_2d_linear(GLcontext *ctx, const struct gl_texture_object *tObj,
+                      const struct gl_texture_image *img,
+                      GLuint n, const GLfloat texcoords[][4],
+                      GLchan rgba[][4])
+{
+   GLuint i;
+
+   for (i = 0; i < n; i += 4) {
+      const GLuint count = MIN2(n - i, 4);
+      GLubyte t[64];
+      GLfloat ia[4], ib[4];
+      __m128 color[4];
+      GLuint k;
+
+      for (k = 0; k < count; k++)
+         sse2_fetch_linear_2d(ctx, tObj, img, texcoords[i + k], t, k,
+                              &ia[k], &ib[k]);
+      for (; k < 4; k++)
+         sse2_fetch_linear_2d(ctx, tObj, img, texcoords[i], t, k,
+                              &ia[k], &ib[k]);
+
+      sse2_lerp_2d(t, ia, ib, color);
+      sse2_store_rgba(rgba + i, color, count);
+   }
+}
+
+
+static void
+sse2_sample_linear_2d(GLcontext *ctx,
+                      const struct gl_texture_object *tObj, GLuint n,
+                      const GLfloat texcoords[][4],
+                      const GLfloat lambda[], GLchan rgba[][4])
+{
+   (void) lambda;
+   sse2_sample_2d_linear(ctx, tObj, tObj->Image[0][tObj->BaseLevel],
+                         n, texcoords, rgba);
+}
+
+
+/**
+ * GL_LINEAR_MIPMAP_LINEAR sampling, four fragments at a time.
+ * Fragments at or above the last level are lerped with weight zero,
+ * which returns the first sample unchanged.
+ */
+static void
+sse2_sample_2d_linear_mipmap_linear(GLcontext *ctx,
+                                    const struct gl_texture_object *tObj,
+                                    GLuint n, const GLfloat texcoords[][4],
+                                    const GLfloat lambda[], GLchan rgba[][4])
+{
+   GLuint i;
+
+   for (i = 0; i < n; i += 4) {
+      const GLuint count = MIN2(n - i, 4);
+      GLubyte t0[64], t1[64];
+      GLfloat ia0[4], ib0[4], ia1[4], ib1[4], ic[4];
+      __m128 color0[4], color1[4];
+      GLuint k;
+
+      for (k = 0; k < 4; k++) {
+         const GLuint j = i + (k < count ? k : 0);
+         GLint level = linear_mipmap_level(tObj, lambda[j]);
+         GLint level1;
+         if (level >= tObj->_MaxLevel) {
+            level = level1 = tObj->_MaxLevel;
+            ic[k] = 0.0F;
+         }
+         else {
+            level1 = level + 1;
+            ic[k] = (GLfloat) IROUND_POS(FRAC(lambda[j]) * ILERP_SCALE);
+         }
+         sse2_fetch_linear_2d(ctx, tObj, tObj->Image[0][level], texcoords[j],
+                              t0, k, &ia0[k], &ib0[k]);
+         sse2_fetch_linear_2d(ctx, tObj, tObj->Image[0][level1], texcoords[j],
+                              t1, k, &ia1[k], &ib1[k]);
+      }
+
+      sse2_lerp_2d(t0, ia0, ib0, color0);
+      sse2_lerp_2d(t1, ia1, ib1, color1);
+      for (k = 0; k < 4; k++)
+         color0[k] = sse2_ilerp(_mm_set1_ps(ic[k]), color0[k], color1[k]);
+      sse2_store_rgba(rgba + i, color0, count);
+   }
+}
+
+#endif /* __SSE2__ && CHAN_TYPE == GL_UNSIGNED_BYTE */
+
+
 static void
 sample_nearest_2d( GLcontext *ctx,
                    const struct gl_texture_object *tObj, GLuint n,
                    const GLfloat texcoords[][4],
                    const GLfloat lambda[], GLchan rgba[][4] )
 {
+   struct swrast_texel_cache *cache = get_texel_cache(ctx, tObj);
    GLuint i;
    struct gl_texture_image *image = tObj->Image[0][tObj->BaseLevel];
    (void) lambda;
    for (i=0;i<n;i++) {
-      sample_2d_nearest(ctx, tObj, image, texcoords[i], rgba[i]);
+      sample_2d_nearest(ctx, tObj, image, cache, texcoords[i], rgba[i]);
    }
 }
 
@@ -1186,6 +1678,7 @@ sample_linear_2d( GLcontext *ctx,
                   const GLfloat texcoords[][4],
                   const GLfloat lambda[], GLchan rgba[][4] )
 {
+   struct swrast_texel_cache *cache = get_texel_cache(ctx, tObj);
    GLuint i;
    struct gl_texture_image *image = tObj->Image[0][tObj->BaseLevel];
    (void) lambda;
@@ -1194,12 +1687,13 @@ sample_linear_2d( GLcontext *ctx,
        image->_IsPowerOfTwo &&
        image->Border == 0) {
       for (i=0;i<n;i++) {
-         sample_2d_linear_repeat(ctx, tObj, image, texcoords[i], rgba[i]);
+         sample_2d_linear_repeat(ctx, tObj, image, cache,
+                                 texcoords[i], rgba[i]);
       }
    }
    else {
       for (i=0;i<n;i++) {
-         sample_2d_linear(ctx, tObj, image, texcoords[i], rgba[i]);
+         sample_2d_linear(ctx, tObj, image, cache, texcoords[i], rgba[i]);
       }
    }
 }
@@ -1335,6 +1829,13 @@ sample_lambda_2d( GLcontext *ctx,
          }
          break;
       case GL_LINEAR:
+#ifdef USE_SSE2_LINEAR_2D
+         if (sse2_linear_2d_ok(tObj, tObj->BaseLevel, tObj->BaseLevel)) {
+            sse2_sample_2d_linear(ctx, tObj, tImg, m, texcoords + minStart,
+                                  rgba + minStart);
+            break;
+         }
+#endif
 	 sample_linear_2d(ctx, tObj, m, texcoords + minStart,
 			  NULL, rgba + minStart);
          break;
@@ -1352,6 +1853,15 @@ sample_lambda_2d( GLcontext *ctx,
                                          lambda + minStart, rgba + minStart);
          break;
       case GL_LINEAR_MIPMAP_LINEAR:
+#ifdef USE_SSE2_LINEAR_2D
+         if (sse2_linear_2d_ok(tObj, tObj->BaseLevel, tObj->_MaxLevel)) {
+            sse2_sample_2d_linear_mipmap_linear(ctx, tObj, m,
+                                                texcoords + minStart,
+                                                lambda + minStart,
+                                                rgba + minStart);
+            break;
+         }
+#endif
          if (repeatNoBorderPOT)
             sample_2d_linear_mipmap_linear_repeat(ctx, tObj, m,
                   texcoords + minStart, lambda + minStart, rgba + minStart);
@@ -1392,6 +1902,13 @@ sample_lambda_2d( GLcontext *ctx,
          }
          break;
       case GL_LINEAR:
+#ifdef USE_SSE2_LINEAR_2D
+         if (sse2_linear_2d_ok(tObj, tObj->BaseLevel, tObj->BaseLevel)) {
+            sse2_sample_2d_linear(ctx, tObj, tImg, m, texcoords + magStart,
+                                  rgba + magStart);
+            break;
+         }
+#endif
 	 sample_linear_2d(ctx, tObj, m, texcoords + magStart,
 			  NULL, rgba + magStart);
          break;
@@ -1813,13 +2330,14 @@ sample_nearest_cube(GLcontext *ctx,
                     const GLfloat texcoords[][4], const GLfloat lambda[],
                     GLchan rgba[][4])
 {
+   struct swrast_texel_cache *cache = get_texel_cache(ctx, tObj);
    GLuint i;
    (void) lambda;
    for (i = 0; i < n; i++) {
       const struct gl_texture_image **images;
       GLfloat newCoord[4];
       images = choose_cube_face(tObj, texcoords[i], newCoord);
-      sample_2d_nearest(ctx, tObj, images[tObj->BaseLevel],
+      sample_2d_nearest(ctx, tObj, images[tObj->BaseLevel], cache,
                         newCoord, rgba[i]);
    }
 }
@@ -1831,13 +2349,14 @@ sample_linear_cube(GLcontext *ctx,
                    const GLfloat texcoords[][4],
 		   const GLfloat lambda[], GLchan rgba[][4])
 {
+   struct swrast_texel_cache *cache = get_texel_cache(ctx, tObj);
    GLuint i;
    (void) lambda;
    for (i = 0; i < n; i++) {
       const struct gl_texture_image **images;
       GLfloat newCoord[4];
       images = choose_cube_face(tObj, texcoords[i], newCoord);
-      sample_2d_linear(ctx, tObj, images[tObj->BaseLevel],
+      sample_2d_linear(ctx, tObj, images[tObj->BaseLevel], cache,
                        newCoord, rgba[i]);
    }
 }
@@ -1849,6 +2368,7 @@ sample_cube_nearest_mipmap_nearest(GLcontext *ctx,
                                    GLuint n, const GLfloat texcoord[][4],
                                    const GLfloat lambda[], GLchan rgba[][4])
 {
+   struct swrast_texel_cache *cache = get_texel_cache(ctx, tObj);
    GLuint i;
    ASSERT(lambda != NULL);
    for (i = 0; i < n; i++) {
@@ -1856,7 +2376,7 @@ sample_cube_nearest_mipmap_nearest(GLcontext *ctx,
       GLfloat newCoord[4];
       GLint level = nearest_mipmap_level(tObj, lambda[i]);
       images = choose_cube_face(tObj, texcoord[i], newCoord);
-      sample_2d_nearest(ctx, tObj, images[level], newCoord, rgba[i]);
+      sample_2d_nearest(ctx, tObj, images[level], cache, newCoord, rgba[i]);
    }
 }
 
@@ -1867,6 +2387,7 @@ sample_cube_linear_mipmap_nearest(GLcontext *ctx,
                                   GLuint n, const GLfloat texcoord[][4],
                                   const GLfloat lambda[], GLchan rgba[][4])
 {
+   struct swrast_texel_cache *cache = get_texel_cache(ctx, tObj);
    GLuint i;
    ASSERT(lambda != NULL);
    for (i = 0; i < n; i++) {
@@ -1874,7 +2395,7 @@ sample_cube_linear_mipmap_nearest(GLcontext *ctx,
       GLfloat newCoord[4];
       GLint level = nearest_mipmap_level(tObj, lambda[i]);
       images = choose_cube_face(tObj, texcoord[i], newCoord);
-      sample_2d_linear(ctx, tObj, images[level], newCoord, rgba[i]);
+      sample_2d_linear(ctx, tObj, images[level], cache, newCoord, rgba[i]);
    }
 }
 
@@ -1885,6 +2406,7 @@ sample_cube_nearest_mipmap_linear(GLcontext *ctx,
                                   GLuint n, const GLfloat texcoord[][4],
                                   const GLfloat lambda[], GLchan rgba[][4])
 {
+   struct swrast_texel_cache *cache = get_texel_cache(ctx, tObj);
    GLuint i;
    ASSERT(lambda != NULL);
    for (i = 0; i < n; i++) {
@@ -1893,14 +2415,14 @@ sample_cube_nearest_mipmap_linear(GLcontext *ctx,
       GLint level = linear_mipmap_level(tObj, lambda[i]);
       images = choose_cube_face(tObj, texcoord[i], newCoord);
       if (level >= tObj->_MaxLevel) {
-         sample_2d_nearest(ctx, tObj, images[tObj->_MaxLevel],
+         sample_2d_nearest(ctx, tObj, images[tObj->_MaxLevel], cache,
                            newCoord, rgba[i]);
       }
       else {
          GLchan t0[4], t1[4];  /* texels */
          const GLfloat f = FRAC(lambda[i]);
-         sample_2d_nearest(ctx, tObj, images[level  ], newCoord, t0);
-         sample_2d_nearest(ctx, tObj, images[level+1], newCoord, t1);
+         sample_2d_nearest(ctx, tObj, images[level  ], cache, newCoord, t0);
+         sample_2d_nearest(ctx, tObj, images[level+1], cache, newCoord, t1);
          lerp_rgba(rgba[i], f, t0, t1);
       }
    }
@@ -1913,6 +2435,7 @@ sample_cube_linear_mipmap_linear(GLcontext *ctx,
                                  GLuint n, const GLfloat texcoord[][4],
                                  const GLfloat lambda[], GLchan rgba[][4])
 {
+   struct swrast_texel_cache *cache = get_texel_cache(ctx, tObj);
    GLuint i;
    ASSERT(lambda != NULL);
    for (i = 0; i < n; i++) {
@@ -1921,14 +2444,14 @@ sample_cube_linear_mipmap_linear(GLcontext *ctx,
       GLint level = linear_mipmap_level(tObj, lambda[i]);
       images = choose_cube_face(tObj, texcoord[i], newCoord);
       if (level >= tObj->_MaxLevel) {
-         sample_2d_linear(ctx, tObj, images[tObj->_MaxLevel],
+         sample_2d_linear(ctx, tObj, images[tObj->_MaxLevel], cache,
                           newCoord, rgba[i]);
       }
       else {
          GLchan t0[4], t1[4];
          const GLfloat f = FRAC(lambda[i]);
-         sample_2d_linear(ctx, tObj, images[level  ], newCoord, t0);
-         sample_2d_linear(ctx, tObj, images[level+1], newCoord, t1);
+         sample_2d_linear(ctx, tObj, images[level  ], cache, newCoord, t0);
+         sample_2d_linear(ctx, tObj, images[level+1], cache, newCoord, t1);
          lerp_rgba(rgba[i], f, t0, t1);
       }
    }
@@ -3359,6 +3882,10 @@ _swrast_choose_texture_sample_func( GLcontext *ctx,
             return &sample_lambda_2d;
          }
          else if (t->MinFilter == GL_LINEAR) {
+#ifdef USE_SSE2_LINEAR_2D
+            if (sse2_linear_2d_ok(t, t->BaseLevel, t->BaseLevel))
+               return &sse2_sample_linear_2d;
+#endif
             return &sample_linear_2d;
          }
          else {
@@ -31,9 +31,15 @@
 #include "swrast.h"
 
 
+struct swrast_texel_cache;
+
+
 extern texture_sample_func
 _swrast_choose_texture_sample_func( GLcontext *ctx,
 				    const struct gl_texture_object *tObj );
 
+extern void
+_swrast_free_texel_cache(struct swrast_texel_cache *cache);
+
 
 #endif
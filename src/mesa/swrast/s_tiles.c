@@ -0,0 +1,381 @@
+/*
+ * Mesa 3-D graphics library
+ * Version:  7.1
+ *
+ * Copyright (C) 1999-2007  Brian Paul   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * BRIAN PAUL BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+ * AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file s_tiles.c
+ * Multithreaded triangle rasterization by screen-space binning.
+ *
+ * When enabled (see _swrast_allow_tile_binning()) triangles aren't
+ * rasterized immediately.  Instead, the vertices are saved and the
+ * triangle is appended to the list of each screen tile it may touch.
+ * When the bins are flushed the tiles are handed out to the threads of
+ * the Mesa thread pool.  Each thread rasterizes, shades and depth/stencil
+ * tests the triangles of its tile in submission order, so per-pixel
+ * results are the same as with serial rendering.
+ *
+ * A tile is a band of TILE_HEIGHT full-width rows.  This means the
+ * triangle rasterizers (including the driver-specific ones generated
+ * from s_tritemp.h which write directly into the color/depth buffers)
+ * only need to skip scanlines outside of [SWthread::Ymin, Ymax).
+ *
+ * Each thread has its own SWthread scratch storage (span arrays, texel
+ * buffer, fragment program machine), found with SWRAST_THREAD().
+ *
+ * Bins are flushed at the end of each primitive batch (render_finish),
+ * on any state change, before rendering points or lines, and when the
+ * bins fill up.
+ */
+
+
+#include "glheader.h"
+#include "imports.h"
+#include "macros.h"
+#include "threadpool.h"
+#include "glapi/glthread.h"
+
+#include "s_context.h"
+#include "s_tiles.h"
+
+
+#define TILE_HEIGHT 32          /**< rows per tile */
+#define MAX_BINNED_TRIS 1024    /**< flush after this many triangles */
+
+
+/** A tile's list of triangles (indexes into swrast_tiles::Verts) */
+struct tile_bin {
+   GLuint *Tris;
+   GLuint NumTris;
+   GLuint MaxTris;
+};
+
+
+struct swrast_tiles {
+   struct _mesa_threadpool *Pool;
+   GLuint NumThreads;
+   SWthread Threads[MAX_POOL_THREADS];
+
+   SWvertex (*Verts)[3];        /**< saved vertices of binned triangles */
+   GLuint NumTris;
+
+   struct tile_bin Bins[MAX_HEIGHT / TILE_HEIGHT];
+   GLuint NumBins;              /**< bins in use for current draw buffer */
+
+   GLcontext *Ctx;              /**< for rasterize_tile() */
+};
+
+
+/** Maps each rasterizing thread to its SWthread */
+static _glthread_TSD ThreadTSD;
+
+_glthread_DECLARE_STATIC_MUTEX(ThreadTSDMutex);
+
+
+/**
+ * Create the TSD key.  This must be done before several threads may
+ * use it, so it's called when a context is created.
+ */
+void
+_swrast_init_thread_tsd(void)
+{
+   _glthread_LOCK_MUTEX(ThreadTSDMutex);
+   (void) _glthread_GetTSD(&ThreadTSD);
+   _glthread_UNLOCK_MUTEX(ThreadTSDMutex);
+}
+
+
+/**
+ * Return the SWthread for the calling thread.  Called via SWRAST_THREAD()
+ * only when binning is enabled.
+ */
+SWthread *
+_swrast_get_thread(GLcontext *ctx)
+{
+   SWthread *thread = (SWthread *) _glthread_GetTSD(&ThreadTSD);
+   return thread ? thread : &SWRAST_CONTEXT(ctx)->Thread;
+}
+
+
+/**
+ * Return the SWthread of the calling thread if it's rasterizing: a tile
+ * worker, or the context's thread between _swrast_render_start() and
+ * _swrast_render_finish().  Other threads, such as tnl workers running
+ * a vertex program which samples textures, get NULL.
+ */
+SWthread *
+_swrast_rasterizing_thread(void)
+{
+   return (SWthread *) _glthread_GetTSD(&ThreadTSD);
+}
+
+
+void
+_swrast_set_rasterizing_thread(SWthread *thread)
+{
+   _glthread_SetTSD(&ThreadTSD, thread);
+}
+
+
+/**
+ * Enable triangle binning for the context, if the thread pool has more
+ * than one thread.
+ * \return GL_TRUE if binning is now enabled
+ */
+GLboolean
+_swrast_create_tiles(GLcontext *ctx)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct _mesa_threadpool *pool = _mesa_get_threadpool();
+   const GLuint numThreads = _mesa_threadpool_size(pool);
+   struct swrast_tiles *tiles;
+   GLuint i;
+
+   if (swrast->Tiles)
+      return GL_TRUE;
+
+   if (numThreads < 2)
+      return GL_FALSE;
+
+   tiles = CALLOC_STRUCT(swrast_tiles);
+   if (!tiles)
+      return GL_FALSE;
+
+   tiles->Verts = (SWvertex (*)[3])
+      MALLOC(MAX_BINNED_TRIS * 3 * sizeof(SWvertex));
+   if (!tiles->Verts) {
+      FREE(tiles);
+      return GL_FALSE;
+   }
+
+   for (i = 0; i < numThreads; i++) {
+      if (!_swrast_init_thread(ctx, &tiles->Threads[i]))
+         break;
+   }
+   tiles->NumThreads = i;
+   if (tiles->NumThreads < numThreads) {
+      /* out of memory */
+      swrast->Tiles = tiles;
+      _swrast_destroy_tiles(ctx);
+      return GL_FALSE;
+   }
+
+   tiles->Pool = pool;
+   tiles->Ctx = ctx;
+
+   swrast->Tiles = tiles;
+   return GL_TRUE;
+}
+
+
+void
+_swrast_destroy_tiles(GLcontext *ctx)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct swrast_tiles *tiles = swrast->Tiles;
+   GLuint i;
+
+   if (!tiles)
+      return;
+
+   _swrast_flush_tiles(ctx);
+
+   for (i = 0; i < tiles->NumThreads; i++)
+      _swrast_free_thread(&tiles->Threads[i]);
+
+   for (i = 0; i < MAX_HEIGHT / TILE_HEIGHT; i++) {
+      if (tiles->Bins[i].Tris)
+         FREE(tiles->Bins[i].Tris);
+   }
+
+   FREE(tiles->Verts);
+   FREE(tiles);
+   swrast->Tiles = NULL;
+}
+
+
+/**
+ * Can the current triangles be binned?  Otherwise they must be drawn
+ * immediately on the calling thread.  We need per-pixel independence:
+ * no feedback/selection and no occlusion counting, and only RGBA mode
+ * is handled.
+ */
+GLboolean
+_swrast_can_bin_triangles(GLcontext *ctx)
+{
+   return (ctx->RenderMode == GL_RENDER &&
+           ctx->Visual.rgbMode &&
+           !ctx->Query.CurrentOcclusionObject &&
+           ctx->DrawBuffer->_Ymax - ctx->DrawBuffer->_Ymin > TILE_HEIGHT);
+}
+
+
+/**
+ * Make room for one more triangle in the bin.
+ * \return GL_FALSE if out of memory
+ */
+static GLboolean
+bin_reserve(struct tile_bin *bin)
+{
+   if (bin->NumTris == bin->MaxTris) {
+      const GLuint newMax = bin->MaxTris ? bin->MaxTris * 2 : 64;
+      GLuint *tris = (GLuint *) _mesa_realloc(bin->Tris,
+                                              bin->MaxTris * sizeof(GLuint),
+                                              newMax * sizeof(GLuint));
+      if (!tris)
+         return GL_FALSE;
+      bin->Tris = tris;
+      bin->MaxTris = newMax;
+   }
+   return GL_TRUE;
+}
+
+
+/**
+ * Save a triangle's vertices and add it to the bins of all tiles its
+ * bounding box overlaps.
+ * \return GL_FALSE if the triangle couldn't be binned (out of memory);
+ *         the caller must flush the bins and draw it immediately
+ */
+GLboolean
+_swrast_bin_triangle(GLcontext *ctx, const SWvertex *v0,
+                     const SWvertex *v1, const SWvertex *v2)
+{
+   struct swrast_tiles *tiles = SWRAST_CONTEXT(ctx)->Tiles;
+   const struct gl_framebuffer *fb = ctx->DrawBuffer;
+   const GLfloat y0 = v0->attrib[FRAG_ATTRIB_WPOS][1];
+   const GLfloat y1 = v1->attrib[FRAG_ATTRIB_WPOS][1];
+   const GLfloat y2 = v2->attrib[FRAG_ATTRIB_WPOS][1];
+   GLfloat ymin, ymax;
+   GLint row0, row1, b;
+   GLuint tri;
+
+   if (tiles->NumTris == MAX_BINNED_TRIS)
+      _swrast_flush_tiles(ctx);
+
+   if (tiles->NumTris == 0) {
+      /* starting a new batch */
+      tiles->NumBins = (fb->_Ymax + TILE_HEIGHT - 1) / TILE_HEIGHT;
+      ASSERT(tiles->NumBins <= MAX_HEIGHT / TILE_HEIGHT);
+      for (b = 0; b < (GLint) tiles->NumBins; b++)
+         tiles->Bins[b].NumTris = 0;
+   }
+
+   ymin = MIN2(y0, MIN2(y1, y2));
+   ymax = MAX2(y0, MAX2(y1, y2));
+   if (IS_INF_OR_NAN(ymin) || IS_INF_OR_NAN(ymax))
+      return GL_TRUE; /* the rasterizer would reject it anyway */
+
+   /* Conservative row range (antialiased triangles can touch one more
+    * pixel on each side).
+    */
+   ymin = MAX2(ymin, (GLfloat) fb->_Ymin);
+   ymax = MIN2(ymax, (GLfloat) (fb->_Ymax - 1));
+   row0 = IFLOOR(ymin) - 1;
+   row1 = IFLOOR(ymax) + 1;
+   row0 = MAX2(row0, fb->_Ymin);
+   row1 = MIN2(row1, fb->_Ymax - 1);
+   if (row1 < row0)
+      return GL_TRUE; /* completely above or below the drawing region */
+
+   /* Grow all the bins first so the triangle is never only partly binned */
+   for (b = row0 / TILE_HEIGHT; b <= row1 / TILE_HEIGHT; b++) {
+      if (!bin_reserve(&tiles->Bins[b]))
+         return GL_FALSE;
+   }
+
+   tri = tiles->NumTris++;
+   tiles->Verts[tri][0] = *v0;
+   tiles->Verts[tri][1] = *v1;
+   tiles->Verts[tri][2] = *v2;
+
+   for (b = row0 / TILE_HEIGHT; b <= row1 / TILE_HEIGHT; b++) {
+      struct tile_bin *bin = &tiles->Bins[b];
+      bin->Tris[bin->NumTris++] = tri;
+   }
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Thread pool task: rasterize all the triangles binned for one tile.
+ */
+static void
+rasterize_tile(void *data, GLuint tile, GLuint threadIndex)
+{
+   struct swrast_tiles *tiles = (struct swrast_tiles *) data;
+   GLcontext *ctx = tiles->Ctx;
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   const struct tile_bin *bin = &tiles->Bins[tile];
+   SWthread *thread = &tiles->Threads[threadIndex];
+   SWthread *prevThread;
+   GLuint i;
+
+   if (bin->NumTris == 0)
+      return;
+
+   thread->Ymin = tile * TILE_HEIGHT;
+   thread->Ymax = thread->Ymin + TILE_HEIGHT;
+   /* the calling thread takes part too, so restore its SWthread after */
+   prevThread = (SWthread *) _glthread_GetTSD(&ThreadTSD);
+   _glthread_SetTSD(&ThreadTSD, thread);
+
+   for (i = 0; i < bin->NumTris; i++) {
+      /* The triangle functions may temporarily modify the vertices
+       * (see _swrast_add_spec_terms_triangle()) and other threads are
+       * working on the same triangle, so use a private copy.
+       */
+      SWvertex v[3];
+      const SWvertex *src = tiles->Verts[bin->Tris[i]];
+      v[0] = src[0];
+      v[1] = src[1];
+      v[2] = src[2];
+      swrast->Triangle(ctx, &v[0], &v[1], &v[2]);
+   }
+
+   _glthread_SetTSD(&ThreadTSD, prevThread);
+}
+
+
+/**
+ * Rasterize all binned triangles, using the thread pool.
+ */
+void
+_swrast_flush_tiles(GLcontext *ctx)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct swrast_tiles *tiles = swrast->Tiles;
+
+   if (!tiles || tiles->NumTris == 0)
+      return;
+
+   /* Lazily-validated function pointers must be resolved now, before
+    * other threads read them.
+    */
+   _swrast_validate_for_threads(ctx);
+
+   _mesa_threadpool_run(tiles->Pool, tiles->NumBins, rasterize_tile, tiles);
+
+   tiles->NumTris = 0;
+}
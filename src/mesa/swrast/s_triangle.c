@@ -654,9 +654,6 @@ fast_persp_span(GLcontext *ctx, SWspan *span,
    GLfloat tex_coord[3], tex_step[3];
    GLchan *dest = span->array->rgba[0];
 
-   const GLuint savedTexEnable = ctx->Texture._EnabledUnits;
-   ctx->Texture._EnabledUnits = 0;
-
    tex_coord[0] = span->attrStart[FRAG_ATTRIB_TEX0][0]  * (info->smask + 1);
    tex_step[0] = span->attrStepX[FRAG_ATTRIB_TEX0][0] * (info->smask + 1);
    tex_coord[1] = span->attrStart[FRAG_ATTRIB_TEX0][1] * (info->tmask + 1);
@@ -762,13 +759,12 @@ fast_persp_span(GLcontext *ctx, SWspan *span,
    }
    
    ASSERT(span->arrayMask & SPAN_RGBA);
+   /* the colors are textured already */
+   span->arrayMask |= SPAN_TEXTURED;
    _swrast_write_rgba_span(ctx, span);
 
 #undef SPAN_NEAREST
 #undef SPAN_LINEAR
-
-   /* restore state */
-   ctx->Texture._EnabledUnits = savedTexEnable;
 }
 
 
@@ -127,11 +127,14 @@ static void NAME(GLcontext *ctx, const SWvertex *v0,
    } EdgeT;
 
    const SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   const SWthread *swthread = SWRAST_THREAD(ctx);
 #ifdef INTERP_Z
    const GLint depthBits = ctx->DrawBuffer->Visual.depthBits;
    const GLint fixedToDepthShift = depthBits <= 16 ? FIXED_SHIFT : 0;
    const GLfloat maxDepth = ctx->DrawBuffer->_DepthMaxF;
 #define FixedToDepth(F)  ((F) >> fixedToDepthShift)
+   const struct swrast_hiz *hiz =
+      swrast->_HiZ && _swrast_hiz_current(swrast->_HiZ) ? swrast->_HiZ : NULL;
 #endif
    EdgeT eMaj, eTop, eBot;
    GLfloat oneOverArea;
@@ -843,8 +846,11 @@ static void NAME(GLcontext *ctx, const SWvertex *v0,
                /* This is where we actually generate fragments */
                /* XXX the test for span.y > 0 _shouldn't_ be needed but
                 * it fixes a problem on 64-bit Opterons (bug 4842).
+                * Ymin is zero unless the triangle is rasterized by a
+                * tile thread, which only owns rows [Ymin, Ymax).
                 */
-               if (span.end > 0 && span.y >= 0) {
+               if (span.end > 0 && span.y >= swthread->Ymin &&
+                   span.y < swthread->Ymax) {
                   const GLint len = span.end - 1;
                   (void) len;
 #ifdef INTERP_RGB
@@ -857,6 +863,41 @@ static void NAME(GLcontext *ctx, const SWvertex *v0,
 #endif
 #ifdef INTERP_INDEX
                   CLAMP_INTERPOLANT(index, indexStep, len);
+#endif
+#ifdef INTERP_Z
+                  if (hiz) {
+                     /* Leave off the ends of the span which are hidden.
+                      * The start can't be moved if pixel/depth addresses
+                      * were computed for it already, nor with float
+                      * attributes since stepping them here would round
+                      * differently from interpolating them later.
+                      */
+                     GLint first;
+                     span.end = _swrast_hiz_cull_span(hiz, &span, &first);
+#if !defined(INTERP_ATTRIBS) && !defined(PIXEL_ADDRESS) && !defined(DEPTH_TYPE)
+                     if (first > 0 && span.end > 0) {
+                        span.x += first;
+                        span.end -= first;
+                        span.z += first * span.zStep;
+#ifdef INTERP_RGB
+                        span.red += first * span.redStep;
+                        span.green += first * span.greenStep;
+                        span.blue += first * span.blueStep;
+#endif
+#ifdef INTERP_ALPHA
+                        span.alpha += first * span.alphaStep;
+#endif
+#ifdef INTERP_INDEX
+                        span.index += first * span.indexStep;
+#endif
+#ifdef INTERP_INT_TEX
+                        span.intTex[0] += first * span.intTexStep[0];
+                        span.intTex[1] += first * span.intTexStep[1];
+#endif
+                     }
+#endif
+                  }
+                  if (span.end > 0)
 #endif
                   {
                      RENDER_SPAN( span );
@@ -466,5 +466,6 @@ _swrast_write_zoomed_z_span(GLcontext *ctx, GLint imgX, GLint imgY,
    /* write the zoomed spans */
    for (y = y0; y < y1; y++) {
       rb->PutRow(ctx, rb, zoomedWidth, x0, y, z, NULL);
+      _swrast_hiz_update(ctx, rb, x0, y, zoomedWidth, 1);
    }
 }
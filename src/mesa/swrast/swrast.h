@@ -195,6 +195,9 @@ _swrast_allow_vertex_fog( GLcontext *ctx, GLboolean value );
 extern void
 _swrast_allow_pixel_fog( GLcontext *ctx, GLboolean value );
 
+extern void
+_swrast_allow_tile_binning( GLcontext *ctx, GLboolean value );
+
 /* Debug:
  */
 extern void
@@ -385,18 +385,6 @@ struct tnl_clipspace
 };
 
 
-struct tnl_cache_item {
-   GLuint hash;
-   void *key;
-   void *data;
-   struct tnl_cache_item *next;
-};
-
-struct tnl_cache {
-   struct tnl_cache_item **items;
-   GLuint size, n_items;
-};
-
 
 struct tnl_device_driver
 {
@@ -529,6 +517,9 @@ typedef struct
    struct tnl_pipeline pipeline;
    struct vertex_buffer vb;
 
+   /** For splitting per-vertex work between threads, see _tnl_run_chunked() */
+   struct _mesa_threadpool *ThreadPool;
+
    /* Clipspace/ndc/window vertex managment:
     */
    struct tnl_clipspace clipspace;
@@ -549,10 +540,6 @@ typedef struct
    GLubyte *block[VERT_ATTRIB_MAX];
    GLuint nr_blocks;
 
-   /* Cache of fixed-function-replacing vertex programs:
-    */
-   struct tnl_cache *vp_cache;
-
 } TNLcontext;
 
 
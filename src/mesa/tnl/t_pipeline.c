@@ -28,8 +28,10 @@
 #include "main/glheader.h"
 #include "main/context.h"
 #include "main/imports.h"
+#include "main/macros.h"
 #include "main/state.h"
 #include "main/mtypes.h"
+#include "main/threadpool.h"
 
 #include "t_context.h"
 #include "t_pipeline.h"
@@ -163,6 +165,80 @@ void _tnl_run_pipeline( GLcontext *ctx )
 }
 
 
+/** Don't hand fewer vertices than this to a thread */
+#define MIN_CHUNK_SIZE 256
+
+
+struct chunk_run {
+   GLcontext *ctx;
+   tnl_chunk_func func;
+   void *data;
+   GLuint count;
+   GLuint chunkSize;
+};
+
+
+static void
+run_chunk( void *data, GLuint chunk, GLuint thread )
+{
+   const struct chunk_run *run = (const struct chunk_run *) data;
+   const GLuint start = chunk * run->chunkSize;
+   unsigned short __tmp;
+
+   START_FAST_MATH(__tmp);
+   run->func( run->ctx, run->data, chunk, start,
+              MIN2(run->chunkSize, run->count - start), thread );
+   END_FAST_MATH(__tmp);
+}
+
+
+/**
+ * Split vertices [0, count) into chunks and call func on each of them,
+ * using the Mesa thread pool.  Small counts are done in a single chunk
+ * on the calling thread.  Chunk and thread numbers passed to func are
+ * less than MAX_POOL_THREADS, for indexing per-chunk results and
+ * per-thread scratch storage.
+ */
+void _tnl_run_chunked( GLcontext *ctx, GLuint count,
+		       tnl_chunk_func func, void *data )
+{
+   TNLcontext *tnl = TNL_CONTEXT(ctx);
+   const GLuint threads = _mesa_threadpool_size(tnl->ThreadPool);
+   struct chunk_run run;
+   GLuint numChunks = MIN2(threads, count / MIN_CHUNK_SIZE);
+
+   if (numChunks <= 1) {
+      func( ctx, data, 0, 0, count, 0 );
+      return;
+   }
+
+   run.ctx = ctx;
+   run.func = func;
+   run.data = data;
+   run.count = count;
+   /* multiple of four, for code which works on four vertices at once */
+   run.chunkSize = ((count + numChunks - 1) / numChunks + 3) & ~3;
+   numChunks = (count + run.chunkSize - 1) / run.chunkSize;
+
+   _mesa_threadpool_run( tnl->ThreadPool, numChunks, run_chunk, &run );
+}
+
+
+/**
+ * Make chunk a view of elements [start, start + count) of vector v.
+ */
+void _tnl_vector4f_chunk( GLvector4f *chunk, const GLvector4f *v,
+			  GLuint start, GLuint count )
+{
+   *chunk = *v;
+   chunk->data = (GLfloat (*)[4]) ((GLubyte *) v->data + start * v->stride);
+   chunk->start = (GLfloat *) ((GLubyte *) v->start + start * v->stride);
+   chunk->count = count;
+   chunk->flags &= ~VEC_MALLOC;
+   chunk->storage = NULL;
+}
+
+
 
 /* The default pipeline.  This is useful for software rasterizers, and
  * simple hardware rasterizers.  For customization, I don't recommend
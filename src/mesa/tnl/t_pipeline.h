@@ -41,6 +41,20 @@ extern void _tnl_install_pipeline( GLcontext *ctx,
 				   const struct tnl_pipeline_stage **stages );
 
 
+/**
+ * Callback for _tnl_run_chunked(), processes vertices
+ * [start, start + count) of the vertex buffer.
+ */
+typedef void (*tnl_chunk_func)( GLcontext *ctx, void *data, GLuint chunk,
+				GLuint start, GLuint count, GLuint thread );
+
+extern void _tnl_run_chunked( GLcontext *ctx, GLuint count,
+			      tnl_chunk_func func, void *data );
+
+extern void _tnl_vector4f_chunk( GLvector4f *chunk, const GLvector4f *v,
+				 GLuint start, GLuint count );
+
+
 /* These are implemented in the t_vb_*.c files:
  */
 extern const struct tnl_pipeline_stage _tnl_vertex_transform_stage;
@@ -194,6 +194,107 @@ static void init_lighting_tables( void )
 }
 
 
+/**
+ * For lighting large vertex buffers on several threads.  Each chunk is
+ * lit by running the light function on a copy of the vertex buffer and
+ * stage data whose vectors only cover the chunk.
+ */
+struct light_chunk_data {
+   struct tnl_pipeline_stage *stage;
+   light_func func;
+   GLvector4f *input;
+
+   /** Outputs which chunk 0's light function set up */
+   /*@{*/
+   GLboolean color[2], secondary[2], index[2];
+   GLuint colorStride[2];
+   /*@}*/
+};
+
+
+static void
+light_chunk(GLcontext *ctx, void *data, GLuint chunk,
+            GLuint start, GLuint count, GLuint thread)
+{
+   struct light_chunk_data *d = (struct light_chunk_data *) data;
+   const struct light_stage_data *store = LIGHT_STAGE_DATA(d->stage);
+   struct vertex_buffer *VB = &TNL_CONTEXT(ctx)->vb;
+   struct vertex_buffer chunkVB;
+   struct light_stage_data chunkStore;
+   struct tnl_pipeline_stage chunkStage;
+   GLvector4f input, normal;
+   GLuint side;
+
+   (void) thread;
+
+   chunkVB = *VB;
+   chunkVB.Count = count;
+   _tnl_vector4f_chunk(&normal, VB->AttribPtr[_TNL_ATTRIB_NORMAL],
+                       start, count);
+   chunkVB.AttribPtr[_TNL_ATTRIB_NORMAL] = &normal;
+   _tnl_vector4f_chunk(&input, d->input, start, count);
+
+   chunkStore = *store;
+   for (side = 0; side < 2; side++) {
+      _tnl_vector4f_chunk(&chunkStore.LitColor[side],
+                          &store->LitColor[side], start, count);
+      _tnl_vector4f_chunk(&chunkStore.LitSecondary[side],
+                          &store->LitSecondary[side], start, count);
+      _tnl_vector4f_chunk(&chunkStore.LitIndex[side],
+                          &store->LitIndex[side], start, count);
+   }
+   chunkStage = *d->stage;
+   chunkStage.privatePtr = &chunkStore;
+
+   d->func( ctx, &chunkVB, &chunkStage, &input );
+
+   if (chunk == 0) {
+      for (side = 0; side < 2; side++) {
+         d->color[side] = chunkVB.ColorPtr[side] == &chunkStore.LitColor[side];
+         d->secondary[side] = (chunkVB.SecondaryColorPtr[side] ==
+                               &chunkStore.LitSecondary[side]);
+         d->index[side] = chunkVB.IndexPtr[side] == &chunkStore.LitIndex[side];
+         d->colorStride[side] = chunkStore.LitColor[side].stride;
+      }
+   }
+}
+
+
+/**
+ * Run the light function over the vertex buffer in chunks, see
+ * _tnl_run_chunked().
+ */
+static void
+light_chunked(GLcontext *ctx, struct tnl_pipeline_stage *stage,
+              light_func func, GLvector4f *input)
+{
+   struct light_stage_data *store = LIGHT_STAGE_DATA(stage);
+   struct vertex_buffer *VB = &TNL_CONTEXT(ctx)->vb;
+   struct light_chunk_data d;
+   GLuint side;
+
+   d.stage = stage;
+   d.func = func;
+   d.input = input;
+
+   /* the chunks' colors are found at this stride */
+   store->LitColor[0].stride = 16;
+   store->LitColor[1].stride = 16;
+
+   _tnl_run_chunked(ctx, VB->Count, light_chunk, &d);
+
+   for (side = 0; side < 2; side++) {
+      store->LitColor[side].stride = d.colorStride[side];
+      if (d.color[side])
+         VB->ColorPtr[side] = &store->LitColor[side];
+      if (d.secondary[side])
+         VB->SecondaryColorPtr[side] = &store->LitSecondary[side];
+      if (d.index[side])
+         VB->IndexPtr[side] = &store->LitIndex[side];
+   }
+}
+
+
 static GLboolean run_lighting( GLcontext *ctx, 
 			       struct tnl_pipeline_stage *stage )
 {
@@ -242,9 +343,13 @@ static GLboolean run_lighting( GLcontext *ctx,
       idx |= LIGHT_TWOSIDE;
 
    /* The individual functions know about replaying side-effects
-    * vs. full re-execution. 
+    * vs. full re-execution.  Without per-vertex material changes the
+    * vertices are independent, so they can be lit in parallel.
     */
-   store->light_func_tab[idx]( ctx, VB, stage, input );
+   if (!(idx & LIGHT_MATERIAL) && VB->AttribPtr[_TNL_ATTRIB_NORMAL]->stride)
+      light_chunked( ctx, stage, store->light_func_tab[idx], input );
+   else
+      store->light_func_tab[idx]( ctx, VB, stage, input );
 
    VB->AttribPtr[_TNL_ATTRIB_COLOR0] = VB->ColorPtr[0];
    VB->AttribPtr[_TNL_ATTRIB_COLOR1] = VB->SecondaryColorPtr[0];
@@ -35,9 +35,12 @@
 #include "main/context.h"
 #include "main/macros.h"
 #include "main/imports.h"
+#include "main/threadpool.h"
 #include "shader/prog_instruction.h"
 #include "shader/prog_statevars.h"
 #include "shader/prog_execute.h"
+#include "shader/prog_execute_batch.h"
+#include "shader/prog_execute_sse.h"
 #include "swrast/s_context.h"
 #include "swrast/s_texfilter.h"
 
@@ -57,6 +60,14 @@ struct vp_stage_data {
    GLvector4f ndcCoords;              /**< normalized device coords */
    GLubyte *clipmask;                 /**< clip flags */
    GLubyte ormask, andmask;           /**< for clipping */
+
+   /** For programs translated to SSE, one machine per pool thread */
+   struct prog_soa_machine *soa[MAX_POOL_THREADS];
+   GLuint numSoa;
+
+   /** For other straight-line programs, one machine per pool thread */
+   struct prog_batch_machine *batch[MAX_POOL_THREADS];
+   GLuint numBatch;
 };
 
 
@@ -290,41 +301,127 @@ unmap_textures(GLcontext *ctx, const struct gl_vertex_program *vp)
 
 
 /**
- * This function executes vertex programs
+ * Run a vertex program which has been translated to SSE code, four
+ * vertices at a time, on vertices [start, end) of the VB.
  */
-static GLboolean
-run_vp( GLcontext *ctx, struct tnl_pipeline_stage *stage )
+static void
+run_vp_sse(GLcontext *ctx, struct vp_stage_data *store,
+           struct prog_soa_machine *soa,
+           const struct gl_vertex_program *program,
+           const GLuint outputs[], GLuint numOutputs,
+           GLuint start, GLuint end)
 {
-   TNLcontext *tnl = TNL_CONTEXT(ctx);
-   struct vp_stage_data *store = VP_STAGE_DATA(stage);
-   struct vertex_buffer *VB = &tnl->vb;
-   struct gl_vertex_program *program = ctx->VertexProgram._Current;
+   struct vertex_buffer *VB = &TNL_CONTEXT(ctx)->vb;
    struct gl_program_machine machine;
-   GLuint outputs[VERT_RESULT_MAX], numOutputs;
-   GLuint i, j;
+   GLuint i, j, lane, c;
 
-   if (!program)
-      return GL_TRUE;
+   /* for the instructions which are interpreted */
+   init_machine(ctx, &machine);
 
-   if (program->IsNVProgram) {
-      _mesa_load_tracked_matrices(ctx);
-   }
-   else {
-      /* ARB program or vertex shader */
-      _mesa_load_state_parameters(ctx, program->Base.Parameters);
+   _mesa_init_soa_machine(ctx, soa, &program->Base, &machine);
+
+   for (i = start; i < end; i += 4) {
+      const GLuint n = MIN2(end - i, 4);
+      GLuint attr;
+
+      soa->LaneMask = (1 << n) - 1;
+
+      for (attr = 0; attr < VERT_ATTRIB_MAX; attr++) {
+	 if (program->Base.InputsRead & (1 << attr)) {
+	    const GLubyte *ptr = (const GLubyte*) VB->AttribPtr[attr]->data;
+	    const GLuint size = VB->AttribPtr[attr]->size;
+	    const GLuint stride = VB->AttribPtr[attr]->stride;
+            for (lane = 0; lane < 4; lane++) {
+               /* unused lanes just repeat the last vertex */
+               const GLuint k = i + MIN2(lane, n - 1);
+               const GLfloat *data = (GLfloat *) (ptr + stride * k);
+               GLfloat attrib[4];
+               COPY_CLEAN_4V(attrib, size, data);
+               for (c = 0; c < 4; c++)
+                  soa->Inputs[attr][c][lane] = attrib[c];
+            }
+	 }
+      }
+
+      _mesa_execute_program_sse(soa);
+
+      for (j = 0; j < numOutputs; j++) {
+         const GLuint attr = outputs[j];
+         for (lane = 0; lane < n; lane++) {
+            for (c = 0; c < 4; c++)
+               store->results[attr].data[i + lane][c]
+                  = soa->Outputs[attr][c][lane];
+         }
+      }
    }
+}
 
-   /* make list of outputs to save some time below */
-   numOutputs = 0;
-   for (i = 0; i < VERT_RESULT_MAX; i++) {
-      if (program->Base.OutputsWritten & (1 << i)) {
-         outputs[numOutputs++] = i;
+
+/**
+ * Run a vertex program with the batch interpreter, PROG_BATCH_SIZE
+ * vertices at a time, on vertices [start, end) of the VB.
+ */
+static void
+run_vp_batch(GLcontext *ctx, struct vp_stage_data *store,
+             struct prog_batch_machine *m,
+             const struct gl_vertex_program *program,
+             const GLuint outputs[], GLuint numOutputs,
+             GLuint start, GLuint end)
+{
+   struct vertex_buffer *VB = &TNL_CONTEXT(ctx)->vb;
+   GLuint i, j, l, c;
+
+   _mesa_init_batch_machine(ctx, m, &program->Base);
+
+   for (i = start; i < end; i += PROG_BATCH_SIZE) {
+      const GLuint n = MIN2(end - i, PROG_BATCH_SIZE);
+      GLuint attr;
+
+      m->Count = n;
+
+      for (attr = 0; attr < VERT_ATTRIB_MAX; attr++) {
+	 if (program->Base.InputsRead & (1 << attr)) {
+	    const GLubyte *ptr = (const GLubyte*) VB->AttribPtr[attr]->data;
+	    const GLuint size = VB->AttribPtr[attr]->size;
+	    const GLuint stride = VB->AttribPtr[attr]->stride;
+            for (l = 0; l < n; l++) {
+               const GLfloat *data = (GLfloat *) (ptr + stride * (i + l));
+               GLfloat attrib[4];
+               COPY_CLEAN_4V(attrib, size, data);
+               for (c = 0; c < 4; c++)
+                  m->Inputs[attr][c][l] = attrib[c];
+            }
+	 }
+      }
+
+      _mesa_execute_program_batch(&program->Base, m);
+
+      for (j = 0; j < numOutputs; j++) {
+         const GLuint attr = outputs[j];
+         for (l = 0; l < n; l++) {
+            for (c = 0; c < 4; c++)
+               store->results[attr].data[i + l][c] = m->Outputs[attr][c][l];
+         }
       }
    }
+}
 
-   map_textures(ctx, program);
 
-   for (i = 0; i < VB->Count; i++) {
+/**
+ * Run a vertex program with the interpreter on vertices [start, end)
+ * of the VB.
+ */
+static void
+run_vp_interp(GLcontext *ctx, struct vp_stage_data *store,
+              const struct gl_vertex_program *program,
+              const GLuint outputs[], GLuint numOutputs,
+              GLuint start, GLuint end)
+{
+   struct vertex_buffer *VB = &TNL_CONTEXT(ctx)->vb;
+   struct gl_program_machine machine;
+   GLuint i, j;
+
+   for (i = start; i < end; i++) {
       GLuint attr;
 
       init_machine(ctx, &machine);
@@ -349,13 +446,13 @@ run_vp( GLcontext *ctx, struct tnl_pipeline_stage *stage )
 
       /* the vertex array case */
       for (attr = 0; attr < VERT_ATTRIB_MAX; attr++) {
-	 if (program->Base.InputsRead & (1 << attr)) {
-	    const GLubyte *ptr = (const GLubyte*) VB->AttribPtr[attr]->data;
-	    const GLuint size = VB->AttribPtr[attr]->size;
-	    const GLuint stride = VB->AttribPtr[attr]->stride;
-	    const GLfloat *data = (GLfloat *) (ptr + stride * i);
-	    COPY_CLEAN_4V(machine.VertAttribs[attr], size, data);
-	 }
+         if (program->Base.InputsRead & (1 << attr)) {
+            const GLubyte *ptr = (const GLubyte*) VB->AttribPtr[attr]->data;
+            const GLuint size = VB->AttribPtr[attr]->size;
+            const GLuint stride = VB->AttribPtr[attr]->stride;
+            const GLfloat *data = (GLfloat *) (ptr + stride * i);
+            COPY_CLEAN_4V(machine.VertAttribs[attr], size, data);
+         }
       }
 
       /* execute the program */
@@ -374,6 +471,95 @@ run_vp( GLcontext *ctx, struct tnl_pipeline_stage *stage )
              machine.Outputs[0][3]);
 #endif
    }
+}
+
+
+/**
+ * State shared by the threads running a vertex program, see vp_chunk().
+ */
+struct vp_chunk_data {
+   struct vp_stage_data *store;
+   const struct gl_vertex_program *program;
+   GLboolean sse;                     /**< run the SSE code? */
+   GLboolean batch;                   /**< else the batch interpreter? */
+   GLuint outputs[VERT_RESULT_MAX];
+   GLuint numOutputs;
+};
+
+
+/**
+ * Run the vertex program on one chunk of the VB.
+ * Called via _tnl_run_chunked().
+ */
+static void
+vp_chunk(GLcontext *ctx, void *data, GLuint chunk,
+         GLuint start, GLuint count, GLuint thread)
+{
+   struct vp_chunk_data *d = (struct vp_chunk_data *) data;
+
+   (void) chunk;
+
+   if (d->sse)
+      run_vp_sse(ctx, d->store, d->store->soa[thread], d->program,
+                 d->outputs, d->numOutputs, start, start + count);
+   else if (d->batch)
+      run_vp_batch(ctx, d->store, d->store->batch[thread], d->program,
+                   d->outputs, d->numOutputs, start, start + count);
+   else
+      run_vp_interp(ctx, d->store, d->program,
+                    d->outputs, d->numOutputs, start, start + count);
+}
+
+
+/**
+ * This function executes vertex programs
+ */
+static GLboolean
+run_vp( GLcontext *ctx, struct tnl_pipeline_stage *stage )
+{
+   TNLcontext *tnl = TNL_CONTEXT(ctx);
+   struct vp_stage_data *store = VP_STAGE_DATA(stage);
+   struct vertex_buffer *VB = &tnl->vb;
+   struct gl_vertex_program *program = ctx->VertexProgram._Current;
+   struct vp_chunk_data d;
+   GLuint i;
+
+   if (!program)
+      return GL_TRUE;
+
+   if (program->IsNVProgram) {
+      _mesa_load_tracked_matrices(ctx);
+   }
+   else {
+      /* ARB program or vertex shader */
+      _mesa_load_state_parameters(ctx, program->Base.Parameters);
+   }
+
+   /* make list of outputs to save some time below */
+   d.numOutputs = 0;
+   for (i = 0; i < VERT_RESULT_MAX; i++) {
+      if (program->Base.OutputsWritten & (1 << i)) {
+         d.outputs[d.numOutputs++] = i;
+      }
+   }
+
+   d.store = store;
+   d.program = program;
+   d.sse = (store->numSoa > 0 &&
+            _mesa_compile_program_sse(ctx, &program->Base));
+   d.batch = (!d.sse && store->numBatch > 0 &&
+              _mesa_can_execute_program_batch(&program->Base));
+
+   map_textures(ctx, program);
+
+   if ((d.sse && store->numSoa < _mesa_threadpool_size(tnl->ThreadPool)) ||
+       (d.batch && store->numBatch < _mesa_threadpool_size(tnl->ThreadPool))) {
+      /* not enough machines to go around */
+      vp_chunk(ctx, &d, 0, 0, VB->Count, 0);
+   }
+   else {
+      _tnl_run_chunked(ctx, VB->Count, vp_chunk, &d);
+   }
 
    unmap_textures(ctx, program);
 
@@ -487,6 +673,22 @@ init_vp(GLcontext *ctx, struct tnl_pipeline_stage *stage)
    _mesa_vector4f_alloc( &store->ndcCoords, 0, size, 32 );
    store->clipmask = (GLubyte *) ALIGN_MALLOC(sizeof(GLubyte)*size, 32 );
 
+   /* if these can't be allocated we just use the interpreter */
+   store->numSoa = 0;
+   for (i = 0; i < _mesa_threadpool_size(tnl->ThreadPool); i++) {
+      store->soa[i] = _mesa_new_soa_machine();
+      if (!store->soa[i])
+         break;
+      store->numSoa++;
+   }
+   store->numBatch = 0;
+   for (i = 0; i < _mesa_threadpool_size(tnl->ThreadPool); i++) {
+      store->batch[i] = _mesa_new_batch_machine();
+      if (!store->batch[i])
+         break;
+      store->numBatch++;
+   }
+
    return GL_TRUE;
 }
 
@@ -509,6 +711,10 @@ dtr(struct tnl_pipeline_stage *stage)
       /* free misc arrays */
       _mesa_vector4f_free( &store->ndcCoords );
       ALIGN_FREE( store->clipmask );
+      for (i = 0; i < store->numSoa; i++)
+         _mesa_free_soa_machine( store->soa[i] );
+      for (i = 0; i < store->numBatch; i++)
+         _mesa_free_batch_machine( store->batch[i] );
 
       FREE( store );
       stage->privatePtr = NULL;
@@ -32,6 +32,7 @@
 #include "macros.h"
 #include "imports.h"
 #include "mtypes.h"
+#include "threadpool.h"
 
 #include "math/m_xform.h"
 
@@ -119,69 +120,154 @@ static void (*(usercliptab[5]))( GLcontext *,
 
 
 
-static GLboolean run_vertex_stage( GLcontext *ctx,
-				   struct tnl_pipeline_stage *stage )
+/* Per-chunk results of transform_chunk().
+ */
+struct vertex_chunk_data {
+   struct vertex_stage_data *store;
+   GLboolean eye;			/* transform to eye coords? */
+   GLvector4f eyeResult;		/* chunk 0's eye/clip/proj vectors */
+   GLvector4f clipResult;
+   GLvector4f projResult;
+   GLboolean ndcIsClip;			/* no divide was needed */
+   GLubyte ormask[MAX_POOL_THREADS];
+   GLubyte andmask[MAX_POOL_THREADS];
+};
+
+
+/* Transform, cliptest and divide one chunk of the vertex buffer.
+ */
+static void transform_chunk( GLcontext *ctx, void *data, GLuint chunk,
+			     GLuint start, GLuint count, GLuint thread )
 {
-   struct vertex_stage_data *store = (struct vertex_stage_data *)stage->privatePtr;
+   struct vertex_chunk_data *d = (struct vertex_chunk_data *) data;
+   struct vertex_stage_data *store = d->store;
    TNLcontext *tnl = TNL_CONTEXT(ctx);
    struct vertex_buffer *VB = &tnl->vb;
+   GLvector4f obj, eye, clip, proj, *ndc = NULL;
 
-   if (ctx->VertexProgram._Current) 
-      return GL_TRUE;
+   (void) thread;
 
-   if (ctx->_NeedEyeCoords) {
-      /* Separate modelview transformation:
-       * Use combined ModelProject to avoid some depth artifacts
-       */
-      if (ctx->ModelviewMatrixStack.Top->type == MATRIX_IDENTITY)
-	 VB->EyePtr = VB->ObjPtr;
-      else
-	 VB->EyePtr = TransformRaw( &store->eye,
-				    ctx->ModelviewMatrixStack.Top,
-				    VB->ObjPtr);
+   _tnl_vector4f_chunk( &obj, VB->ObjPtr, start, count );
+
+   if (d->eye) {
+      _tnl_vector4f_chunk( &eye, &store->eye, start, count );
+      (void) TransformRaw( &eye, ctx->ModelviewMatrixStack.Top, &obj );
    }
 
-   VB->ClipPtr = TransformRaw( &store->clip,
-			       &ctx->_ModelProjectMatrix,
-			       VB->ObjPtr );
+   _tnl_vector4f_chunk( &clip, &store->clip, start, count );
+   (void) TransformRaw( &clip, &ctx->_ModelProjectMatrix, &obj );
 
    /* Drivers expect this to be clean to element 4...
     */
-   switch (VB->ClipPtr->size) {
+   switch (clip.size) {
    case 1:			
       /* impossible */
    case 2:
-      _mesa_vector4f_clean_elem( VB->ClipPtr, VB->Count, 2 );
+      _mesa_vector4f_clean_elem( &clip, count, 2 );
       /* fall-through */
    case 3:
-      _mesa_vector4f_clean_elem( VB->ClipPtr, VB->Count, 3 );
+      _mesa_vector4f_clean_elem( &clip, count, 3 );
       /* fall-through */
    case 4:
       break;
    }
 
-
    /* Cliptest and perspective divide.  Clip functions must clear
     * the clipmask.
     */
-   store->ormask = 0;
-   store->andmask = CLIP_FRUSTUM_BITS;
+   d->ormask[chunk] = 0;
+   d->andmask[chunk] = CLIP_FRUSTUM_BITS;
 
    if (tnl->NeedNdcCoords) {
-      VB->NdcPtr =
-	 _mesa_clip_tab[VB->ClipPtr->size]( VB->ClipPtr,
-					    &store->proj,
-					    store->clipmask,
-					    &store->ormask,
-					    &store->andmask );
+      _tnl_vector4f_chunk( &proj, &store->proj, start, count );
+      ndc = _mesa_clip_tab[clip.size]( &clip,
+				       &proj,
+				       store->clipmask + start,
+				       &d->ormask[chunk],
+				       &d->andmask[chunk] );
    }
    else {
+      _mesa_clip_np_tab[clip.size]( &clip,
+				    NULL,
+				    store->clipmask + start,
+				    &d->ormask[chunk],
+				    &d->andmask[chunk] );
+   }
+
+   if (chunk == 0) {
+      if (d->eye)
+	 d->eyeResult = eye;
+      d->clipResult = clip;
+      if (ndc) {
+	 d->ndcIsClip = (ndc == &clip);
+	 d->projResult = *ndc;
+      }
+   }
+}
+
+
+/* Copy the size and flags of a chunk's result vector to the whole
+ * vector.
+ */
+static GLvector4f *chunk_result( GLvector4f *v, const GLvector4f *chunk,
+				 GLuint count )
+{
+   v->size = chunk->size;
+   v->flags = chunk->flags | (v->flags & VEC_MALLOC);
+   v->count = count;
+   return v;
+}
+
+
+static GLboolean run_vertex_stage( GLcontext *ctx,
+				   struct tnl_pipeline_stage *stage )
+{
+   struct vertex_stage_data *store = (struct vertex_stage_data *)stage->privatePtr;
+   TNLcontext *tnl = TNL_CONTEXT(ctx);
+   struct vertex_buffer *VB = &tnl->vb;
+   struct vertex_chunk_data d;
+   GLuint i;
+
+   if (ctx->VertexProgram._Current) 
+      return GL_TRUE;
+
+   /* Separate modelview transformation:
+    * Use combined ModelProject to avoid some depth artifacts
+    */
+   d.store = store;
+   d.eye = (ctx->_NeedEyeCoords &&
+	    ctx->ModelviewMatrixStack.Top->type != MATRIX_IDENTITY);
+   d.ndcIsClip = GL_FALSE;
+   for (i = 0; i < MAX_POOL_THREADS; i++) {
+      d.ormask[i] = 0;
+      d.andmask[i] = CLIP_FRUSTUM_BITS;
+   }
+
+   /* Large vertex buffers are split between threads.
+    */
+   _tnl_run_chunked( ctx, VB->Count, transform_chunk, &d );
+
+   if (ctx->_NeedEyeCoords) {
+      if (d.eye)
+	 VB->EyePtr = chunk_result( &store->eye, &d.eyeResult, VB->Count );
+      else
+	 VB->EyePtr = VB->ObjPtr;
+   }
+
+   VB->ClipPtr = chunk_result( &store->clip, &d.clipResult, VB->Count );
+
+   if (tnl->NeedNdcCoords && d.ndcIsClip)
+      VB->NdcPtr = VB->ClipPtr;
+   else if (tnl->NeedNdcCoords)
+      VB->NdcPtr = chunk_result( &store->proj, &d.projResult, VB->Count );
+   else
       VB->NdcPtr = NULL;
-      _mesa_clip_np_tab[VB->ClipPtr->size]( VB->ClipPtr,
-					    NULL,
-					    store->clipmask,
-					    &store->ormask,
-					    &store->andmask );
+
+   store->ormask = 0;
+   store->andmask = CLIP_FRUSTUM_BITS;
+   for (i = 0; i < MAX_POOL_THREADS; i++) {
+      store->ormask |= d.ormask[i];
+      store->andmask &= d.andmask[i];
    }
 
    if (store->andmask)
@@ -189,7 +275,8 @@ static GLboolean run_vertex_stage( GLcontext *ctx,
 
 
    /* Test userclip planes.  This contributes to VB->ClipMask, so
-    * is essentially required to be in this stage.
+    * is essentially required to be in this stage.  It must see the
+    * whole buffer to know if all vertices are outside a plane.
     */
    if (ctx->Transform.ClipPlanesEnabled) {
       usercliptab[VB->ClipPtr->size]( ctx,
@@ -483,7 +483,7 @@ void _tnl_init_vertices( GLcontext *ctx,
 
    vtx->codegen_emit = NULL;
 
-#ifdef USE_SSE_ASM
+#if defined(USE_SSE_ASM) || defined(USE_X86_64_ASM)
    if (!_mesa_getenv("MESA_NO_CODEGEN"))
       vtx->codegen_emit = _tnl_generate_sse_emit;
 #endif
@@ -33,7 +33,7 @@
 #include "simple_list.h"
 #include "enums.h"
 
-#if defined(USE_SSE_ASM)
+#if defined(USE_SSE_ASM) || defined(USE_X86_64_ASM)
 
 #include "x86/rtasm/x86sse.h"
 #include "x86/common_x86_asm.h"
@@ -294,6 +294,31 @@ static GLint get_offset( const void *a, const void *b )
    return (const char *)b - (const char *)a;
 }
 
+/* Moves and address arithmetic on pointers, which are 64 bits wide on
+ * x86-64.  Everything else (the vertex count) stays 32 bits.
+ */
+static void emit_mov_ptr( struct x86_program *p,
+			  struct x86_reg dst,
+			  struct x86_reg src )
+{
+#if defined(USE_X86_64_ASM)
+   x86_mov64(&p->func, dst, src);
+#else
+   x86_mov(&p->func, dst, src);
+#endif
+}
+
+static void emit_lea_ptr( struct x86_program *p,
+			  struct x86_reg dst,
+			  struct x86_reg src )
+{
+#if defined(USE_X86_64_ASM)
+   x86_lea64(&p->func, dst, src);
+#else
+   x86_lea(&p->func, dst, src);
+#endif
+}
+
 /* Not much happens here.  Eventually use this function to try and
  * avoid saving/reloading the source pointers each vertex (if some of
  * them can fit in registers).
@@ -308,7 +333,7 @@ static void get_src_ptr( struct x86_program *p,
 
    /* Load current a[j].inputptr
     */
-   x86_mov(&p->func, srcREG, ptr_to_src);
+   emit_mov_ptr(p, srcREG, ptr_to_src);
 }
 
 static void update_src_ptr( struct x86_program *p,
@@ -323,11 +348,11 @@ static void update_src_ptr( struct x86_program *p,
       /* add a[j].inputstride (hardcoded value - could just as easily
        * pull the stride value from memory each time).
        */
-      x86_lea(&p->func, srcREG, x86_make_disp(srcREG, a->inputstride));
+      emit_lea_ptr(p, srcREG, x86_make_disp(srcREG, a->inputstride));
       
       /* save new value of a[j].inputptr 
        */
-      x86_mov(&p->func, ptr_to_src, srcREG);
+      emit_mov_ptr(p, ptr_to_src, srcREG);
    }
 }
 
@@ -337,6 +362,9 @@ static void update_src_ptr( struct x86_program *p,
  * EAX -- pointer to current output vertex
  * ECX -- pointer to current attribute 
  * 
+ * On x86-64 the arguments arrive in RDI, RSI and RDX (see
+ * x86-64/calling_convention.txt), so the count has to be read before
+ * ESI is reused for the vertex state.
  */
 static GLboolean build_vertex_emit( struct x86_program *p )
 {
@@ -369,12 +397,12 @@ static GLboolean build_vertex_emit( struct x86_program *p )
 
    /* Initialize destination register. 
     */
-   x86_mov(&p->func, vertexEAX, x86_fn_arg(&p->func, 3));
+   emit_mov_ptr(p, vertexEAX, x86_fn_arg(&p->func, 3));
 
    /* Dereference ctx to get tnl, then vtx:
     */
-   x86_mov(&p->func, vtxESI, x86_fn_arg(&p->func, 1));
-   x86_mov(&p->func, vtxESI, x86_make_disp(vtxESI, get_offset(ctx, &ctx->swtnl_context)));
+   emit_mov_ptr(p, vtxESI, x86_fn_arg(&p->func, 1));
+   emit_mov_ptr(p, vtxESI, x86_make_disp(vtxESI, get_offset(ctx, &ctx->swtnl_context)));
    vtxESI = x86_make_disp(vtxESI, get_offset(tnl, &tnl->clipspace));
 
    
@@ -602,7 +630,7 @@ static GLboolean build_vertex_emit( struct x86_program *p )
 
    /* Next vertex:
     */
-   x86_lea(&p->func, vertexEAX, x86_make_disp(vertexEAX, vtx->vertex_size));
+   emit_lea_ptr(p, vertexEAX, x86_make_disp(vertexEAX, vtx->vertex_size));
 
    /* decr count, loop if not zero
     */
@@ -639,17 +667,23 @@ void _tnl_generate_sse_emit( GLcontext *ctx )
    struct tnl_clipspace *vtx = GET_VERTEX_STATE(ctx);
    struct x86_program p;   
 
+#if !defined(USE_X86_64_ASM)
    if (!cpu_has_xmm) {
       vtx->codegen_emit = NULL;
       return;
    }
+#endif
 
    _mesa_memset(&p, 0, sizeof(p));
 
    p.ctx = ctx;
    p.inputs_safe = 0;		/* for now */
    p.outputs_safe = 1;		/* for now */
+#if defined(USE_X86_64_ASM)
+   p.have_sse2 = GL_TRUE;	/* always there on x86-64 */
+#else
    p.have_sse2 = cpu_has_xmm2;
+#endif
    p.identity = x86_make_reg(file_XMM, 6);
    p.chan0 = x86_make_reg(file_XMM, 7);
 
@@ -674,7 +708,7 @@ void _tnl_generate_sse_emit( GLcontext *ctx )
 
 void _tnl_generate_sse_emit( GLcontext *ctx )
 {
-   /* Dummy version for when USE_SSE_ASM not defined */
+   /* Dummy version for when USE_SSE_ASM/USE_X86_64_ASM not defined */
 }
 
 #endif
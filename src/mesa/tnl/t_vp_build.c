@@ -34,7 +34,9 @@
 #include "macros.h"
 #include "enums.h"
 #include "shader/program.h"
+#include "shader/prog_cache.h"
 #include "shader/prog_instruction.h"
+#include "shader/prog_optimize.h"
 #include "shader/prog_parameter.h"
 #include "shader/prog_print.h"
 #include "shader/prog_statevars.h"
@@ -1131,6 +1133,9 @@ static void build_fog( struct tnl_program *p )
       input = swizzle1(register_input(p, VERT_ATTRIB_FOG), X);
    }
 
+   /* only fog.x is computed below; don't leave the rest undefined */
+   emit_op1(p, OPCODE_MOV, fog, WRITEMASK_YZW, get_identity_param(p));
+
    if (p->state->fog_mode && p->state->tnl_do_vertex_fog) {
       struct ureg params = register_param2(p, STATE_INTERNAL,
 					   STATE_FOG_PARAMS_OPTIMIZED);
@@ -1459,80 +1464,15 @@ create_new_program( const struct state_key *key,
    p.program->Base.OutputsWritten = 0;
 
    build_tnl_program( &p );
-}
-
-static void *search_cache( struct tnl_cache *cache,
-			   GLuint hash,
-			   const void *key,
-			   GLuint keysize)
-{
-   struct tnl_cache_item *c;
-
-   for (c = cache->items[hash % cache->size]; c; c = c->next) {
-      if (c->hash == hash && _mesa_memcmp(c->key, key, keysize) == 0)
-	 return c->data;
-   }
-
-   return NULL;
-}
-
-static void rehash( struct tnl_cache *cache )
-{
-   struct tnl_cache_item **items;
-   struct tnl_cache_item *c, *next;
-   GLuint size, i;
-
-   size = cache->size * 3;
-   items = (struct tnl_cache_item**) _mesa_malloc(size * sizeof(*items));
-   _mesa_memset(items, 0, size * sizeof(*items));
-
-   for (i = 0; i < cache->size; i++)
-      for (c = cache->items[i]; c; c = next) {
-	 next = c->next;
-	 c->next = items[c->hash % size];
-	 items[c->hash % size] = c;
-      }
-
-   FREE(cache->items);
-   cache->items = items;
-   cache->size = size;
-}
-
-static void cache_item( struct tnl_cache *cache,
-			GLuint hash,
-			void *key,
-			void *data )
-{
-   struct tnl_cache_item *c = (struct tnl_cache_item*) _mesa_malloc(sizeof(*c));
-   c->hash = hash;
-   c->key = key;
-   c->data = data;
 
-   if (++cache->n_items > cache->size * 1.5)
-      rehash(cache);
-
-   c->next = cache->items[hash % cache->size];
-   cache->items[hash % cache->size] = c;
-}
-
-static GLuint hash_key( struct state_key *key )
-{
-   GLuint *ikey = (GLuint *)key;
-   GLuint hash = 0, i;
-
-   /* I'm sure this can be improved on, but speed is important:
-    */
-   for (i = 0; i < sizeof(*key)/sizeof(GLuint); i++)
-      hash ^= ikey[i];
-
-   return hash;
+   _mesa_optimize_program(&p.program->Base);
 }
 
 void _tnl_UpdateFixedFunctionProgram( GLcontext *ctx )
 {
-   TNLcontext *tnl = TNL_CONTEXT(ctx);
+   struct gl_program_cache *cache = ctx->VertexProgram.Cache;
    struct state_key *key;
-   GLuint hash;
+   struct gl_vertex_program *newProg;
    const struct gl_vertex_program *prev = ctx->VertexProgram._Current;
 
    if (!ctx->VertexProgram._Current ||
@@ -1540,36 +1480,44 @@ void _tnl_UpdateFixedFunctionProgram( GLcontext *ctx )
       /* Grab all the relevent state and put it in a single structure:
        */
       key = make_state_key(ctx);
-      hash = hash_key(key);
 
       /* Look for an already-prepared program for this state:
        */
-      ctx->VertexProgram._TnlProgram = (struct gl_vertex_program *)
-	 search_cache( tnl->vp_cache, hash, key, sizeof(*key) );
+      newProg = (struct gl_vertex_program *)
+	 _mesa_search_program_cache( cache, key, sizeof(*key) );
    
       /* OK, we'll have to build a new one:
        */
-      if (!ctx->VertexProgram._TnlProgram) {
+      if (!newProg) {
 	 if (0)
 	    _mesa_printf("Build new TNL program\n");
 	 
-	 ctx->VertexProgram._TnlProgram = (struct gl_vertex_program *)
+	 newProg = (struct gl_vertex_program *)
 	    ctx->Driver.NewProgram(ctx, GL_VERTEX_PROGRAM_ARB, 0); 
 
-	 create_new_program( key, ctx->VertexProgram._TnlProgram, 
+	 create_new_program( key, newProg, 
 			     ctx->Const.VertexProgram.MaxTemps );
 
 	 if (ctx->Driver.ProgramStringNotify)
 	    ctx->Driver.ProgramStringNotify( ctx, GL_VERTEX_PROGRAM_ARB, 
-                                       &ctx->VertexProgram._TnlProgram->Base );
+                                       &newProg->Base );
 
-	 cache_item(tnl->vp_cache, hash, key, ctx->VertexProgram._TnlProgram );
+	 _mesa_program_cache_insert( ctx, cache, key, sizeof(*key),
+				     &newProg->Base );
       }
       else {
-	 FREE(key);
 	 if (0) 
-	    _mesa_printf("Found existing TNL program for key %x\n", hash);
+	    _mesa_printf("Found existing TNL program\n");
       }
+      FREE(key);
+
+      /* The context holds its own reference, see prog_cache.c:
+       */
+      if (ctx->VertexProgram._TnlProgram)
+	 _mesa_program_cache_release( ctx, cache,
+				      &ctx->VertexProgram._TnlProgram->Base );
+
+      ctx->VertexProgram._TnlProgram = newProg;
       ctx->VertexProgram._Current = ctx->VertexProgram._TnlProgram;
    }
 
@@ -1581,32 +1529,3 @@ void _tnl_UpdateFixedFunctionProgram( GLcontext *ctx )
                             (struct gl_program *) ctx->VertexProgram._Current);
    }
 }
-
-void _tnl_ProgramCacheInit( GLcontext *ctx )
-{
-   TNLcontext *tnl = TNL_CONTEXT(ctx);
-
-   tnl->vp_cache = (struct tnl_cache *) MALLOC(sizeof(*tnl->vp_cache));
-   tnl->vp_cache->size = 17;
-   tnl->vp_cache->n_items = 0;
-   tnl->vp_cache->items = (struct tnl_cache_item**)
-      _mesa_calloc(tnl->vp_cache->size * sizeof(*tnl->vp_cache->items));
-}
-
-void _tnl_ProgramCacheDestroy( GLcontext *ctx )
-{
-   TNLcontext *tnl = TNL_CONTEXT(ctx);
-   struct tnl_cache_item *c, *next;
-   GLuint i;
-
-   for (i = 0; i < tnl->vp_cache->size; i++)
-      for (c = tnl->vp_cache->items[i]; c; c = next) {
-	 next = c->next;
-	 FREE(c->key);
-	 FREE(c->data);
-	 FREE(c);
-      }
-
-   FREE(tnl->vp_cache->items);
-   FREE(tnl->vp_cache);
-}
@@ -30,7 +30,4 @@
 
 extern void _tnl_UpdateFixedFunctionProgram( GLcontext *ctx );
 
-extern void _tnl_ProgramCacheInit( GLcontext *ctx );
-extern void _tnl_ProgramCacheDestroy( GLcontext *ctx );
-
 #endif
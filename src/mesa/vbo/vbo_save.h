@@ -89,6 +89,15 @@ struct vbo_save_vertex_list {
  */
 #define VBO_SAVE_BUFFER_SIZE (8*1024) /* dwords */
 #define VBO_SAVE_PRIM_SIZE   128
+
+/* A list which overflows the above is not split into several vertex
+ * lists, instead the run of vertices or primitives being compiled is
+ * moved to a store of twice the size, up to these limits.  Apps
+ * which compile a few large lists get one large VBO and a single
+ * draw per list, everybody else keeps the small buffers.
+ */
+#define VBO_SAVE_BUFFER_MAX  (256*1024) /* dwords */
+#define VBO_SAVE_PRIM_MAX    (8*1024)
 #define VBO_SAVE_PRIM_WEAK 0x40
 
 #define VBO_SAVE_FALLBACK    0x10000000
@@ -98,12 +107,14 @@ struct vbo_save_vertex_list {
 struct vbo_save_vertex_store {
    struct gl_buffer_object *bufferobj;
    GLfloat *buffer;
+   GLuint size;			/* dwords */
    GLuint used;
    GLuint refcount;
 };
 
 struct vbo_save_primitive_store {
-   struct _mesa_prim buffer[VBO_SAVE_PRIM_SIZE];
+   struct _mesa_prim *buffer;
+   GLuint size;
    GLuint used;
    GLuint refcount;
 };
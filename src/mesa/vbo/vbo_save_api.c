@@ -160,9 +160,14 @@ static GLuint _save_copy_vertices( GLcontext *ctx,
 }
 
 
-static struct vbo_save_vertex_store *alloc_vertex_store( GLcontext *ctx )
+/* Returns NULL if out of memory.
+ */
+static struct vbo_save_vertex_store *alloc_vertex_store( GLcontext *ctx,
+							 GLuint size )
 {
    struct vbo_save_vertex_store *vertex_store = CALLOC_STRUCT(vbo_save_vertex_store);
+   if (!vertex_store)
+      return NULL;
 
    /* obj->Name needs to be non-zero, but won't ever be examined more
     * closely than that.  In particular these buffers won't be entered
@@ -171,15 +176,28 @@ static struct vbo_save_vertex_store *alloc_vertex_store( GLcontext *ctx )
     * buffers:
     */
    vertex_store->bufferobj = ctx->Driver.NewBufferObject(ctx, 1, GL_ARRAY_BUFFER_ARB);
+   if (!vertex_store->bufferobj) {
+      FREE( vertex_store );
+      return NULL;
+   }
 
    ctx->Driver.BufferData( ctx, 
 			   GL_ARRAY_BUFFER_ARB, 
-			   VBO_SAVE_BUFFER_SIZE * sizeof(GLfloat),
+			   size * sizeof(GLfloat),
 			   NULL,
 			   GL_STATIC_DRAW_ARB,
 			   vertex_store->bufferobj);
 
+   /* BufferData leaves the old (empty) storage if it runs out of memory:
+    */
+   if (vertex_store->bufferobj->Size < (GLsizeiptrARB) (size * sizeof(GLfloat))) {
+      ctx->Driver.DeleteBuffer( ctx, vertex_store->bufferobj );
+      FREE( vertex_store );
+      return NULL;
+   }
+
    vertex_store->buffer = NULL;
+   vertex_store->size = size;
    vertex_store->used = 0;
    vertex_store->refcount = 1;
 
@@ -196,6 +214,8 @@ static void free_vertex_store( GLcontext *ctx, struct vbo_save_vertex_store *ver
    FREE( vertex_store );
 }
 
+/* Returns NULL if the buffer can't be mapped.
+ */
 static GLfloat *map_vertex_store( GLcontext *ctx, struct vbo_save_vertex_store *vertex_store )
 {
    assert(vertex_store->bufferobj);
@@ -205,7 +225,8 @@ static GLfloat *map_vertex_store( GLcontext *ctx, struct vbo_save_vertex_store *
 							   GL_WRITE_ONLY, /* not used */
 							   vertex_store->bufferobj); 
 
-   assert(vertex_store->buffer);
+   if (!vertex_store->buffer)
+      return NULL;
    return vertex_store->buffer + vertex_store->used;
 }
 
@@ -216,35 +237,64 @@ static void unmap_vertex_store( GLcontext *ctx, struct vbo_save_vertex_store *ve
 }
 
 
-static struct vbo_save_primitive_store *alloc_prim_store( GLcontext *ctx )
+/* Returns NULL if out of memory.
+ */
+static struct vbo_save_primitive_store *alloc_prim_store( GLcontext *ctx,
+							 GLuint size )
 {
    struct vbo_save_primitive_store *store = CALLOC_STRUCT(vbo_save_primitive_store);
    (void) ctx;
+   if (!store)
+      return NULL;
+   store->buffer = (struct _mesa_prim *)
+      MALLOC(size * sizeof(struct _mesa_prim));
+   if (!store->buffer) {
+      FREE( store );
+      return NULL;
+   }
+   store->size = size;
    store->used = 0;
    store->refcount = 1;
    return store;
 }
 
+static void free_prim_store( GLcontext *ctx, struct vbo_save_primitive_store *store )
+{
+   (void) ctx;
+   FREE( store->buffer );
+   FREE( store );
+}
+
 static void _save_reset_counters( GLcontext *ctx )
 {
    struct vbo_save_context *save = &vbo_context(ctx)->save;
 
-   save->prim = save->prim_store->buffer + save->prim_store->used;
    save->buffer = (save->vertex_store->buffer + 
 		   save->vertex_store->used);
 
    assert(save->buffer == save->vbptr);
 
    if (save->vertex_size)
-      save->max_vert = ((VBO_SAVE_BUFFER_SIZE - save->vertex_store->used) / 
+      save->max_vert = ((save->vertex_store->size - save->vertex_store->used) / 
 			 save->vertex_size);
    else
       save->max_vert = 0;
 
    save->vert_count = 0;
    save->prim_count = 0;
-   save->prim_max = VBO_SAVE_PRIM_SIZE - save->prim_store->used;
    save->dangling_attr_ref = 0;
+
+   /* Without a primitive store vbo_save_NotifyBegin() leaves begin/end
+    * objects to the display list opcodes.
+    */
+   if (save->prim_store) {
+      save->prim = save->prim_store->buffer + save->prim_store->used;
+      save->prim_max = save->prim_store->size - save->prim_store->used;
+   }
+   else {
+      save->prim = NULL;
+      save->prim_max = 0;
+   }
 }
 
 
@@ -320,28 +370,45 @@ static void _save_compile_vertex_list( GLcontext *ctx )
     * the next vertex lists as well.
     */
    if (save->vertex_store->used > 
-       VBO_SAVE_BUFFER_SIZE - 16 * (save->vertex_size + 4)) {
-
-      /* Unmap old store:
-       */
-      unmap_vertex_store( ctx, save->vertex_store );
+       save->vertex_store->size - 16 * (save->vertex_size + 4)) {
+      struct vbo_save_vertex_store *store =
+	 alloc_vertex_store( ctx, VBO_SAVE_BUFFER_SIZE );
 
-      /* Release old reference:
-       */
-      save->vertex_store->refcount--; 
-      assert(save->vertex_store->refcount != 0);
-      save->vertex_store = NULL;
+      if (store && !map_vertex_store( ctx, store )) {
+	 free_vertex_store( ctx, store );
+	 store = NULL;
+      }
 
-      /* Allocate and map new store:
+      /* If out of memory, keep using the old store for now, as for
+       * the primitive store below.
        */
-      save->vertex_store = alloc_vertex_store( ctx );
-      save->vbptr = map_vertex_store( ctx, save->vertex_store );
+      if (store) {
+	 /* Unmap old store:
+	  */
+	 unmap_vertex_store( ctx, save->vertex_store );
+
+	 /* Release old reference:
+	  */
+	 save->vertex_store->refcount--; 
+	 assert(save->vertex_store->refcount != 0);
+
+	 save->vertex_store = store;
+	 save->vbptr = store->buffer;
+      }
    } 
 
-   if (save->prim_store->used > VBO_SAVE_PRIM_SIZE - 6) {
-      save->prim_store->refcount--; 
-      assert(save->prim_store->refcount != 0);
-      save->prim_store = alloc_prim_store( ctx );
+   if (save->prim_store->used > save->prim_store->size - 6) {
+      struct vbo_save_primitive_store *store =
+	 alloc_prim_store( ctx, VBO_SAVE_PRIM_SIZE );
+
+      /* If out of memory, keep using the old store until
+       * vbo_save_NotifyBegin() finds it full.
+       */
+      if (store) {
+	 save->prim_store->refcount--; 
+	 assert(save->prim_store->refcount != 0);
+	 save->prim_store = store;
+      }
    } 
 
    /* Reset our structures for the next run of vertices:
@@ -350,6 +417,83 @@ static void _save_compile_vertex_list( GLcontext *ctx )
 }
 
 
+/* The vertex store is full in the middle of a run of vertices.  Move
+ * the run to a new, larger store rather than splitting it into two
+ * vertex lists.  Returns GL_FALSE if the run is already too big or
+ * out of memory.
+ */
+static GLboolean _save_grow_vertex_store( GLcontext *ctx )
+{
+   struct vbo_save_context *save = &vbo_context(ctx)->save;
+   struct vbo_save_vertex_store *old_store = save->vertex_store;
+   struct vbo_save_vertex_store *store;
+   GLuint used = save->vbptr - save->buffer;
+   GLuint size = VBO_SAVE_BUFFER_SIZE;
+
+   while (size < 2 * used)
+      size *= 2;
+
+   if (size > VBO_SAVE_BUFFER_MAX)
+      return GL_FALSE;
+
+   store = alloc_vertex_store( ctx, size );
+   if (!store)
+      return GL_FALSE;
+
+   if (!map_vertex_store( ctx, store )) {
+      free_vertex_store( ctx, store );
+      return GL_FALSE;
+   }
+
+   _mesa_memcpy( store->buffer, save->buffer, used * sizeof(GLfloat) );
+
+   unmap_vertex_store( ctx, old_store );
+   if (--old_store->refcount == 0)
+      free_vertex_store( ctx, old_store );
+
+   save->vertex_store = store;
+   save->buffer = store->buffer;
+   save->vbptr = store->buffer + used;
+   save->max_vert = size / save->vertex_size;
+   return GL_TRUE;
+}
+
+
+/* As above, for the primitive store.  Also used to get a new store
+ * when there is none, after running out of memory.
+ */
+static GLboolean _save_grow_prim_store( GLcontext *ctx )
+{
+   struct vbo_save_context *save = &vbo_context(ctx)->save;
+   struct vbo_save_primitive_store *old_store = save->prim_store;
+   struct vbo_save_primitive_store *store;
+   GLuint size = VBO_SAVE_PRIM_SIZE;
+
+   while (size < 2 * save->prim_count)
+      size *= 2;
+
+   if (size > VBO_SAVE_PRIM_MAX)
+      return GL_FALSE;
+
+   store = alloc_prim_store( ctx, size );
+   if (!store)
+      return GL_FALSE;
+
+   if (old_store) {
+      _mesa_memcpy( store->buffer, save->prim, 
+		    save->prim_count * sizeof(struct _mesa_prim) );
+
+      if (--old_store->refcount == 0)
+	 free_prim_store( ctx, old_store );
+   }
+
+   save->prim_store = store;
+   save->prim = store->buffer;
+   save->prim_max = size;
+   return GL_TRUE;
+}
+
+
 /* TODO -- If no new vertices have been stored, don't bother saving
  * it.
  */
@@ -397,6 +541,9 @@ static void _save_wrap_filled_vertex( GLcontext *ctx )
    GLfloat *data = save->copied.buffer;
    GLuint i;
 
+   if (_save_grow_vertex_store( ctx ))
+      return;
+
    /* Emit a glEnd to close off the last vertex list.
     */
    _save_wrap_buffers( ctx );
@@ -480,7 +627,7 @@ static void _save_upgrade_vertex( GLcontext *ctx,
    save->attrsz[attr] = newsz;
 
    save->vertex_size += newsz - oldsz;
-   save->max_vert = ((VBO_SAVE_BUFFER_SIZE - save->vertex_store->used) / 
+   save->max_vert = ((save->vertex_store->size - save->vertex_store->used) / 
 		      save->vertex_size);
    save->vert_count = 0;
 
@@ -713,10 +860,26 @@ static void GLAPIENTRY _save_CallLists( GLsizei n, GLenum type, const GLvoid *v
 GLboolean vbo_save_NotifyBegin( GLcontext *ctx, GLenum mode )
 {
    struct vbo_save_context *save = &vbo_context(ctx)->save; 
+   GLuint i;
 
-   GLuint i = save->prim_count++;
+   /* Keep a free slot after the new primitive, for restarting it in
+    * _save_wrap_buffers().  When the store can't grow any more, start
+    * a new vertex list in a new store.  If that can't be had either,
+    * leave the primitive to the display list opcodes.
+    */
+   if (save->prim_count + 2 > save->prim_max &&
+       !_save_grow_prim_store( ctx )) {
+      if (save->prim_count)
+	 _save_compile_vertex_list( ctx );
+
+      if (save->prim_count + 2 > save->prim_max) {
+	 _mesa_error( ctx, GL_OUT_OF_MEMORY, "Building display list" );
+	 return GL_FALSE;
+      }
+   }
 
-   assert(i < save->prim_max);
+   i = save->prim_count++;
+   assert(i + 1 < save->prim_max);
    save->prim[i].mode = mode & ~VBO_SAVE_PRIM_WEAK;
    save->prim[i].begin = 1;
    save->prim[i].end = 0;
@@ -743,11 +906,6 @@ static void GLAPIENTRY _save_End( void )
    save->prim[i].count = (save->vert_count - 
 			  save->prim[i].start);
 
-   if (i == (GLint) save->prim_max - 1) {
-      _save_compile_vertex_list( ctx );
-      assert(save->copied.nr == 0);
-   }
-
    /* Swap out this vertex format while outside begin/end.  Any color,
     * etc. received between here and the next begin will be compiled
     * as opcodes.
@@ -822,7 +980,8 @@ static void GLAPIENTRY _save_Begin( GLenum mode )
 static void GLAPIENTRY _save_OBE_Rectf( GLfloat x1, GLfloat y1, GLfloat x2, GLfloat y2 )
 {
    GET_CURRENT_CONTEXT(ctx);
-   vbo_save_NotifyBegin( ctx, GL_QUADS | VBO_SAVE_PRIM_WEAK );
+   if (!vbo_save_NotifyBegin( ctx, GL_QUADS | VBO_SAVE_PRIM_WEAK ))
+      CALL_Begin(GET_DISPATCH(), ( GL_QUADS ));
    CALL_Vertex2f(GET_DISPATCH(), ( x1, y1 ));
    CALL_Vertex2f(GET_DISPATCH(), ( x2, y1 ));
    CALL_Vertex2f(GET_DISPATCH(), ( x2, y2 ));
@@ -841,7 +1000,8 @@ static void GLAPIENTRY _save_OBE_DrawArrays(GLenum mode, GLint start, GLsizei co
 
    _ae_map_vbos( ctx );
 
-   vbo_save_NotifyBegin( ctx, mode | VBO_SAVE_PRIM_WEAK );
+   if (!vbo_save_NotifyBegin( ctx, mode | VBO_SAVE_PRIM_WEAK ))
+      CALL_Begin(GET_DISPATCH(), ( mode ));
 
    for (i = 0; i < count; i++)
        CALL_ArrayElement(GET_DISPATCH(), (start + i));
@@ -867,7 +1027,8 @@ static void GLAPIENTRY _save_OBE_DrawElements(GLenum mode, GLsizei count, GLenum
    if (ctx->Array.ElementArrayBufferObj->Name)
       indices = ADD_POINTERS(ctx->Array.ElementArrayBufferObj->Pointer, indices);
 
-   vbo_save_NotifyBegin( ctx, mode | VBO_SAVE_PRIM_WEAK );
+   if (!vbo_save_NotifyBegin( ctx, mode | VBO_SAVE_PRIM_WEAK ))
+      CALL_Begin(GET_DISPATCH(), ( mode ));
 
    switch (type) {
    case GL_UNSIGNED_BYTE:
@@ -1021,11 +1182,14 @@ void vbo_save_NewList( GLcontext *ctx, GLuint list, GLenum mode )
 
    (void) list; (void) mode;
 
-   if (!save->prim_store)
-      save->prim_store = alloc_prim_store( ctx );
+   if (!save->prim_store) {
+      save->prim_store = alloc_prim_store( ctx, VBO_SAVE_PRIM_SIZE );
+      if (!save->prim_store)
+	 _mesa_error( ctx, GL_OUT_OF_MEMORY, "glNewList" );
+   }
 
    if (!save->vertex_store) 
-      save->vertex_store = alloc_vertex_store( ctx );
+      save->vertex_store = alloc_vertex_store( ctx, VBO_SAVE_BUFFER_SIZE );
       
    save->vbptr = map_vertex_store( ctx, save->vertex_store );
    
@@ -1070,7 +1234,19 @@ static void vbo_destroy_vertex_list( GLcontext *ctx, void *data )
       free_vertex_store( ctx, node->vertex_store );
 
    if ( --node->prim_store->refcount == 0 )
-      FREE( node->prim_store );
+      free_prim_store( ctx, node->prim_store );
+}
+
+
+/* The display list optimizer has made a copy of the node:
+ */
+static void vbo_copy_vertex_list( GLcontext *ctx, void *data )
+{
+   struct vbo_save_vertex_list *node = (struct vbo_save_vertex_list *)data;
+   (void) ctx;
+
+   node->vertex_store->refcount++;
+   node->prim_store->refcount++;
 }
 
 
@@ -1132,7 +1308,8 @@ void vbo_save_api_init( struct vbo_save_context *save )
 			  sizeof(struct vbo_save_vertex_list),
 			  vbo_save_playback_vertex_list,
 			  vbo_destroy_vertex_list,
-			  vbo_print_vertex_list );
+			  vbo_print_vertex_list,
+			  vbo_copy_vertex_list );
 
    ctx->Driver.NotifySaveBegin = vbo_save_NotifyBegin;
 
@@ -49,8 +49,10 @@ struct split_context {
 
    const struct split_limits *limits;
 
-   struct _mesa_prim dstprim[MAX_PRIM];
+   struct _mesa_prim *dstprim;
    GLuint dstprim_nr;
+   GLuint dstprim_max;
+   struct _mesa_prim dstprim_buf[MAX_PRIM];
 };
 
 
@@ -110,7 +112,7 @@ static void flush_vertex( struct split_context *split )
 
 static struct _mesa_prim *next_outprim( struct split_context *split )
 {
-   if (split->dstprim_nr == MAX_PRIM-1) {
+   if (split->dstprim_nr == split->dstprim_max-1) {
       flush_vertex(split);
    }
 
@@ -280,7 +282,24 @@ void vbo_split_inplace( GLcontext *ctx,
    split.draw = draw;
    split.limits = limits;
 
+   /* Display lists hand over long arrays of small primitives.  Don't
+    * break those up any more than the vertex limit requires.
+    */
+   split.dstprim = split.dstprim_buf;
+   split.dstprim_max = MAX_PRIM;
+   if (nr_prims + 1 > MAX_PRIM) {
+      struct _mesa_prim *dstprim = (struct _mesa_prim *)
+	 _mesa_malloc((nr_prims + 1) * sizeof(struct _mesa_prim));
+      if (dstprim) {
+	 split.dstprim = dstprim;
+	 split.dstprim_max = nr_prims + 1;
+      }
+   }
+
    split_prims( &split );
+
+   if (split.dstprim != split.dstprim_buf)
+      _mesa_free(split.dstprim);
 }
 
 
@@ -1,4 +1,4 @@
-#if defined(USE_X86_ASM) || defined(SLANG_X86)
+#if defined(USE_X86_ASM) || defined(USE_X86_64_ASM) || defined(SLANG_X86)
 
 #include "imports.h"
 #include "x86sse.h"
@@ -6,6 +6,14 @@
 #define DISASSEM 0
 #define X86_TWOB 0x0f
 
+/* Size of a push/pop stack slot:
+ */
+#if defined(USE_X86_64_ASM)
+#define X86_STACK_SLOT 8
+#else
+#define X86_STACK_SLOT 4
+#endif
+
 /* Emit bytes to the instruction stream:
  */
 static void emit_1b( struct x86_function *p, GLbyte b0 )
@@ -165,7 +173,10 @@ struct x86_reg x86_make_disp( struct x86_reg reg,
    else
       reg.disp += disp;
 
-   if (reg.disp == 0)
+   /* [ebp] with no displacement is how disp32-only (or rip-relative on
+    * x86-64) addressing is encoded, so always give ebp a displacement.
+    */
+   if (reg.disp == 0 && reg.idx != reg_BP)
       reg.mod = mod_INDIRECT;
    else if (reg.disp <= 127 && reg.disp >= -128)
       reg.mod = mod_DISP8;
@@ -258,6 +269,16 @@ void x86_call( struct x86_function *p, GLubyte *label)
    emit_1i(p, label - x86_get_label(p) - 4);
 }
 
+/* Call through a function pointer held in a register or in memory.
+ * Needed on x86-64 where C functions may be more than 2GB away from
+ * the generated code.
+ */
+void x86_call_indirect( struct x86_function *p, struct x86_reg target )
+{
+   emit_1ub(p, 0xff);
+   emit_modrm_noreg(p, 2, target);
+}
+
 /* michal:
  * Temporary. As I need immediate operands, and dont want to mess with the codegen,
  * I load the immediate into general purpose register and use it.
@@ -274,7 +295,7 @@ void x86_push( struct x86_function *p,
 {
    assert(reg.mod == mod_REG);
    emit_1ub(p, 0x50 + reg.idx);
-   p->stack_offset += 4;
+   p->stack_offset += X86_STACK_SLOT;
 }
 
 void x86_pop( struct x86_function *p,
@@ -282,21 +303,34 @@ void x86_pop( struct x86_function *p,
 {
    assert(reg.mod == mod_REG);
    emit_1ub(p, 0x58 + reg.idx);
-   p->stack_offset -= 4;
+   p->stack_offset -= X86_STACK_SLOT;
 }
 
+/* The one-byte inc/dec opcodes are REX prefixes in 64-bit mode, so use
+ * the modrm forms there.
+ */
 void x86_inc( struct x86_function *p,
 	      struct x86_reg reg )
 {
    assert(reg.mod == mod_REG);
+#if defined(USE_X86_64_ASM)
+   emit_1ub(p, 0xff);
+   emit_modrm_noreg(p, 0, reg);
+#else
    emit_1ub(p, 0x40 + reg.idx);
+#endif
 }
 
 void x86_dec( struct x86_function *p,
 	      struct x86_reg reg )
 {
    assert(reg.mod == mod_REG);
+#if defined(USE_X86_64_ASM)
+   emit_1ub(p, 0xff);
+   emit_modrm_noreg(p, 1, reg);
+#else
    emit_1ub(p, 0x48 + reg.idx);
+#endif
 }
 
 void x86_ret( struct x86_function *p )
@@ -316,6 +350,18 @@ void x86_mov( struct x86_function *p,
    emit_op_modrm( p, 0x8b, 0x89, dst, src );
 }
 
+#if defined(USE_X86_64_ASM)
+/* Pointer-sized (REX.W) move.  The other integer ops stay 32 bits wide.
+ */
+void x86_mov64( struct x86_function *p,
+		struct x86_reg dst,
+		struct x86_reg src )
+{
+   emit_1ub(p, 0x48);
+   emit_op_modrm( p, 0x8b, 0x89, dst, src );
+}
+#endif
+
 void x86_xor( struct x86_function *p,
 	      struct x86_reg dst,
 	      struct x86_reg src )
@@ -338,6 +384,16 @@ void x86_lea( struct x86_function *p,
    emit_modrm( p, dst, src );
 }
 
+#if defined(USE_X86_64_ASM)
+void x86_lea64( struct x86_function *p,
+		struct x86_reg dst,
+		struct x86_reg src )
+{
+   emit_1ub(p, 0x48);
+   x86_lea(p, dst, src);
+}
+#endif
+
 void x86_test( struct x86_function *p,
 	       struct x86_reg dst,
 	       struct x86_reg src )
@@ -502,6 +558,22 @@ void sse_addss( struct x86_function *p,
    emit_modrm( p, dst, src );
 }
 
+void sse_divps( struct x86_function *p,
+		struct x86_reg dst,
+		struct x86_reg src )
+{
+   emit_2ub(p, X86_TWOB, 0x5E);
+   emit_modrm( p, dst, src );
+}
+
+void sse_sqrtps( struct x86_function *p,
+		 struct x86_reg dst,
+		 struct x86_reg src )
+{
+   emit_2ub(p, X86_TWOB, 0x51);
+   emit_modrm( p, dst, src );
+}
+
 void sse_andps( struct x86_function *p,
 		struct x86_reg dst,
 		struct x86_reg src )
@@ -510,6 +582,30 @@ void sse_andps( struct x86_function *p,
    emit_modrm( p, dst, src );
 }
 
+void sse_andnps( struct x86_function *p,
+		 struct x86_reg dst,
+		 struct x86_reg src )
+{
+   emit_2ub(p, X86_TWOB, 0x55);
+   emit_modrm( p, dst, src );
+}
+
+void sse_orps( struct x86_function *p,
+	       struct x86_reg dst,
+	       struct x86_reg src )
+{
+   emit_2ub(p, X86_TWOB, 0x56);
+   emit_modrm( p, dst, src );
+}
+
+void sse_xorps( struct x86_function *p,
+		struct x86_reg dst,
+		struct x86_reg src )
+{
+   emit_2ub(p, X86_TWOB, 0x57);
+   emit_modrm( p, dst, src );
+}
+
 
 void sse_rsqrtss( struct x86_function *p,
 		  struct x86_reg dst,
@@ -601,6 +697,22 @@ void sse2_cvtps2dq( struct x86_function *p,
    emit_modrm( p, dst, src );
 }
 
+void sse2_cvttps2dq( struct x86_function *p,
+		     struct x86_reg dst,
+		     struct x86_reg src )
+{
+   emit_3ub(p, 0xF3, X86_TWOB, 0x5B);
+   emit_modrm( p, dst, src );
+}
+
+void sse2_cvtdq2ps( struct x86_function *p,
+		    struct x86_reg dst,
+		    struct x86_reg src )
+{
+   emit_2ub(p, X86_TWOB, 0x5B);
+   emit_modrm( p, dst, src );
+}
+
 void sse2_packssdw( struct x86_function *p,
 		    struct x86_reg dst,
 		    struct x86_reg src )
@@ -1058,8 +1170,19 @@ void mmx_movq( struct x86_function *p,
 struct x86_reg x86_fn_arg( struct x86_function *p,
 			   GLuint arg )
 {
+#if defined(USE_X86_64_ASM)
+   /* System V ABI: the first integer/pointer args are in rdi, rsi, rdx,
+    * rcx.  r8 and r9 would need REX prefixes which we don't emit.
+    */
+   static const enum x86_reg_name arg_regs[4] = {
+      reg_DI, reg_SI, reg_DX, reg_CX
+   };
+   assert(arg >= 1 && arg <= 4);
+   return x86_make_reg(file_REG32, arg_regs[arg - 1]);
+#else
    return x86_make_disp(x86_make_reg(file_REG32, reg_SP), 
 			p->stack_offset + arg * 4);	/* ??? */
+#endif
 }
 
 